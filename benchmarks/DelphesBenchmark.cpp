@@ -0,0 +1,512 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesBenchmark
+ *
+ *  Reproducible benchmarks of Delphes:
+ *
+ *  minbias - writes a synthetic minimum-bias pile-up file,
+ *  run - processes flat particle gun events through a configuration
+ *    and records the event rate and the per-module profile,
+ *  pileup - measures random-access reads of a pile-up file.
+ *
+ *  Results are appended as one JSON object per line.
+ *
+ */
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "TApplication.h"
+#include "TROOT.h"
+
+#include "TDatabasePDG.h"
+#include "TFile.h"
+#include "TLorentzVector.h"
+#include "TMath.h"
+#include "TObjArray.h"
+#include "TParticlePDG.h"
+#include "TRandom3.h"
+#include "TStopwatch.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+#include "classes/DelphesPileUpReader.h"
+#include "classes/DelphesPileUpWriter.h"
+#include "classes/DelphesProfiler.h"
+#include "modules/Delphes.h"
+
+#include "ExRootAnalysis/ExRootConfReader.h"
+#include "ExRootAnalysis/ExRootProgressBar.h"
+#include "ExRootAnalysis/ExRootTreeWriter.h"
+
+using namespace std;
+
+//---------------------------------------------------------------------------
+
+static bool interrupted = false;
+
+void SignalHandler(int sig)
+{
+  interrupted = true;
+}
+
+//---------------------------------------------------------------------------
+
+static const char *GetOption(int argc, char *argv[], int first, const char *name, const char *defaultValue)
+{
+  int i;
+
+  for(i = first; i < argc - 1; ++i)
+  {
+    if(strcmp(argv[i], name) == 0) return argv[i + 1];
+  }
+
+  return defaultValue;
+}
+
+//---------------------------------------------------------------------------
+
+static void WriteRecord(const char *fileName, const string &record)
+{
+  cout << record << endl;
+
+  if(!fileName) return;
+
+  ofstream output(fileName, ios::app);
+  if(!output)
+  {
+    stringstream message;
+    message << "can't open " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  output << record << endl;
+}
+
+//---------------------------------------------------------------------------
+
+// minimum-bias like spectrum: charged pions, kaons, protons and photons
+// from neutral pion decays, exponential pt, flat in |eta| < 5
+static void GenerateMinBias(TRandom3 &random, TDatabasePDG *pdg, DelphesPileUpWriter *writer, double multiplicity)
+{
+  static const int species[] = {211, 321, 2212, 22};
+  static const double fractions[] = {0.60, 0.72, 0.77, 1.0};
+  Int_t i, j, n, pid;
+  Double_t pt, eta, phi, mass, r;
+  TParticlePDG *pdgParticle;
+  TLorentzVector momentum;
+
+  n = random.Poisson(multiplicity);
+  for(i = 0; i < n; ++i)
+  {
+    r = random.Rndm();
+    for(j = 0; r > fractions[j]; ++j)
+      ;
+
+    pid = species[j];
+    if(pid != 22 && random.Rndm() < 0.5) pid = -pid;
+
+    pdgParticle = pdg->GetParticle(pid);
+    mass = pdgParticle ? pdgParticle->Mass() : 0.0;
+
+    pt = random.Exp(0.5);
+    eta = random.Uniform(-5.0, 5.0);
+    phi = random.Uniform(-TMath::Pi(), TMath::Pi());
+    momentum.SetPtEtaPhiM(pt, eta, phi, mass);
+
+    writer->WriteParticle(pid, 0.0, 0.0, 0.0, 0.0,
+      momentum.Px(), momentum.Py(), momentum.Pz(), momentum.E());
+  }
+
+  writer->WriteEntry();
+}
+
+//---------------------------------------------------------------------------
+
+// particles of the given types, flat in pt, eta and phi,
+// filled in the same way as the HepMC reader
+static void GenerateGun(TRandom3 &random, TDatabasePDG *pdg, DelphesFactory *factory,
+  TObjArray *allParticleOutputArray, TObjArray *stableParticleOutputArray,
+  const vector<Int_t> &gun, Int_t particles, Double_t ptMin, Double_t ptMax, Double_t etaMax)
+{
+  Int_t i, pid;
+  Double_t pt, eta, phi;
+  TParticlePDG *pdgParticle;
+  Candidate *candidate;
+
+  for(i = 0; i < particles; ++i)
+  {
+    pid = gun[random.Integer(gun.size())];
+
+    candidate = factory->NewCandidate();
+
+    candidate->PID = pid;
+    candidate->Status = 1;
+
+    candidate->M1 = -1;
+    candidate->M2 = -1;
+    candidate->D1 = -1;
+    candidate->D2 = -1;
+
+    pdgParticle = pdg->GetParticle(pid);
+    candidate->Charge = pdgParticle ? Int_t(pdgParticle->Charge() / 3.0) : -999;
+    candidate->Mass = pdgParticle ? pdgParticle->Mass() : -999.9;
+
+    pt = random.Uniform(ptMin, ptMax);
+    eta = random.Uniform(-etaMax, etaMax);
+    phi = random.Uniform(-TMath::Pi(), TMath::Pi());
+    candidate->Momentum.SetPtEtaPhiM(pt, eta, phi, pdgParticle ? pdgParticle->Mass() : 0.0);
+    candidate->Position.SetXYZT(0.0, 0.0, 0.0, 0.0);
+
+    allParticleOutputArray->Add(candidate);
+    stableParticleOutputArray->Add(candidate);
+  }
+}
+
+//---------------------------------------------------------------------------
+
+static int MinBias(int argc, char *argv[])
+{
+  DelphesPileUpWriter *writer = 0;
+  TDatabasePDG *pdg = TDatabasePDG::Instance();
+  Long64_t entry, events;
+  Double_t multiplicity;
+  UInt_t seed;
+
+  if(argc < 4)
+  {
+    cout << " Usage: DelphesBenchmark minbias output_file events"
+         << " [--multiplicity m] [--seed s]" << endl;
+    cout << " output_file - output binary pile-up file," << endl;
+    cout << " events - number of minimum-bias interactions," << endl;
+    cout << " m - mean number of particles per interaction (100)," << endl;
+    cout << " s - random seed (1)." << endl;
+    return 1;
+  }
+
+  events = atoll(argv[3]);
+  multiplicity = atof(GetOption(argc, argv, 4, "--multiplicity", "100"));
+  seed = atoi(GetOption(argc, argv, 4, "--seed", "1"));
+
+  if(events <= 0)
+  {
+    throw runtime_error("number of events must be positive");
+  }
+
+  TRandom3 random(seed);
+
+  writer = new DelphesPileUpWriter(argv[2]);
+
+  ExRootProgressBar progressBar(events);
+
+  for(entry = 0; entry < events && !interrupted; ++entry)
+  {
+    GenerateMinBias(random, pdg, writer, multiplicity);
+    progressBar.Update(entry);
+  }
+  progressBar.Update(events, events, kTRUE);
+  progressBar.Finish();
+
+  writer->WriteIndex();
+
+  delete writer;
+
+  return 0;
+}
+
+//---------------------------------------------------------------------------
+
+static int Run(int argc, char *argv[])
+{
+  stringstream record;
+  TFile *outputFile = 0;
+  TStopwatch genStopWatch, procStopWatch;
+  ExRootTreeWriter *treeWriter = 0;
+  ExRootConfReader *confReader = 0;
+  Delphes *modularDelphes = 0;
+  DelphesFactory *factory = 0;
+  DelphesProfiler *profiler = 0;
+  TObjArray *stableParticleOutputArray = 0, *allParticleOutputArray = 0;
+  TDatabasePDG *pdg = TDatabasePDG::Instance();
+  vector<Int_t> gun;
+  string pid;
+  Long64_t entry, events;
+  Int_t particles;
+  Double_t ptMin, ptMax, etaMax;
+  UInt_t seed;
+  const char *name, *jsonFileName;
+
+  if(argc < 5)
+  {
+    cout << " Usage: DelphesBenchmark run config_file output_file events"
+         << " [--gun pid,...] [--particles n] [--ptmin pt] [--ptmax pt] [--etamax eta]"
+         << " [--seed s] [--name name] [--json results_file]" << endl;
+    cout << " config_file - configuration file in Tcl format with set Profile true," << endl;
+    cout << " output_file - output file in ROOT format," << endl;
+    cout << " events - number of particle gun events," << endl;
+    cout << " pid,... - particle types (211,-211,22,11,-11,13,-13)," << endl;
+    cout << " n - particles per event (10), flat in pt (1-100 GeV), |eta| (2.5) and phi," << endl;
+    cout << " s - random seed (1), name - benchmark name (config_file)," << endl;
+    cout << " results_file - results appended as one JSON object per line." << endl;
+    return 1;
+  }
+
+  events = atoll(argv[4]);
+  stringstream gunList(GetOption(argc, argv, 5, "--gun", "211,-211,22,11,-11,13,-13"));
+  particles = atoi(GetOption(argc, argv, 5, "--particles", "10"));
+  ptMin = atof(GetOption(argc, argv, 5, "--ptmin", "1.0"));
+  ptMax = atof(GetOption(argc, argv, 5, "--ptmax", "100.0"));
+  etaMax = atof(GetOption(argc, argv, 5, "--etamax", "2.5"));
+  seed = atoi(GetOption(argc, argv, 5, "--seed", "1"));
+  name = GetOption(argc, argv, 5, "--name", argv[2]);
+  jsonFileName = GetOption(argc, argv, 5, "--json", 0);
+
+  while(getline(gunList, pid, ','))
+  {
+    if(!pid.empty()) gun.push_back(atoi(pid.c_str()));
+  }
+
+  if(events <= 0 || particles < 0 || gun.empty())
+  {
+    throw runtime_error("number of events and particle types must be positive");
+  }
+
+  TRandom3 random(seed);
+
+  try
+  {
+    outputFile = TFile::Open(argv[3], "RECREATE");
+
+    if(outputFile == NULL)
+    {
+      stringstream message;
+      message << "can't create output file " << argv[3];
+      throw runtime_error(message.str());
+    }
+
+    treeWriter = new ExRootTreeWriter(outputFile, "Delphes");
+
+    confReader = new ExRootConfReader;
+    confReader->ReadFile(argv[2]);
+
+    if(!confReader->GetBool("::Profile", false))
+    {
+      throw runtime_error("benchmark configuration must set Profile true");
+    }
+
+    modularDelphes = new Delphes("Delphes");
+    modularDelphes->SetConfReader(confReader);
+    modularDelphes->SetTreeWriter(treeWriter);
+
+    factory = modularDelphes->GetFactory();
+    allParticleOutputArray = modularDelphes->ExportArray("allParticles");
+    stableParticleOutputArray = modularDelphes->ExportArray("stableParticles");
+    modularDelphes->ExportArray("partons");
+
+    modularDelphes->InitTask();
+
+    ExRootProgressBar progressBar(events);
+
+    treeWriter->Clear();
+    modularDelphes->Clear();
+    genStopWatch.Reset();
+    procStopWatch.Reset();
+    for(entry = 0; entry < events && !interrupted; ++entry)
+    {
+      genStopWatch.Start(kFALSE);
+      GenerateGun(random, pdg, factory, allParticleOutputArray, stableParticleOutputArray,
+        gun, particles, ptMin, ptMax, etaMax);
+      genStopWatch.Stop();
+
+      procStopWatch.Start(kFALSE);
+      modularDelphes->ProcessTask();
+      procStopWatch.Stop();
+
+      treeWriter->Fill();
+
+      treeWriter->Clear();
+      modularDelphes->Clear();
+
+      progressBar.Update(entry);
+    }
+    progressBar.Update(entry, entry, kTRUE);
+    progressBar.Finish();
+
+    // the profiler is deleted by FinishTask
+    profiler = modularDelphes->GetProfiler();
+
+    record << "{\"benchmark\":\"" << name << "\",\"config\":\"" << argv[2] << "\"";
+    record << ",\"events\":" << entry << ",\"particles\":" << particles;
+    record << ",\"pileup\":" << confReader->GetDouble("PileUpMerger::MeanPileUp", 0.0);
+    record << ",\"threads\":" << confReader->GetInt("::NumberOfThreads", 0);
+    record << ",\"seed\":" << seed;
+    record << ",\"generation_s\":" << genStopWatch.RealTime();
+    record << ",\"processing_s\":" << procStopWatch.RealTime();
+    record << ",\"processing_cpu_s\":" << procStopWatch.CpuTime();
+    record << ",\"events_per_second\":" << (procStopWatch.RealTime() > 0.0 ? entry / procStopWatch.RealTime() : 0.0);
+    record << ",\"modules\":";
+    if(profiler)
+    {
+      profiler->WriteJSON(record);
+    }
+    else
+    {
+      record << "{}";
+    }
+    record << "}";
+
+    WriteRecord(jsonFileName, record.str());
+
+    modularDelphes->FinishTask();
+    treeWriter->Write();
+
+    delete modularDelphes;
+    delete confReader;
+    delete treeWriter;
+    delete outputFile;
+
+    return 0;
+  }
+  catch(runtime_error &e)
+  {
+    if(treeWriter) delete treeWriter;
+    if(outputFile) delete outputFile;
+    throw;
+  }
+}
+
+//---------------------------------------------------------------------------
+
+static int PileUp(int argc, char *argv[])
+{
+  stringstream record;
+  DelphesPileUpReader *reader = 0;
+  TStopwatch readStopWatch;
+  Long64_t i, reads, entries, particles;
+  Int_t pid;
+  Float_t x, y, z, t, px, py, pz, e;
+  UInt_t seed;
+  const char *jsonFileName;
+
+  if(argc < 4)
+  {
+    cout << " Usage: DelphesBenchmark pileup input_file reads"
+         << " [--seed s] [--json results_file]" << endl;
+    cout << " input_file - input binary pile-up file," << endl;
+    cout << " reads - number of randomly chosen entries to read," << endl;
+    cout << " s - random seed (1)," << endl;
+    cout << " results_file - results appended as one JSON object per line." << endl;
+    return 1;
+  }
+
+  reads = atoll(argv[3]);
+  seed = atoi(GetOption(argc, argv, 4, "--seed", "1"));
+  jsonFileName = GetOption(argc, argv, 4, "--json", 0);
+
+  if(reads <= 0)
+  {
+    throw runtime_error("number of reads must be positive");
+  }
+
+  TRandom3 random(seed);
+
+  reader = new DelphesPileUpReader(argv[2]);
+  entries = reader->GetEntries();
+
+  if(entries <= 0)
+  {
+    delete reader;
+    throw runtime_error("pile-up file is empty");
+  }
+
+  // same access pattern as PileUpMerger
+  particles = 0;
+  readStopWatch.Start();
+  for(i = 0; i < reads && !interrupted; ++i)
+  {
+    reader->ReadEntry(random.Integer(entries));
+    while(reader->ReadParticle(pid, x, y, z, t, px, py, pz, e))
+    {
+      ++particles;
+    }
+  }
+  readStopWatch.Stop();
+
+  record << "{\"benchmark\":\"DelphesPileUpReader\",\"input\":\"" << argv[2] << "\"";
+  record << ",\"entries\":" << entries << ",\"reads\":" << i << ",\"particles\":" << particles;
+  record << ",\"seed\":" << seed;
+  record << ",\"read_s\":" << readStopWatch.RealTime();
+  record << ",\"entries_per_second\":" << (readStopWatch.RealTime() > 0.0 ? i / readStopWatch.RealTime() : 0.0);
+  record << ",\"particles_per_second\":" << (readStopWatch.RealTime() > 0.0 ? particles / readStopWatch.RealTime() : 0.0);
+  record << "}";
+
+  WriteRecord(jsonFileName, record.str());
+
+  delete reader;
+
+  return 0;
+}
+
+//---------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "DelphesBenchmark";
+
+  if(argc < 2)
+  {
+    cout << " Usage: " << appName << " minbias|run|pileup [arguments]" << endl;
+    cout << " minbias - write a synthetic minimum-bias pile-up file," << endl;
+    cout << " run - process particle gun events and record the module profile," << endl;
+    cout << " pileup - measure random-access reads of a pile-up file," << endl;
+    cout << " run a command without arguments for its usage." << endl;
+    return 1;
+  }
+
+  signal(SIGINT, SignalHandler);
+
+  gROOT->SetBatch();
+
+  int appargc = 1;
+  char *appargv[] = {appName};
+  TApplication app(appName, &appargc, appargv);
+
+  try
+  {
+    if(strcmp(argv[1], "minbias") == 0) return MinBias(argc, argv);
+    if(strcmp(argv[1], "run") == 0) return Run(argc, argv);
+    if(strcmp(argv[1], "pileup") == 0) return PileUp(argc, argv);
+
+    stringstream message;
+    message << "unknown command " << argv[1];
+    throw runtime_error(message.str());
+  }
+  catch(runtime_error &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+}
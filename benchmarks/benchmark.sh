@@ -0,0 +1,79 @@
+#!/bin/bash
+################################################################################
+#
+# This code runs a reproducible set of Delphes benchmarks and appends the
+# results to a file with one JSON object per line.
+#
+# Execute from Delphes main dir after building DelphesBenchmark:
+#
+# ./benchmarks/benchmark.sh [number_of_events] [results_file]
+#
+#  e.g.
+#
+# ./benchmarks/benchmark.sh 100 benchmark_results.jsonl
+#
+# The benchmarks are:
+#
+# - random-access reads of a synthetic minimum-bias pile-up file,
+# - per-module timings (Calorimeter, RunPUPPI, VertexFinderDA4D,
+#   FastJetFinder, Isolation, TreeWriter) of benchmarks/cards/benchmark_modules.tcl,
+# - end-to-end event rate of cards/papu/papu_CMS_PhaseII_HGCal.tcl,
+#
+# with particle gun events overlaid with 0, 50, 140 and 200 pile-up interactions.
+# All random seeds are fixed, so repeated runs process identical events.
+#
+################################################################################
+
+EXPECTED_ARGS=2
+E_BADARGS=65
+
+if [ $# -ne $EXPECTED_ARGS ]
+then
+  echo "Usage: ./benchmarks/benchmark.sh [number_of_events] [results_file]"
+  echo "for instance: ./benchmarks/benchmark.sh 100 benchmark_results.jsonl"
+  exit $E_BADARGS
+fi
+
+nEvents=$1
+results=$2
+seed=1
+pileUpValues="0 50 140 200"
+minBiasEvents=10000
+minBiasMultiplicity=100
+
+workdir=benchmarks/work
+pileupfile=$workdir/MinBias.pileup
+
+mkdir -p $workdir
+
+echo "** Generating $minBiasEvents synthetic minimum-bias interactions"
+./DelphesBenchmark minbias $pileupfile $minBiasEvents --multiplicity $minBiasMultiplicity --seed $seed || exit 1
+
+./DelphesBenchmark pileup $pileupfile 10000 --seed $seed --json $results || exit 1
+
+function runBenchmark {
+  name=$1
+  inputcard=$2
+  pileup=$3
+  # the edited card is written next to the original one,
+  # the files it sources are looked up in the directory of the card
+  card=$(dirname $inputcard)/benchmark_${name}_PU${pileup}.tcl
+  sed "/set RandomSeed/s|RandomSeed.*|RandomSeed $seed|; /set PileUpFile/s|PileUpFile.*|PileUpFile $pileupfile|; /set MeanPileUp/s|MeanPileUp.*|MeanPileUp $pileup|" $inputcard > $card
+  grep -q "^set Profile" $card || sed -i "1i set Profile true" $card
+  ./DelphesBenchmark run $card $workdir/${name}_PU${pileup}.root $nEvents --seed $seed --name ${name}_PU${pileup} --json $results
+  status=$?
+  rm -f $card
+  [ $status -eq 0 ] || exit 1
+}
+
+for pileup in $pileUpValues
+do
+  runBenchmark modules benchmarks/cards/benchmark_modules.tcl $pileup
+done
+
+for pileup in $pileUpValues
+do
+  runBenchmark papu cards/papu/papu_CMS_PhaseII_HGCal.tcl $pileup
+done
+
+echo "** Results appended to $results"
@@ -0,0 +1,326 @@
+#######################################
+# Module micro-benchmarks
+#
+# Minimal chain timing Calorimeter, RunPUPPI, VertexFinderDA4D,
+# FastJetFinder, Isolation and TreeWriter with the per-module profiler,
+# see benchmarks/benchmark.sh
+#######################################
+
+set RandomSeed 1
+set MaxEvents 100
+
+set Profile true
+
+set ExecutionPath {
+  BeamSpotFilter
+  PileUpMerger
+  ParticlePropagator
+
+  TrackMerger
+  TrackSmearing
+  TimeSmearing
+  VertexFinderDA4D
+
+  Calorimeter
+  NeutralEFlowMerger
+  EFlowMerger
+
+  RunPUPPI
+
+  PhotonIsolation
+  FastJetFinder
+
+  TreeWriter
+}
+
+#################
+# Beam spot
+#################
+
+module BeamSpotFilter BeamSpotFilter {
+  set InputArray Delphes/stableParticles
+  set OutputArray beamSpotParticle
+}
+
+###############
+# PileUp Merger
+###############
+
+module PileUpMerger PileUpMerger {
+  set InputArray Delphes/stableParticles
+
+  set ParticleOutputArray stableParticles
+  set VertexOutputArray vertices
+
+  # pre-generated minbias input file
+  set PileUpFile MinBias.pileup
+
+  # average expected pile up
+  set MeanPileUp 140
+
+  # maximum spread in the beam direction in m
+  set ZVertexSpread 0.25
+
+  # maximum spread in time in s
+  set TVertexSpread 800E-12
+
+  # vertex smearing formula f(z,t) (z,t need to be respectively given in m,s)
+  set VertexDistributionFormula {exp(-(t^2/160e-12^2/2))*exp(-(z^2/0.053^2/2))}
+}
+
+#################################
+# Propagate particles in cylinder
+#################################
+
+module ParticlePropagator ParticlePropagator {
+  set InputArray PileUpMerger/stableParticles
+
+  set OutputArray stableParticles
+  set ChargedHadronOutputArray chargedHadrons
+  set ElectronOutputArray electrons
+  set MuonOutputArray muons
+
+  # radius of the magnetic field coverage, in m
+  set Radius 1.29
+  # half-length of the magnetic field coverage, in m
+  set HalfLength 3.00
+
+  # magnetic field
+  set Bz 3.8
+}
+
+##############
+# Track merger
+##############
+
+module Merger TrackMerger {
+# add InputArray InputArray
+  add InputArray ParticlePropagator/chargedHadrons
+  add InputArray ParticlePropagator/electrons
+  add InputArray ParticlePropagator/muons
+  set OutputArray tracks
+}
+
+################
+# Track smearing
+################
+
+module TrackSmearing TrackSmearing {
+  set InputArray TrackMerger/tracks
+  set BeamSpotInputArray BeamSpotFilter/beamSpotParticle
+  set OutputArray tracks
+  set ApplyToPileUp true
+
+  set Bz 3.8
+
+  # resolutions in mm and rad
+  set D0ResolutionFormula {0.01 + 0.02/pt}
+  set DZResolutionFormula {0.02 + 0.04/pt}
+  set PResolutionFormula {0.01}
+  set CtgThetaResolutionFormula {0.001}
+  set PhiResolutionFormula {0.001}
+}
+
+###############
+# Time smearing
+###############
+
+module TimeSmearing TimeSmearing {
+  set InputArray TrackSmearing/tracks
+  set OutputArray tracks
+
+  # assume constant 30 ps resolution for now
+  set TimeResolution 30E-12
+}
+
+##################################
+# Primary vertex reconstruction 4D
+##################################
+
+module VertexFinderDA4D VertexFinderDA4D {
+  set InputArray TimeSmearing/tracks
+
+  set OutputArray tracks
+  set VertexOutputArray vertices
+
+  set Verbose 0
+
+  set MinPT 1.0
+
+  set VertexSpaceSize 0.5
+  set VertexTimeSize 10E-12
+
+  set UseTc 1
+  set BetaMax 0.1
+  set BetaStop 1.0
+  set CoolingFactor 0.8
+  set MaxIterations 100
+
+  set DzCutOff 40
+  set D0CutOff 30
+}
+
+#############
+# Calorimeter
+#############
+
+module Calorimeter Calorimeter {
+  set ParticleInputArray ParticlePropagator/stableParticles
+  set TrackInputArray TrackMerger/tracks
+
+  set TowerOutputArray towers
+  set PhotonOutputArray photons
+
+  set EFlowTrackOutputArray eflowTracks
+  set EFlowPhotonOutputArray eflowPhotons
+  set EFlowNeutralHadronOutputArray eflowNeutralHadrons
+
+  set ECalEnergyMin 0.5
+  set HCalEnergyMin 1.0
+
+  set ECalEnergySignificanceMin 1.0
+  set HCalEnergySignificanceMin 1.0
+
+  set SmearTowerCenter true
+
+  set pi [expr {acos(-1)}]
+
+  # 5 degrees towers
+  set PhiBins {}
+  for {set i -36} {$i <= 36} {incr i} {
+    add PhiBins [expr {$i * $pi/36.0}]
+  }
+  for {set i -30} {$i <= 30} {incr i} {
+    add EtaPhiBins [expr {$i * 0.1}] $PhiBins
+  }
+
+  # 10 degrees towers
+  set PhiBins {}
+  for {set i -18} {$i <= 18} {incr i} {
+    add PhiBins [expr {$i * $pi/18.0}]
+  }
+  foreach eta {-5.0 -4.5 -4.0 -3.5 3.5 4.0 4.5 5.0} {
+    add EtaPhiBins $eta $PhiBins
+  }
+
+  # default energy fractions {abs(PDG code)} {Fecal Fhcal}
+  add EnergyFraction {0} {0.0 1.0}
+  # energy fractions for e, gamma and pi0
+  add EnergyFraction {11} {1.0 0.0}
+  add EnergyFraction {22} {1.0 0.0}
+  add EnergyFraction {111} {1.0 0.0}
+  # energy fractions for muon and neutrinos
+  add EnergyFraction {12} {0.0 0.0}
+  add EnergyFraction {13} {0.0 0.0}
+  add EnergyFraction {14} {0.0 0.0}
+  add EnergyFraction {16} {0.0 0.0}
+  # energy fractions for K0short and Lambda
+  add EnergyFraction {310} {0.3 0.7}
+  add EnergyFraction {3122} {0.3 0.7}
+
+  set ECalResolutionFormula {                (abs(eta) <= 3.0) * sqrt(energy^2*0.007^2 + energy*0.07^2 + 0.35^2) +
+                             (abs(eta) > 3.0 && abs(eta) <= 5.0) * sqrt(energy^2*0.107^2 + energy*2.08^2)}
+
+  set HCalResolutionFormula {                (abs(eta) <= 3.0) * sqrt(energy^2*0.050^2 + energy*1.50^2) +
+                             (abs(eta) > 3.0 && abs(eta) <= 5.0) * sqrt(energy^2*0.130^2 + energy*2.70^2)}
+}
+
+####################
+# Energy flow merger
+####################
+
+module Merger NeutralEFlowMerger {
+# add InputArray InputArray
+  add InputArray Calorimeter/eflowPhotons
+  add InputArray Calorimeter/eflowNeutralHadrons
+  set OutputArray eflowTowers
+}
+
+module Merger EFlowMerger {
+# add InputArray InputArray
+  add InputArray Calorimeter/eflowTracks
+  add InputArray Calorimeter/eflowPhotons
+  add InputArray Calorimeter/eflowNeutralHadrons
+  set OutputArray eflow
+}
+
+#########
+# PUPPI
+#########
+
+module RunPUPPI RunPUPPI {
+  ## input information
+  set TrackInputArray   Calorimeter/eflowTracks
+  set NeutralInputArray NeutralEFlowMerger/eflowTowers
+  set PVInputArray      PileUpMerger/vertices
+  set MinPuppiWeight    0.05
+  set UseExp            false
+  set UseNoLep          false
+
+  ## define puppi algorithm parameters (more than one for the same eta region is possible)
+  add EtaMinBin           0.0   1.5   4.0
+  add EtaMaxBin           1.5   4.0   10.0
+  add PtMinBin            0.0   0.0   0.0
+  add ConeSizeBin         0.2   0.2   0.2
+  add RMSPtMinBin         0.1   0.5   0.5
+  add RMSScaleFactorBin   1.0   1.0   1.0
+  add NeutralMinEBin      0.2   0.2   0.5
+  add NeutralPtSlope      0.006 0.013 0.067
+  add ApplyCHS            true  true  true
+  add UseCharged          true  true  false
+  add ApplyLowPUCorr      true  true  true
+  add MetricId            5     5     5
+  add CombId              0     0     0
+
+  ## output name
+  set OutputArray         PuppiParticles
+  set OutputArrayTracks   puppiTracks
+  set OutputArrayNeutrals puppiNeutrals
+}
+
+###################
+# Photon isolation
+###################
+
+module Isolation PhotonIsolation {
+  set CandidateInputArray Calorimeter/eflowPhotons
+  set IsolationInputArray EFlowMerger/eflow
+
+  set OutputArray photons
+
+  set DeltaRMax 0.3
+
+  set PTMin 0.5
+
+  set PTRatioMax 0.12
+}
+
+############
+# Jet finder
+############
+
+module FastJetFinder FastJetFinder {
+  set InputArray RunPUPPI/PuppiParticles
+
+  set OutputArray jets
+
+  # algorithm: 1 CDFJetClu, 2 MidPoint, 3 SIScone, 4 kt, 5 Cambridge/Aachen, 6 antikt
+  set JetAlgorithm 6
+  set ParameterR 0.4
+
+  set JetPTMin 20.0
+}
+
+##################
+# ROOT tree writer
+##################
+
+module TreeWriter TreeWriter {
+# add Branch InputArray BranchName BranchClass
+  add Branch PileUpMerger/vertices GenVertex Vertex
+  add Branch VertexFinderDA4D/vertices Vertex4D Vertex
+  add Branch Calorimeter/towers Tower Tower
+  add Branch RunPUPPI/PuppiParticles ParticleFlowCandidate ParticleFlowCandidate
+  add Branch PhotonIsolation/photons Photon Photon
+  add Branch FastJetFinder/jets Jet Jet
+}
@@ -162,6 +162,15 @@ module TrackCovariance TrackSmearing {
     set InputArray TrackMergerPre/tracks
     set OutputArray tracks
 
+    ## the covariance grid is computed once per geometry and cached in
+    ## CovarianceCacheDirectory (default is the system temporary directory)
+    # set UseCovarianceCache true
+    # set CovarianceCacheDirectory /tmp
+
+    ## optional grid points in pt (GeV) and polar angle (degrees), they set the interpolation accuracy
+    # set PtGrid {0.1 0.2 0.5 0.7 1. 2. 3. 4. 6. 8. 10. 15. 20. 25. 30. 40. 50. 60. 80. 100. 150. 200.}
+    # set AngleGrid {10. 15. 20. 25. 30. 35. 40. 45. 50. 60. 70. 80. 90.}
+
     ## uses https://raw.githubusercontent.com/selvaggi/FastTrackCovariance/master/GeoIDEA_BASE.txt
     set DetectorGeometry {
 
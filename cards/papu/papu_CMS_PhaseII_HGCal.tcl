@@ -1082,6 +1082,28 @@ module PidFilter ZFilter {
 }
 
 
+###################
+# Papu tensor writer
+###################
+
+# add PapuWriter to the ExecutionPath to write the training tensors
+# and drop the ParticleFlowCandidate branch from the TreeWriter
+
+module PapuWriter PapuWriter {
+  set InputArray RunPUPPI/PuppiParticles
+  set VertexInputArray VertexFinder/vertices
+  set GenParticleInputArray PileUpMerger/stableParticles
+  set GenMissingETInputArray GenMissingET/momentum
+  set GenJetInputArray GenJetFinder/jets
+
+  set OutputFile papu_XXX.npz
+
+  set MaxParticles 9000
+  set ClusterK 4
+  set ClusterSize 10
+}
+
+
 ##################
 # ROOT tree writer
 ##################
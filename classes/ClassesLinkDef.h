@@ -30,6 +30,7 @@
 
 #include "classes/SortableObject.h"
 #include "classes/DelphesClasses.h"
+#include "classes/DelphesColumnReader.h"
 
 #ifdef __CINT__
 
@@ -64,5 +65,7 @@
 
 #pragma link C++ class Candidate+;
 
+#pragma link C++ class DelphesColumnReader+;
+
 #endif
 
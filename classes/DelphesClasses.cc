@@ -43,6 +43,8 @@ CompBase *HectorHit::fgCompare = CompE<HectorHit>::Instance();
 CompBase *Vertex::fgCompare = CompSumPT2<Vertex>::Instance();
 CompBase *Candidate::fgCompare = CompMomentumPt<Candidate>::Instance();
 
+Bool_t Candidate::fgCacheKinematics = kTRUE;
+
 //------------------------------------------------------------------------------
 
 TLorentzVector GenParticle::P4() const
@@ -175,7 +177,8 @@ Candidate::Candidate() :
   ExclYmerge56(0),
   ParticleDensity(0),
   fFactory(0),
-  fArray(0)
+  fArray(0),
+  fMomentumCached(kFALSE), fPositionCached(kFALSE)
 {
   int i;
   Edges[0] = 0.0;
@@ -207,6 +210,31 @@ Candidate::Candidate() :
 
 //------------------------------------------------------------------------------
 
+void Candidate::CacheMomentum() const
+{
+  fMomentumKey[0] = Momentum.Px();
+  fMomentumKey[1] = Momentum.Py();
+  fMomentumKey[2] = Momentum.Pz();
+  fMomentumPt = Momentum.Pt();
+  fMomentumEta = Momentum.Eta();
+  fMomentumPhi = Momentum.Phi();
+  fMomentumCached = kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
+void Candidate::CachePosition() const
+{
+  fPositionKey[0] = Position.X();
+  fPositionKey[1] = Position.Y();
+  fPositionKey[2] = Position.Z();
+  fPositionEta = Position.Eta();
+  fPositionPhi = Position.Phi();
+  fPositionCached = kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
 void Candidate::AddCandidate(Candidate *object)
 {
   if(!fArray) fArray = fFactory->NewArray();
@@ -265,6 +293,7 @@ void Candidate::Copy(TObject &obj) const
 {
   Candidate &object = static_cast<Candidate &>(obj);
   Candidate *candidate;
+  int i;
 
   object.PID = PID;
   object.Status = Status;
@@ -306,6 +335,18 @@ void Candidate::Copy(TObject &obj) const
   object.Position = Position;
   object.InitialPosition = InitialPosition;
   object.PositionError = PositionError;
+  object.fMomentumCached = fMomentumCached;
+  object.fPositionCached = fPositionCached;
+  for(i = 0; i < 3; ++i)
+  {
+    object.fMomentumKey[i] = fMomentumKey[i];
+    object.fPositionKey[i] = fPositionKey[i];
+  }
+  object.fMomentumPt = fMomentumPt;
+  object.fMomentumEta = fMomentumEta;
+  object.fMomentumPhi = fMomentumPhi;
+  object.fPositionEta = fPositionEta;
+  object.fPositionPhi = fPositionPhi;
   object.Area = Area;
   object.L = L;
   object.ErrorT = ErrorT;
@@ -438,6 +479,8 @@ void Candidate::Clear(Option_t *option)
   Position.SetXYZT(0.0, 0.0, 0.0, 0.0);
   InitialPosition.SetXYZT(0.0, 0.0, 0.0, 0.0);
   Area.SetXYZT(0.0, 0.0, 0.0, 0.0);
+  fMomentumCached = kFALSE;
+  fPositionCached = kFALSE;
   L = 0.0;
   ErrorT = 0.0;
   D0 = 0.0;
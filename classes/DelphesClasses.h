@@ -763,6 +763,18 @@ public:
 
   Bool_t Overlaps(const Candidate *object) const;
 
+  // cached Momentum.Pt(), Eta(), Phi() and Position.Eta(), Phi(),
+  // computed on first use and again only after Momentum or Position change
+  Double_t MomentumPt() const { if(!fgCacheKinematics) return Momentum.Pt(); if(!MomentumCached()) CacheMomentum(); return fMomentumPt; }
+  Double_t MomentumEta() const { if(!fgCacheKinematics) return Momentum.Eta(); if(!MomentumCached()) CacheMomentum(); return fMomentumEta; }
+  Double_t MomentumPhi() const { if(!fgCacheKinematics) return Momentum.Phi(); if(!MomentumCached()) CacheMomentum(); return fMomentumPhi; }
+  Double_t PositionEta() const { if(!fgCacheKinematics) return Position.Eta(); if(!PositionCached()) CachePosition(); return fPositionEta; }
+  Double_t PositionPhi() const { if(!fgCacheKinematics) return Position.Phi(); if(!PositionCached()) CachePosition(); return fPositionPhi; }
+
+  // the cache is written by const accessors, it must be disabled
+  // when modules reading the same candidates run concurrently
+  static void SetKinematicsCache(Bool_t enable) { fgCacheKinematics = enable; }
+
   virtual void Copy(TObject &object) const;
   virtual TObject *Clone(const char *newname = "") const;
   virtual void Clear(Option_t *option = "");
@@ -773,6 +785,25 @@ private:
 
   void SetFactory(DelphesFactory *factory) { fFactory = factory; }
 
+  // the cache is keyed by the components it was computed from
+  Bool_t MomentumCached() const
+  {
+    return fMomentumCached && Momentum.Px() == fMomentumKey[0] && Momentum.Py() == fMomentumKey[1] && Momentum.Pz() == fMomentumKey[2];
+  }
+  Bool_t PositionCached() const
+  {
+    return fPositionCached && Position.X() == fPositionKey[0] && Position.Y() == fPositionKey[1] && Position.Z() == fPositionKey[2];
+  }
+  void CacheMomentum() const;
+  void CachePosition() const;
+
+  mutable Bool_t fMomentumCached, fPositionCached; //!
+  mutable Double_t fMomentumKey[3], fPositionKey[3]; //!
+  mutable Double_t fMomentumPt, fMomentumEta, fMomentumPhi; //!
+  mutable Double_t fPositionEta, fPositionPhi; //!
+
+  static Bool_t fgCacheKinematics; //!
+
   ClassDef(Candidate, 6)
 };
 
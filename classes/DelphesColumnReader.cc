@@ -0,0 +1,539 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesColumnReader
+ *
+ *  Reads selected numeric fields of Delphes tree branches for a range of
+ *  entries into contiguous arrays, one per field. The objects of the i-th
+ *  entry read are at [offsets[i], offsets[i + 1]) of the arrays of their
+ *  branch. Floating point fields are read into GetColumn, integer fields
+ *  into GetIntegerColumn, unsigned 64 bit fields keep their bit pattern.
+ *
+ *  Branches written with the flat layout of TreeWriter are read directly
+ *  from their <branch>_size and <branch>_<field> leaves. For the other
+ *  branches, only the leaves of the selected fields of the TClonesArray
+ *  are read.
+ *
+ */
+
+#include "classes/DelphesColumnReader.h"
+
+#include "ExRootAnalysis/ExRootTreeReader.h"
+
+#include "TBranch.h"
+#include "TClass.h"
+#include "TClonesArray.h"
+#include "TDataMember.h"
+#include "TDataType.h"
+#include "TLeaf.h"
+#include "TROOT.h"
+#include "TRealData.h"
+#include "TTree.h"
+
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+// appends the values of type T at the given offset of the objects of array,
+// or of the array of type T in buffer when array is NULL
+template <typename T, typename S>
+static void AppendValues(vector<S> &values, TClonesArray *array, const char *buffer, Int_t size, Int_t offset)
+{
+  Int_t i;
+  const char *object;
+
+  if(array)
+  {
+    for(i = 0; i < size; ++i)
+    {
+      object = reinterpret_cast<const char *>(array->UncheckedAt(i));
+      values.push_back(S(*reinterpret_cast<const T *>(object + offset)));
+    }
+  }
+  else
+  {
+    for(i = 0; i < size; ++i)
+    {
+      values.push_back(S(reinterpret_cast<const T *>(buffer)[i]));
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+static bool IsNumeric(Int_t type)
+{
+  switch(type)
+  {
+    case kFloat_t:
+    case kFloat16_t:
+    case kDouble_t:
+    case kDouble32_t:
+      return true;
+    default:
+      return DelphesColumnReader::IsIntegerType(type);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesColumnReader::IsIntegerType(Int_t type)
+{
+  switch(type)
+  {
+    case kInt_t:
+    case kUInt_t:
+    case kShort_t:
+    case kUShort_t:
+    case kChar_t:
+    case kUChar_t:
+    case kBool_t:
+    case kLong_t:
+    case kULong_t:
+    case kLong64_t:
+    case kULong64_t:
+      return kTRUE;
+    default:
+      return kFALSE;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesColumnReader::DelphesColumnReader(TTree *tree) :
+  fTree(tree), fTreeReader(0), fLeavesSelected(kFALSE), fCacheSelected(kFALSE)
+{
+  fTreeReader = new ExRootTreeReader(fTree);
+}
+
+//------------------------------------------------------------------------------
+
+DelphesColumnReader::~DelphesColumnReader()
+{
+  vector<Branch *>::iterator itBranch;
+  vector<Column *>::iterator itColumn;
+
+  for(itBranch = fBranches.begin(); itBranch != fBranches.end(); ++itBranch)
+  {
+    for(itColumn = (*itBranch)->columns.begin(); itColumn != (*itBranch)->columns.end(); ++itColumn)
+    {
+      delete *itColumn;
+    }
+    delete *itBranch;
+  }
+
+  delete fTreeReader;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesColumnReader::AddColumn(const char *branchName, const char *fieldName)
+{
+  stringstream message;
+  vector<Column *>::iterator itColumn;
+  Branch *branch;
+  Column *column;
+  TClonesArray *array = 0;
+  TRealData *data;
+  TDataMember *member;
+  TDataType *type;
+  TBranch *leafBranch;
+  TLeaf *leaf;
+  TString leafName;
+  Bool_t flat;
+  Int_t offset = 0;
+
+  if(!fTree)
+  {
+    throw runtime_error("no tree to read the columns from");
+  }
+
+  branch = FindBranch(branchName);
+  if(!branch)
+  {
+    // the flat layout has a <branch>_size counter but no <branch> branch
+    flat = !fTree->GetBranch(branchName) && fTree->GetBranch(TString::Format("%s_size", branchName));
+    if(!flat)
+    {
+      array = fTreeReader->UseBranch(branchName);
+      if(!array)
+      {
+        message << "can't find branch " << branchName;
+        throw runtime_error(message.str());
+      }
+    }
+
+    branch = new Branch;
+    branch->name = branchName;
+    branch->array = array;
+    branch->offsets.push_back(0);
+    branch->flat = flat;
+    branch->counter = 0;
+    branch->size = 0;
+    fBranches.push_back(branch);
+  }
+
+  for(itColumn = branch->columns.begin(); itColumn != branch->columns.end(); ++itColumn)
+  {
+    if((*itColumn)->name == fieldName) return;
+  }
+
+  if(branch->flat)
+  {
+    leafName.Form("%s_%s", branchName, fieldName);
+    leafBranch = fTree->GetBranch(leafName);
+    leaf = leafBranch ? leafBranch->GetLeaf(leafName) : 0;
+    if(!leaf)
+    {
+      message << "can't find field " << fieldName << " in branch " << branchName;
+      throw runtime_error(message.str());
+    }
+
+    type = gROOT->GetType(leaf->GetTypeName());
+    if(!type || !IsNumeric(type->GetType()))
+    {
+      message << "field " << fieldName << " of branch " << branchName << " is not a number";
+      throw runtime_error(message.str());
+    }
+  }
+  else
+  {
+    data = branch->array->GetClass()->GetRealData(fieldName);
+    if(!data)
+    {
+      message << "can't find field " << fieldName << " in branch " << branchName;
+      throw runtime_error(message.str());
+    }
+
+    member = data->GetDataMember();
+    type = member->GetDataType();
+    if(!member->IsBasic() || member->GetArrayDim() > 0 || !type || !IsNumeric(type->GetType()))
+    {
+      message << "field " << fieldName << " of branch " << branchName << " is not a number";
+      throw runtime_error(message.str());
+    }
+
+    offset = data->GetThisOffset();
+  }
+
+  column = new Column;
+  column->name = fieldName;
+  column->offset = offset;
+  column->type = type->GetType();
+  column->width = type->Size();
+  column->branch = 0;
+  branch->columns.push_back(column);
+
+  fLeavesSelected = kFALSE;
+  fCacheSelected = kFALSE;
+}
+
+//------------------------------------------------------------------------------
+
+Long64_t DelphesColumnReader::GetEntries() const
+{
+  return fTreeReader->GetEntries();
+}
+
+//------------------------------------------------------------------------------
+
+Long64_t DelphesColumnReader::ReadEntries(Long64_t first, Long64_t size)
+{
+  vector<Branch *>::iterator itBranch;
+  vector<Column *>::iterator itColumn;
+  Branch *branch;
+  Long64_t entry, last, treeEntry, entries = GetEntries();
+  Int_t objects;
+
+  if(!fLeavesSelected)
+  {
+    SelectLeaves();
+    fLeavesSelected = kTRUE;
+  }
+
+  last = (size < 0 || first + size > entries) ? entries : first + size;
+
+  // keep the capacity of the arrays from one call to the next
+  for(itBranch = fBranches.begin(); itBranch != fBranches.end(); ++itBranch)
+  {
+    branch = *itBranch;
+    branch->offsets.clear();
+    branch->offsets.push_back(0);
+    for(itColumn = branch->columns.begin(); itColumn != branch->columns.end(); ++itColumn)
+    {
+      (*itColumn)->values.clear();
+      (*itColumn)->integers.clear();
+    }
+  }
+
+  for(entry = first; entry < last; ++entry)
+  {
+    // loads the tree and reads the TClonesArray branches
+    if(!fTreeReader->ReadEntry(entry)) break;
+
+    treeEntry = fTree->LoadTree(entry);
+
+    // the tree cache is restricted to the TClonesArray branches by the first ReadEntry
+    if(!fCacheSelected)
+    {
+      for(itBranch = fBranches.begin(); itBranch != fBranches.end(); ++itBranch)
+      {
+        branch = *itBranch;
+        if(!branch->flat) continue;
+        fTree->AddBranchToCache(TString::Format("%s_size", branch->name.Data()), kTRUE);
+        for(itColumn = branch->columns.begin(); itColumn != branch->columns.end(); ++itColumn)
+        {
+          fTree->AddBranchToCache(TString::Format("%s_%s", branch->name.Data(), (*itColumn)->name.Data()), kTRUE);
+        }
+      }
+      fCacheSelected = kTRUE;
+    }
+
+    for(itBranch = fBranches.begin(); itBranch != fBranches.end(); ++itBranch)
+    {
+      branch = *itBranch;
+      if(branch->flat)
+      {
+        ReadColumns(branch, treeEntry);
+        objects = branch->size;
+      }
+      else
+      {
+        objects = branch->array->GetEntriesFast();
+        for(itColumn = branch->columns.begin(); itColumn != branch->columns.end(); ++itColumn)
+        {
+          FillColumn(*itColumn, branch->array, 0, objects);
+        }
+      }
+      branch->offsets.push_back(branch->offsets.back() + objects);
+    }
+  }
+
+  return entry - first;
+}
+
+//------------------------------------------------------------------------------
+
+const vector<Long64_t> &DelphesColumnReader::GetOffsets(const char *branchName) const
+{
+  stringstream message;
+  Branch *branch;
+
+  branch = FindBranch(branchName);
+  if(!branch)
+  {
+    message << "no column of branch " << branchName << " was added";
+    throw runtime_error(message.str());
+  }
+
+  return branch->offsets;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesColumnReader::GetColumnType(const char *branchName, const char *fieldName) const
+{
+  return FindColumn(branchName, fieldName)->type;
+}
+
+//------------------------------------------------------------------------------
+
+const vector<Double_t> &DelphesColumnReader::GetColumn(const char *branchName, const char *fieldName) const
+{
+  stringstream message;
+  Column *column;
+
+  column = FindColumn(branchName, fieldName);
+  if(IsIntegerType(column->type))
+  {
+    message << "column " << branchName << "." << fieldName << " is an integer column";
+    throw runtime_error(message.str());
+  }
+
+  return column->values;
+}
+
+//------------------------------------------------------------------------------
+
+const vector<Long64_t> &DelphesColumnReader::GetIntegerColumn(const char *branchName, const char *fieldName) const
+{
+  stringstream message;
+  Column *column;
+
+  column = FindColumn(branchName, fieldName);
+  if(!IsIntegerType(column->type))
+  {
+    message << "column " << branchName << "." << fieldName << " is not an integer column";
+    throw runtime_error(message.str());
+  }
+
+  return column->integers;
+}
+
+//------------------------------------------------------------------------------
+
+DelphesColumnReader::Branch *DelphesColumnReader::FindBranch(const char *branchName) const
+{
+  vector<Branch *>::const_iterator itBranch;
+
+  for(itBranch = fBranches.begin(); itBranch != fBranches.end(); ++itBranch)
+  {
+    if((*itBranch)->name == branchName) return *itBranch;
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+
+DelphesColumnReader::Column *DelphesColumnReader::FindColumn(const char *branchName, const char *fieldName) const
+{
+  stringstream message;
+  vector<Column *>::const_iterator itColumn;
+  Branch *branch;
+
+  branch = FindBranch(branchName);
+  if(branch)
+  {
+    for(itColumn = branch->columns.begin(); itColumn != branch->columns.end(); ++itColumn)
+    {
+      if((*itColumn)->name == fieldName) return *itColumn;
+    }
+  }
+
+  message << "column " << branchName << "." << fieldName << " was not added";
+  throw runtime_error(message.str());
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesColumnReader::SelectLeaves()
+{
+  vector<Branch *>::iterator itBranch;
+  vector<Column *>::iterator itColumn;
+  Branch *branch;
+
+  // only read the leaves of the selected fields, in particular skip the TRefArray members
+  for(itBranch = fBranches.begin(); itBranch != fBranches.end(); ++itBranch)
+  {
+    branch = *itBranch;
+    if(branch->flat) continue;
+    fTree->SetBranchStatus(TString::Format("%s.*", branch->name.Data()), 0);
+    for(itColumn = branch->columns.begin(); itColumn != branch->columns.end(); ++itColumn)
+    {
+      fTree->SetBranchStatus(TString::Format("%s.%s", branch->name.Data(), (*itColumn)->name.Data()), 1);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesColumnReader::ReadColumns(Branch *branch, Long64_t treeEntry)
+{
+  vector<Column *>::iterator itColumn;
+  Column *column;
+  size_t length;
+
+  // a TChain updates the TBranch pointers given to SetBranchAddress when it loads another tree
+  if(!branch->counter)
+  {
+    fTree->SetBranchAddress(TString::Format("%s_size", branch->name.Data()), &branch->size, &branch->counter);
+  }
+
+  branch->size = 0;
+  if(branch->counter) branch->counter->GetEntry(treeEntry);
+  if(branch->size < 0) branch->size = 0;
+
+  for(itColumn = branch->columns.begin(); itColumn != branch->columns.end(); ++itColumn)
+  {
+    column = *itColumn;
+
+    length = size_t(branch->size > 0 ? branch->size : 1) * column->width;
+    if(!column->branch || column->buffer.size() < length)
+    {
+      if(column->buffer.size() < length) column->buffer.resize(2 * length);
+      fTree->SetBranchAddress(TString::Format("%s_%s", branch->name.Data(), column->name.Data()), &column->buffer[0], &column->branch);
+    }
+
+    if(column->branch) column->branch->GetEntry(treeEntry);
+
+    FillColumn(column, 0, &column->buffer[0], branch->size);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesColumnReader::FillColumn(Column *column, TClonesArray *array, const char *buffer, Int_t size)
+{
+  vector<Double_t> &values = column->values;
+  vector<Long64_t> &integers = column->integers;
+  Int_t offset = column->offset;
+
+  switch(column->type)
+  {
+    case kFloat_t:
+    case kFloat16_t:
+      AppendValues<Float_t>(values, array, buffer, size, offset);
+      break;
+    case kDouble_t:
+    case kDouble32_t:
+      AppendValues<Double_t>(values, array, buffer, size, offset);
+      break;
+    case kInt_t:
+      AppendValues<Int_t>(integers, array, buffer, size, offset);
+      break;
+    case kUInt_t:
+      AppendValues<UInt_t>(integers, array, buffer, size, offset);
+      break;
+    case kShort_t:
+      AppendValues<Short_t>(integers, array, buffer, size, offset);
+      break;
+    case kUShort_t:
+      AppendValues<UShort_t>(integers, array, buffer, size, offset);
+      break;
+    case kChar_t:
+      AppendValues<Char_t>(integers, array, buffer, size, offset);
+      break;
+    case kUChar_t:
+      AppendValues<UChar_t>(integers, array, buffer, size, offset);
+      break;
+    case kBool_t:
+      AppendValues<Bool_t>(integers, array, buffer, size, offset);
+      break;
+    case kLong_t:
+      AppendValues<Long_t>(integers, array, buffer, size, offset);
+      break;
+    case kULong_t:
+      AppendValues<ULong_t>(integers, array, buffer, size, offset);
+      break;
+    case kLong64_t:
+      AppendValues<Long64_t>(integers, array, buffer, size, offset);
+      break;
+    case kULong64_t:
+      // keeps the bit pattern, read back as unsigned
+      AppendValues<ULong64_t>(integers, array, buffer, size, offset);
+      break;
+    default:
+      // not reached, AddColumn only accepts the types above
+      values.resize(values.size() + size, 0.0);
+      break;
+  }
+}
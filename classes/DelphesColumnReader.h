@@ -0,0 +1,119 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesColumnReader_h
+#define DelphesColumnReader_h
+
+/** \class DelphesColumnReader
+ *
+ *  Reads selected numeric fields of Delphes tree branches for a range of
+ *  entries into contiguous arrays, one per field. The objects of the i-th
+ *  entry read are at [offsets[i], offsets[i + 1]) of the arrays of their
+ *  branch. Floating point fields are read into GetColumn, integer fields
+ *  into GetIntegerColumn, unsigned 64 bit fields keep their bit pattern.
+ *
+ *  Branches written with the flat layout of TreeWriter are read directly
+ *  from their <branch>_size and <branch>_<field> leaves. For the other
+ *  branches, only the leaves of the selected fields of the TClonesArray
+ *  are read.
+ *
+ */
+
+#include "Rtypes.h"
+#include "TString.h"
+
+#include <vector>
+
+class TTree;
+class TBranch;
+class TClonesArray;
+class ExRootTreeReader;
+
+class DelphesColumnReader
+{
+public:
+  DelphesColumnReader(TTree *tree = 0);
+
+  ~DelphesColumnReader();
+
+  // selects a field of the objects of a branch, for example ("Jet", "PT")
+  void AddColumn(const char *branchName, const char *fieldName);
+
+  Long64_t GetEntries() const;
+
+  // reads up to size entries starting at first, size < 0 reads up to the last entry,
+  // returns the number of entries read
+  Long64_t ReadEntries(Long64_t first, Long64_t size = -1);
+
+  const std::vector<Long64_t> &GetOffsets(const char *branchName) const;
+
+  // EDataType of the field, kFloat_t, kInt_t, ...
+  Int_t GetColumnType(const char *branchName, const char *fieldName) const;
+
+  static Bool_t IsIntegerType(Int_t type);
+
+  const std::vector<Double_t> &GetColumn(const char *branchName, const char *fieldName) const;
+  const std::vector<Long64_t> &GetIntegerColumn(const char *branchName, const char *fieldName) const;
+
+private:
+  struct Column
+  {
+    TString name;
+    Int_t offset;
+    Int_t type;
+    std::vector<Double_t> values;
+    std::vector<Long64_t> integers;
+
+    // flat layout
+    Int_t width;
+    TBranch *branch;
+    std::vector<char> buffer;
+  };
+
+  struct Branch
+  {
+    TString name;
+    TClonesArray *array;
+    std::vector<Long64_t> offsets;
+    std::vector<Column *> columns;
+
+    // flat layout
+    Bool_t flat;
+    TBranch *counter;
+    Int_t size;
+  };
+
+  Branch *FindBranch(const char *branchName) const;
+  Column *FindColumn(const char *branchName, const char *fieldName) const;
+
+  void SelectLeaves();
+
+  void ReadColumns(Branch *branch, Long64_t treeEntry);
+
+  void FillColumn(Column *column, TClonesArray *array, const char *buffer, Int_t size);
+
+  TTree *fTree; //!
+  ExRootTreeReader *fTreeReader; //!
+
+  Bool_t fLeavesSelected; //!
+  Bool_t fCacheSelected; //!
+
+  std::vector<Branch *> fBranches; //!
+};
+
+#endif // DelphesColumnReader_h
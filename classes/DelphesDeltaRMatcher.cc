@@ -0,0 +1,166 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesDeltaRMatcher
+ *
+ *  Finds objects close in (eta, phi) to a query direction.
+ *  Objects are sorted by eta once, so every query only visits
+ *  the objects inside its eta window.
+ *
+ */
+
+#include "classes/DelphesDeltaRMatcher.h"
+
+#include "classes/DelphesClasses.h"
+
+#include "TMath.h"
+#include "TObjArray.h"
+#include "TVector2.h"
+
+#include <algorithm>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+DelphesDeltaRMatcher::DelphesDeltaRMatcher()
+{
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesDeltaRMatcher::Clear()
+{
+  fObjects.clear();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesDeltaRMatcher::Add(Double_t eta, Double_t phi, Int_t index)
+{
+  Object object;
+
+  object.eta = eta;
+  object.phi = phi;
+  object.index = index;
+
+  fObjects.push_back(object);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesDeltaRMatcher::Fill(const TObjArray *array)
+{
+  Candidate *candidate;
+  Int_t i, size;
+
+  Clear();
+
+  size = array ? array->GetEntriesFast() : 0;
+  fObjects.reserve(size);
+  for(i = 0; i < size; ++i)
+  {
+    candidate = static_cast<Candidate *>(array->At(i));
+    Add(candidate->MomentumEta(), candidate->MomentumPhi(), i);
+  }
+
+  Sort();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesDeltaRMatcher::Sort()
+{
+  stable_sort(fObjects.begin(), fObjects.end());
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesDeltaRMatcher::LowerBound(Double_t eta) const
+{
+  Object object;
+
+  object.eta = eta;
+
+  return lower_bound(fObjects.begin(), fObjects.end(), object) - fObjects.begin();
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesDeltaRMatcher::FindNearest(Double_t eta, Double_t phi, Double_t deltaRMax, Double_t *deltaR) const
+{
+  Double_t window, distance, best = 0.0;
+  Int_t i, size, index = -1;
+
+  // widen the eta window slightly so that rounding in DeltaR can never
+  // accept an object that lies just outside of it
+  window = deltaRMax * (1.0 + 1.0e-9) + 1.0e-9;
+
+  size = fObjects.size();
+  for(i = LowerBound(eta - window); i < size && fObjects[i].eta <= eta + window; ++i)
+  {
+    const Object &object = fObjects[i];
+    distance = DeltaR(eta, phi, object.eta, object.phi);
+    if(distance > deltaRMax) continue;
+
+    // on ties prefer the lowest index, as a linear scan would
+    if(index < 0 || distance < best || (distance == best && object.index < index))
+    {
+      best = distance;
+      index = object.index;
+    }
+  }
+
+  if(deltaR) *deltaR = best;
+
+  return index;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesDeltaRMatcher::FindWithin(Double_t eta, Double_t phi, Double_t deltaRMax, vector<pair<Int_t, Double_t> > &matches) const
+{
+  Double_t window, distance;
+  Int_t i, size;
+
+  matches.clear();
+
+  window = deltaRMax * (1.0 + 1.0e-9) + 1.0e-9;
+
+  size = fObjects.size();
+  for(i = LowerBound(eta - window); i < size && fObjects[i].eta <= eta + window; ++i)
+  {
+    const Object &object = fObjects[i];
+    distance = DeltaR(eta, phi, object.eta, object.phi);
+    if(distance <= deltaRMax) matches.push_back(make_pair(object.index, distance));
+  }
+
+  sort(matches.begin(), matches.end());
+}
+
+//------------------------------------------------------------------------------
+
+Double_t DelphesDeltaRMatcher::DeltaR(Double_t eta1, Double_t phi1, Double_t eta2, Double_t phi2)
+{
+  // same expression as TLorentzVector::DeltaR
+  Double_t deta = eta1 - eta2;
+  Double_t dphi = TVector2::Phi_mpi_pi(phi1 - phi2);
+  return TMath::Sqrt(deta * deta + dphi * dphi);
+}
+
+//------------------------------------------------------------------------------
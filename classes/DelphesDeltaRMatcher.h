@@ -0,0 +1,77 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesDeltaRMatcher_h
+#define DelphesDeltaRMatcher_h
+
+/** \class DelphesDeltaRMatcher
+ *
+ *  Finds objects close in (eta, phi) to a query direction.
+ *  Objects are sorted by eta once, so every query only visits
+ *  the objects inside its eta window.
+ *  Distances are computed exactly as TLorentzVector::DeltaR does.
+ *
+ */
+
+#include "Rtypes.h"
+
+#include <utility>
+#include <vector>
+
+class TObjArray;
+
+class DelphesDeltaRMatcher
+{
+public:
+  DelphesDeltaRMatcher();
+
+  void Clear();
+
+  // index identifies the object in the matches
+  void Add(Double_t eta, Double_t phi, Int_t index);
+
+  // Clear, Add the momentum direction of every candidate in the array and Sort
+  void Fill(const TObjArray *array);
+
+  // must be called after the last Add and before the first query
+  void Sort();
+
+  Int_t GetSize() const { return fObjects.size(); }
+
+  // returns the index of the closest object with DeltaR <= deltaRMax, or -1
+  Int_t FindNearest(Double_t eta, Double_t phi, Double_t deltaRMax, Double_t *deltaR = 0) const;
+
+  // fills (index, DeltaR) of all objects with DeltaR <= deltaRMax, in increasing index order
+  void FindWithin(Double_t eta, Double_t phi, Double_t deltaRMax, std::vector<std::pair<Int_t, Double_t> > &matches) const;
+
+  static Double_t DeltaR(Double_t eta1, Double_t phi1, Double_t eta2, Double_t phi2);
+
+private:
+  struct Object
+  {
+    Double_t eta, phi;
+    Int_t index;
+    bool operator<(const Object &object) const { return eta < object.eta; }
+  };
+
+  Int_t LowerBound(Double_t eta) const;
+
+  std::vector<Object> fObjects;
+};
+
+#endif /* DelphesDeltaRMatcher_h */
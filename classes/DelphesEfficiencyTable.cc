@@ -0,0 +1,466 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesEfficiencyTable
+ *
+ *  Efficiency formula precompiled into a (pt, eta) lookup table.
+ *
+ *  \class DelphesEfficiencyMap
+ *
+ *  Efficiency tables indexed by flavor, with flavor 0 as the default.
+ *
+ *  \class DelphesWorkingPoints
+ *
+ *  Efficiency maps of the working points of a tagging module and the bits they set.
+ *
+ */
+
+#include "classes/DelphesEfficiencyTable.h"
+
+#include "classes/DelphesFormula.h"
+
+#include "ExRootAnalysis/ExRootConfReader.h"
+#include "ExRootAnalysis/ExRootTask.h"
+
+#include "TMath.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+static const Int_t kMaxRegions = 1000000;
+static const Int_t kMaxLookup = 1024;
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+
+enum Variable
+{
+  kPT,
+  kEta,
+  kAbsEta
+};
+
+//------------------------------------------------------------------------------
+
+// an operand can only start after an opening parenthesis or a logical operator
+Bool_t IsOpening(const string &s, size_t position)
+{
+  return position == 0 || strchr("(&|", s[position - 1]);
+}
+
+//------------------------------------------------------------------------------
+
+// and end before a closing parenthesis or a logical operator
+Bool_t IsClosing(const string &s, size_t position)
+{
+  return position >= s.size() || strchr(")&|", s[position]);
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t MatchVariable(const string &s, size_t &position, Int_t &variable)
+{
+  static const struct
+  {
+    const char *name;
+    Int_t variable;
+  } names[] = {{"fabs(eta)", kAbsEta}, {"abs(eta)", kAbsEta}, {"eta", kEta}, {"pt", kPT}};
+  size_t i, length;
+
+  for(i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+  {
+    length = strlen(names[i].name);
+    if(s.compare(position, length, names[i].name) == 0)
+    {
+      position += length;
+      variable = names[i].variable;
+      return kTRUE;
+    }
+  }
+  return kFALSE;
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t MatchOperator(const string &s, size_t &position)
+{
+  static const char *operators[] = {"<=", ">=", "==", "!=", "<", ">"};
+  size_t i, length;
+
+  for(i = 0; i < sizeof(operators) / sizeof(operators[0]); ++i)
+  {
+    length = strlen(operators[i]);
+    if(s.compare(position, length, operators[i]) == 0)
+    {
+      position += length;
+      return kTRUE;
+    }
+  }
+  return kFALSE;
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t MatchNumber(const string &s, size_t &position, Double_t &value)
+{
+  const char *begin = s.c_str() + position;
+  char *end;
+
+  if(position >= s.size() || !(isdigit(*begin) || *begin == '.' || *begin == '+' || *begin == '-')) return kFALSE;
+
+  value = strtod(begin, &end);
+  if(end == begin) return kFALSE;
+
+  position += end - begin;
+  return kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
+// matches "variable op number" or "number op variable" starting at position,
+// delimited by parentheses or logical operators so that no other
+// arithmetic can apply to either operand
+Bool_t MatchComparison(const string &s, size_t &position, Int_t &variable, Double_t &value)
+{
+  size_t i;
+
+  if(!IsOpening(s, position)) return kFALSE;
+
+  i = position;
+  if(MatchVariable(s, i, variable) && MatchOperator(s, i) && MatchNumber(s, i, value) && IsClosing(s, i))
+  {
+    position = i;
+    return kTRUE;
+  }
+
+  i = position;
+  if(MatchNumber(s, i, value) && MatchOperator(s, i) && MatchVariable(s, i, variable) && IsClosing(s, i))
+  {
+    position = i;
+    return kTRUE;
+  }
+
+  return kFALSE;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+DelphesEfficiencyTable::DelphesEfficiencyTable() :
+  fFormula(0), fTabulated(kFALSE)
+{
+}
+
+//------------------------------------------------------------------------------
+
+DelphesEfficiencyTable::~DelphesEfficiencyTable()
+{
+  if(fFormula) delete fFormula;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesEfficiencyTable::Compile(const char *expression)
+{
+  if(fFormula) delete fFormula;
+
+  fFormula = new DelphesFormula;
+  fFormula->Compile(expression);
+
+  fTabulated = Tabulate(expression);
+}
+
+//------------------------------------------------------------------------------
+
+Double_t DelphesEfficiencyTable::Eval(Double_t pt, Double_t eta, Double_t phi, Double_t energy)
+{
+  // NaN would not fall in any region
+  if(fTabulated && pt == pt && eta == eta)
+  {
+    return fValues[GetRegion(fPTEdges, pt) * (2 * fEtaEdges.size() + 1) + GetRegion(fEtaEdges, eta)];
+  }
+
+  return fFormula->Eval(pt, eta, phi, energy);
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesEfficiencyTable::Tabulate(const char *expression)
+{
+  string buffer, rest;
+  const char *it;
+  size_t position;
+  Int_t variable, i, j, ptRegions, etaRegions;
+  Double_t value, pt, eta;
+
+  fPTEdges.clear();
+  fEtaEdges.clear();
+  fValues.clear();
+
+  // same preprocessing as DelphesFormula::Compile
+  for(it = expression; *it; ++it)
+  {
+    if(*it == ' ' || *it == '\t' || *it == '\r' || *it == '\n' || *it == '\\') continue;
+    buffer += *it;
+  }
+
+  // collect the thresholds of all comparisons
+  position = 0;
+  while(position < buffer.size())
+  {
+    if(MatchComparison(buffer, position, variable, value))
+    {
+      if(variable == kPT)
+      {
+        fPTEdges.push_back(value);
+      }
+      else
+      {
+        fEtaEdges.push_back(value);
+        if(variable == kAbsEta) fEtaEdges.push_back(-value);
+      }
+      rest += '#';
+    }
+    else
+    {
+      rest += buffer[position++];
+    }
+  }
+
+  // anything named, other than exponents, may depend on the kinematics
+  for(position = 0; position < rest.size(); ++position)
+  {
+    if(!isalpha(rest[position]) && rest[position] != '_') continue;
+    if((rest[position] == 'e' || rest[position] == 'E') && position > 0 && position + 1 < rest.size()
+      && (isdigit(rest[position - 1]) || rest[position - 1] == '.')
+      && (isdigit(rest[position + 1]) || rest[position + 1] == '+' || rest[position + 1] == '-')) continue;
+    return kFALSE;
+  }
+
+  sort(fPTEdges.begin(), fPTEdges.end());
+  fPTEdges.erase(unique(fPTEdges.begin(), fPTEdges.end()), fPTEdges.end());
+  sort(fEtaEdges.begin(), fEtaEdges.end());
+  fEtaEdges.erase(unique(fEtaEdges.begin(), fEtaEdges.end()), fEtaEdges.end());
+
+  ptRegions = 2 * fPTEdges.size() + 1;
+  etaRegions = 2 * fEtaEdges.size() + 1;
+  if(Double_t(ptRegions) * etaRegions > kMaxRegions) return kFALSE;
+
+  // evaluate the formula once inside every region
+  fValues.resize(ptRegions * etaRegions);
+  for(i = 0; i < ptRegions; ++i)
+  {
+    pt = GetPoint(fPTEdges, i);
+    if(GetRegion(fPTEdges, pt) != i) return kFALSE;
+
+    for(j = 0; j < etaRegions; ++j)
+    {
+      eta = GetPoint(fEtaEdges, j);
+      if(GetRegion(fEtaEdges, eta) != j) return kFALSE;
+
+      fValues[i * etaRegions + j] = fFormula->Eval(pt, eta);
+    }
+  }
+
+  return kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
+// regions are numbered 0 for x < edges[0], 1 for x == edges[0],
+// 2 for edges[0] < x < edges[1], ...
+Int_t DelphesEfficiencyTable::GetRegion(const vector<Double_t> &edges, Double_t x)
+{
+  Int_t i = upper_bound(edges.begin(), edges.end(), x) - edges.begin();
+  if(i > 0 && edges[i - 1] == x) return 2 * i - 1;
+  return 2 * i;
+}
+
+//------------------------------------------------------------------------------
+
+Double_t DelphesEfficiencyTable::GetPoint(const vector<Double_t> &edges, Int_t region)
+{
+  Int_t i = region / 2, size = edges.size();
+
+  if(size == 0) return 0.0;
+  if(region % 2 == 1) return edges[i];
+  if(i == 0) return edges[0] - TMath::Max(1.0, TMath::Abs(edges[0]));
+  if(i == size) return edges[size - 1] + TMath::Max(1.0, TMath::Abs(edges[size - 1]));
+  return 0.5 * edges[i - 1] + 0.5 * edges[i];
+}
+
+//------------------------------------------------------------------------------
+
+DelphesEfficiencyMap::DelphesEfficiencyMap()
+{
+}
+
+//------------------------------------------------------------------------------
+
+DelphesEfficiencyMap::~DelphesEfficiencyMap()
+{
+  map<Int_t, DelphesEfficiencyTable *>::iterator itTables;
+
+  for(itTables = fTables.begin(); itTables != fTables.end(); ++itTables)
+  {
+    delete itTables->second;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesEfficiencyMap::Add(Int_t flavor, const char *expression)
+{
+  DelphesEfficiencyTable *table = new DelphesEfficiencyTable;
+  map<Int_t, DelphesEfficiencyTable *>::iterator itTables;
+
+  table->Compile(expression);
+
+  itTables = fTables.find(flavor);
+  if(itTables != fTables.end())
+  {
+    delete itTables->second;
+    itTables->second = table;
+  }
+  else
+  {
+    fTables[flavor] = table;
+  }
+
+  fLookup.clear();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesEfficiencyMap::Finalize()
+{
+  map<Int_t, DelphesEfficiencyTable *>::iterator itTables;
+  Int_t size = 0;
+
+  // set default efficiency formula
+  if(fTables.find(0) == fTables.end())
+  {
+    Add(0, "0.0");
+  }
+
+  for(itTables = fTables.begin(); itTables != fTables.end(); ++itTables)
+  {
+    if(itTables->first >= 0 && itTables->first < kMaxLookup) size = itTables->first + 1;
+  }
+
+  fLookup.assign(size, fTables[0]);
+  for(itTables = fTables.begin(); itTables != fTables.end(); ++itTables)
+  {
+    if(itTables->first >= 0 && itTables->first < size) fLookup[itTables->first] = itTables->second;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesEfficiencyTable *DelphesEfficiencyMap::FindSlow(Int_t flavor) const
+{
+  map<Int_t, DelphesEfficiencyTable *>::const_iterator itTables;
+
+  itTables = fTables.find(flavor);
+  if(itTables == fTables.end()) itTables = fTables.find(0);
+  if(itTables == fTables.end())
+  {
+    throw runtime_error("DelphesEfficiencyMap::Finalize was not called");
+  }
+  return itTables->second;
+}
+
+//------------------------------------------------------------------------------
+
+static DelphesEfficiencyMap *NewEfficiencyMap(ExRootConfParam param)
+{
+  DelphesEfficiencyMap *efficiencyMap;
+  Int_t i, size;
+
+  size = param.GetSize();
+
+  efficiencyMap = new DelphesEfficiencyMap;
+  for(i = 0; i < size / 2; ++i)
+  {
+    efficiencyMap->Add(param[i * 2].GetInt(), param[i * 2 + 1].GetString());
+  }
+  efficiencyMap->Finalize();
+
+  return efficiencyMap;
+}
+
+//------------------------------------------------------------------------------
+
+DelphesWorkingPoints::DelphesWorkingPoints()
+{
+}
+
+//------------------------------------------------------------------------------
+
+DelphesWorkingPoints::~DelphesWorkingPoints()
+{
+  Clear();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesWorkingPoints::Read(ExRootTask *module)
+{
+  ExRootConfParam param;
+  Int_t i, size;
+
+  // read efficiency formulas of the main working point
+  fBitNumbers.push_back(module->GetInt("BitNumber", 0));
+  fEfficiencyMaps.push_back(NewEfficiencyMap(module->GetParam("EfficiencyFormula")));
+
+  // read efficiency formulas of additional working points
+  param = module->GetParam("WorkingPoint");
+  size = param.GetSize();
+
+  for(i = 0; i < size / 2; ++i)
+  {
+    fBitNumbers.push_back(param[i * 2].GetInt());
+    fEfficiencyMaps.push_back(NewEfficiencyMap(param[i * 2 + 1]));
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesWorkingPoints::Clear()
+{
+  vector<DelphesEfficiencyMap *>::iterator itEfficiencyMaps;
+
+  for(itEfficiencyMaps = fEfficiencyMaps.begin(); itEfficiencyMaps != fEfficiencyMaps.end(); ++itEfficiencyMaps)
+  {
+    delete *itEfficiencyMaps;
+  }
+  fEfficiencyMaps.clear();
+  fBitNumbers.clear();
+}
+
+//------------------------------------------------------------------------------
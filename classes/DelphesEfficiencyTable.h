@@ -0,0 +1,143 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesEfficiencyTable_h
+#define DelphesEfficiencyTable_h
+
+/** \class DelphesEfficiencyTable
+ *
+ *  Efficiency formula precompiled into a (pt, eta) lookup table.
+ *
+ *  Formulas built only from constants and comparisons of pt, eta or
+ *  abs(eta) with constants are piecewise constant. Their value is
+ *  tabulated once on every open interval between the thresholds and on
+ *  the thresholds themselves, so that Eval returns exactly what the
+ *  formula would. Any other formula is evaluated with DelphesFormula.
+ *
+ *  \class DelphesEfficiencyMap
+ *
+ *  Efficiency tables indexed by flavor, with flavor 0 as the default.
+ *
+ *  \class DelphesWorkingPoints
+ *
+ *  Efficiency maps of the working points of a tagging module and the bits
+ *  they set. Besides the working point given by BitNumber and
+ *  EfficiencyFormula, further working points can be added as
+ *  add WorkingPoint {bit number} {{flavor} {formula} ...}
+ *  so that they are all applied in the same pass over the jets.
+ *
+ */
+
+#include "Rtypes.h"
+
+#include <map>
+#include <vector>
+
+class DelphesFormula;
+class ExRootTask;
+
+class DelphesEfficiencyTable
+{
+public:
+  DelphesEfficiencyTable();
+
+  ~DelphesEfficiencyTable();
+
+  void Compile(const char *expression);
+
+  Double_t Eval(Double_t pt, Double_t eta, Double_t phi = 0, Double_t energy = 0);
+
+  Bool_t IsTabulated() const { return fTabulated; }
+
+private:
+  DelphesEfficiencyTable(const DelphesEfficiencyTable &);
+  DelphesEfficiencyTable &operator=(const DelphesEfficiencyTable &);
+
+  Bool_t Tabulate(const char *expression);
+
+  static Int_t GetRegion(const std::vector<Double_t> &edges, Double_t x);
+  static Double_t GetPoint(const std::vector<Double_t> &edges, Int_t region);
+
+  DelphesFormula *fFormula;
+
+  Bool_t fTabulated;
+
+  std::vector<Double_t> fPTEdges, fEtaEdges;
+  std::vector<Double_t> fValues;
+};
+
+//------------------------------------------------------------------------------
+
+class DelphesEfficiencyMap
+{
+public:
+  DelphesEfficiencyMap();
+
+  ~DelphesEfficiencyMap();
+
+  void Add(Int_t flavor, const char *expression);
+
+  // adds a null efficiency for flavor 0 if it is missing
+  // and must be called before the first Find
+  void Finalize();
+
+  // returns the table of this flavor or the table of flavor 0
+  DelphesEfficiencyTable *Find(Int_t flavor) const
+  {
+    if(flavor >= 0 && flavor < Int_t(fLookup.size())) return fLookup[flavor];
+    return FindSlow(flavor);
+  }
+
+private:
+  DelphesEfficiencyMap(const DelphesEfficiencyMap &);
+  DelphesEfficiencyMap &operator=(const DelphesEfficiencyMap &);
+
+  DelphesEfficiencyTable *FindSlow(Int_t flavor) const;
+
+  std::map<Int_t, DelphesEfficiencyTable *> fTables;
+  std::vector<DelphesEfficiencyTable *> fLookup;
+};
+
+//------------------------------------------------------------------------------
+
+class DelphesWorkingPoints
+{
+public:
+  DelphesWorkingPoints();
+
+  ~DelphesWorkingPoints();
+
+  // reads the BitNumber, EfficiencyFormula and WorkingPoint parameters of the module
+  void Read(ExRootTask *module);
+
+  void Clear();
+
+  Int_t GetSize() const { return fEfficiencyMaps.size(); }
+
+  Int_t GetBitNumber(Int_t i) const { return fBitNumbers[i]; }
+  DelphesEfficiencyMap *GetEfficiencyMap(Int_t i) const { return fEfficiencyMaps[i]; }
+
+private:
+  DelphesWorkingPoints(const DelphesWorkingPoints &);
+  DelphesWorkingPoints &operator=(const DelphesWorkingPoints &);
+
+  std::vector<Int_t> fBitNumbers;
+  std::vector<DelphesEfficiencyMap *> fEfficiencyMaps;
+};
+
+#endif /* DelphesEfficiencyTable_h */
@@ -0,0 +1,245 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesEventIndex
+ *
+ *  Byte offsets of the events in a text event file, found by a fast scan
+ *  for the lines that start an event ("E " for HepMC).
+ *  The offsets are kept in a sidecar file, <input file>.idx, and the scan
+ *  is only repeated when the input file changes.
+ *
+ */
+
+#include "classes/DelphesEventIndex.h"
+#include "classes/DelphesXDRReader.h"
+#include "classes/DelphesXDRWriter.h"
+
+#include <sstream>
+#include <stdexcept>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const char kMagic[] = "EVTINDEX";
+static const int kMagicSize = 8;
+static const int kHeaderSize = kMagicSize + 3 * 8;
+static const size_t kBufferSize = 1 << 22;
+
+//------------------------------------------------------------------------------
+
+DelphesEventIndex::DelphesEventIndex(const char *fileName, const char *prefix) :
+  fPrefix(prefix), fSize(0), fTime(0), fScanned(false)
+{
+  stringstream message;
+  struct stat status;
+  string indexName;
+  FILE *file;
+
+  file = fopen(fileName, "rb");
+
+  if(file == NULL || fstat(fileno(file), &status) != 0)
+  {
+    if(file) fclose(file);
+    message << "can't open " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  fSize = status.st_size;
+  fTime = status.st_mtime;
+
+  indexName = string(fileName) + ".idx";
+
+  if(!ReadIndex(indexName.c_str()))
+  {
+    Scan(file);
+    fScanned = true;
+    WriteIndex(indexName.c_str());
+  }
+
+  fclose(file);
+}
+
+//------------------------------------------------------------------------------
+
+int64_t DelphesEventIndex::GetOffset(int64_t entry) const
+{
+  if(entry < 0) return 0;
+  if(entry >= GetEntries()) return fSize;
+  return fOffsets[entry];
+}
+
+//------------------------------------------------------------------------------
+
+bool DelphesEventIndex::ReadIndex(const char *indexName)
+{
+  DelphesXDRReader reader;
+  struct stat status;
+  char magic[kMagicSize];
+  int64_t size, time, entries, i;
+  vector<uint8_t> buffer;
+  FILE *file;
+  bool valid;
+
+  file = fopen(indexName, "rb");
+  if(file == NULL) return false;
+
+  valid = fstat(fileno(file), &status) == 0 && status.st_size >= kHeaderSize;
+
+  if(valid)
+  {
+    reader.SetFile(file);
+    reader.ReadRaw(magic, kMagicSize);
+    reader.ReadValue(&size, 8);
+    reader.ReadValue(&time, 8);
+    reader.ReadValue(&entries, 8);
+
+    // an index is only valid for the file it was built from
+    valid = memcmp(magic, kMagic, kMagicSize) == 0
+      && size == fSize && time == fTime && entries >= 0
+      && status.st_size == kHeaderSize + 8 * entries;
+  }
+
+  if(valid && entries > 0)
+  {
+    buffer.resize(8 * entries);
+    valid = fread(&buffer[0], 8, entries, file) == size_t(entries);
+  }
+
+  fclose(file);
+
+  if(!valid) return false;
+
+  reader.SetFile(0);
+  reader.SetBuffer(buffer.empty() ? 0 : &buffer[0]);
+
+  fOffsets.resize(entries);
+  for(i = 0; i < entries; ++i) reader.ReadValue(&fOffsets[i], 8);
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesEventIndex::WriteIndex(const char *indexName)
+{
+  DelphesXDRWriter writer;
+  stringstream temporaryName;
+  char magic[kMagicSize];
+  int64_t entries, i;
+  FILE *file;
+  bool valid;
+
+  // several jobs may build the same index, the complete file is renamed
+  temporaryName << indexName << "." << getpid();
+
+  file = fopen(temporaryName.str().c_str(), "wb");
+
+  // the index is only a cache, read-only directories are fine
+  if(file == NULL) return;
+
+  memcpy(magic, kMagic, kMagicSize);
+  entries = GetEntries();
+
+  writer.SetFile(file);
+  writer.WriteRaw(magic, kMagicSize);
+  writer.WriteValue(&fSize, 8);
+  writer.WriteValue(&fTime, 8);
+  writer.WriteValue(&entries, 8);
+  for(i = 0; i < entries; ++i) writer.WriteValue(&fOffsets[i], 8);
+
+  valid = !ferror(file);
+  valid = fclose(file) == 0 && valid;
+
+  if(!valid || rename(temporaryName.str().c_str(), indexName) != 0)
+  {
+    remove(temporaryName.str().c_str());
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesEventIndex::Scan(FILE *file)
+{
+  size_t prefixSize, keep, size, end, position;
+  vector<char> buffer;
+  int64_t base;
+  bool start, lineStart;
+  char *next;
+
+  prefixSize = fPrefix.size();
+  buffer.resize(kBufferSize + prefixSize);
+
+  fOffsets.clear();
+
+  keep = 0;
+  base = 0;
+  lineStart = true;
+
+  while((size = fread(&buffer[keep], 1, kBufferSize, file)) > 0)
+  {
+    end = keep + size;
+    position = 0;
+    start = lineStart;
+
+    while(true)
+    {
+      if(!start)
+      {
+        next = static_cast<char *>(memchr(&buffer[position], '\n', end - position));
+        if(!next) break;
+        position = next - &buffer[0] + 1;
+        start = true;
+      }
+
+      if(end - position < prefixSize) break;
+
+      if(memcmp(&buffer[position], fPrefix.data(), prefixSize) == 0)
+      {
+        fOffsets.push_back(base + position);
+      }
+
+      start = false;
+    }
+
+    // a line start too short to be checked is kept for the next block
+    if(start)
+    {
+      keep = end - position;
+      memmove(&buffer[0], &buffer[position], keep);
+      base += position;
+    }
+    else
+    {
+      keep = 0;
+      base += end;
+    }
+    lineStart = start;
+  }
+
+  if(ferror(file))
+  {
+    throw runtime_error("can't read input file while building the event index");
+  }
+}
+
+//------------------------------------------------------------------------------
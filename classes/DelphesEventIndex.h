@@ -0,0 +1,65 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesEventIndex_h
+#define DelphesEventIndex_h
+
+/** \class DelphesEventIndex
+ *
+ *  Byte offsets of the events in a text event file, found by a fast scan
+ *  for the lines that start an event ("E " for HepMC).
+ *  The offsets are kept in a sidecar file, <input file>.idx, and the scan
+ *  is only repeated when the input file changes.
+ *
+ */
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <stdio.h>
+
+class DelphesEventIndex
+{
+public:
+  DelphesEventIndex(const char *fileName, const char *prefix);
+
+  int64_t GetEntries() const { return fOffsets.size(); }
+
+  // offset of the first line of an event, the file size past the last event
+  int64_t GetOffset(int64_t entry) const;
+
+  // false when the index was read from the sidecar file
+  bool IsScanned() const { return fScanned; }
+
+private:
+  bool ReadIndex(const char *indexName);
+  void WriteIndex(const char *indexName);
+  void Scan(FILE *file);
+
+  std::string fPrefix;
+
+  int64_t fSize;
+  int64_t fTime;
+
+  bool fScanned;
+
+  std::vector<int64_t> fOffsets;
+};
+
+#endif // DelphesEventIndex_h
@@ -33,12 +33,19 @@
 #include "TClass.h"
 #include "TObjArray.h"
 
+#include <mutex>
+
 using namespace std;
 
+static mutex gFactoryMutex;
+
+static thread_local Long64_t gCandidateCount = 0;
+static thread_local Long64_t gArrayCount = 0;
+
 //------------------------------------------------------------------------------
 
 DelphesFactory::DelphesFactory(const char *name) :
-  TNamed(name, ""), fObjArrays(0)
+  TNamed(name, ""), fObjArrays(0), fEventCounter(0), fThreadSafe(kFALSE)
 {
   fObjArrays = new ExRootTreeBranch("PermanentObjArrays", TObjArray::Class(), 0);
 }
@@ -73,6 +80,8 @@ void DelphesFactory::Clear(Option_t *option)
   {
     itBranches->second->Clear();
   }
+
+  ++fEventCounter;
 }
 
 //------------------------------------------------------------------------------
@@ -88,7 +97,11 @@ TObjArray *DelphesFactory::NewPermanentArray()
 
 Candidate *DelphesFactory::NewCandidate()
 {
-  Candidate *object = New<Candidate>();
+  unique_lock<mutex> lock(gFactoryMutex, defer_lock);
+  if(fThreadSafe) lock.lock();
+
+  Candidate *object = static_cast<Candidate *>(NewObject(Candidate::Class()));
+  ++gCandidateCount;
   object->SetFactory(this);
   TProcessID::AssignID(object);
   return object;
@@ -97,6 +110,32 @@ Candidate *DelphesFactory::NewCandidate()
 //------------------------------------------------------------------------------
 
 TObject *DelphesFactory::New(TClass *cl)
+{
+  unique_lock<mutex> lock(gFactoryMutex, defer_lock);
+  if(fThreadSafe) lock.lock();
+
+  if(cl == TObjArray::Class()) ++gArrayCount;
+
+  return NewObject(cl);
+}
+
+//------------------------------------------------------------------------------
+
+Long64_t DelphesFactory::GetCandidateCount()
+{
+  return gCandidateCount;
+}
+
+//------------------------------------------------------------------------------
+
+Long64_t DelphesFactory::GetArrayCount()
+{
+  return gArrayCount;
+}
+
+//------------------------------------------------------------------------------
+
+TObject *DelphesFactory::NewObject(TClass *cl)
 {
   TObject *object = 0;
   ExRootTreeBranch *branch = 0;
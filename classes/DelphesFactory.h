@@ -57,7 +57,19 @@ public:
   template <typename T>
   T *New() { return static_cast<T *>(New(T::Class())); }
 
+  // incremented by Clear, identifies the current event
+  Long64_t GetEventCounter() const { return fEventCounter; }
+
+  // serializes the creation of objects when modules run concurrently
+  void SetThreadSafe(Bool_t flag) { fThreadSafe = flag; }
+
+  // numbers of candidates and arrays created so far by the calling thread
+  static Long64_t GetCandidateCount();
+  static Long64_t GetArrayCount();
+
 private:
+  TObject *NewObject(TClass *cl);
+
   ExRootTreeBranch *fObjArrays; //!
 
 #if !defined(__CINT__) && !defined(__CLING__)
@@ -66,6 +78,10 @@ private:
 
   std::set<TObject *> fPool; //!
 
+  Long64_t fEventCounter; //!
+
+  Bool_t fThreadSafe; //!
+
   ClassDef(DelphesFactory, 1)
 };
 
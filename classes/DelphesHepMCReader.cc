@@ -20,20 +20,31 @@
  *
  *  Reads HepMC file
  *
+ *  The input is read in large blocks and every line is parsed in place.
+ *  Mother and daughter ranges are indexed by vertex barcode in flat arrays,
+ *  sized from the number of vertices of the event. Barcodes beyond them
+ *  (sparse numbering) are kept in maps.
+ *
+ *  With SetReadAhead, events are parsed on a background thread and
+ *  ReadBlock returns one complete event per call.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
 
 #include "classes/DelphesHepMCReader.h"
 
+#include <functional>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 
-#include <map>
+#include <utility>
 #include <vector>
 
+#include <fcntl.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "TDatabasePDG.h"
 #include "TLorentzVector.h"
@@ -49,16 +60,22 @@
 
 using namespace std;
 
-static const int kBufferSize = 16384;
+static const size_t kBufferSize = 4194304;
+
+// upper limit on the size of the flat vertex arrays, 32 MB each
+static const int kMaxFlatVertices = 4194304;
 
 //---------------------------------------------------------------------------
 
 DelphesHepMCReader::DelphesHepMCReader() :
-  fInputFile(0), fBuffer(0), fPDG(0),
+  fInputFile(0), fBuffer(0), fBufferSize(kBufferSize),
+  fLine(0), fEnd(0), fEndOfFile(false), fPDG(0),
   fVertexCounter(-1), fInCounter(-1), fOutCounter(-1),
-  fParticleCounter(0)
+  fParticleCounter(0), fReadAheadSize(0), fReadAhead(0), fFlatVertices(0)
 {
-  fBuffer = new char[kBufferSize];
+  // one more byte to terminate the last line
+  fBuffer = new char[fBufferSize + 1];
+  fLine = fEnd = fBuffer;
 
   fPDG = TDatabasePDG::Instance();
 }
@@ -67,6 +84,7 @@ DelphesHepMCReader::DelphesHepMCReader() :
 
 DelphesHepMCReader::~DelphesHepMCReader()
 {
+  StopReadAhead();
   if(fBuffer) delete[] fBuffer;
 }
 
@@ -74,12 +92,101 @@ DelphesHepMCReader::~DelphesHepMCReader()
 
 void DelphesHepMCReader::SetInputFile(FILE *inputFile)
 {
+  StopReadAhead();
+
   fInputFile = inputFile;
+  fLine = fEnd = fBuffer;
+  fEndOfFile = false;
+
+  if(!fInputFile) return;
+
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(fileno(fInputFile), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  if(fReadAheadSize > 0)
+  {
+    Reset();
+    // build the particle lookup table before it is shared with the reading thread
+    fPDG->GetParticle(0);
+    fReadAhead = new DelphesReadAhead<EventRecord>(fReadAheadSize,
+      bind(&DelphesHepMCReader::ReadEvent, this, placeholders::_1));
+  }
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesHepMCReader::StopReadAhead()
+{
+  if(fReadAhead)
+  {
+    delete fReadAhead;
+    fReadAhead = 0;
+  }
+}
+
+//---------------------------------------------------------------------------
+
+// returns the next line terminated in place, or null at the end of the input
+char *DelphesHepMCReader::ReadLine()
+{
+  char *line, *newLine, *buffer;
+  size_t size, count;
+
+  while(true)
+  {
+    newLine = static_cast<char *>(memchr(fLine, '\n', fEnd - fLine));
+    if(newLine)
+    {
+      *newLine = '\0';
+      line = fLine;
+      fLine = newLine + 1;
+      return line;
+    }
+
+    if(fEndOfFile)
+    {
+      if(fLine == fEnd) return 0;
+      *fEnd = '\0';
+      line = fLine;
+      fLine = fEnd;
+      return line;
+    }
+
+    // keep the incomplete line at the beginning of the buffer
+    size = fEnd - fLine;
+    if(size == fBufferSize)
+    {
+      buffer = new char[2 * fBufferSize + 1];
+      memcpy(buffer, fLine, size);
+      delete[] fBuffer;
+      fBuffer = buffer;
+      fBufferSize *= 2;
+    }
+    else if(fLine != fBuffer)
+    {
+      memmove(fBuffer, fLine, size);
+    }
+    fLine = fBuffer;
+    fEnd = fBuffer + size;
+
+    count = fread(fEnd, 1, fBufferSize - size, fInputFile);
+    if(count == 0) fEndOfFile = true;
+    fEnd += count;
+  }
 }
 
 //---------------------------------------------------------------------------
 
 void DelphesHepMCReader::Clear()
+{
+  // the reading thread starts every event from a clean state
+  if(!fReadAhead) Reset();
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesHepMCReader::Reset()
 {
   fStateSize = 0;
   fState.clear();
@@ -90,14 +197,24 @@ void DelphesHepMCReader::Clear()
   fVertexCounter = -1;
   fInCounter = -1;
   fOutCounter = -1;
-  fMotherMap.clear();
-  fDaughterMap.clear();
+  fFlatVertices = 0;
+  fMotherMap.Clear();
+  fDaughterMap.Clear();
   fParticleCounter = 0;
+  fParticles.clear();
 }
 
 //---------------------------------------------------------------------------
 
 bool DelphesHepMCReader::EventReady()
+{
+  // events read ahead are always complete
+  return fReadAhead || Complete();
+}
+
+//---------------------------------------------------------------------------
+
+bool DelphesHepMCReader::Complete() const
 {
   return (fVertexCounter == 0) && (fInCounter == 0) && (fOutCounter == 0);
 }
@@ -109,21 +226,97 @@ bool DelphesHepMCReader::ReadBlock(DelphesFactory *factory,
   TObjArray *stableParticleOutputArray,
   TObjArray *partonOutputArray)
 {
-  map<int, pair<int, int> >::iterator itMotherMap;
-  map<int, pair<int, int> >::iterator itDaughterMap;
+  char *line;
+
+  if(fReadAhead)
+  {
+    if(!fReadAhead->Next(fEvent)) return kFALSE;
+
+    fEvent.Materialize(factory, allParticleOutputArray,
+      stableParticleOutputArray, partonOutputArray);
+
+    return kTRUE;
+  }
+
+  line = ReadLine();
+  if(!line || !ParseLine(line)) return kFALSE;
+
+  if(Complete())
+  {
+    FinishEvent(fEvent);
+
+    fEvent.Materialize(factory, allParticleOutputArray,
+      stableParticleOutputArray, partonOutputArray);
+  }
+
+  return kTRUE;
+}
+
+//---------------------------------------------------------------------------
+
+// runs on the reading thread
+bool DelphesHepMCReader::ReadEvent(EventRecord &event)
+{
+  char *line;
+
+  while((line = ReadLine()))
+  {
+    if(!ParseLine(line)) return false;
+
+    if(Complete())
+    {
+      FinishEvent(event);
+      Reset();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesHepMCReader::FinishEvent(EventRecord &event)
+{
+  FinalizeParticles();
+
+  event.particles.swap(fParticles);
+  fParticles.clear();
+
+  event.number = fEventNumber;
+  event.mpi = fMPI;
+  event.processID = fProcessID;
+  event.scale = fScale;
+  event.alphaQCD = fAlphaQCD;
+  event.alphaQED = fAlphaQED;
+  event.weights = fWeight;
+  event.crossSection = fCrossSection;
+  event.crossSectionError = fCrossSectionError;
+  event.id1 = fID1;
+  event.id2 = fID2;
+  event.x1 = fX1;
+  event.x2 = fX2;
+  event.scalePDF = fScalePDF;
+  event.pdf1 = fPDF1;
+  event.pdf2 = fPDF2;
+}
+
+//---------------------------------------------------------------------------
+
+bool DelphesHepMCReader::ParseLine(char *line)
+{
+  pair<int, int> *range;
   char key, momentumUnit[4], positionUnit[3];
   int i, rc, state;
   double weight;
 
-  if(!fgets(fBuffer, kBufferSize, fInputFile)) return kFALSE;
-
-  DelphesStream bufferStream(fBuffer + 1);
+  DelphesStream bufferStream(line + 1);
 
-  key = fBuffer[0];
+  key = line[0];
 
   if(key == 'E')
   {
-    Clear();
+    Reset();
 
     rc = bufferStream.ReadInt(fEventNumber)
       && bufferStream.ReadInt(fMPI)
@@ -144,6 +337,9 @@ bool DelphesHepMCReader::ReadBlock(DelphesFactory *factory,
       return kFALSE;
     }
 
+    // barcodes are usually numbered from -1, the other ones go to the maps
+    fFlatVertices = (fVertexCounter > 0 && fVertexCounter < kMaxFlatVertices / 2) ? 2 * fVertexCounter + 1024 : kMaxFlatVertices;
+
     for(i = 0; i < fStateSize; ++i)
     {
       rc = rc && bufferStream.ReadInt(state);
@@ -174,7 +370,7 @@ bool DelphesHepMCReader::ReadBlock(DelphesFactory *factory,
   }
   else if(key == 'U')
   {
-    rc = sscanf(fBuffer + 1, "%3s %2s", momentumUnit, positionUnit);
+    rc = sscanf(line + 1, "%3s %2s", momentumUnit, positionUnit);
 
     if(rc != 2)
     {
@@ -267,32 +463,43 @@ bool DelphesHepMCReader::ReadBlock(DelphesFactory *factory,
 
     if(fInVertexCode < 0)
     {
-      itMotherMap = fMotherMap.find(fInVertexCode);
-      if(itMotherMap == fMotherMap.end())
+      range = GetRange(fMotherMap, fInVertexCode);
+      if(!range)
       {
-        fMotherMap[fInVertexCode] = make_pair(fParticleCounter, -1);
+        cerr << "** ERROR: "
+             << "invalid vertex barcode " << fInVertexCode << endl;
+        return kFALSE;
+      }
+      if(range->first < 0)
+      {
+        *range = make_pair(fParticleCounter, -1);
       }
       else
       {
-        itMotherMap->second.second = fParticleCounter;
+        range->second = fParticleCounter;
       }
     }
 
     if(fInCounter <= 0)
     {
-      itDaughterMap = fDaughterMap.find(fOutVertexCode);
-      if(itDaughterMap == fDaughterMap.end())
+      range = GetRange(fDaughterMap, fOutVertexCode);
+      if(!range)
+      {
+        cerr << "** ERROR: "
+             << "invalid vertex barcode " << fOutVertexCode << endl;
+        return kFALSE;
+      }
+      if(range->first < 0)
       {
-        fDaughterMap[fOutVertexCode] = make_pair(fParticleCounter, fParticleCounter);
+        *range = make_pair(fParticleCounter, fParticleCounter);
       }
       else
       {
-        itDaughterMap->second.second = fParticleCounter;
+        range->second = fParticleCounter;
       }
     }
 
-    AnalyzeParticle(factory, allParticleOutputArray,
-      stableParticleOutputArray, partonOutputArray);
+    AnalyzeParticle();
 
     if(fInCounter > 0)
     {
@@ -306,11 +513,6 @@ bool DelphesHepMCReader::ReadBlock(DelphesFactory *factory,
     ++fParticleCounter;
   }
 
-  if(EventReady())
-  {
-    FinalizeParticles(allParticleOutputArray);
-  }
-
   return kTRUE;
 }
 
@@ -322,24 +524,24 @@ void DelphesHepMCReader::AnalyzeEvent(ExRootTreeBranch *branch, long long eventN
   HepMCEvent *element;
 
   element = static_cast<HepMCEvent *>(branch->NewEntry());
-  element->Number = fEventNumber;
-
-  element->ProcessID = fProcessID;
-  element->MPI = fMPI;
-  element->Weight = fWeight.size() > 0 ? fWeight[0] : 1.0;
-  element->CrossSection = fCrossSection;
-  element->CrossSectionError = fCrossSectionError;
-  element->Scale = fScale;
-  element->AlphaQED = fAlphaQED;
-  element->AlphaQCD = fAlphaQCD;
-
-  element->ID1 = fID1;
-  element->ID2 = fID2;
-  element->X1 = fX1;
-  element->X2 = fX2;
-  element->ScalePDF = fScalePDF;
-  element->PDF1 = fPDF1;
-  element->PDF2 = fPDF2;
+  element->Number = fEvent.number;
+
+  element->ProcessID = fEvent.processID;
+  element->MPI = fEvent.mpi;
+  element->Weight = fEvent.weights.size() > 0 ? fEvent.weights[0] : 1.0;
+  element->CrossSection = fEvent.crossSection;
+  element->CrossSectionError = fEvent.crossSectionError;
+  element->Scale = fEvent.scale;
+  element->AlphaQED = fEvent.alphaQED;
+  element->AlphaQCD = fEvent.alphaQCD;
+
+  element->ID1 = fEvent.id1;
+  element->ID2 = fEvent.id2;
+  element->X1 = fEvent.x1;
+  element->X2 = fEvent.x2;
+  element->ScalePDF = fEvent.scalePDF;
+  element->PDF1 = fEvent.pdf1;
+  element->PDF2 = fEvent.pdf2;
 
   element->ReadTime = readStopWatch->RealTime();
   element->ProcTime = procStopWatch->RealTime();
@@ -352,7 +554,7 @@ void DelphesHepMCReader::AnalyzeWeight(ExRootTreeBranch *branch)
   Weight *element;
   vector<double>::const_iterator itWeight;
 
-  for(itWeight = fWeight.begin(); itWeight != fWeight.end(); ++itWeight)
+  for(itWeight = fEvent.weights.begin(); itWeight != fEvent.weights.end(); ++itWeight)
   {
     element = static_cast<Weight *>(branch->NewEntry());
 
@@ -362,123 +564,158 @@ void DelphesHepMCReader::AnalyzeWeight(ExRootTreeBranch *branch)
 
 //---------------------------------------------------------------------------
 
-void DelphesHepMCReader::AnalyzeParticle(DelphesFactory *factory,
-  TObjArray *allParticleOutputArray,
-  TObjArray *stableParticleOutputArray,
-  TObjArray *partonOutputArray)
+void DelphesHepMCReader::AnalyzeParticle()
 {
-  Candidate *candidate;
+  DelphesStagedParticle particle;
   TParticlePDG *pdgParticle;
   int pdgCode;
 
-  candidate = factory->NewCandidate();
+  particle.PID = fPID;
+  pdgCode = TMath::Abs(particle.PID);
 
-  candidate->PID = fPID;
-  pdgCode = TMath::Abs(candidate->PID);
-
-  candidate->Status = fStatus;
+  particle.Status = fStatus;
 
   pdgParticle = fPDG->GetParticle(fPID);
-  candidate->Charge = pdgParticle ? int(pdgParticle->Charge() / 3.0) : -999;
-  candidate->Mass = fMass;
+  particle.Charge = pdgParticle ? int(pdgParticle->Charge() / 3.0) : -999;
+  particle.Mass = fMass;
 
-  candidate->Momentum.SetPxPyPzE(fPx, fPy, fPz, fE);
-  if(fMomentumCoefficient != 1.0)
-  {
-    candidate->Momentum *= fMomentumCoefficient;
-  }
+  particle.Px = fPx * fMomentumCoefficient;
+  particle.Py = fPy * fMomentumCoefficient;
+  particle.Pz = fPz * fMomentumCoefficient;
+  particle.E = fE * fMomentumCoefficient;
 
-  candidate->M2 = 1;
-  candidate->D2 = 1;
+  particle.M2 = 1;
+  particle.D2 = 1;
   if(fInCounter > 0)
   {
-    candidate->M1 = 1;
-    candidate->Position.SetXYZT(0.0, 0.0, 0.0, 0.0);
+    particle.M1 = 1;
+    particle.X = particle.Y = particle.Z = particle.T = 0.0;
   }
   else
   {
-    candidate->M1 = fOutVertexCode;
-    candidate->Position.SetXYZT(fX, fY, fZ, fT);
-    if(fPositionCoefficient != 1.0)
-    {
-      candidate->Position *= fPositionCoefficient;
-    }
+    particle.M1 = fOutVertexCode;
+    particle.X = fX * fPositionCoefficient;
+    particle.Y = fY * fPositionCoefficient;
+    particle.Z = fZ * fPositionCoefficient;
+    particle.T = fT * fPositionCoefficient;
   }
   if(fInVertexCode < 0)
   {
-    candidate->D1 = fInVertexCode;
+    particle.D1 = fInVertexCode;
   }
   else
   {
-    candidate->D1 = 1;
+    particle.D1 = 1;
   }
 
-  allParticleOutputArray->Add(candidate);
-
-  if(!pdgParticle) return;
+  particle.Stable = pdgParticle && fStatus == 1;
+  particle.Parton = pdgParticle && !particle.Stable && (pdgCode <= 5 || pdgCode == 21 || pdgCode == 15);
 
-  if(fStatus == 1)
-  {
-    stableParticleOutputArray->Add(candidate);
-  }
-  else if(pdgCode <= 5 || pdgCode == 21 || pdgCode == 15)
-  {
-    partonOutputArray->Add(candidate);
-  }
+  fParticles.push_back(particle);
 }
 
 //---------------------------------------------------------------------------
 
-void DelphesHepMCReader::FinalizeParticles(TObjArray *allParticleOutputArray)
+void DelphesHepMCReader::FinalizeParticles()
 {
-  Candidate *candidate;
-  map<int, pair<int, int> >::iterator itMotherMap;
-  map<int, pair<int, int> >::iterator itDaughterMap;
-  int i;
+  vector<DelphesStagedParticle>::iterator itParticle;
+  DelphesStagedParticle *particle;
+  const pair<int, int> *range;
 
-  for(i = 0; i < allParticleOutputArray->GetEntriesFast(); ++i)
+  for(itParticle = fParticles.begin(); itParticle != fParticles.end(); ++itParticle)
   {
-    candidate = static_cast<Candidate *>(allParticleOutputArray->At(i));
+    particle = &*itParticle;
 
-    if(candidate->M1 > 0)
+    if(particle->M1 > 0)
     {
-      candidate->M1 = -1;
-      candidate->M2 = -1;
+      particle->M1 = -1;
+      particle->M2 = -1;
     }
     else
     {
-      itMotherMap = fMotherMap.find(candidate->M1);
-      if(itMotherMap == fMotherMap.end())
+      range = FindRange(fMotherMap, particle->M1);
+      if(!range)
       {
-        candidate->M1 = -1;
-        candidate->M2 = -1;
+        particle->M1 = -1;
+        particle->M2 = -1;
       }
       else
       {
-        candidate->M1 = itMotherMap->second.first;
-        candidate->M2 = itMotherMap->second.second;
+        particle->M1 = range->first;
+        particle->M2 = range->second;
       }
     }
-    if(candidate->D1 > 0)
+    if(particle->D1 > 0)
     {
-      candidate->D1 = -1;
-      candidate->D2 = -1;
+      particle->D1 = -1;
+      particle->D2 = -1;
     }
     else
     {
-      itDaughterMap = fDaughterMap.find(candidate->D1);
-      if(itDaughterMap == fDaughterMap.end())
+      range = FindRange(fDaughterMap, particle->D1);
+      if(!range)
       {
-        candidate->D1 = -1;
-        candidate->D2 = -1;
+        particle->D1 = -1;
+        particle->D2 = -1;
       }
       else
       {
-        candidate->D1 = itDaughterMap->second.first;
-        candidate->D2 = itDaughterMap->second.second;
+        particle->D1 = range->first;
+        particle->D2 = range->second;
       }
     }
   }
 }
 
 //---------------------------------------------------------------------------
+
+void DelphesHepMCReader::VertexRanges::Clear()
+{
+  flat.clear();
+  sparse.clear();
+}
+
+//---------------------------------------------------------------------------
+
+// vertex barcodes are negative, -1 is stored at index 0
+pair<int, int> *DelphesHepMCReader::GetRange(VertexRanges &ranges, int vertexCode)
+{
+  int index = -vertexCode - 1;
+
+  if(vertexCode >= 0) return 0;
+
+  if(index >= fFlatVertices)
+  {
+    return &ranges.sparse.insert(make_pair(vertexCode, make_pair(-1, -1))).first->second;
+  }
+
+  if(index >= int(ranges.flat.size()))
+  {
+    ranges.flat.resize(index + 1, make_pair(-1, -1));
+  }
+
+  return &ranges.flat[index];
+}
+
+//---------------------------------------------------------------------------
+
+const pair<int, int> *DelphesHepMCReader::FindRange(const VertexRanges &ranges, int vertexCode) const
+{
+  map<int, pair<int, int> >::const_iterator itRange;
+  int index = -vertexCode - 1;
+
+  if(vertexCode >= 0) return 0;
+
+  if(index >= fFlatVertices)
+  {
+    itRange = ranges.sparse.find(vertexCode);
+    if(itRange == ranges.sparse.end() || itRange->second.first < 0) return 0;
+    return &itRange->second;
+  }
+
+  if(index >= int(ranges.flat.size()) || ranges.flat[index].first < 0) return 0;
+
+  return &ranges.flat[index];
+}
+
+//---------------------------------------------------------------------------
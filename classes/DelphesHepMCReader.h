@@ -23,15 +23,26 @@
  *
  *  Reads HepMC file
  *
+ *  The input is read in large blocks and every line is parsed in place.
+ *  Mother and daughter ranges are indexed by vertex barcode in flat arrays,
+ *  sized from the number of vertices of the event. Barcodes beyond them
+ *  (sparse numbering) are kept in maps.
+ *
+ *  With SetReadAhead, events are parsed on a background thread and
+ *  ReadBlock returns one complete event per call.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
 
 #include <map>
+#include <utility>
 #include <vector>
 
 #include <stdio.h>
 
+#include "classes/DelphesReadAhead.h"
+
 class TObjArray;
 class TStopwatch;
 class TDatabasePDG;
@@ -44,8 +55,15 @@ public:
   DelphesHepMCReader();
   ~DelphesHepMCReader();
 
+  // number of events parsed ahead, 0 to parse while reading
+  void SetReadAhead(int events) { fReadAheadSize = events; }
+
+  // starts reading ahead if enabled
   void SetInputFile(FILE *inputFile);
 
+  // must be called before the input file is closed
+  void StopReadAhead();
+
   void Clear();
   bool EventReady();
 
@@ -60,16 +78,47 @@ public:
   void AnalyzeWeight(ExRootTreeBranch *branch);
 
 private:
-  void AnalyzeParticle(DelphesFactory *factory,
-    TObjArray *allParticleOutputArray,
-    TObjArray *stableParticleOutputArray,
-    TObjArray *partonOutputArray);
+  struct EventRecord: public DelphesStagedEvent
+  {
+    int number, mpi, processID;
+    double scale, alphaQCD, alphaQED;
+    std::vector<double> weights;
+    double crossSection, crossSectionError;
+    int id1, id2;
+    double x1, x2, scalePDF, pdf1, pdf2;
+  };
+
+  void Reset();
+  bool Complete() const;
 
-  void FinalizeParticles(TObjArray *allParticleOutputArray);
+  bool ParseLine(char *line);
+  bool ReadEvent(EventRecord &event);
+  void FinishEvent(EventRecord &event);
+
+  char *ReadLine();
+
+  struct VertexRanges
+  {
+    // first and last particle indices for vertex barcode -1, -2, ...
+    std::vector<std::pair<int, int> > flat;
+    std::map<int, std::pair<int, int> > sparse;
+
+    void Clear();
+  };
+
+  std::pair<int, int> *GetRange(VertexRanges &ranges, int vertexCode);
+  const std::pair<int, int> *FindRange(const VertexRanges &ranges, int vertexCode) const;
+
+  void AnalyzeParticle();
+
+  void FinalizeParticles();
 
   FILE *fInputFile;
 
   char *fBuffer;
+  size_t fBufferSize;
+  char *fLine, *fEnd;
+  bool fEndOfFile;
 
   TDatabasePDG *fPDG;
 
@@ -97,8 +146,16 @@ private:
 
   int fParticleCounter;
 
-  std::map<int, std::pair<int, int> > fMotherMap;
-  std::map<int, std::pair<int, int> > fDaughterMap;
+  std::vector<DelphesStagedParticle> fParticles;
+
+  EventRecord fEvent;
+
+  int fReadAheadSize;
+  DelphesReadAhead<EventRecord> *fReadAhead;
+
+  int fFlatVertices;
+  VertexRanges fMotherMap;
+  VertexRanges fDaughterMap;
 };
 
 #endif // DelphesHepMCReader_h
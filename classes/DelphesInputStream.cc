@@ -0,0 +1,644 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesInputStream
+ *
+ *  Opens an input file, or the standard input, and provides its content
+ *  as a FILE stream, decompressing gzip, zstd, xz and lz4 data on the fly.
+ *  The format is recognized from the first bytes of the input.
+ *
+ *  Compressed data are decoded in large blocks on a background thread,
+ *  and the position reported for progress bars counts compressed bytes.
+ *
+ *  Support for each format depends on the libraries found at build time
+ *  (HAS_ZLIB, HAS_ZSTD, HAS_LZMA and HAS_LZ4).
+ *
+ */
+
+#include "classes/DelphesInputStream.h"
+#include "classes/DelphesReadAhead.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAS_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef HAS_LZMA
+#include <lzma.h>
+#endif
+
+#ifdef HAS_LZ4
+#include <lz4frame.h>
+#endif
+
+using namespace std;
+
+static const size_t kMagicSize = 6;
+static const size_t kInputSize = 1 << 20;
+static const size_t kBlockSize = 1 << 22;
+static const size_t kReadAheadBlocks = 4;
+
+//------------------------------------------------------------------------------
+
+class DelphesDecoder
+{
+public:
+  DelphesDecoder(FILE *file, const char *magic, size_t magicSize) :
+    fFile(file), fInput(kInputSize), fBegin(0), fEnd(magicSize), fPosition(magicSize)
+  {
+    copy(magic, magic + magicSize, fInput.begin());
+  }
+
+  virtual ~DelphesDecoder() {}
+
+  // fills output with up to size bytes and returns 0 at the end of the input
+  virtual size_t Decode(char *output, size_t size) = 0;
+
+  int64_t GetPosition() const { return fPosition; }
+
+protected:
+  // returns the number of input bytes available, 0 at the end of the input
+  size_t Fill()
+  {
+    if(fBegin < fEnd) return fEnd - fBegin;
+
+    fBegin = 0;
+    fEnd = fread(&fInput[0], 1, fInput.size(), fFile);
+    fPosition += fEnd;
+
+    if(fEnd == 0 && ferror(fFile))
+    {
+      throw runtime_error(string("can't read input: ") + strerror(errno));
+    }
+
+    return fEnd;
+  }
+
+  void Truncated(const char *format)
+  {
+    stringstream message;
+    message << "truncated " << format << " input";
+    throw runtime_error(message.str());
+  }
+
+  FILE *fFile;
+
+  vector<char> fInput;
+  size_t fBegin, fEnd;
+  int64_t fPosition;
+};
+
+//------------------------------------------------------------------------------
+
+class DelphesPlainDecoder: public DelphesDecoder
+{
+public:
+  DelphesPlainDecoder(FILE *file, const char *magic, size_t magicSize) :
+    DelphesDecoder(file, magic, magicSize) {}
+
+  size_t Decode(char *output, size_t size)
+  {
+    size_t produced = 0, available;
+
+    while(produced < size && (available = Fill()) > 0)
+    {
+      available = min(available, size - produced);
+      memcpy(output + produced, &fInput[fBegin], available);
+      fBegin += available;
+      produced += available;
+    }
+
+    return produced;
+  }
+};
+
+//------------------------------------------------------------------------------
+
+#ifdef HAS_ZLIB
+
+class DelphesGzipDecoder: public DelphesDecoder
+{
+public:
+  DelphesGzipDecoder(FILE *file, const char *magic, size_t magicSize) :
+    DelphesDecoder(file, magic, magicSize), fFinished(false)
+  {
+    memset(&fStream, 0, sizeof(fStream));
+    if(inflateInit2(&fStream, 15 + 32) != Z_OK)
+    {
+      throw runtime_error("can't initialize gzip decoder");
+    }
+  }
+
+  ~DelphesGzipDecoder()
+  {
+    inflateEnd(&fStream);
+  }
+
+  size_t Decode(char *output, size_t size)
+  {
+    size_t available;
+    uInt previous;
+    int rc;
+
+    fStream.next_out = reinterpret_cast<Bytef *>(output);
+    fStream.avail_out = size;
+
+    while(fStream.avail_out > 0)
+    {
+      available = Fill();
+
+      // several gzip members can be concatenated
+      if(fFinished)
+      {
+        if(available == 0) break;
+        inflateReset(&fStream);
+        fFinished = false;
+      }
+
+      fStream.next_in = reinterpret_cast<Bytef *>(available > 0 ? &fInput[fBegin] : 0);
+      fStream.avail_in = available;
+      previous = fStream.avail_out;
+
+      rc = inflate(&fStream, Z_NO_FLUSH);
+
+      fBegin = fEnd - fStream.avail_in;
+
+      if(rc == Z_STREAM_END)
+      {
+        fFinished = true;
+      }
+      else if(rc != Z_OK && rc != Z_BUF_ERROR)
+      {
+        throw runtime_error(string("can't decode gzip input: ") + (fStream.msg ? fStream.msg : zError(rc)));
+      }
+      else if(available == 0 && fStream.avail_out == previous)
+      {
+        Truncated("gzip");
+      }
+    }
+
+    return size - fStream.avail_out;
+  }
+
+private:
+  z_stream fStream;
+  bool fFinished;
+};
+
+#endif
+
+//------------------------------------------------------------------------------
+
+#ifdef HAS_ZSTD
+
+class DelphesZstdDecoder: public DelphesDecoder
+{
+public:
+  DelphesZstdDecoder(FILE *file, const char *magic, size_t magicSize) :
+    DelphesDecoder(file, magic, magicSize), fHint(1)
+  {
+    fContext = ZSTD_createDStream();
+    if(!fContext) throw runtime_error("can't initialize zstd decoder");
+    ZSTD_initDStream(fContext);
+  }
+
+  ~DelphesZstdDecoder()
+  {
+    ZSTD_freeDStream(fContext);
+  }
+
+  size_t Decode(char *output, size_t size)
+  {
+    ZSTD_outBuffer out = {output, size, 0};
+    ZSTD_inBuffer in;
+    size_t available, previous, hint;
+
+    while(out.pos < out.size)
+    {
+      available = Fill();
+
+      in.src = available > 0 ? &fInput[fBegin] : 0;
+      in.size = available;
+      in.pos = 0;
+      previous = out.pos;
+
+      hint = ZSTD_decompressStream(fContext, &out, &in);
+      if(ZSTD_isError(hint))
+      {
+        throw runtime_error(string("can't decode zstd input: ") + ZSTD_getErrorName(hint));
+      }
+
+      fBegin += in.pos;
+
+      // a zero hint means that the last frame was complete
+      if(available == 0 && out.pos == previous)
+      {
+        if(fHint != 0) Truncated("zstd");
+        break;
+      }
+
+      fHint = hint;
+    }
+
+    return out.pos;
+  }
+
+private:
+  ZSTD_DStream *fContext;
+  size_t fHint;
+};
+
+#endif
+
+//------------------------------------------------------------------------------
+
+#ifdef HAS_LZMA
+
+class DelphesXZDecoder: public DelphesDecoder
+{
+public:
+  DelphesXZDecoder(FILE *file, const char *magic, size_t magicSize) :
+    DelphesDecoder(file, magic, magicSize), fFinished(false)
+  {
+    lzma_stream stream = LZMA_STREAM_INIT;
+    fStream = stream;
+    if(lzma_stream_decoder(&fStream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+    {
+      throw runtime_error("can't initialize xz decoder");
+    }
+  }
+
+  ~DelphesXZDecoder()
+  {
+    lzma_end(&fStream);
+  }
+
+  size_t Decode(char *output, size_t size)
+  {
+    size_t available;
+    lzma_ret rc;
+
+    fStream.next_out = reinterpret_cast<uint8_t *>(output);
+    fStream.avail_out = size;
+
+    while(fStream.avail_out > 0 && !fFinished)
+    {
+      available = Fill();
+
+      fStream.next_in = reinterpret_cast<const uint8_t *>(available > 0 ? &fInput[fBegin] : 0);
+      fStream.avail_in = available;
+
+      rc = lzma_code(&fStream, available > 0 ? LZMA_RUN : LZMA_FINISH);
+
+      fBegin = fEnd - fStream.avail_in;
+
+      if(rc == LZMA_STREAM_END)
+      {
+        fFinished = true;
+      }
+      else if(rc == LZMA_BUF_ERROR)
+      {
+        Truncated("xz");
+      }
+      else if(rc != LZMA_OK)
+      {
+        stringstream message;
+        message << "can't decode xz input: error " << rc;
+        throw runtime_error(message.str());
+      }
+    }
+
+    return size - fStream.avail_out;
+  }
+
+private:
+  lzma_stream fStream;
+  bool fFinished;
+};
+
+#endif
+
+//------------------------------------------------------------------------------
+
+#ifdef HAS_LZ4
+
+class DelphesLZ4Decoder: public DelphesDecoder
+{
+public:
+  DelphesLZ4Decoder(FILE *file, const char *magic, size_t magicSize) :
+    DelphesDecoder(file, magic, magicSize), fHint(1)
+  {
+    if(LZ4F_isError(LZ4F_createDecompressionContext(&fContext, LZ4F_VERSION)))
+    {
+      throw runtime_error("can't initialize lz4 decoder");
+    }
+  }
+
+  ~DelphesLZ4Decoder()
+  {
+    LZ4F_freeDecompressionContext(fContext);
+  }
+
+  size_t Decode(char *output, size_t size)
+  {
+    size_t produced = 0, available, inputSize, outputSize, hint;
+
+    while(produced < size)
+    {
+      available = Fill();
+
+      inputSize = available;
+      outputSize = size - produced;
+
+      hint = LZ4F_decompress(fContext, output + produced, &outputSize,
+        available > 0 ? &fInput[fBegin] : 0, &inputSize, 0);
+      if(LZ4F_isError(hint))
+      {
+        throw runtime_error(string("can't decode lz4 input: ") + LZ4F_getErrorName(hint));
+      }
+
+      fBegin += inputSize;
+      produced += outputSize;
+
+      // a zero hint means that the last frame was complete
+      if(available == 0 && outputSize == 0)
+      {
+        if(fHint != 0) Truncated("lz4");
+        break;
+      }
+
+      fHint = hint;
+    }
+
+    return produced;
+  }
+
+private:
+  LZ4F_dctx *fContext;
+  size_t fHint;
+};
+
+#endif
+
+//------------------------------------------------------------------------------
+
+#ifdef __APPLE__
+static int ReadCookie(void *cookie, char *buffer, int size)
+#else
+static ssize_t ReadCookie(void *cookie, char *buffer, size_t size)
+#endif
+{
+  return static_cast<DelphesInputStream *>(cookie)->Read(buffer, size);
+}
+
+//------------------------------------------------------------------------------
+
+static DelphesInputStream::Compression DetectCompression(const unsigned char *magic, size_t size)
+{
+  if(size >= 2 && magic[0] == 0x1F && magic[1] == 0x8B)
+  {
+    return DelphesInputStream::kGzip;
+  }
+  else if(size >= 4 && magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD)
+  {
+    return DelphesInputStream::kZstd;
+  }
+  else if(size >= 6 && memcmp(magic, "\xFD" "7zXZ\0", 6) == 0)
+  {
+    return DelphesInputStream::kXZ;
+  }
+  else if(size >= 4 && magic[0] == 0x04 && magic[1] == 0x22 && magic[2] == 0x4D && magic[3] == 0x18)
+  {
+    return DelphesInputStream::kLZ4;
+  }
+  return DelphesInputStream::kNone;
+}
+
+//------------------------------------------------------------------------------
+
+DelphesInputStream::DelphesInputStream(const char *fileName, bool threaded) :
+  fRawFile(0), fFile(0), fCompression(kNone), fSize(-1),
+  fDecoder(0), fReadAhead(0), fOffset(0), fPosition(0)
+{
+  stringstream message;
+  struct stat status;
+  char magic[kMagicSize];
+  size_t magicSize;
+  bool regular;
+
+  fBlock.size = 0;
+  fBlock.position = 0;
+
+  if(!fileName || strncmp(fileName, "-", 2) == 0)
+  {
+    fRawFile = stdin;
+  }
+  else
+  {
+    fRawFile = fopen(fileName, "rb");
+    if(fRawFile == NULL)
+    {
+      message << "can't open " << fileName;
+      throw runtime_error(message.str());
+    }
+  }
+
+  regular = fstat(fileno(fRawFile), &status) == 0 && S_ISREG(status.st_mode);
+  if(regular) fSize = status.st_size;
+
+#ifdef POSIX_FADV_SEQUENTIAL
+  if(regular) posix_fadvise(fileno(fRawFile), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  magicSize = fread(magic, 1, kMagicSize, fRawFile);
+  fCompression = DetectCompression(reinterpret_cast<unsigned char *>(magic), magicSize);
+
+  // uncompressed files are read directly
+  if(fCompression == kNone && regular && fseeko(fRawFile, 0, SEEK_SET) == 0)
+  {
+    fFile = fRawFile;
+    return;
+  }
+
+  try
+  {
+    switch(fCompression)
+    {
+      case kNone:
+        fDecoder = new DelphesPlainDecoder(fRawFile, magic, magicSize);
+        break;
+#ifdef HAS_ZLIB
+      case kGzip:
+        fDecoder = new DelphesGzipDecoder(fRawFile, magic, magicSize);
+        break;
+#endif
+#ifdef HAS_ZSTD
+      case kZstd:
+        fDecoder = new DelphesZstdDecoder(fRawFile, magic, magicSize);
+        break;
+#endif
+#ifdef HAS_LZMA
+      case kXZ:
+        fDecoder = new DelphesXZDecoder(fRawFile, magic, magicSize);
+        break;
+#endif
+#ifdef HAS_LZ4
+      case kLZ4:
+        fDecoder = new DelphesLZ4Decoder(fRawFile, magic, magicSize);
+        break;
+#endif
+      default:
+        message << GetCompressionName() << " input is not supported by this build";
+        throw runtime_error(message.str());
+    }
+
+#ifdef __APPLE__
+    fFile = funopen(this, ReadCookie, 0, 0, 0);
+#else
+    cookie_io_functions_t functions = {ReadCookie, 0, 0, 0};
+    fFile = fopencookie(this, "r", functions);
+#endif
+    if(fFile == NULL)
+    {
+      throw runtime_error("can't create input stream");
+    }
+  }
+  catch(...)
+  {
+    delete fDecoder;
+    if(fRawFile != stdin) fclose(fRawFile);
+    throw;
+  }
+
+  if(threaded && fCompression != kNone)
+  {
+    fReadAhead = new DelphesReadAhead<Block>(kReadAheadBlocks,
+      bind(&DelphesInputStream::DecodeBlock, this, placeholders::_1));
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesInputStream::~DelphesInputStream()
+{
+  delete fReadAhead;
+
+  if(fFile && fFile != fRawFile) fclose(fFile);
+
+  delete fDecoder;
+
+  if(fRawFile && fRawFile != stdin) fclose(fRawFile);
+}
+
+//------------------------------------------------------------------------------
+
+const char *DelphesInputStream::GetCompressionName() const
+{
+  switch(fCompression)
+  {
+    case kGzip:
+      return "gzip";
+    case kZstd:
+      return "zstd";
+    case kXZ:
+      return "xz";
+    case kLZ4:
+      return "lz4";
+    default:
+      return "uncompressed";
+  }
+}
+
+//------------------------------------------------------------------------------
+
+int64_t DelphesInputStream::GetPosition() const
+{
+  if(fFile == fRawFile) return ftello(fFile);
+  return fPosition;
+}
+
+//------------------------------------------------------------------------------
+
+int64_t DelphesInputStream::Read(char *buffer, size_t size)
+{
+  size_t available;
+  bool ready;
+
+  while(fOffset == fBlock.size)
+  {
+    try
+    {
+      ready = fReadAhead ? fReadAhead->Next(fBlock) : DecodeBlock(fBlock);
+    }
+    catch(runtime_error &e)
+    {
+      // exceptions must not cross the C library
+      fprintf(stderr, "** ERROR: %s\n", e.what());
+      return -1;
+    }
+
+    if(!ready) return 0;
+
+    fOffset = 0;
+    fPosition = fBlock.position;
+  }
+
+  available = min(size, fBlock.size - fOffset);
+  memcpy(buffer, &fBlock.data[fOffset], available);
+  fOffset += available;
+
+  return available;
+}
+
+//------------------------------------------------------------------------------
+
+bool DelphesInputStream::DecodeBlock(Block &block)
+{
+  size_t size;
+
+  if(block.data.size() < kBlockSize) block.data.resize(kBlockSize);
+
+  block.size = 0;
+  while(block.size < kBlockSize)
+  {
+    size = fDecoder->Decode(&block.data[block.size], kBlockSize - block.size);
+    if(size == 0) break;
+    block.size += size;
+  }
+
+  block.position = fDecoder->GetPosition();
+
+  return block.size > 0;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,102 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesInputStream_h
+#define DelphesInputStream_h
+
+/** \class DelphesInputStream
+ *
+ *  Opens an input file, or the standard input, and provides its content
+ *  as a FILE stream, decompressing gzip, zstd, xz and lz4 data on the fly.
+ *  The format is recognized from the first bytes of the input.
+ *
+ *  Compressed data are decoded in large blocks on a background thread,
+ *  and the position reported for progress bars counts compressed bytes.
+ *
+ *  Support for each format depends on the libraries found at build time
+ *  (HAS_ZLIB, HAS_ZSTD, HAS_LZMA and HAS_LZ4).
+ *
+ */
+
+#include <atomic>
+#include <vector>
+
+#include <stdint.h>
+#include <stdio.h>
+
+class DelphesDecoder;
+
+template <class Event>
+class DelphesReadAhead;
+
+class DelphesInputStream
+{
+public:
+  enum Compression
+  {
+    kNone,
+    kGzip,
+    kZstd,
+    kXZ,
+    kLZ4
+  };
+
+  // with no file name, or when fileName is -, reads standard input
+  DelphesInputStream(const char *fileName, bool threaded = true);
+
+  ~DelphesInputStream();
+
+  FILE *GetFile() const { return fFile; }
+
+  Compression GetCompression() const { return fCompression; }
+  const char *GetCompressionName() const;
+
+  // size of the input in bytes, -1 when unknown
+  int64_t GetSize() const { return fSize; }
+
+  // number of input bytes read so far
+  int64_t GetPosition() const;
+
+  // decompressed data, as read through GetFile
+  int64_t Read(char *buffer, size_t size);
+
+private:
+  struct Block
+  {
+    std::vector<char> data;
+    size_t size;
+    int64_t position;
+  };
+
+  bool DecodeBlock(Block &block);
+
+  FILE *fRawFile;
+  FILE *fFile;
+
+  Compression fCompression;
+  int64_t fSize;
+
+  DelphesDecoder *fDecoder;
+  DelphesReadAhead<Block> *fReadAhead;
+
+  Block fBlock;
+  size_t fOffset;
+  std::atomic<int64_t> fPosition;
+};
+
+#endif // DelphesInputStream_h
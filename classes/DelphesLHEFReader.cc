@@ -20,12 +20,16 @@
  *
  *  Reads LHEF file
  *
+ *  With SetReadAhead, events are parsed on a background thread and
+ *  ReadBlock returns one complete event per call.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
 
 #include "classes/DelphesLHEFReader.h"
 
+#include <functional>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
@@ -52,8 +56,8 @@ static const int kBufferSize = 16384;
 
 DelphesLHEFReader::DelphesLHEFReader() :
   fInputFile(0), fBuffer(0), fPDG(0),
-  fEventReady(kFALSE), fEventCounter(-1), fParticleCounter(-1), fCrossSection(1)
-
+  fEventReady(kFALSE), fEventCounter(-1), fParticleCounter(-1), fCrossSection(1),
+  fReadAheadSize(0), fReadAhead(0)
 {
   fBuffer = new char[kBufferSize];
 
@@ -64,6 +68,7 @@ DelphesLHEFReader::DelphesLHEFReader() :
 
 DelphesLHEFReader::~DelphesLHEFReader()
 {
+  StopReadAhead();
   if(fBuffer) delete[] fBuffer;
 }
 
@@ -71,24 +76,56 @@ DelphesLHEFReader::~DelphesLHEFReader()
 
 void DelphesLHEFReader::SetInputFile(FILE *inputFile)
 {
+  StopReadAhead();
+
   fInputFile = inputFile;
+
+  if(fInputFile && fReadAheadSize > 0)
+  {
+    Reset();
+    // build the particle lookup table before it is shared with the reading thread
+    fPDG->GetParticle(0);
+    fReadAhead = new DelphesReadAhead<EventRecord>(fReadAheadSize,
+      bind(&DelphesLHEFReader::ReadEvent, this, placeholders::_1));
+  }
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesLHEFReader::StopReadAhead()
+{
+  if(fReadAhead)
+  {
+    delete fReadAhead;
+    fReadAhead = 0;
+  }
 }
 
 //---------------------------------------------------------------------------
 
 void DelphesLHEFReader::Clear()
+{
+  // the reading thread starts every event from a clean state
+  if(!fReadAhead) Reset();
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesLHEFReader::Reset()
 {
   fEventReady = kFALSE;
   fEventCounter = -1;
   fParticleCounter = -1;
   fWeightList.clear();
+  fParticles.clear();
 }
 
 //---------------------------------------------------------------------------
 
 bool DelphesLHEFReader::EventReady()
 {
-  return fEventReady;
+  // events read ahead are always complete
+  return fReadAhead || fEventReady;
 }
 
 //---------------------------------------------------------------------------
@@ -97,16 +134,77 @@ bool DelphesLHEFReader::ReadBlock(DelphesFactory *factory,
   TObjArray *allParticleOutputArray,
   TObjArray *stableParticleOutputArray,
   TObjArray *partonOutputArray)
+{
+  if(fReadAhead)
+  {
+    if(!fReadAhead->Next(fEvent)) return kFALSE;
+
+    fEvent.Materialize(factory, allParticleOutputArray,
+      stableParticleOutputArray, partonOutputArray);
+
+    return kTRUE;
+  }
+
+  if(!fgets(fBuffer, kBufferSize, fInputFile) || !ParseLine()) return kFALSE;
+
+  if(fEventReady)
+  {
+    FinishEvent(fEvent);
+
+    fEvent.Materialize(factory, allParticleOutputArray,
+      stableParticleOutputArray, partonOutputArray);
+  }
+
+  return kTRUE;
+}
+
+//---------------------------------------------------------------------------
+
+// runs on the reading thread
+bool DelphesLHEFReader::ReadEvent(EventRecord &event)
+{
+  while(fgets(fBuffer, kBufferSize, fInputFile))
+  {
+    if(!ParseLine()) return false;
+
+    if(fEventReady)
+    {
+      FinishEvent(event);
+      Reset();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesLHEFReader::FinishEvent(EventRecord &event)
+{
+  event.particles.swap(fParticles);
+  fParticles.clear();
+
+  event.processID = fProcessID;
+  event.crossSection = fCrossSection;
+  event.weight = fWeight;
+  event.scalePDF = fScalePDF;
+  event.alphaQCD = fAlphaQCD;
+  event.alphaQED = fAlphaQED;
+  event.weights = fWeightList;
+}
+
+//---------------------------------------------------------------------------
+
+bool DelphesLHEFReader::ParseLine()
 {
   int rc, id;
   char *pch;
   double weight, xsec;
 
-  if(!fgets(fBuffer, kBufferSize, fInputFile)) return kFALSE;
-
   if(strstr(fBuffer, "<event>"))
   {
-    Clear();
+    Reset();
     fEventCounter = 1;
   }
   else if(fEventCounter > 0)
@@ -152,8 +250,7 @@ bool DelphesLHEFReader::ReadBlock(DelphesFactory *factory,
       return kFALSE;
     }
 
-    AnalyzeParticle(factory, allParticleOutputArray,
-      stableParticleOutputArray, partonOutputArray);
+    AnalyzeParticle();
 
     --fParticleCounter;
   }
@@ -238,13 +335,13 @@ void DelphesLHEFReader::AnalyzeEvent(ExRootTreeBranch *branch, long long eventNu
   element = static_cast<LHEFEvent *>(branch->NewEntry());
   element->Number = eventNumber;
 
-  element->ProcessID = fProcessID;
-  element->Weight = fWeight;
-  element->CrossSection = fCrossSection;
+  element->ProcessID = fEvent.processID;
+  element->Weight = fEvent.weight;
+  element->CrossSection = fEvent.crossSection;
 
-  element->ScalePDF = fScalePDF;
-  element->AlphaQED = fAlphaQED;
-  element->AlphaQCD = fAlphaQCD;
+  element->ScalePDF = fEvent.scalePDF;
+  element->AlphaQED = fEvent.alphaQED;
+  element->AlphaQCD = fEvent.alphaQCD;
 
   element->ReadTime = readStopWatch->RealTime();
   element->ProcTime = procStopWatch->RealTime();
@@ -257,7 +354,7 @@ void DelphesLHEFReader::AnalyzeWeight(ExRootTreeBranch *branch)
   LHEFWeight *element;
   vector<pair<int, double> >::const_iterator itWeightList;
 
-  for(itWeightList = fWeightList.begin(); itWeightList != fWeightList.end(); ++itWeightList)
+  for(itWeightList = fEvent.weights.begin(); itWeightList != fEvent.weights.end(); ++itWeightList)
   {
     element = static_cast<LHEFWeight *>(branch->NewEntry());
 
@@ -268,47 +365,37 @@ void DelphesLHEFReader::AnalyzeWeight(ExRootTreeBranch *branch)
 
 //---------------------------------------------------------------------------
 
-void DelphesLHEFReader::AnalyzeParticle(DelphesFactory *factory,
-  TObjArray *allParticleOutputArray,
-  TObjArray *stableParticleOutputArray,
-  TObjArray *partonOutputArray)
+void DelphesLHEFReader::AnalyzeParticle()
 {
-  Candidate *candidate;
+  DelphesStagedParticle particle;
   TParticlePDG *pdgParticle;
   int pdgCode;
 
-  candidate = factory->NewCandidate();
-
-  candidate->PID = fPID;
-  pdgCode = TMath::Abs(candidate->PID);
+  particle.PID = fPID;
+  pdgCode = TMath::Abs(particle.PID);
 
-  candidate->Status = fStatus;
+  particle.Status = fStatus;
 
   pdgParticle = fPDG->GetParticle(fPID);
-  candidate->Charge = pdgParticle ? int(pdgParticle->Charge() / 3.0) : -999;
-  candidate->Mass = fMass;
+  particle.Charge = pdgParticle ? int(pdgParticle->Charge() / 3.0) : -999;
+  particle.Mass = fMass;
 
-  candidate->Momentum.SetPxPyPzE(fPx, fPy, fPz, fE);
-  candidate->Position.SetXYZT(0.0, 0.0, 0.0, 0.0);
+  particle.Px = fPx;
+  particle.Py = fPy;
+  particle.Pz = fPz;
+  particle.E = fE;
+  particle.X = particle.Y = particle.Z = particle.T = 0.0;
 
-  candidate->M1 = fM1 - 1;
-  candidate->M2 = fM2 - 1;
+  particle.M1 = fM1 - 1;
+  particle.M2 = fM2 - 1;
 
-  candidate->D1 = -1;
-  candidate->D2 = -1;
+  particle.D1 = -1;
+  particle.D2 = -1;
 
-  allParticleOutputArray->Add(candidate);
+  particle.Stable = pdgParticle && fStatus == 1;
+  particle.Parton = pdgParticle && !particle.Stable && (pdgCode <= 5 || pdgCode == 21 || pdgCode == 15);
 
-  if(!pdgParticle) return;
-
-  if(fStatus == 1)
-  {
-    stableParticleOutputArray->Add(candidate);
-  }
-  else if(pdgCode <= 5 || pdgCode == 21 || pdgCode == 15)
-  {
-    partonOutputArray->Add(candidate);
-  }
+  fParticles.push_back(particle);
 }
 
 //---------------------------------------------------------------------------
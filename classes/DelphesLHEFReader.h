@@ -23,6 +23,9 @@
  *
  *  Reads LHEF file
  *
+ *  With SetReadAhead, events are parsed on a background thread and
+ *  ReadBlock returns one complete event per call.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
@@ -32,6 +35,8 @@
 #include <utility>
 #include <vector>
 
+#include "classes/DelphesReadAhead.h"
+
 class TObjArray;
 class TStopwatch;
 class TDatabasePDG;
@@ -44,8 +49,15 @@ public:
   DelphesLHEFReader();
   ~DelphesLHEFReader();
 
+  // number of events parsed ahead, 0 to parse while reading
+  void SetReadAhead(int events) { fReadAheadSize = events; }
+
+  // starts reading ahead if enabled
   void SetInputFile(FILE *inputFile);
 
+  // must be called before the input file is closed
+  void StopReadAhead();
+
   void Clear();
   bool EventReady();
 
@@ -60,10 +72,20 @@ public:
   void AnalyzeWeight(ExRootTreeBranch *branch);
 
 private:
-  void AnalyzeParticle(DelphesFactory *factory,
-    TObjArray *allParticleOutputArray,
-    TObjArray *stableParticleOutputArray,
-    TObjArray *partonOutputArray);
+  struct EventRecord: public DelphesStagedEvent
+  {
+    int processID;
+    double crossSection, weight, scalePDF, alphaQCD, alphaQED;
+    std::vector<std::pair<int, double> > weights;
+  };
+
+  void Reset();
+
+  bool ParseLine();
+  bool ReadEvent(EventRecord &event);
+  void FinishEvent(EventRecord &event);
+
+  void AnalyzeParticle();
 
   FILE *fInputFile;
 
@@ -82,6 +104,13 @@ private:
   double fPx, fPy, fPz, fE, fMass;
 
   std::vector<std::pair<int, double> > fWeightList;
+
+  std::vector<DelphesStagedParticle> fParticles;
+
+  EventRecord fEvent;
+
+  int fReadAheadSize;
+  DelphesReadAhead<EventRecord> *fReadAhead;
 };
 
 #endif // DelphesLHEFReader_h
@@ -89,6 +89,8 @@ TObjArray *DelphesModule::ImportArray(const char *name)
     throw runtime_error(message.str());
   }
 
+  fImportedArrays.push_back(name);
+
   return object;
 }
 
@@ -107,12 +109,21 @@ TObjArray *DelphesModule::ExportArray(const char *name)
   array->SetName(name);
   fExportFolder->Add(array);
 
+  fExportedArrays.push_back(string(GetName()) + "/" + name);
+
   return array;
 }
 
 //------------------------------------------------------------------------------
 
-ExRootTreeBranch *DelphesModule::NewBranch(const char *name, TClass *cl)
+ExRootTreeBranch *DelphesModule::NewBranch(const char *name, TClass *cl, const char *fields)
+{
+  return GetTreeWriter()->NewBranch(name, cl, fields);
+}
+
+//------------------------------------------------------------------------------
+
+ExRootTreeWriter *DelphesModule::GetTreeWriter()
 {
   stringstream message;
   if(!fTreeWriter)
@@ -124,7 +135,7 @@ ExRootTreeBranch *DelphesModule::NewBranch(const char *name, TClass *cl)
       throw runtime_error(message.str());
     }
   }
-  return fTreeWriter->NewBranch(name, cl);
+  return fTreeWriter;
 }
 
 //------------------------------------------------------------------------------
@@ -29,6 +29,9 @@
 
 #include "ExRootAnalysis/ExRootTask.h"
 
+#include <string>
+#include <vector>
+
 class TClass;
 class TObject;
 class TFolder;
@@ -53,12 +56,26 @@ public:
   TObjArray *ImportArray(const char *name);
   TObjArray *ExportArray(const char *name);
 
-  ExRootTreeBranch *NewBranch(const char *name, TClass *cl);
+  ExRootTreeBranch *NewBranch(const char *name, TClass *cl, const char *fields = 0);
 
   ExRootResult *GetPlots();
   DelphesFactory *GetFactory();
 
+  // true for modules that neither modify the candidates they import nor the
+  // candidates reached through them (constituents, GetCandidates creating an
+  // array, ...), only clones and new candidates; the other modules are not
+  // run concurrently with any module
+  virtual Bool_t IsReadOnly() const { return kFALSE; }
+
+#if !defined(__CINT__) && !defined(__CLING__)
+  // full names of the arrays imported and exported during Init
+  const std::vector<std::string> &GetImportedArrays() const { return fImportedArrays; }
+  const std::vector<std::string> &GetExportedArrays() const { return fExportedArrays; }
+#endif
+
 protected:
+  ExRootTreeWriter *GetTreeWriter();
+
   ExRootTreeWriter *fTreeWriter;
   DelphesFactory *fFactory;
 
@@ -67,6 +84,11 @@ private:
 
   TFolder *fPlotFolder, *fExportFolder;
 
+#if !defined(__CINT__) && !defined(__CLING__)
+  std::vector<std::string> fImportedArrays; //!
+  std::vector<std::string> fExportedArrays; //!
+#endif
+
   ClassDef(DelphesModule, 1)
 };
 
@@ -0,0 +1,684 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesNpyWriter
+ *
+ *  Streams fixed-shape rows of floats into a NumPy .npy file.
+ *  The leading dimension is the number of rows written and is
+ *  patched into the header when the file is closed.
+ *
+ *  \class DelphesNpzWriter
+ *
+ *  Writes several named arrays of fixed-shape rows into an uncompressed
+ *  .npz archive. The array with the largest rows is written directly into
+ *  the archive and its sizes and CRC are patched when the file is closed,
+ *  the other arrays are kept in memory until then.
+ *
+ */
+
+#include "classes/DelphesNpyWriter.h"
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace std;
+
+static const size_t kHeaderSize = 128;
+
+static const uint32_t kZipLimit = 0xFFFFFFFF;
+
+//------------------------------------------------------------------------------
+
+static void PutUInt16(uint8_t *buffer, uint16_t value)
+{
+  buffer[0] = value & 0xFF;
+  buffer[1] = (value >> 8) & 0xFF;
+}
+
+//------------------------------------------------------------------------------
+
+static void PutUInt32(uint8_t *buffer, uint32_t value)
+{
+  PutUInt16(buffer, value & 0xFFFF);
+  PutUInt16(buffer + 2, (value >> 16) & 0xFFFF);
+}
+
+//------------------------------------------------------------------------------
+
+static void PutUInt64(uint8_t *buffer, uint64_t value)
+{
+  PutUInt32(buffer, value & 0xFFFFFFFF);
+  PutUInt32(buffer + 4, (value >> 32) & 0xFFFFFFFF);
+}
+
+//------------------------------------------------------------------------------
+
+static uint32_t UpdateCRC32(uint32_t crc, const uint8_t *data, size_t size)
+{
+  static uint32_t table[256];
+  static bool initialized = false;
+  uint32_t c;
+  size_t i;
+  int k;
+
+  if(!initialized)
+  {
+    for(i = 0; i < 256; ++i)
+    {
+      c = i;
+      for(k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+    initialized = true;
+  }
+
+  crc = ~crc;
+  for(i = 0; i < size; ++i)
+  {
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+//------------------------------------------------------------------------------
+
+static uint32_t MultiplyGF2(const uint32_t *matrix, uint32_t vector)
+{
+  uint32_t sum = 0;
+
+  for(; vector; vector >>= 1, ++matrix)
+  {
+    if(vector & 1) sum ^= *matrix;
+  }
+  return sum;
+}
+
+//------------------------------------------------------------------------------
+
+static void SquareGF2(uint32_t *square, const uint32_t *matrix)
+{
+  int i;
+
+  for(i = 0; i < 32; ++i) square[i] = MultiplyGF2(matrix, matrix[i]);
+}
+
+//------------------------------------------------------------------------------
+
+// CRC of the concatenation of two blocks from their CRCs and the size of the second,
+// by applying size zero bytes to the first CRC (as crc32_combine of zlib)
+static uint32_t CombineCRC32(uint32_t crc1, uint32_t crc2, uint64_t size2)
+{
+  uint32_t even[32], odd[32], row;
+  int i;
+
+  if(size2 == 0) return crc1;
+
+  // operator for one zero bit
+  odd[0] = 0xEDB88320;
+  row = 1;
+  for(i = 1; i < 32; ++i)
+  {
+    odd[i] = row;
+    row <<= 1;
+  }
+
+  // operators for two and four zero bits
+  SquareGF2(even, odd);
+  SquareGF2(odd, even);
+
+  // apply the operators for one zero byte, two zero bytes, ...
+  while(true)
+  {
+    SquareGF2(even, odd);
+    if(size2 & 1) crc1 = MultiplyGF2(even, crc1);
+    size2 >>= 1;
+    if(size2 == 0) break;
+
+    SquareGF2(odd, even);
+    if(size2 & 1) crc1 = MultiplyGF2(odd, crc1);
+    size2 >>= 1;
+    if(size2 == 0) break;
+  }
+
+  return crc1 ^ crc2;
+}
+
+//------------------------------------------------------------------------------
+
+// zip local file header, with a zip64 extra field for large or unknown sizes
+static size_t WriteLocalHeader(FILE *file, const string &name, uint32_t crc, uint64_t size, bool zip64)
+{
+  uint8_t record[64];
+
+  memset(record, 0, sizeof(record));
+  PutUInt32(record, 0x04034B50);
+  PutUInt16(record + 4, zip64 ? 45 : 20);
+  PutUInt32(record + 14, crc);
+  PutUInt32(record + 18, zip64 ? kZipLimit : size);
+  PutUInt32(record + 22, zip64 ? kZipLimit : size);
+  PutUInt16(record + 26, name.size());
+  PutUInt16(record + 28, zip64 ? 20 : 0);
+  fwrite(record, 1, 30, file);
+  fwrite(name.data(), 1, name.size(), file);
+  if(zip64)
+  {
+    PutUInt16(record, 0x0001);
+    PutUInt16(record + 2, 16);
+    PutUInt64(record + 4, size);
+    PutUInt64(record + 12, size);
+    fwrite(record, 1, 20, file);
+  }
+
+  return 30 + name.size() + (zip64 ? 20 : 0);
+}
+
+//------------------------------------------------------------------------------
+
+static void AddCentralRecord(vector<uint8_t> &central, const string &name, uint32_t crc, uint64_t size, uint64_t offset)
+{
+  uint8_t record[64];
+  bool zip64Size = size >= kZipLimit;
+  bool zip64Offset = offset >= kZipLimit;
+  size_t extraSize = (zip64Size ? 16 : 0) + (zip64Offset ? 8 : 0);
+  size_t length = 0;
+
+  memset(record, 0, sizeof(record));
+  PutUInt32(record, 0x02014B50);
+  PutUInt16(record + 4, (zip64Size || zip64Offset) ? 45 : 20);
+  PutUInt16(record + 6, (zip64Size || zip64Offset) ? 45 : 20);
+  PutUInt32(record + 16, crc);
+  PutUInt32(record + 20, zip64Size ? kZipLimit : size);
+  PutUInt32(record + 24, zip64Size ? kZipLimit : size);
+  PutUInt16(record + 28, name.size());
+  PutUInt16(record + 30, extraSize > 0 ? extraSize + 4 : 0);
+  PutUInt32(record + 42, zip64Offset ? kZipLimit : offset);
+  central.insert(central.end(), record, record + 46);
+  central.insert(central.end(), name.begin(), name.end());
+
+  if(extraSize > 0)
+  {
+    PutUInt16(record, 0x0001);
+    PutUInt16(record + 2, extraSize);
+    if(zip64Size)
+    {
+      PutUInt64(record + 4, size);
+      PutUInt64(record + 12, size);
+      length += 16;
+    }
+    if(zip64Offset)
+    {
+      PutUInt64(record + 4 + length, offset);
+    }
+    central.insert(central.end(), record, record + 4 + extraSize);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesNpyWriter::DelphesNpyWriter(const char *fileName, const vector<size_t> &rowShape, bool halfPrecision) :
+  fRowShape(rowShape), fRowSize(1), fWordSize(halfPrecision ? 2 : 4), fEntries(0), fFile(0)
+{
+  stringstream message;
+  vector<size_t>::const_iterator itShape;
+
+  for(itShape = fRowShape.begin(); itShape != fRowShape.end(); ++itShape)
+  {
+    fRowSize *= *itShape;
+  }
+
+  fBuffer.resize(fRowSize * fWordSize);
+
+  fFile = fopen(fileName, "w+b");
+
+  if(fFile == NULL)
+  {
+    message << "can't open output file " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  WriteHeader();
+}
+
+//------------------------------------------------------------------------------
+
+DelphesNpyWriter::~DelphesNpyWriter()
+{
+  try
+  {
+    Close();
+  }
+  catch(exception &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+uint16_t DelphesNpyWriter::FloatToHalf(float value)
+{
+  uint32_t bits, mantissa, remainder, halfway;
+  uint16_t sign, half;
+  int exponent, shift;
+
+  memcpy(&bits, &value, 4);
+
+  sign = (bits >> 16) & 0x8000;
+  exponent = (bits >> 23) & 0xFF;
+  mantissa = bits & 0x7FFFFF;
+
+  // infinity and NaN
+  if(exponent == 0xFF) return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+
+  exponent = exponent - 127 + 15;
+
+  // overflow
+  if(exponent >= 31) return sign | 0x7C00;
+
+  // subnormal or underflow
+  if(exponent <= 0)
+  {
+    if(exponent < -10) return sign;
+    mantissa |= 0x800000;
+    shift = 14 - exponent;
+    half = mantissa >> shift;
+    remainder = mantissa & ((1 << shift) - 1);
+    halfway = 1 << (shift - 1);
+    if(remainder > halfway || (remainder == halfway && (half & 1))) ++half;
+    return sign | half;
+  }
+
+  // round to nearest even, the carry propagates into the exponent
+  half = sign | (exponent << 10) | (mantissa >> 13);
+  remainder = mantissa & 0x1FFF;
+  if(remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) ++half;
+  return half;
+}
+
+//------------------------------------------------------------------------------
+
+string DelphesNpyWriter::GetHeader(const vector<size_t> &rowShape, size_t wordSize, int64_t entries)
+{
+  stringstream header;
+  vector<size_t>::const_iterator itShape;
+  uint8_t preamble[10] = {0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0, 0, 0};
+
+  header << "{'descr': '<f" << wordSize << "', 'fortran_order': False, 'shape': (" << entries << ",";
+  for(itShape = rowShape.begin(); itShape != rowShape.end(); ++itShape)
+  {
+    header << " " << *itShape << ",";
+  }
+  header << "), }";
+
+  string text = header.str();
+
+  if(text.size() + 11 > kHeaderSize)
+  {
+    throw runtime_error("npy header too long");
+  }
+
+  // pad with spaces so that the header size never changes when the shape is updated
+  text.resize(kHeaderSize - 11, ' ');
+  text += '\n';
+
+  PutUInt16(preamble + 8, text.size());
+
+  return string(preamble, preamble + 10) + text;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesNpyWriter::EncodeRow(const float *values, size_t rowSize, size_t wordSize, uint8_t *buffer)
+{
+  size_t i;
+
+  if(wordSize == 2)
+  {
+    for(i = 0; i < rowSize; ++i)
+    {
+      PutUInt16(buffer + 2 * i, FloatToHalf(values[i]));
+    }
+  }
+  else
+  {
+    memcpy(buffer, values, rowSize * 4);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesNpyWriter::WriteHeader()
+{
+  string header = GetHeader(fRowShape, fWordSize, fEntries);
+
+  fseeko(fFile, 0, SEEK_SET);
+  fwrite(header.data(), 1, header.size(), fFile);
+  fseeko(fFile, 0, SEEK_END);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesNpyWriter::WriteRow(const float *values)
+{
+  if(!fFile)
+  {
+    throw runtime_error("npy file is already closed");
+  }
+
+  EncodeRow(values, fRowSize, fWordSize, &fBuffer[0]);
+
+  if(fwrite(&fBuffer[0], 1, fBuffer.size(), fFile) != fBuffer.size())
+  {
+    throw runtime_error("can't write to npy file");
+  }
+
+  ++fEntries;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesNpyWriter::Close()
+{
+  if(!fFile) return;
+
+  WriteHeader();
+  fclose(fFile);
+  fFile = 0;
+}
+
+//------------------------------------------------------------------------------
+
+DelphesNpzWriter::DelphesNpzWriter(const char *fileName, bool halfPrecision) :
+  fFileName(fileName), fWordSize(halfPrecision ? 2 : 4), fFile(0),
+  fStreamCRC(0), fStreamSize(0)
+{
+  stringstream message;
+
+  fFile = fopen(fileName, "w+b");
+
+  if(fFile == NULL)
+  {
+    message << "can't open output file " << fileName;
+    throw runtime_error(message.str());
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesNpzWriter::~DelphesNpzWriter()
+{
+  try
+  {
+    Close();
+  }
+  catch(exception &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesNpzWriter::AddArray(const char *name, const vector<size_t> &rowShape)
+{
+  stringstream message;
+  vector<size_t>::const_iterator itShape;
+
+  if(fArrays.find(name) != fArrays.end())
+  {
+    message << "array " << name << " is already defined";
+    throw runtime_error(message.str());
+  }
+
+  if(!fFile || !fStreamName.empty())
+  {
+    throw runtime_error("npz arrays must be defined before the first row is written");
+  }
+
+  Array &array = fArrays[name];
+  array.rowShape = rowShape;
+  array.rowSize = 1;
+  array.entries = 0;
+  for(itShape = rowShape.begin(); itShape != rowShape.end(); ++itShape)
+  {
+    array.rowSize *= *itShape;
+  }
+
+  fNames.push_back(name);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesNpzWriter::StartStream()
+{
+  vector<string>::iterator itName;
+  string header;
+  size_t largest = 0;
+
+  // the largest rows go directly to the archive, its local header is patched in Finish
+  for(itName = fNames.begin(); itName != fNames.end(); ++itName)
+  {
+    if(fStreamName.empty() || fArrays[*itName].rowSize > largest)
+    {
+      fStreamName = *itName;
+      largest = fArrays[*itName].rowSize;
+    }
+  }
+
+  Array &array = fArrays[fStreamName];
+  header = DelphesNpyWriter::GetHeader(array.rowShape, fWordSize, 0);
+
+  WriteLocalHeader(fFile, fStreamName + ".npy", 0, 0, true);
+  fwrite(header.data(), 1, header.size(), fFile);
+
+  fStreamCRC = 0;
+  fStreamSize = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesNpzWriter::WriteRow(const char *name, const float *values)
+{
+  stringstream message;
+  map<string, Array>::iterator itArray = fArrays.find(name);
+  size_t size;
+
+  if(itArray == fArrays.end())
+  {
+    message << "array " << name << " is not defined";
+    throw runtime_error(message.str());
+  }
+
+  if(!fFile)
+  {
+    throw runtime_error("npz file is already closed");
+  }
+
+  if(fStreamName.empty()) StartStream();
+
+  Array &array = itArray->second;
+  size = array.rowSize * fWordSize;
+
+  if(itArray->first == fStreamName)
+  {
+    fBuffer.resize(size);
+    DelphesNpyWriter::EncodeRow(values, array.rowSize, fWordSize, &fBuffer[0]);
+    if(fwrite(&fBuffer[0], 1, size, fFile) != size)
+    {
+      throw runtime_error("can't write to npz file");
+    }
+    fStreamCRC = UpdateCRC32(fStreamCRC, &fBuffer[0], size);
+    fStreamSize += size;
+  }
+  else
+  {
+    array.data.resize(array.data.size() + size);
+    DelphesNpyWriter::EncodeRow(values, array.rowSize, fWordSize, &array.data[array.data.size() - size]);
+  }
+
+  ++array.entries;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesNpzWriter::Close()
+{
+  if(!fFile) return;
+
+  try
+  {
+    Finish();
+  }
+  catch(...)
+  {
+    fclose(fFile);
+    fFile = 0;
+    throw;
+  }
+
+  if(fclose(fFile) != 0)
+  {
+    fFile = 0;
+    throw runtime_error("can't write to npz file");
+  }
+  fFile = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesNpzWriter::Finish()
+{
+  vector<string>::iterator itName;
+  vector<uint8_t> central;
+  map<string, uint64_t> offsets;
+  map<string, uint32_t> crcs;
+  map<string, uint64_t> sizes;
+  uint8_t record[64];
+  string memberName, header;
+  uint64_t size, offset, end, centralOffset, centralSize, dataOffset;
+  uint32_t crc;
+
+  // members are stored without compression, the float16 payload barely compresses
+
+  // complete the streamed member: npy header, then CRC and sizes of the local header
+  if(!fNames.empty())
+  {
+    if(fStreamName.empty()) StartStream();
+
+    Array &stream = fArrays[fStreamName];
+    header = DelphesNpyWriter::GetHeader(stream.rowShape, fWordSize, stream.entries);
+    memberName = fStreamName + ".npy";
+    dataOffset = 30 + memberName.size() + 20;
+    size = header.size() + fStreamSize;
+    crc = CombineCRC32(UpdateCRC32(0, (const uint8_t *)header.data(), header.size()), fStreamCRC, fStreamSize);
+
+    end = ftello(fFile);
+    fseeko(fFile, 0, SEEK_SET);
+    WriteLocalHeader(fFile, memberName, crc, size, true);
+    fwrite(header.data(), 1, header.size(), fFile);
+    fseeko(fFile, end, SEEK_SET);
+
+    if(end != dataOffset + size)
+    {
+      throw runtime_error("can't write to npz file");
+    }
+
+    offsets[fStreamName] = 0;
+    crcs[fStreamName] = crc;
+    sizes[fStreamName] = size;
+  }
+
+  // then the members kept in memory
+  for(itName = fNames.begin(); itName != fNames.end(); ++itName)
+  {
+    if(*itName == fStreamName) continue;
+
+    Array &array = fArrays[*itName];
+    header = DelphesNpyWriter::GetHeader(array.rowShape, fWordSize, array.entries);
+    memberName = *itName + ".npy";
+    size = header.size() + array.data.size();
+    crc = UpdateCRC32(0, (const uint8_t *)header.data(), header.size());
+    if(!array.data.empty()) crc = UpdateCRC32(crc, &array.data[0], array.data.size());
+
+    offset = ftello(fFile);
+    WriteLocalHeader(fFile, memberName, crc, size, size >= kZipLimit);
+    fwrite(header.data(), 1, header.size(), fFile);
+    if(!array.data.empty() && fwrite(&array.data[0], 1, array.data.size(), fFile) != array.data.size())
+    {
+      throw runtime_error("can't write to npz file");
+    }
+
+    offsets[*itName] = offset;
+    crcs[*itName] = crc;
+    sizes[*itName] = size;
+  }
+
+  // central directory, in the order of definition of the arrays
+  for(itName = fNames.begin(); itName != fNames.end(); ++itName)
+  {
+    AddCentralRecord(central, *itName + ".npy", crcs[*itName], sizes[*itName], offsets[*itName]);
+  }
+
+  centralOffset = ftello(fFile);
+  centralSize = central.size();
+  if(!central.empty()) fwrite(&central[0], 1, central.size(), fFile);
+
+  if(centralOffset >= kZipLimit)
+  {
+    // zip64 end of central directory record and locator
+    end = ftello(fFile);
+    memset(record, 0, sizeof(record));
+    PutUInt32(record, 0x06064B50);
+    PutUInt64(record + 4, 44);
+    PutUInt16(record + 12, 45);
+    PutUInt16(record + 14, 45);
+    PutUInt64(record + 24, fNames.size());
+    PutUInt64(record + 32, fNames.size());
+    PutUInt64(record + 40, centralSize);
+    PutUInt64(record + 48, centralOffset);
+    fwrite(record, 1, 56, fFile);
+
+    memset(record, 0, sizeof(record));
+    PutUInt32(record, 0x07064B50);
+    PutUInt64(record + 8, end);
+    PutUInt32(record + 16, 1);
+    fwrite(record, 1, 20, fFile);
+  }
+
+  // end of central directory record
+  memset(record, 0, sizeof(record));
+  PutUInt32(record, 0x06054B50);
+  PutUInt16(record + 8, fNames.size());
+  PutUInt16(record + 10, fNames.size());
+  PutUInt32(record + 12, centralSize);
+  PutUInt32(record + 16, centralOffset >= kZipLimit ? kZipLimit : centralOffset);
+  if(fwrite(record, 1, 22, fFile) != 22)
+  {
+    throw runtime_error("can't write to npz file");
+  }
+
+  fArrays.clear();
+  fNames.clear();
+}
+
+//------------------------------------------------------------------------------
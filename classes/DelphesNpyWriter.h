@@ -0,0 +1,119 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesNpyWriter_h
+#define DelphesNpyWriter_h
+
+/** \class DelphesNpyWriter
+ *
+ *  Streams fixed-shape rows of floats into a NumPy .npy file.
+ *  The leading dimension is the number of rows written and is
+ *  patched into the header when the file is closed.
+ *
+ *  \class DelphesNpzWriter
+ *
+ *  Writes several named arrays of fixed-shape rows into an uncompressed
+ *  .npz archive. The array with the largest rows is written directly into
+ *  the archive and its sizes and CRC are patched when the file is closed,
+ *  the other arrays are kept in memory until then.
+ *
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <stdio.h>
+
+class DelphesNpyWriter
+{
+public:
+  DelphesNpyWriter(const char *fileName, const std::vector<size_t> &rowShape, bool halfPrecision = true);
+
+  ~DelphesNpyWriter();
+
+  void WriteRow(const float *values);
+
+  void Close();
+
+  size_t GetRowSize() const { return fRowSize; }
+  int64_t GetEntries() const { return fEntries; }
+
+  static uint16_t FloatToHalf(float value);
+
+  // npy header of fixed size, so that it can be rewritten when the number of rows is known
+  static std::string GetHeader(const std::vector<size_t> &rowShape, size_t wordSize, int64_t entries);
+
+  static void EncodeRow(const float *values, size_t rowSize, size_t wordSize, uint8_t *buffer);
+
+private:
+  void WriteHeader();
+
+  std::vector<size_t> fRowShape;
+  size_t fRowSize;
+  size_t fWordSize;
+  int64_t fEntries;
+
+  FILE *fFile;
+  std::vector<uint8_t> fBuffer;
+};
+
+//------------------------------------------------------------------------------
+
+class DelphesNpzWriter
+{
+public:
+  DelphesNpzWriter(const char *fileName, bool halfPrecision = true);
+
+  ~DelphesNpzWriter();
+
+  void AddArray(const char *name, const std::vector<size_t> &rowShape);
+
+  void WriteRow(const char *name, const float *values);
+
+  void Close();
+
+private:
+  struct Array
+  {
+    std::vector<size_t> rowShape;
+    size_t rowSize;
+    int64_t entries;
+    std::vector<uint8_t> data; // encoded rows, except for the streamed array
+  };
+
+  void StartStream();
+  void Finish();
+
+  std::string fFileName;
+  size_t fWordSize;
+
+  FILE *fFile;
+
+  std::vector<std::string> fNames;
+  std::map<std::string, Array> fArrays;
+
+  std::string fStreamName; // array written directly to the archive
+  uint32_t fStreamCRC;
+  uint64_t fStreamSize;
+
+  std::vector<uint8_t> fBuffer;
+};
+
+#endif // DelphesNpyWriter_h
@@ -0,0 +1,547 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesPapuLoader
+ *
+ *  Streams the Papu "events" trees written by PapuDelphesTrain into
+ *  fixed-shape float16 batches with the layout of the .npz files
+ *  (x, met, recoil, jet1 and jet2), so that training does not need to
+ *  materialize the whole data set in memory.
+ *  With the kInfer layout, the trees written by PapuDelphesInfer are read
+ *  as by convert_infer.py: x has the isolep feature in addition and the
+ *  genz and recz arrays are filled.
+ *
+ *  The entries of all files are split into contiguous shards, one per
+ *  training worker. Batches are read ahead on background threads, at most
+ *  "prefetch" batches are kept in memory and they are returned in order.
+ *
+ *  A C interface is provided for the Python binding in data_recoil/loader.py.
+ *
+ */
+
+#include "classes/DelphesPapuLoader.h"
+#include "classes/DelphesNpyWriter.h"
+
+#include "RVersion.h"
+#include "TChain.h"
+#include "TROOT.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <string.h>
+
+using namespace std;
+
+// the kTrain layout uses the first 13 features and 12 targets
+static const size_t kNumberOfFeatures[2] = {13, 14};
+static const size_t kNumberOfTargets[2] = {12, 16};
+
+static const size_t kMaxFeatures = 14;
+static const size_t kMaxTargets = 16;
+
+static const char *kFeatureNames[kMaxFeatures] = {
+  "pt", "eta", "phi", "e", "puppi", "pdgid", "hardfrac", "cluster_idx", "vtxid",
+  "cluster_r", "cluster_hardch_pt", "cluster_puch_pt", "npv", "isolep"};
+
+// values of the padding particles, as in PapuClusterOrdering::Order
+static const float kFeatureDefaults[kMaxFeatures] = {
+  0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 1.0, -1.0, -1.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+static const char *kTargetNames[kMaxTargets] = {
+  "genmet", "genmetphi", "genUmag", "genUphi",
+  "genjet1pt", "genjet1eta", "genjet1phi", "genjet1e",
+  "genjet2pt", "genjet2eta", "genjet2phi", "genjet2e",
+  "genZpt", "genZphi", "recZpt", "recZphi"};
+
+//------------------------------------------------------------------------------
+
+class DelphesPapuLoader::Reader
+{
+public:
+  Reader(const vector<string> &fileNames, Layout layout);
+  ~Reader();
+
+  void Read(Long64_t entry);
+
+  vector<float> *fFeatures[kMaxFeatures];
+  Float_t fTargets[kMaxTargets];
+
+private:
+  TChain *fChain;
+};
+
+//------------------------------------------------------------------------------
+
+DelphesPapuLoader::Reader::Reader(const vector<string> &fileNames, Layout layout) :
+  fChain(0)
+{
+  vector<string>::const_iterator itFileName;
+  stringstream message;
+  size_t i;
+
+  fChain = new TChain("events");
+  for(itFileName = fileNames.begin(); itFileName != fileNames.end(); ++itFileName)
+  {
+    fChain->Add(itFileName->c_str());
+  }
+
+  // only read the branches that end up in the batches
+  fChain->SetBranchStatus("*", 0);
+
+  for(i = 0; i < kMaxFeatures; ++i) fFeatures[i] = 0;
+  for(i = 0; i < kMaxTargets; ++i) fTargets[i] = -99.0;
+
+  for(i = 0; i < kNumberOfFeatures[layout]; ++i)
+  {
+    if(!fChain->GetBranch(kFeatureNames[i]))
+    {
+      delete fChain;
+      message << "can't find branch " << kFeatureNames[i];
+      throw runtime_error(message.str());
+    }
+    fChain->SetBranchStatus(kFeatureNames[i], 1);
+    fChain->SetBranchAddress(kFeatureNames[i], &fFeatures[i]);
+  }
+
+  // missing targets are filled with -99
+  for(i = 0; i < kNumberOfTargets[layout]; ++i)
+  {
+    if(!fChain->GetBranch(kTargetNames[i])) continue;
+    fChain->SetBranchStatus(kTargetNames[i], 1);
+    fChain->SetBranchAddress(kTargetNames[i], &fTargets[i]);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesPapuLoader::Reader::~Reader()
+{
+  if(fChain) delete fChain;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPapuLoader::Reader::Read(Long64_t entry)
+{
+  stringstream message;
+
+  if(fChain->GetEntry(entry) <= 0)
+  {
+    message << "can't read entry " << entry;
+    throw runtime_error(message.str());
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesPapuLoader::DelphesPapuLoader(const vector<string> &fileNames, size_t batchSize, size_t maxParticles,
+  int shard, int numberOfShards, int numberOfThreads, int prefetch, Layout layout) :
+  fFileNames(fileNames), fLayout(layout),
+  fBatchSize(batchSize), fMaxParticles(maxParticles), fNumberOfFeatures(kNumberOfFeatures[layout]),
+  fNumberOfThreads(numberOfThreads), fPrefetch(max(prefetch, 1)),
+  fFirstEntry(0), fLastEntry(0), fNumberOfBatches(0),
+  fNextTask(0), fNextBatch(0), fStop(false), fReader(0)
+{
+  vector<string>::const_iterator itFileName;
+  stringstream message;
+  Long64_t entries;
+
+  if(fBatchSize == 0 || fMaxParticles == 0)
+  {
+    throw runtime_error("batch size and maximum number of particles must be positive");
+  }
+
+  if(numberOfShards < 1 || shard < 0 || shard >= numberOfShards)
+  {
+    message << "invalid shard " << shard << " of " << numberOfShards;
+    throw runtime_error(message.str());
+  }
+
+  // count the entries once to split them into shards
+  TChain chain("events");
+  for(itFileName = fFileNames.begin(); itFileName != fFileNames.end(); ++itFileName)
+  {
+    chain.Add(itFileName->c_str());
+  }
+  entries = chain.GetEntries();
+
+  fFirstEntry = entries * shard / numberOfShards;
+  fLastEntry = entries * (shard + 1) / numberOfShards;
+  fNumberOfBatches = (fLastEntry - fFirstEntry + fBatchSize - 1) / fBatchSize;
+
+  if(fNumberOfThreads > 0)
+  {
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 0, 0)
+    ROOT::EnableThreadSafety();
+#endif
+    Start();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesPapuLoader::~DelphesPapuLoader()
+{
+  Stop();
+  if(fReader) delete fReader;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPapuLoader::Start()
+{
+  int i;
+
+  fStop = false;
+  fError = nullptr;
+  fNextTask = 0;
+  fNextBatch = 0;
+
+  for(i = 0; i < fNumberOfThreads; ++i)
+  {
+    fThreads.push_back(thread(&DelphesPapuLoader::Work, this));
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPapuLoader::Stop()
+{
+  vector<thread>::iterator itThread;
+  map<Long64_t, DelphesPapuBatch *>::iterator itBatch;
+
+  {
+    lock_guard<mutex> lock(fMutex);
+    fStop = true;
+  }
+  fConsumed.notify_all();
+
+  for(itThread = fThreads.begin(); itThread != fThreads.end(); ++itThread)
+  {
+    itThread->join();
+  }
+  fThreads.clear();
+
+  for(itBatch = fReady.begin(); itBatch != fReady.end(); ++itBatch)
+  {
+    delete itBatch->second;
+  }
+  fReady.clear();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPapuLoader::Reset()
+{
+  if(fNumberOfThreads > 0)
+  {
+    Stop();
+    Start();
+  }
+  else
+  {
+    fNextBatch = 0;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPapuLoader::Work()
+{
+  Reader *reader = 0;
+  DelphesPapuBatch *batch = 0;
+  Long64_t index;
+
+  try
+  {
+    reader = new Reader(fFileNames, fLayout);
+
+    while(true)
+    {
+      {
+        unique_lock<mutex> lock(fMutex);
+
+        // do not read more than prefetch batches ahead of the consumer
+        while(!fStop && fNextTask < fNumberOfBatches && fNextTask >= fNextBatch + fPrefetch)
+        {
+          fConsumed.wait(lock);
+        }
+
+        if(fStop || fNextTask >= fNumberOfBatches) break;
+
+        index = fNextTask++;
+      }
+
+      batch = new DelphesPapuBatch;
+      Fill(*reader, index, *batch);
+
+      {
+        lock_guard<mutex> lock(fMutex);
+        fReady[index] = batch;
+        batch = 0;
+      }
+      fProduced.notify_all();
+    }
+  }
+  catch(...)
+  {
+    // any exception is passed to the consumer and rethrown by Next
+    lock_guard<mutex> lock(fMutex);
+    if(!fError) fError = current_exception();
+    fStop = true;
+  }
+
+  if(batch) delete batch;
+  if(reader) delete reader;
+
+  fProduced.notify_all();
+  fConsumed.notify_all();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPapuLoader::Fill(Reader &reader, Long64_t index, DelphesPapuBatch &batch)
+{
+  Long64_t entry, first, last;
+  size_t i, j, k, size;
+  uint16_t *x, *met, *recoil, *jet1, *jet2;
+  uint16_t defaults[kMaxFeatures];
+  size_t features = fNumberOfFeatures;
+  bool infer = (fLayout == kInfer);
+  const vector<float> *feature;
+
+  first = fFirstEntry + index * fBatchSize;
+  last = min(first + Long64_t(fBatchSize), fLastEntry);
+
+  batch.size = last - first;
+
+  // the last batch is padded with zeros to keep the shape fixed
+  batch.x.assign(fBatchSize * fMaxParticles * features, 0);
+  batch.met.assign(fBatchSize * 2, 0);
+  batch.recoil.assign(fBatchSize * 2, 0);
+  batch.jet1.assign(fBatchSize * 4, 0);
+  batch.jet2.assign(fBatchSize * 4, 0);
+  batch.genz.assign(infer ? fBatchSize * 2 : 0, 0);
+  batch.recz.assign(infer ? fBatchSize * 2 : 0, 0);
+
+  for(k = 0; k < features; ++k)
+  {
+    defaults[k] = DelphesNpyWriter::FloatToHalf(kFeatureDefaults[k]);
+  }
+
+  for(entry = first, i = 0; entry < last; ++entry, ++i)
+  {
+    reader.Read(entry);
+
+    x = &batch.x[i * fMaxParticles * features];
+    for(k = 0; k < features; ++k)
+    {
+      feature = reader.fFeatures[k];
+      size = feature ? min(feature->size(), fMaxParticles) : 0;
+      for(j = 0; j < size; ++j)
+      {
+        x[j * features + k] = DelphesNpyWriter::FloatToHalf((*feature)[j]);
+      }
+      for(; j < fMaxParticles; ++j)
+      {
+        x[j * features + k] = defaults[k];
+      }
+    }
+
+    met = &batch.met[i * 2];
+    recoil = &batch.recoil[i * 2];
+    jet1 = &batch.jet1[i * 4];
+    jet2 = &batch.jet2[i * 4];
+
+    for(k = 0; k < 2; ++k)
+    {
+      met[k] = DelphesNpyWriter::FloatToHalf(reader.fTargets[k]);
+      recoil[k] = DelphesNpyWriter::FloatToHalf(reader.fTargets[2 + k]);
+    }
+    for(k = 0; k < 4; ++k)
+    {
+      jet1[k] = DelphesNpyWriter::FloatToHalf(reader.fTargets[4 + k]);
+      jet2[k] = DelphesNpyWriter::FloatToHalf(reader.fTargets[8 + k]);
+    }
+
+    if(infer)
+    {
+      for(k = 0; k < 2; ++k)
+      {
+        batch.genz[i * 2 + k] = DelphesNpyWriter::FloatToHalf(reader.fTargets[12 + k]);
+        batch.recz[i * 2 + k] = DelphesNpyWriter::FloatToHalf(reader.fTargets[14 + k]);
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+bool DelphesPapuLoader::Next(DelphesPapuBatch &batch)
+{
+  map<Long64_t, DelphesPapuBatch *>::iterator itBatch;
+  DelphesPapuBatch *ready;
+
+  if(fNextBatch >= fNumberOfBatches) return false;
+
+  // without background threads the batch is read in place
+  if(fNumberOfThreads <= 0)
+  {
+    if(!fReader) fReader = new Reader(fFileNames, fLayout);
+    Fill(*fReader, fNextBatch, batch);
+    ++fNextBatch;
+    return true;
+  }
+
+  {
+    unique_lock<mutex> lock(fMutex);
+
+    while(!fError && (itBatch = fReady.find(fNextBatch)) == fReady.end())
+    {
+      fProduced.wait(lock);
+    }
+
+    if(fError) rethrow_exception(fError);
+
+    ready = itBatch->second;
+    fReady.erase(itBatch);
+    ++fNextBatch;
+  }
+  fConsumed.notify_all();
+
+  batch.size = ready->size;
+  batch.x.swap(ready->x);
+  batch.met.swap(ready->met);
+  batch.recoil.swap(ready->recoil);
+  batch.jet1.swap(ready->jet1);
+  batch.jet2.swap(ready->jet2);
+  batch.genz.swap(ready->genz);
+  batch.recz.swap(ready->recz);
+
+  delete ready;
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// C interface for the Python binding
+
+struct DelphesPapuLoaderHandle
+{
+  DelphesPapuLoader *loader;
+  DelphesPapuBatch batch;
+};
+
+extern "C" {
+
+DelphesPapuLoaderHandle *DelphesPapuLoader_New(const char **fileNames, int numberOfFiles, size_t batchSize,
+  size_t maxParticles, int shard, int numberOfShards, int numberOfThreads, int prefetch, int layout)
+{
+  DelphesPapuLoaderHandle *handle = 0;
+  vector<string> names(fileNames, fileNames + numberOfFiles);
+
+  try
+  {
+    handle = new DelphesPapuLoaderHandle;
+    handle->loader = new DelphesPapuLoader(names, batchSize, maxParticles,
+      shard, numberOfShards, numberOfThreads, prefetch,
+      layout == DelphesPapuLoader::kInfer ? DelphesPapuLoader::kInfer : DelphesPapuLoader::kTrain);
+  }
+  catch(exception &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+    delete handle;
+    return 0;
+  }
+
+  return handle;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPapuLoader_Delete(DelphesPapuLoaderHandle *handle)
+{
+  if(!handle) return;
+  delete handle->loader;
+  delete handle;
+}
+
+//------------------------------------------------------------------------------
+
+Long64_t DelphesPapuLoader_GetEntries(DelphesPapuLoaderHandle *handle)
+{
+  return handle->loader->GetEntries();
+}
+
+//------------------------------------------------------------------------------
+
+Long64_t DelphesPapuLoader_GetNumberOfBatches(DelphesPapuLoaderHandle *handle)
+{
+  return handle->loader->GetNumberOfBatches();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPapuLoader_Reset(DelphesPapuLoaderHandle *handle)
+{
+  handle->loader->Reset();
+}
+
+//------------------------------------------------------------------------------
+
+// copies the next batch into the given buffers and returns its size,
+// 0 at the end of the shard and -1 on error, genz and recz are only
+// filled with the kInfer layout and may be null otherwise
+Long64_t DelphesPapuLoader_Next(DelphesPapuLoaderHandle *handle,
+  uint16_t *x, uint16_t *met, uint16_t *recoil, uint16_t *jet1, uint16_t *jet2,
+  uint16_t *genz, uint16_t *recz)
+{
+  DelphesPapuBatch &batch = handle->batch;
+
+  try
+  {
+    if(!handle->loader->Next(batch)) return 0;
+  }
+  catch(exception &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+    return -1;
+  }
+  catch(...)
+  {
+    cerr << "** ERROR: unknown exception" << endl;
+    return -1;
+  }
+
+  memcpy(x, &batch.x[0], batch.x.size() * sizeof(uint16_t));
+  memcpy(met, &batch.met[0], batch.met.size() * sizeof(uint16_t));
+  memcpy(recoil, &batch.recoil[0], batch.recoil.size() * sizeof(uint16_t));
+  memcpy(jet1, &batch.jet1[0], batch.jet1.size() * sizeof(uint16_t));
+  memcpy(jet2, &batch.jet2[0], batch.jet2.size() * sizeof(uint16_t));
+  if(genz && !batch.genz.empty()) memcpy(genz, &batch.genz[0], batch.genz.size() * sizeof(uint16_t));
+  if(recz && !batch.recz.empty()) memcpy(recz, &batch.recz[0], batch.recz.size() * sizeof(uint16_t));
+
+  return batch.size;
+}
+
+} // extern "C"
+
+//------------------------------------------------------------------------------
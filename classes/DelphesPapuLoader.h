@@ -0,0 +1,128 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesPapuLoader_h
+#define DelphesPapuLoader_h
+
+/** \class DelphesPapuLoader
+ *
+ *  Streams the Papu "events" trees written by PapuDelphesTrain into
+ *  fixed-shape float16 batches with the layout of the .npz files
+ *  (x, met, recoil, jet1 and jet2), so that training does not need to
+ *  materialize the whole data set in memory.
+ *  With the kInfer layout, the trees written by PapuDelphesInfer are read
+ *  as by convert_infer.py: x has the isolep feature in addition and the
+ *  genz and recz arrays are filled.
+ *
+ *  The entries of all files are split into contiguous shards, one per
+ *  training worker. Batches are read ahead on background threads, at most
+ *  "prefetch" batches are kept in memory and they are returned in order.
+ *
+ *  A C interface is provided for the Python binding in data_recoil/loader.py.
+ *
+ */
+
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdint.h>
+
+#include "Rtypes.h"
+
+//------------------------------------------------------------------------------
+
+struct DelphesPapuBatch
+{
+  size_t size; // number of events, the last batch of a shard may be smaller
+
+  std::vector<uint16_t> x; // [batch size, max particles, features]
+  std::vector<uint16_t> met; // [batch size, 2]
+  std::vector<uint16_t> recoil; // [batch size, 2]
+  std::vector<uint16_t> jet1; // [batch size, 4]
+  std::vector<uint16_t> jet2; // [batch size, 4]
+  std::vector<uint16_t> genz; // [batch size, 2], kInfer layout only
+  std::vector<uint16_t> recz; // [batch size, 2], kInfer layout only
+};
+
+//------------------------------------------------------------------------------
+
+class DelphesPapuLoader
+{
+public:
+  enum Layout
+  {
+    kTrain,
+    kInfer
+  };
+
+  DelphesPapuLoader(const std::vector<std::string> &fileNames, size_t batchSize, size_t maxParticles = 9000,
+    int shard = 0, int numberOfShards = 1, int numberOfThreads = 1, int prefetch = 2, Layout layout = kTrain);
+
+  ~DelphesPapuLoader();
+
+  Long64_t GetEntries() const { return fLastEntry - fFirstEntry; }
+  Long64_t GetNumberOfBatches() const { return fNumberOfBatches; }
+
+  size_t GetBatchSize() const { return fBatchSize; }
+  size_t GetMaxParticles() const { return fMaxParticles; }
+  size_t GetNumberOfFeatures() const { return fNumberOfFeatures; }
+  Layout GetLayout() const { return fLayout; }
+
+  // blocks until the next batch is read, returns false at the end of the shard
+  // an exception thrown while reading a batch in the background is rethrown here
+  bool Next(DelphesPapuBatch &batch);
+
+  // restarts from the first batch of the shard
+  void Reset();
+
+private:
+  class Reader;
+
+  void Start();
+  void Stop();
+  void Work();
+
+  void Fill(Reader &reader, Long64_t index, DelphesPapuBatch &batch);
+
+  std::vector<std::string> fFileNames;
+
+  Layout fLayout;
+
+  size_t fBatchSize, fMaxParticles, fNumberOfFeatures;
+  int fNumberOfThreads, fPrefetch;
+
+  Long64_t fFirstEntry, fLastEntry, fNumberOfBatches;
+  Long64_t fNextTask, fNextBatch;
+
+  bool fStop;
+  std::exception_ptr fError;
+
+  Reader *fReader;
+
+  std::vector<std::thread> fThreads;
+  std::mutex fMutex;
+  std::condition_variable fProduced, fConsumed;
+  std::map<Long64_t, DelphesPapuBatch *> fReady;
+};
+
+#endif // DelphesPapuLoader_h
@@ -0,0 +1,834 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesPapuReader
+ *
+ *  Extracts the per-particle and per-event features used by the Papu
+ *  readers (PapuDelphes, PapuDelphesTrain, PapuDelphesInfer and
+ *  ClusterDelphes) from a Delphes tree in a single read pass.
+ *  Only the branches and leaves needed by the requested features are read.
+ *
+ *  \class PapuClusterOrdering
+ *
+ *  Orders particles by recursive k-means clusters in (eta, cos phi, sin phi)
+ *  and fills the cluster features of each particle.
+ *  Unlike the copies it replaces, empty clusters are dropped (cluster_idx only
+ *  counts non-empty clusters), fewer than k particles form a single cluster and
+ *  clusters that cannot be split are not split again.
+ *
+ *  \class PapuTrainWriter
+ *
+ *  Writes the PapuDelphesTrain output, a ROOT tree or a NumPy .npz file,
+ *  so that it can be filled from the same read pass as another output.
+ *
+ */
+
+#include "classes/DelphesPapuReader.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesNpyWriter.h"
+
+#include "ExRootAnalysis/ExRootTreeReader.h"
+
+#include "TClonesArray.h"
+#include "TFile.h"
+#include "TMath.h"
+#include "TString.h"
+#include "TTree.h"
+#include "TVector2.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+PapuParticle::PapuParticle() :
+  pt(0), eta(0), phi(0), x(0), y(0), e(0), puppi(1), pdgid(0), charge(0),
+  hardfrac(1), cluster_idx(-1), cluster_hardch_pt(0), cluster_puch_pt(0),
+  cluster_r(0), vtxid(-1), npv(0), isolep(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+PapuCluster::PapuCluster() :
+  fEta(0), fPhi(0), fSumPT(0), fHardChargedPT(0), fPileUpChargedPT(0), fR(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+void PapuCluster::Finalize()
+{
+  const_iterator itParticle;
+  PapuParticle *particle;
+  float x = 0.0, y = 0.0, r, dr, largest = -1.0;
+
+  fEta = fPhi = fSumPT = fHardChargedPT = fPileUpChargedPT = fR = 0.0;
+
+  for(itParticle = begin(); itParticle != end(); ++itParticle)
+  {
+    particle = *itParticle;
+    fSumPT += particle->pt;
+    if(particle->vtxid == 0)
+      fHardChargedPT += particle->pt;
+    else if(particle->vtxid == 1)
+      fPileUpChargedPT += particle->pt;
+    fEta += particle->pt * particle->eta;
+    x += particle->pt * particle->x;
+    y += particle->pt * particle->y;
+  }
+
+  fEta /= fSumPT;
+  x /= fSumPT;
+  y /= fSumPT;
+
+  r = sqrt(x * x + y * y);
+  x /= r;
+  y /= r;
+
+  for(itParticle = begin(); itParticle != end(); ++itParticle)
+  {
+    particle = *itParticle;
+    dr = (fEta - particle->eta) * (fEta - particle->eta)
+      + (x - particle->x) * (x - particle->x)
+      + (y - particle->y) * (y - particle->y);
+    if(dr > largest) largest = dr;
+  }
+
+  fR = largest;
+  fPhi = TMath::ATan2(y, x);
+}
+
+//------------------------------------------------------------------------------
+
+PapuClusterOrdering::PapuClusterOrdering(int k, int n, int maxDepth, int maxIterations) :
+  fK(k), fN(n), fMaxDepth(maxDepth), fMaxIterations(maxIterations)
+{
+}
+
+//------------------------------------------------------------------------------
+
+void PapuClusterOrdering::KMeans(const vector<PapuParticle *> &particles, vector<PapuCluster> &clusters)
+{
+  vector<int> seeds(fK);
+  vector<float> centroids(3 * fK);
+  vector<bool> active(fK, true);
+  vector<PapuParticle *>::const_iterator itParticle;
+  PapuParticle *particle;
+  float closest, dr, eta, x, y, r;
+  int i, j, iteration, index, best;
+  bool found;
+
+  clusters.assign(fK, PapuCluster());
+
+  // the centroids are seeded with distinct particles, with fewer particles
+  // than clusters they all go to one cluster (the seeding never ended before)
+  if(particles.size() < size_t(fK))
+  {
+    clusters.resize(1);
+    clusters[0].assign(particles.begin(), particles.end());
+    return;
+  }
+
+  // randomly initialize centroids
+  for(i = 0; i < fK; ++i)
+  {
+    while(true)
+    {
+      index = rand() % particles.size();
+      found = false;
+      for(j = 0; j < i && !found; ++j) found = (seeds[j] == index);
+      if(!found)
+      {
+        seeds[i] = index;
+        centroids[3 * i] = particles[index]->eta;
+        centroids[3 * i + 1] = particles[index]->x;
+        centroids[3 * i + 2] = particles[index]->y;
+        break;
+      }
+    }
+  }
+
+  for(iteration = 0; iteration < fMaxIterations; ++iteration)
+  {
+    // assign particles to the closest centroid
+    for(i = 0; i < fK; ++i) clusters[i].clear();
+
+    for(itParticle = particles.begin(); itParticle != particles.end(); ++itParticle)
+    {
+      particle = *itParticle;
+      closest = 99999.0;
+      best = -1;
+      for(i = 0; i < fK; ++i)
+      {
+        if(!active[i]) continue;
+        dr = (particle->eta - centroids[3 * i]) * (particle->eta - centroids[3 * i])
+          + (particle->x - centroids[3 * i + 1]) * (particle->x - centroids[3 * i + 1])
+          + (particle->y - centroids[3 * i + 2]) * (particle->y - centroids[3 * i + 2]);
+        if(dr < closest)
+        {
+          closest = dr;
+          best = i;
+        }
+      }
+      if(best >= 0) clusters[best].push_back(particle);
+    }
+
+    // update centroids
+    for(i = 0; i < fK; ++i)
+    {
+      PapuCluster &cluster = clusters[i];
+
+      // a cluster left empty has no centroid and stays empty,
+      // as with the undefined (NaN) centroid of the original code
+      if(cluster.empty())
+      {
+        active[i] = false;
+        continue;
+      }
+
+      eta = x = y = 0.0;
+      for(itParticle = cluster.begin(); itParticle != cluster.end(); ++itParticle)
+      {
+        eta += (*itParticle)->eta;
+        x += (*itParticle)->x;
+        y += (*itParticle)->y;
+      }
+
+      x /= cluster.size();
+      y /= cluster.size();
+      r = sqrt(x * x + y * y);
+
+      centroids[3 * i] = eta / cluster.size();
+      centroids[3 * i + 1] = x / r;
+      centroids[3 * i + 2] = y / r;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void PapuClusterOrdering::Fit(const vector<PapuParticle *> &particles, int depth, vector<PapuCluster> &clusters)
+{
+  vector<PapuCluster> split;
+  vector<PapuCluster>::iterator itCluster;
+
+  KMeans(particles, split);
+
+  for(itCluster = split.begin(); itCluster != split.end(); ++itCluster)
+  {
+    // empty clusters are dropped: the original code kept them with an undefined
+    // position, so they took a cluster_idx and broke the proximity ordering
+    if(itCluster->empty()) continue;
+
+    // a cluster that could not be split (all particles at the same position)
+    // is kept as it is instead of being split again forever
+    if(itCluster->size() > size_t(fN) && itCluster->size() < particles.size() && depth != fMaxDepth)
+    {
+      Fit(*itCluster, depth + 1, clusters);
+    }
+    else
+    {
+      clusters.push_back(*itCluster);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+static bool CompareSumPT(const PapuCluster &a, const PapuCluster &b)
+{
+  return a.SumPT() > b.SumPT();
+}
+
+//------------------------------------------------------------------------------
+
+void PapuClusterOrdering::Order(vector<PapuParticle> &particles, vector<PapuParticle> &output, size_t size)
+{
+  vector<PapuParticle *> pointers;
+  vector<PapuParticle>::iterator itParticle;
+  vector<PapuCluster> clusters, sorted;
+  vector<PapuCluster>::iterator itCluster;
+  PapuCluster::iterator itMember;
+  PapuParticle *particle;
+  size_t i, best;
+  float dr2, bestDR2;
+  int index;
+
+  output.clear();
+
+  if(!particles.empty())
+  {
+    pointers.reserve(particles.size());
+    for(itParticle = particles.begin(); itParticle != particles.end(); ++itParticle)
+    {
+      pointers.push_back(&(*itParticle));
+    }
+
+    Fit(pointers, 0, clusters);
+
+    for(itCluster = clusters.begin(); itCluster != clusters.end(); ++itCluster)
+    {
+      itCluster->Finalize();
+    }
+
+    // sort clusters by sum pt
+    sort(clusters.begin(), clusters.end(), CompareSumPT);
+
+    // then chain them by proximity to the last cluster, starting with the hardest one
+    sorted.reserve(clusters.size());
+    sorted.push_back(clusters.front());
+    clusters.erase(clusters.begin());
+    while(!clusters.empty())
+    {
+      const PapuCluster &last = sorted.back();
+      best = 0;
+      bestDR2 = 999999.0;
+      for(i = 0; i < clusters.size(); ++i)
+      {
+        dr2 = (last.Eta() - clusters[i].Eta()) * (last.Eta() - clusters[i].Eta())
+          + (last.Phi() - clusters[i].Phi()) * (last.Phi() - clusters[i].Phi());
+        if(dr2 < bestDR2)
+        {
+          best = i;
+          bestDR2 = dr2;
+        }
+      }
+      sorted.push_back(clusters[best]);
+      clusters.erase(clusters.begin() + best);
+    }
+
+    output.reserve(size > 0 ? size : particles.size());
+
+    index = 0;
+    for(itCluster = sorted.begin(); itCluster != sorted.end(); ++itCluster)
+    {
+      for(itMember = itCluster->begin(); itMember != itCluster->end(); ++itMember)
+      {
+        particle = *itMember;
+        particle->cluster_idx = index;
+        particle->cluster_hardch_pt = itCluster->HardChargedPT();
+        particle->cluster_puch_pt = itCluster->PileUpChargedPT();
+        particle->cluster_r = itCluster->R();
+        output.push_back(*particle);
+      }
+      ++index;
+    }
+  }
+
+  // if there are fewer than size particles, pad with default values
+  if(size > 0) output.resize(size);
+}
+
+//------------------------------------------------------------------------------
+
+PapuEvent::PapuEvent()
+{
+  Clear();
+}
+
+//------------------------------------------------------------------------------
+
+void PapuEvent::Clear()
+{
+  npv = 0.0;
+  genmet = genmetphi = genUmag = genUphi = -99.0;
+  genZ.SetPxPyPzE(0.0, 0.0, 0.0, 0.0);
+  genZacc = -99.0;
+  recZ.SetPxPyPzE(0.0, 0.0, 0.0, 0.0);
+  leptonPT.clear();
+  higgs.SetPxPyPzE(0.0, 0.0, 0.0, 0.0);
+  genJets.clear();
+  particles.clear();
+}
+
+//------------------------------------------------------------------------------
+
+DelphesPapuReader::DelphesPapuReader(TTree *tree, int features) :
+  fTree(tree), fTreeReader(0), fFeatures(features), fMaxGenJets(-1),
+  fBranchParticleFlowCandidate(0), fBranchVertex(0), fBranchGenMissingET(0),
+  fBranchPileUpMix(0), fBranchGenJet(0), fBranchZBoson(0),
+  fBranchElectron(0), fBranchMuon(0), fBranchParticle(0)
+{
+  fTreeReader = new ExRootTreeReader(fTree);
+
+  if(fFeatures & kParticles)
+  {
+    fBranchParticleFlowCandidate = UseBranch("ParticleFlowCandidate", "PID Charge E PT Eta Phi PuppiW hardfrac");
+    if(fTree->GetBranch("Vertex")) fBranchVertex = UseBranch("Vertex", "");
+  }
+  if(fFeatures & kRecoil)
+  {
+    fBranchGenMissingET = UseBranch("GenMissingET", "MET Phi");
+    fBranchPileUpMix = UseBranch("PileUpMix", "PID IsPU PT Phi");
+  }
+  if(fFeatures & kGenJets)
+  {
+    fBranchGenJet = UseBranch("GenJet", "PT Eta Phi Mass");
+  }
+  if(fFeatures & kGenZ)
+  {
+    fBranchZBoson = UseBranch("ZBoson", "PT Eta Phi Mass");
+  }
+  if(fFeatures & kRecZ)
+  {
+    fBranchElectron = UseBranch("Electron", "PT Eta Phi Charge");
+    fBranchMuon = UseBranch("MuonLoose", "PT Eta Phi Charge");
+  }
+  if(fFeatures & kHiggs)
+  {
+    fBranchParticle = UseBranch("Particle", "PID PT Eta Phi E");
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesPapuReader::~DelphesPapuReader()
+{
+  if(fTreeReader) delete fTreeReader;
+}
+
+//------------------------------------------------------------------------------
+
+TClonesArray *DelphesPapuReader::UseBranch(const char *branchName, const char *leaves)
+{
+  stringstream message, list(leaves);
+  string leaf;
+  TClonesArray *array;
+
+  array = fTreeReader->UseBranch(branchName);
+  if(!array)
+  {
+    message << "can't find branch " << branchName;
+    throw runtime_error(message.str());
+  }
+
+  // only read the leaves that are used, in particular skip the TRefArray members
+  fTree->SetBranchStatus(TString::Format("%s.*", branchName), 0);
+  while(list >> leaf)
+  {
+    fTree->SetBranchStatus(TString::Format("%s.%s", branchName, leaf.c_str()), 1);
+  }
+
+  return array;
+}
+
+//------------------------------------------------------------------------------
+
+Long64_t DelphesPapuReader::GetEntries() const
+{
+  return fTreeReader->GetEntries();
+}
+
+//------------------------------------------------------------------------------
+
+bool DelphesPapuReader::ReadEntry(Long64_t entry, PapuEvent &event)
+{
+  Int_t i, size;
+  Jet *jet;
+  GenParticle *particle;
+  TLorentzVector momentum;
+
+  event.Clear();
+
+  if(!fTreeReader->ReadEntry(entry)) return false;
+
+  if(fFeatures & kRecoil) ReadRecoil(event);
+
+  if(fFeatures & kGenJets)
+  {
+    size = fBranchGenJet->GetEntriesFast();
+    if(fMaxGenJets >= 0 && size > fMaxGenJets) size = fMaxGenJets;
+    for(i = 0; i < size; ++i)
+    {
+      jet = static_cast<Jet *>(fBranchGenJet->At(i));
+      momentum.SetPtEtaPhiM(jet->PT, jet->Eta, jet->Phi, jet->Mass);
+      event.genJets.push_back(momentum);
+    }
+  }
+
+  if((fFeatures & kGenZ) && fBranchZBoson->GetEntriesFast() > 0)
+  {
+    particle = static_cast<GenParticle *>(fBranchZBoson->At(0));
+    event.genZ.SetPtEtaPhiM(particle->PT, particle->Eta, particle->Phi, particle->Mass);
+    event.genZacc = 1.0;
+  }
+
+  if(fFeatures & kRecZ) ReadRecZ(event);
+
+  if(fFeatures & kHiggs)
+  {
+    size = fBranchParticle->GetEntriesFast();
+    for(i = 0; i < size; ++i)
+    {
+      particle = static_cast<GenParticle *>(fBranchParticle->At(i));
+      if(particle->PID == 25)
+      {
+        event.higgs.SetPtEtaPhiE(particle->PT, particle->Eta, particle->Phi, particle->E);
+        break;
+      }
+    }
+  }
+
+  if(fFeatures & kParticles) ReadParticles(event);
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPapuReader::ReadRecoil(PapuEvent &event)
+{
+  Int_t i, size;
+  MissingET *met;
+  GenParticle *particle;
+  TVector2 recoil, lepton;
+
+  if(fBranchGenMissingET->GetEntriesFast() > 0)
+  {
+    met = static_cast<MissingET *>(fBranchGenMissingET->At(0));
+    event.genmet = met->MET;
+    event.genmetphi = met->Phi;
+  }
+
+  // hadronic recoil: add back the hard-scatter leptons
+  recoil.SetMagPhi(event.genmet, event.genmetphi);
+  size = fBranchPileUpMix->GetEntriesFast();
+  for(i = 0; i < size; ++i)
+  {
+    particle = static_cast<GenParticle *>(fBranchPileUpMix->At(i));
+    if(particle->PT > 10 && particle->IsPU == 0 && (abs(particle->PID) == 11 || abs(particle->PID) == 13))
+    {
+      lepton.SetMagPhi(particle->PT, particle->Phi);
+      recoil += lepton;
+    }
+  }
+
+  event.genUmag = recoil.Mod();
+  event.genUphi = recoil.Phi();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPapuReader::ReadRecZ(PapuEvent &event)
+{
+  Int_t i, size, firstCharge = 0;
+  TClonesArray *array = 0;
+  Float_t leading = -99.0, pt, eta, phi, mass = 0.0;
+  Int_t charge;
+  TLorentzVector lepton;
+
+  // use the flavour of the leading lepton, at least two leptons of this flavour are required
+  if(fBranchElectron->GetEntriesFast() > 1)
+  {
+    leading = static_cast<Electron *>(fBranchElectron->At(0))->PT;
+    array = fBranchElectron;
+    mass = 0.00051099;
+  }
+  if(fBranchMuon->GetEntriesFast() > 1 && static_cast<Muon *>(fBranchMuon->At(0))->PT > leading)
+  {
+    leading = static_cast<Muon *>(fBranchMuon->At(0))->PT;
+    array = fBranchMuon;
+    mass = 0.1057;
+  }
+
+  if(!array || leading <= 0) return;
+
+  size = array->GetEntriesFast();
+  for(i = 0; i < size; ++i)
+  {
+    if(array == fBranchElectron)
+    {
+      Electron *electron = static_cast<Electron *>(array->At(i));
+      pt = electron->PT, eta = electron->Eta, phi = electron->Phi, charge = electron->Charge;
+    }
+    else
+    {
+      Muon *muon = static_cast<Muon *>(array->At(i));
+      pt = muon->PT, eta = muon->Eta, phi = muon->Phi, charge = muon->Charge;
+    }
+
+    if(pt <= 10) continue;
+
+    if(firstCharge == 0 || firstCharge == -charge)
+    {
+      lepton.SetPtEtaPhiM(pt, eta, phi, mass);
+      event.recZ += lepton;
+      event.leptonPT.push_back(pt);
+      if(firstCharge != 0) break;
+      firstCharge = charge;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+static bool ComparePT(const PapuParticle &a, const PapuParticle &b)
+{
+  return a.pt > b.pt;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPapuReader::ReadParticles(PapuEvent &event)
+{
+  Int_t i, size;
+  ParticleFlowCandidate *candidate;
+  PapuParticle particle;
+
+  if(fBranchVertex) event.npv = fBranchVertex->GetEntriesFast();
+
+  size = fBranchParticleFlowCandidate->GetEntriesFast();
+  event.particles.reserve(size);
+
+  for(i = 0; i < size; ++i)
+  {
+    candidate = static_cast<ParticleFlowCandidate *>(fBranchParticleFlowCandidate->At(i));
+
+    particle.npv = event.npv;
+    particle.pt = candidate->PT;
+    particle.eta = candidate->Eta;
+    particle.phi = candidate->Phi;
+    particle.x = TMath::Cos(particle.phi);
+    particle.y = TMath::Sin(particle.phi);
+    particle.e = candidate->E;
+    particle.puppi = candidate->PuppiW;
+    particle.hardfrac = candidate->hardfrac;
+    particle.pdgid = candidate->PID;
+    particle.charge = candidate->Charge;
+
+    if(candidate->Charge != 0)
+      particle.vtxid = (candidate->hardfrac == 1) ? 0 : 1;
+    else
+      particle.vtxid = -1;
+
+    particle.isolep = 0;
+    if((abs(candidate->PID) == 11 || abs(candidate->PID) == 13) && particle.pt > 10)
+    {
+      if(find(event.leptonPT.begin(), event.leptonPT.end(), particle.pt) != event.leptonPT.end())
+        particle.isolep = 1;
+    }
+
+    event.particles.push_back(particle);
+  }
+
+  sort(event.particles.begin(), event.particles.end(), ComparePT);
+}
+
+//------------------------------------------------------------------------------
+
+PapuTrainWriter::PapuTrainWriter(const char *fileName, size_t size) :
+  fFile(0), fTree(0), fNpzWriter(0), fSize(size),
+  fGenMET(-99.0), fGenMETPhi(-99.0), fGenUMag(-99.0), fGenUPhi(-99.0)
+{
+  size_t length = strlen(fileName);
+  vector<size_t> shape;
+  int i;
+
+  for(i = 0; i < 4; ++i) fGenJet1[i] = fGenJet2[i] = -99.0;
+
+  if(length > 4 && strcmp(fileName + length - 4, ".npz") == 0)
+  {
+    // same layout as data/convert.py: x is [events, size, features]
+    fNpzWriter = new DelphesNpzWriter(fileName);
+    shape.push_back(fSize);
+    shape.push_back(13);
+    fRow.resize(fSize * 13);
+    fNpzWriter->AddArray("x", shape);
+    fNpzWriter->AddArray("met", vector<size_t>(1, 2));
+    fNpzWriter->AddArray("recoil", vector<size_t>(1, 2));
+    fNpzWriter->AddArray("jet1", vector<size_t>(1, 4));
+    fNpzWriter->AddArray("jet2", vector<size_t>(1, 4));
+    return;
+  }
+
+  fFile = TFile::Open(fileName, "RECREATE");
+  if(!fFile || fFile->IsZombie())
+  {
+    stringstream message;
+    message << "can't create output file " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  fTree = new TTree("events", "events");
+
+  fTree->Branch("pt", &fPT);
+  fTree->Branch("eta", &fEta);
+  fTree->Branch("phi", &fPhi);
+  fTree->Branch("e", &fE);
+  fTree->Branch("puppi", &fPuppi);
+  fTree->Branch("pdgid", &fPID);
+  fTree->Branch("hardfrac", &fHardFrac);
+  fTree->Branch("cluster_idx", &fClusterIndex);
+  fTree->Branch("cluster_r", &fClusterR);
+  fTree->Branch("cluster_hardch_pt", &fClusterHardChargedPT);
+  fTree->Branch("cluster_puch_pt", &fClusterPileUpChargedPT);
+  fTree->Branch("vtxid", &fVertexIndex);
+  fTree->Branch("npv", &fNPV);
+
+  fTree->Branch("genmet", &fGenMET, "genmet/F");
+  fTree->Branch("genmetphi", &fGenMETPhi, "genmetphi/F");
+  fTree->Branch("genUmag", &fGenUMag, "genUmag/F");
+  fTree->Branch("genUphi", &fGenUPhi, "genUphi/F");
+  fTree->Branch("genjet1pt", &fGenJet1[0], "genjet1pt/F");
+  fTree->Branch("genjet1eta", &fGenJet1[1], "genjet1eta/F");
+  fTree->Branch("genjet1phi", &fGenJet1[2], "genjet1phi/F");
+  fTree->Branch("genjet1e", &fGenJet1[3], "genjet1e/F");
+  fTree->Branch("genjet2pt", &fGenJet2[0], "genjet2pt/F");
+  fTree->Branch("genjet2eta", &fGenJet2[1], "genjet2eta/F");
+  fTree->Branch("genjet2phi", &fGenJet2[2], "genjet2phi/F");
+  fTree->Branch("genjet2e", &fGenJet2[3], "genjet2e/F");
+}
+
+//------------------------------------------------------------------------------
+
+PapuTrainWriter::~PapuTrainWriter()
+{
+  try
+  {
+    Close();
+  }
+  catch(exception &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void PapuTrainWriter::Fill(const PapuEvent &event, const vector<PapuParticle> &particles)
+{
+  vector<PapuParticle>::const_iterator itParticle;
+  float *row, *jet;
+  size_t i;
+
+  fGenMET = event.genmet;
+  fGenMETPhi = event.genmetphi;
+  fGenUMag = event.genUmag;
+  fGenUPhi = event.genUphi;
+
+  // the generator jets missing in this event are written as -99, as in PapuWriter
+  for(i = 0; i < 2; ++i)
+  {
+    jet = (i == 0) ? fGenJet1 : fGenJet2;
+    jet[0] = jet[1] = jet[2] = jet[3] = -99.0;
+    if(i >= event.genJets.size()) continue;
+
+    const TLorentzVector &genJet = event.genJets[i];
+    jet[0] = genJet.Pt();
+    jet[1] = genJet.Eta();
+    jet[2] = genJet.Phi();
+    jet[3] = genJet.E();
+  }
+
+  if(fNpzWriter)
+  {
+    float met[2] = {fGenMET, fGenMETPhi};
+    float recoil[2] = {fGenUMag, fGenUPhi};
+
+    fill(fRow.begin(), fRow.end(), 0.0);
+    row = &fRow[0];
+    for(itParticle = particles.begin(); itParticle != particles.end() && row < &fRow[0] + fRow.size(); ++itParticle)
+    {
+      *row++ = itParticle->pt;
+      *row++ = itParticle->eta;
+      *row++ = itParticle->phi;
+      *row++ = itParticle->e;
+      *row++ = itParticle->puppi;
+      *row++ = itParticle->pdgid;
+      *row++ = itParticle->hardfrac;
+      *row++ = itParticle->cluster_idx;
+      *row++ = itParticle->vtxid;
+      *row++ = itParticle->cluster_r;
+      *row++ = itParticle->cluster_hardch_pt;
+      *row++ = itParticle->cluster_puch_pt;
+      *row++ = itParticle->npv;
+    }
+
+    fNpzWriter->WriteRow("x", &fRow[0]);
+    fNpzWriter->WriteRow("met", met);
+    fNpzWriter->WriteRow("recoil", recoil);
+    fNpzWriter->WriteRow("jet1", fGenJet1);
+    fNpzWriter->WriteRow("jet2", fGenJet2);
+    return;
+  }
+
+  fPT.clear(); fEta.clear(); fPhi.clear(); fE.clear(); fPuppi.clear();
+  fPID.clear(); fHardFrac.clear(); fClusterIndex.clear(); fClusterR.clear();
+  fClusterHardChargedPT.clear(); fClusterPileUpChargedPT.clear(); fVertexIndex.clear(); fNPV.clear();
+
+  for(itParticle = particles.begin(); itParticle != particles.end(); ++itParticle)
+  {
+    fPT.push_back(itParticle->pt);
+    fEta.push_back(itParticle->eta);
+    fPhi.push_back(itParticle->phi);
+    fE.push_back(itParticle->e);
+    fPuppi.push_back(itParticle->puppi);
+    fPID.push_back(itParticle->pdgid);
+    fHardFrac.push_back(itParticle->hardfrac);
+    fClusterIndex.push_back(itParticle->cluster_idx);
+    fClusterR.push_back(itParticle->cluster_r);
+    fClusterHardChargedPT.push_back(itParticle->cluster_hardch_pt);
+    fClusterPileUpChargedPT.push_back(itParticle->cluster_puch_pt);
+    fVertexIndex.push_back(itParticle->vtxid);
+    fNPV.push_back(itParticle->npv);
+  }
+
+  fTree->Fill();
+}
+
+//------------------------------------------------------------------------------
+
+void PapuTrainWriter::Close()
+{
+  if(fNpzWriter)
+  {
+    DelphesNpzWriter *writer = fNpzWriter;
+    fNpzWriter = 0;
+    try
+    {
+      writer->Close();
+    }
+    catch(...)
+    {
+      delete writer;
+      throw;
+    }
+    delete writer;
+  }
+
+  if(fFile)
+  {
+    fFile->Write();
+    fFile->Close();
+    delete fFile;
+    fFile = 0;
+    fTree = 0;
+  }
+}
+
+//------------------------------------------------------------------------------
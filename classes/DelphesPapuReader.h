@@ -0,0 +1,220 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesPapuReader_h
+#define DelphesPapuReader_h
+
+/** \class DelphesPapuReader
+ *
+ *  Extracts the per-particle and per-event features used by the Papu
+ *  readers (PapuDelphes, PapuDelphesTrain, PapuDelphesInfer and
+ *  ClusterDelphes) from a Delphes tree in a single read pass.
+ *  Only the branches and leaves needed by the requested features are read.
+ *
+ *  \class PapuClusterOrdering
+ *
+ *  Orders particles by recursive k-means clusters in (eta, cos phi, sin phi)
+ *  and fills the cluster features of each particle.
+ *  Unlike the copies it replaces, empty clusters are dropped (cluster_idx only
+ *  counts non-empty clusters), fewer than k particles form a single cluster and
+ *  clusters that cannot be split are not split again.
+ *
+ *  \class PapuTrainWriter
+ *
+ *  Writes the PapuDelphesTrain output, a ROOT tree or a NumPy .npz file,
+ *  so that it can be filled from the same read pass as another output.
+ *
+ */
+
+#include <vector>
+
+#include "TLorentzVector.h"
+
+class TFile;
+class TTree;
+class TClonesArray;
+class ExRootTreeReader;
+class DelphesNpzWriter;
+
+//------------------------------------------------------------------------------
+
+struct PapuParticle
+{
+  PapuParticle();
+
+  float pt, eta, phi;
+  float x, y; // cos and sin phi
+  float e;
+  float puppi;
+  float pdgid;
+  float charge;
+  float hardfrac;
+  float cluster_idx;
+  float cluster_hardch_pt;
+  float cluster_puch_pt;
+  float cluster_r;
+  float vtxid;
+  float npv;
+  float isolep;
+};
+
+//------------------------------------------------------------------------------
+
+class PapuCluster: public std::vector<PapuParticle *>
+{
+public:
+  PapuCluster();
+
+  void Finalize();
+
+  float Eta() const { return fEta; }
+  float Phi() const { return fPhi; }
+  float SumPT() const { return fSumPT; }
+  float HardChargedPT() const { return fHardChargedPT; }
+  float PileUpChargedPT() const { return fPileUpChargedPT; }
+  float R() const { return fR; }
+
+private:
+  float fEta, fPhi, fSumPT, fHardChargedPT, fPileUpChargedPT, fR;
+};
+
+//------------------------------------------------------------------------------
+
+class PapuClusterOrdering
+{
+public:
+  PapuClusterOrdering(int k = 4, int n = 10, int maxDepth = -1, int maxIterations = 20);
+
+  // particles must stay alive while output is filled,
+  // output is padded with default particles up to size if size > 0
+  void Order(std::vector<PapuParticle> &particles, std::vector<PapuParticle> &output, size_t size = 0);
+
+private:
+  void Fit(const std::vector<PapuParticle *> &particles, int depth, std::vector<PapuCluster> &clusters);
+  void KMeans(const std::vector<PapuParticle *> &particles, std::vector<PapuCluster> &clusters);
+
+  int fK, fN, fMaxDepth, fMaxIterations;
+};
+
+//------------------------------------------------------------------------------
+
+struct PapuEvent
+{
+  PapuEvent();
+
+  void Clear();
+
+  float npv;
+
+  float genmet, genmetphi;
+  float genUmag, genUphi; // hadronic recoil
+
+  TLorentzVector genZ;
+  float genZacc;
+  TLorentzVector recZ;
+  std::vector<float> leptonPT; // transverse momenta of the leptons used for recZ
+
+  TLorentzVector higgs;
+
+  std::vector<TLorentzVector> genJets;
+
+  std::vector<PapuParticle> particles; // sorted by decreasing pt
+};
+
+//------------------------------------------------------------------------------
+
+class DelphesPapuReader
+{
+public:
+  enum Features
+  {
+    kParticles = 1 << 0,
+    kRecoil = 1 << 1,
+    kGenJets = 1 << 2,
+    kGenZ = 1 << 3,
+    kRecZ = 1 << 4,
+    kHiggs = 1 << 5
+  };
+
+  DelphesPapuReader(TTree *tree, int features);
+
+  ~DelphesPapuReader();
+
+  Long64_t GetEntries() const;
+
+  bool ReadEntry(Long64_t entry, PapuEvent &event);
+
+  void SetMaxGenJets(int maxGenJets) { fMaxGenJets = maxGenJets; }
+
+private:
+  TClonesArray *UseBranch(const char *branchName, const char *leaves);
+
+  void ReadParticles(PapuEvent &event);
+  void ReadRecoil(PapuEvent &event);
+  void ReadRecZ(PapuEvent &event);
+
+  TTree *fTree;
+  ExRootTreeReader *fTreeReader;
+
+  int fFeatures;
+  int fMaxGenJets;
+
+  TClonesArray *fBranchParticleFlowCandidate;
+  TClonesArray *fBranchVertex;
+  TClonesArray *fBranchGenMissingET;
+  TClonesArray *fBranchPileUpMix;
+  TClonesArray *fBranchGenJet;
+  TClonesArray *fBranchZBoson;
+  TClonesArray *fBranchElectron;
+  TClonesArray *fBranchMuon;
+  TClonesArray *fBranchParticle;
+};
+
+//------------------------------------------------------------------------------
+
+class PapuTrainWriter
+{
+public:
+  // ROOT tree, or NumPy arrays if fileName ends with .npz,
+  // with size particles per event in the NumPy arrays
+  PapuTrainWriter(const char *fileName, size_t size);
+
+  ~PapuTrainWriter();
+
+  // particles are the ordered particles of event
+  void Fill(const PapuEvent &event, const std::vector<PapuParticle> &particles);
+
+  void Close();
+
+private:
+  TFile *fFile;
+  TTree *fTree;
+  DelphesNpzWriter *fNpzWriter;
+
+  size_t fSize;
+
+  std::vector<float> fPT, fEta, fPhi, fE, fPuppi, fPID, fHardFrac, fClusterIndex;
+  std::vector<float> fVertexIndex, fClusterR, fClusterHardChargedPT, fClusterPileUpChargedPT, fNPV;
+
+  float fGenMET, fGenMETPhi, fGenUMag, fGenUPhi;
+  float fGenJet1[4], fGenJet2[4]; // pt, eta, phi, e
+
+  std::vector<float> fRow;
+};
+
+#endif // DelphesPapuReader_h
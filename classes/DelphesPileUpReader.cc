@@ -32,32 +32,25 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "classes/DelphesXDRReader.h"
 
 using namespace std;
 
-static const int kIndexSize = 10000000;
-static const int kBufferSize = 1000000;
+static const int kMaxEntrySize = 1000000;
 static const int kRecordSize = 9;
 
 //------------------------------------------------------------------------------
 
 DelphesPileUpReader::DelphesPileUpReader(const char *fileName) :
   fEntries(0), fEntrySize(0), fCounter(0),
-  fPileUpFile(0), fIndex(0), fBuffer(0),
-  fInputReader(0), fIndexReader(0), fBufferReader(0)
+  fPileUpFile(0), fInputReader(0)
 {
   stringstream message;
+  int64_t size;
 
-  fIndex = new uint8_t[kIndexSize * 8];
-  fBuffer = new uint8_t[kBufferSize * kRecordSize * 4];
   fInputReader = new DelphesXDRReader;
-  fIndexReader = new DelphesXDRReader;
-  fBufferReader = new DelphesXDRReader;
-
-  fIndexReader->SetBuffer(fIndex);
-  fBufferReader->SetBuffer(fBuffer);
 
   fPileUpFile = fopen(fileName, "rb");
 
@@ -70,18 +63,21 @@ DelphesPileUpReader::DelphesPileUpReader(const char *fileName) :
   fInputReader->SetFile(fPileUpFile);
 
   // read number of events
+  fseeko(fPileUpFile, 0, SEEK_END);
+  size = ftello(fPileUpFile);
   fseeko(fPileUpFile, -8, SEEK_END);
   fInputReader->ReadValue(&fEntries, 8);
 
-  if(fEntries >= kIndexSize)
+  if(size < 8 || fEntries < 0 || fEntries > (size - 8) / 8)
   {
-    message << "too many events in pile-up file " << fileName;
+    message << "invalid index in pile-up file " << fileName;
     throw runtime_error(message.str());
   }
 
   // read index of events
   fseeko(fPileUpFile, -8 - 8 * fEntries, SEEK_END);
-  fInputReader->ReadRaw(fIndex, fEntries * 8);
+  fIndex.resize(fEntries);
+  if(fEntries > 0) fInputReader->ReadArray(&fIndex[0], fEntries, 8);
 }
 
 //------------------------------------------------------------------------------
@@ -89,11 +85,7 @@ DelphesPileUpReader::DelphesPileUpReader(const char *fileName) :
 DelphesPileUpReader::~DelphesPileUpReader()
 {
   if(fPileUpFile) fclose(fPileUpFile);
-  if(fBufferReader) delete fBufferReader;
-  if(fIndexReader) delete fIndexReader;
   if(fInputReader) delete fInputReader;
-  if(fBuffer) delete[] fBuffer;
-  if(fIndex) delete[] fIndex;
 }
 
 //------------------------------------------------------------------------------
@@ -102,17 +94,21 @@ bool DelphesPileUpReader::ReadParticle(int32_t &pid,
   float &x, float &y, float &z, float &t,
   float &px, float &py, float &pz, float &e)
 {
+  const uint32_t *record;
+
   if(fCounter >= fEntrySize) return false;
 
-  fBufferReader->ReadValue(&pid, 4);
-  fBufferReader->ReadValue(&x, 4);
-  fBufferReader->ReadValue(&y, 4);
-  fBufferReader->ReadValue(&z, 4);
-  fBufferReader->ReadValue(&t, 4);
-  fBufferReader->ReadValue(&px, 4);
-  fBufferReader->ReadValue(&py, 4);
-  fBufferReader->ReadValue(&pz, 4);
-  fBufferReader->ReadValue(&e, 4);
+  record = &fBuffer[kRecordSize * fCounter];
+
+  memcpy(&pid, record, 4);
+  memcpy(&x, record + 1, 4);
+  memcpy(&y, record + 2, 4);
+  memcpy(&z, record + 3, 4);
+  memcpy(&t, record + 4, 4);
+  memcpy(&px, record + 5, 4);
+  memcpy(&py, record + 6, 4);
+  memcpy(&pz, record + 7, 4);
+  memcpy(&e, record + 8, 4);
 
   ++fCounter;
 
@@ -123,25 +119,20 @@ bool DelphesPileUpReader::ReadParticle(int32_t &pid,
 
 bool DelphesPileUpReader::ReadEntry(int64_t entry)
 {
-  int64_t offset;
-
-  if(entry >= fEntries) return false;
-
-  // read event position
-  fIndexReader->SetOffset(8 * entry);
-  fIndexReader->ReadValue(&offset, 8);
+  if(entry < 0 || entry >= fEntries) return false;
 
   // read event
-  fseeko(fPileUpFile, offset, SEEK_SET);
+  fseeko(fPileUpFile, fIndex[entry], SEEK_SET);
   fInputReader->ReadValue(&fEntrySize, 4);
 
-  if(fEntrySize >= kBufferSize)
+  if(fEntrySize < 0 || fEntrySize >= kMaxEntrySize)
   {
     throw runtime_error("too many particles in pile-up event");
   }
 
-  fInputReader->ReadRaw(fBuffer, fEntrySize * kRecordSize * 4);
-  fBufferReader->SetOffset(0);
+  // all values are 4 bytes long and are converted in one pass
+  fBuffer.resize(fEntrySize * kRecordSize);
+  if(fEntrySize > 0) fInputReader->ReadArray(&fBuffer[0], fEntrySize * kRecordSize, 4);
   fCounter = 0;
 
   return true;
@@ -27,6 +27,8 @@
  *
  */
 
+#include <vector>
+
 #include <stdint.h>
 #include <stdio.h>
 
@@ -54,12 +56,12 @@ private:
   int32_t fCounter;
 
   FILE *fPileUpFile;
-  uint8_t *fIndex;
-  uint8_t *fBuffer;
+
+  // decoded event offsets and particle records of the current event
+  std::vector<int64_t> fIndex;
+  std::vector<uint32_t> fBuffer;
 
   DelphesXDRReader *fInputReader;
-  DelphesXDRReader *fIndexReader;
-  DelphesXDRReader *fBufferReader;
 };
 
 #endif // DelphesPileUpReader_h
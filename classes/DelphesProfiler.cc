@@ -0,0 +1,280 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesProfiler
+ *
+ *  Collects per-module time, allocation and memory statistics.
+ *
+ */
+
+#include "classes/DelphesProfiler.h"
+#include "classes/DelphesFactory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include <math.h>
+#include <sys/resource.h>
+#include <time.h>
+
+using namespace std;
+
+// histogram bins per decade, starting at 1 us
+static const double kBinsPerDecade = 16.0;
+static const double kMinTime = 1.0e-6;
+
+//------------------------------------------------------------------------------
+
+static double WallTime()
+{
+  return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//------------------------------------------------------------------------------
+
+DelphesProfiler::DelphesProfiler(const char *traceFileName) :
+  fOrigin(WallTime()), fTraceFile(0), fFirstTraceEvent(true)
+{
+  stringstream message;
+
+  if(traceFileName && *traceFileName)
+  {
+    fTraceFile = fopen(traceFileName, "w");
+    if(!fTraceFile)
+    {
+      message << "can't open " << traceFileName;
+      throw runtime_error(message.str());
+    }
+    fputs("{\"traceEvents\":[\n", fTraceFile);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesProfiler::~DelphesProfiler()
+{
+  if(fTraceFile)
+  {
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", fTraceFile);
+    fclose(fTraceFile);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+int DelphesProfiler::AddModule(const char *name)
+{
+  Module module;
+
+  module.name = name;
+  module.calls = 0;
+  module.sumWall = 0.0;
+  module.sumCPU = 0.0;
+  module.maxWall = 0.0;
+  module.candidates = 0;
+  module.arrays = 0;
+  module.peakMemory = 0;
+  module.wallHistogram.assign(kBins, 0);
+  module.cpuHistogram.assign(kBins, 0);
+
+  fModules.push_back(module);
+
+  return fModules.size() - 1;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesProfiler::Start(Sample &sample) const
+{
+  sample.candidates = DelphesFactory::GetCandidateCount();
+  sample.arrays = DelphesFactory::GetArrayCount();
+  sample.peakMemory = PeakMemory();
+  sample.cpu = CPUTime();
+  sample.wall = WallTime();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesProfiler::Stop(int index, const Sample &start, int thread)
+{
+  double wall, cpu;
+  Long64_t candidates, arrays, peakMemory;
+  Module &module = fModules[index];
+
+  wall = WallTime() - start.wall;
+  cpu = CPUTime() - start.cpu;
+  candidates = DelphesFactory::GetCandidateCount() - start.candidates;
+  arrays = DelphesFactory::GetArrayCount() - start.arrays;
+  peakMemory = PeakMemory() - start.peakMemory;
+
+  ++module.calls;
+  module.sumWall += wall;
+  module.sumCPU += cpu;
+  module.maxWall = max(module.maxWall, wall);
+  module.candidates += candidates;
+  module.arrays += arrays;
+  module.peakMemory += peakMemory;
+  ++module.wallHistogram[Bin(wall)];
+  ++module.cpuHistogram[Bin(cpu)];
+
+  if(!fTraceFile) return;
+
+  lock_guard<mutex> lock(fTraceMutex);
+
+  fprintf(fTraceFile, "%s{\"name\":\"%s\",\"cat\":\"module\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,",
+    fFirstTraceEvent ? "" : ",\n", module.name.c_str(), thread);
+  fprintf(fTraceFile, "\"ts\":%.3f,\"dur\":%.3f,", (start.wall - fOrigin) * 1.0e6, wall * 1.0e6);
+  fprintf(fTraceFile, "\"args\":{\"cpu_us\":%.3f,\"candidates\":%lld,\"arrays\":%lld,\"peak_rss_kb\":%lld}}",
+    cpu * 1.0e6, candidates, arrays, peakMemory);
+
+  fFirstTraceEvent = false;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesProfiler::PrintSummary(ostream &out) const
+{
+  vector<const Module *> modules;
+  vector<const Module *>::iterator itModule;
+  vector<Module>::const_iterator itModules;
+  const Module *module;
+  double sumWall = 0.0;
+
+  for(itModules = fModules.begin(); itModules != fModules.end(); ++itModules)
+  {
+    if(itModules->calls == 0) continue;
+    modules.push_back(&*itModules);
+    sumWall += itModules->sumWall;
+  }
+
+  if(modules.empty()) return;
+
+  // most expensive modules first
+  stable_sort(modules.begin(), modules.end(), CompareWall);
+
+  out << "** INFO: module profile (times in ms per call, counts per call, peak RSS increase in MB)" << endl;
+  out << left << setw(30) << "**   module" << right;
+  out << setw(8) << "share" << setw(10) << "mean" << setw(10) << "median" << setw(10) << "p95";
+  out << setw(10) << "max" << setw(10) << "cpu" << setw(12) << "candidates" << setw(8) << "arrays";
+  out << setw(10) << "rss" << endl;
+
+  out << fixed;
+  for(itModule = modules.begin(); itModule != modules.end(); ++itModule)
+  {
+    module = *itModule;
+    out << "**   " << left << setw(25) << module->name << right;
+    out << setprecision(3) << setw(8) << (sumWall > 0.0 ? module->sumWall / sumWall : 0.0);
+    out << setw(10) << module->sumWall / module->calls * 1.0e3;
+    out << setw(10) << Quantile(module->wallHistogram, module->calls, 0.5) * 1.0e3;
+    out << setw(10) << Quantile(module->wallHistogram, module->calls, 0.95) * 1.0e3;
+    out << setw(10) << module->maxWall * 1.0e3;
+    out << setw(10) << module->sumCPU / module->calls * 1.0e3;
+    out << setprecision(1) << setw(12) << double(module->candidates) / module->calls;
+    out << setw(8) << double(module->arrays) / module->calls;
+    out << setw(10) << module->peakMemory / 1024.0 << endl;
+  }
+
+  out.unsetf(ios::floatfield);
+  out << setprecision(6);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesProfiler::WriteJSON(ostream &out) const
+{
+  vector<Module>::const_iterator itModules;
+  bool first = true;
+  stringstream record;
+
+  record << setprecision(6) << "{";
+  for(itModules = fModules.begin(); itModules != fModules.end(); ++itModules)
+  {
+    if(itModules->calls == 0) continue;
+
+    if(!first) record << ",";
+    first = false;
+
+    record << "\"" << itModules->name << "\":{";
+    record << "\"calls\":" << itModules->calls << ",";
+    record << "\"mean_ms\":" << itModules->sumWall / itModules->calls * 1.0e3 << ",";
+    record << "\"median_ms\":" << Quantile(itModules->wallHistogram, itModules->calls, 0.5) * 1.0e3 << ",";
+    record << "\"p95_ms\":" << Quantile(itModules->wallHistogram, itModules->calls, 0.95) * 1.0e3 << ",";
+    record << "\"max_ms\":" << itModules->maxWall * 1.0e3 << ",";
+    record << "\"cpu_ms\":" << itModules->sumCPU / itModules->calls * 1.0e3 << ",";
+    record << "\"candidates\":" << double(itModules->candidates) / itModules->calls << ",";
+    record << "\"arrays\":" << double(itModules->arrays) / itModules->calls << ",";
+    record << "\"rss_mb\":" << itModules->peakMemory / 1024.0 << "}";
+  }
+  record << "}";
+
+  out << record.str();
+}
+
+//------------------------------------------------------------------------------
+
+int DelphesProfiler::Bin(double time)
+{
+  int bin;
+
+  if(time <= kMinTime) return 0;
+
+  bin = int(kBinsPerDecade * log10(time / kMinTime));
+  return min(bin, kBins - 1);
+}
+
+//------------------------------------------------------------------------------
+
+// centre of the logarithmic bin holding the given fraction of the calls
+double DelphesProfiler::Quantile(const vector<Long64_t> &histogram, Long64_t calls, double fraction)
+{
+  int bin;
+  Long64_t sum = 0;
+
+  for(bin = 0; bin < kBins - 1; ++bin)
+  {
+    sum += histogram[bin];
+    if(sum >= fraction * calls) break;
+  }
+
+  return kMinTime * pow(10.0, (bin + 0.5) / kBinsPerDecade);
+}
+
+//------------------------------------------------------------------------------
+
+double DelphesProfiler::CPUTime()
+{
+  struct timespec time;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+  return time.tv_sec + 1.0e-9 * time.tv_nsec;
+}
+
+//------------------------------------------------------------------------------
+
+Long64_t DelphesProfiler::PeakMemory()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
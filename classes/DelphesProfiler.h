@@ -0,0 +1,101 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesProfiler_h
+#define DelphesProfiler_h
+
+/** \class DelphesProfiler
+ *
+ *  Collects per-module wall and CPU time histograms, numbers of
+ *  candidates and arrays created by DelphesFactory and peak resident
+ *  memory increases, and prints them as a summary table.
+ *
+ *  Every module call can also be written to a JSON timeline
+ *  in the Chrome trace event format (chrome://tracing, Perfetto).
+ *
+ *  The same statistics can be written as a JSON object for
+ *  machine-readable benchmark records.
+ *
+ *  Stop may be called concurrently for different modules.
+ *
+ */
+
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+
+#include "Rtypes.h"
+
+class DelphesProfiler
+{
+public:
+  struct Sample
+  {
+    double wall, cpu; // seconds
+    Long64_t candidates, arrays;
+    Long64_t peakMemory; // kB
+  };
+
+  DelphesProfiler(const char *traceFileName = 0);
+
+  ~DelphesProfiler();
+
+  // returns the index of the module
+  int AddModule(const char *name);
+
+  void Start(Sample &sample) const;
+  void Stop(int module, const Sample &start, int thread = 0);
+
+  void PrintSummary(std::ostream &out = std::cout) const;
+
+  // modules in task order, times in ms per call
+  void WriteJSON(std::ostream &out) const;
+
+private:
+  static const int kBins = 160;
+
+  struct Module
+  {
+    std::string name;
+    Long64_t calls;
+    double sumWall, sumCPU, maxWall;
+    Long64_t candidates, arrays, peakMemory;
+    std::vector<Long64_t> wallHistogram, cpuHistogram;
+  };
+
+  static bool CompareWall(const Module *a, const Module *b) { return a->sumWall > b->sumWall; }
+
+  static int Bin(double time);
+  static double Quantile(const std::vector<Long64_t> &histogram, Long64_t calls, double fraction);
+
+  static double CPUTime();
+  static Long64_t PeakMemory();
+
+  std::vector<Module> fModules;
+
+  double fOrigin;
+
+  FILE *fTraceFile;
+  bool fFirstTraceEvent;
+  std::mutex fTraceMutex;
+};
+
+#endif // DelphesProfiler_h
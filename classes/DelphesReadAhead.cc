@@ -0,0 +1,75 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesReadAhead
+ *
+ *  Parses events ahead of the processing on a background thread.
+ *
+ */
+
+#include "classes/DelphesReadAhead.h"
+
+#include "TLorentzVector.h"
+#include "TObjArray.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+void DelphesStagedEvent::Materialize(DelphesFactory *factory,
+  TObjArray *allParticleOutputArray,
+  TObjArray *stableParticleOutputArray,
+  TObjArray *partonOutputArray) const
+{
+  vector<DelphesStagedParticle>::const_iterator itParticle;
+  Candidate *candidate;
+
+  for(itParticle = particles.begin(); itParticle != particles.end(); ++itParticle)
+  {
+    candidate = factory->NewCandidate();
+
+    candidate->PID = itParticle->PID;
+    candidate->Status = itParticle->Status;
+    candidate->Charge = itParticle->Charge;
+    candidate->Mass = itParticle->Mass;
+
+    candidate->Momentum.SetPxPyPzE(itParticle->Px, itParticle->Py, itParticle->Pz, itParticle->E);
+    candidate->Position.SetXYZT(itParticle->X, itParticle->Y, itParticle->Z, itParticle->T);
+
+    candidate->M1 = itParticle->M1;
+    candidate->M2 = itParticle->M2;
+    candidate->D1 = itParticle->D1;
+    candidate->D2 = itParticle->D2;
+
+    allParticleOutputArray->Add(candidate);
+
+    if(itParticle->Stable)
+    {
+      stableParticleOutputArray->Add(candidate);
+    }
+    else if(itParticle->Parton)
+    {
+      partonOutputArray->Add(candidate);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
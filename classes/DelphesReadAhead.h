@@ -0,0 +1,211 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesReadAhead_h
+#define DelphesReadAhead_h
+
+/** \class DelphesReadAhead
+ *
+ *  Parses events ahead of the processing on a background thread.
+ *
+ *  Up to a fixed number of parsed events are kept in a ring of staging
+ *  records. Next hands them to the caller in input order by swapping,
+ *  so the buffers of the records are reused. An exception thrown while
+ *  reading is rethrown by Next after the events read before it.
+ *
+ *  \class DelphesStagedEvent
+ *
+ *  Particles of an event as plain values. They are turned into
+ *  factory candidates on the processing thread by Materialize.
+ *
+ */
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class TObjArray;
+class DelphesFactory;
+
+//------------------------------------------------------------------------------
+
+struct DelphesStagedParticle
+{
+  int PID, Status, Charge;
+  int M1, M2, D1, D2;
+  double Mass;
+  double Px, Py, Pz, E;
+  double X, Y, Z, T;
+  bool Stable, Parton;
+};
+
+//------------------------------------------------------------------------------
+
+class DelphesStagedEvent
+{
+public:
+  void Materialize(DelphesFactory *factory,
+    TObjArray *allParticleOutputArray,
+    TObjArray *stableParticleOutputArray,
+    TObjArray *partonOutputArray) const;
+
+  std::vector<DelphesStagedParticle> particles;
+};
+
+//------------------------------------------------------------------------------
+
+template <class Event>
+class DelphesReadAhead
+{
+public:
+  // read fills the next event and returns false at the end of the input
+  DelphesReadAhead(size_t size, std::function<bool(Event &)> read);
+
+  ~DelphesReadAhead();
+
+  // returns false when all events have been handed out
+  bool Next(Event &event);
+
+  void Stop();
+
+private:
+  void Run();
+
+  std::function<bool(Event &)> fRead;
+
+  std::vector<Event> fEvents;
+  size_t fHead, fCount;
+  bool fEnd, fStop;
+  std::exception_ptr fError;
+
+  std::mutex fMutex;
+  std::condition_variable fNotEmpty, fNotFull;
+  std::thread fThread;
+};
+
+//------------------------------------------------------------------------------
+
+template <class Event>
+DelphesReadAhead<Event>::DelphesReadAhead(size_t size, std::function<bool(Event &)> read) :
+  fRead(read), fEvents(size > 0 ? size : 1), fHead(0), fCount(0), fEnd(false), fStop(false)
+{
+  fThread = std::thread(&DelphesReadAhead::Run, this);
+}
+
+//------------------------------------------------------------------------------
+
+template <class Event>
+DelphesReadAhead<Event>::~DelphesReadAhead()
+{
+  Stop();
+}
+
+//------------------------------------------------------------------------------
+
+template <class Event>
+bool DelphesReadAhead<Event>::Next(Event &event)
+{
+  std::exception_ptr error;
+  std::unique_lock<std::mutex> lock(fMutex);
+
+  while(fCount == 0 && !fEnd) fNotEmpty.wait(lock);
+
+  if(fCount == 0)
+  {
+    if(fError)
+    {
+      error = fError;
+      fError = std::exception_ptr();
+      std::rethrow_exception(error);
+    }
+    return false;
+  }
+
+  std::swap(event, fEvents[fHead]);
+  fHead = (fHead + 1) % fEvents.size();
+  --fCount;
+
+  fNotFull.notify_one();
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+template <class Event>
+void DelphesReadAhead<Event>::Stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fStop = true;
+  }
+  fNotFull.notify_one();
+
+  if(fThread.joinable()) fThread.join();
+}
+
+//------------------------------------------------------------------------------
+
+template <class Event>
+void DelphesReadAhead<Event>::Run()
+{
+  size_t slot;
+  bool ready;
+
+  while(true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(fMutex);
+      while(fCount == fEvents.size() && !fStop) fNotFull.wait(lock);
+      if(fStop) return;
+      slot = (fHead + fCount) % fEvents.size();
+    }
+
+    // the slot is not visible to Next until fCount is increased
+    try
+    {
+      ready = fRead(fEvents[slot]);
+    }
+    catch(...)
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fError = std::current_exception();
+      fEnd = true;
+      fNotEmpty.notify_one();
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(fMutex);
+    if(ready)
+    {
+      ++fCount;
+    }
+    else
+    {
+      fEnd = true;
+    }
+    fNotEmpty.notify_one();
+    if(!ready) return;
+  }
+}
+
+#endif // DelphesReadAhead_h
@@ -20,17 +20,20 @@
  *
  *  Reads STDHEP file
  *
+ *  With SetReadAhead, events are parsed on a background thread and
+ *  ReadBlock returns one complete event per call.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
 
 #include "classes/DelphesSTDHEPReader.h"
 
+#include <functional>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 
-#include <errno.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
@@ -49,14 +52,16 @@
 
 using namespace std;
 
-static const int kBufferSize = 1000000;
+static const int kMaxEventSize = 1000000;
+static const int kInitialBufferSize = 65536;
 
 //---------------------------------------------------------------------------
 
 DelphesSTDHEPReader::DelphesSTDHEPReader() :
-  fInputFile(0), fBuffer(0), fPDG(0), fBlockType(-1)
+  fInputFile(0), fBuffer(0), fBufferSize(0), fPDG(0), fBlockType(-1),
+  fReadAheadSize(0), fReadAhead(0)
 {
-  fBuffer = new uint8_t[kBufferSize * 96 + 24];
+  Reserve(kInitialBufferSize);
 
   fPDG = TDatabasePDG::Instance();
 }
@@ -65,27 +70,59 @@ DelphesSTDHEPReader::DelphesSTDHEPReader() :
 
 DelphesSTDHEPReader::~DelphesSTDHEPReader()
 {
-  if(fBuffer) delete fBuffer;
+  StopReadAhead();
+  if(fBuffer) delete[] fBuffer;
 }
 
 //---------------------------------------------------------------------------
 
 void DelphesSTDHEPReader::SetInputFile(FILE *inputFile)
 {
+  StopReadAhead();
+
   fInputFile = inputFile;
   fReader[0].SetFile(inputFile);
+
+  if(fInputFile && fReadAheadSize > 0)
+  {
+    fBlockType = -1;
+    // build the particle lookup table before it is shared with the reading thread
+    fPDG->GetParticle(0);
+    fReadAhead = new DelphesReadAhead<EventRecord>(fReadAheadSize,
+      bind(&DelphesSTDHEPReader::ReadEvent, this, placeholders::_1));
+  }
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesSTDHEPReader::StopReadAhead()
+{
+  if(fReadAhead)
+  {
+    delete fReadAhead;
+    fReadAhead = 0;
+  }
 }
 
 //---------------------------------------------------------------------------
 
 void DelphesSTDHEPReader::Clear()
 {
-  fBlockType = -1;
+  // the reading thread starts every event from a clean state
+  if(!fReadAhead) fBlockType = -1;
 }
 
 //---------------------------------------------------------------------------
 
 bool DelphesSTDHEPReader::EventReady()
+{
+  // events read ahead are always complete
+  return fReadAhead || Complete();
+}
+
+//---------------------------------------------------------------------------
+
+bool DelphesSTDHEPReader::Complete() const
 {
   return (fBlockType == MCFIO_STDHEP) || (fBlockType == MCFIO_STDHEP4);
 }
@@ -96,6 +133,65 @@ bool DelphesSTDHEPReader::ReadBlock(DelphesFactory *factory,
   TObjArray *allParticleOutputArray,
   TObjArray *stableParticleOutputArray,
   TObjArray *partonOutputArray)
+{
+  if(fReadAhead)
+  {
+    if(!fReadAhead->Next(fEvent)) return kFALSE;
+
+    fEvent.Materialize(factory, allParticleOutputArray,
+      stableParticleOutputArray, partonOutputArray);
+
+    return kTRUE;
+  }
+
+  if(!ParseBlock()) return kFALSE;
+
+  if(Complete())
+  {
+    FinishEvent(fEvent);
+
+    fEvent.Materialize(factory, allParticleOutputArray,
+      stableParticleOutputArray, partonOutputArray);
+  }
+
+  return kTRUE;
+}
+
+//---------------------------------------------------------------------------
+
+// runs on the reading thread
+bool DelphesSTDHEPReader::ReadEvent(EventRecord &event)
+{
+  while(ParseBlock())
+  {
+    if(Complete())
+    {
+      FinishEvent(event);
+      fBlockType = -1;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesSTDHEPReader::FinishEvent(EventRecord &event)
+{
+  event.particles.swap(fParticles);
+  fParticles.clear();
+
+  event.number = fEventNumber;
+  event.weight = fWeight;
+  event.scalePDF = fScale[0];
+  event.alphaQCD = fAlphaQCD;
+  event.alphaQED = fAlphaQED;
+}
+
+//---------------------------------------------------------------------------
+
+bool DelphesSTDHEPReader::ParseBlock()
 {
   fReader[0].ReadValue(&fBlockType, 4);
 
@@ -122,14 +218,12 @@ bool DelphesSTDHEPReader::ReadBlock(DelphesFactory *factory,
   else if(fBlockType == MCFIO_STDHEP)
   {
     ReadSTDHEP();
-    AnalyzeParticles(factory, allParticleOutputArray,
-      stableParticleOutputArray, partonOutputArray);
+    AnalyzeParticles();
   }
   else if(fBlockType == MCFIO_STDHEP4)
   {
     ReadSTDHEP();
-    AnalyzeParticles(factory, allParticleOutputArray,
-      stableParticleOutputArray, partonOutputArray);
+    AnalyzeParticles();
     ReadSTDHEP4();
   }
   else
@@ -142,6 +236,21 @@ bool DelphesSTDHEPReader::ReadBlock(DelphesFactory *factory,
 
 //---------------------------------------------------------------------------
 
+void DelphesSTDHEPReader::Reserve(int size)
+{
+  // XDR reads are padded to 4 bytes
+  size += 4;
+
+  if(size <= fBufferSize) return;
+
+  if(fBuffer) delete[] fBuffer;
+
+  fBufferSize = size;
+  fBuffer = new uint8_t[fBufferSize];
+}
+
+//---------------------------------------------------------------------------
+
 void DelphesSTDHEPReader::SkipBytes(int size)
 {
   int rc;
@@ -155,8 +264,10 @@ void DelphesSTDHEPReader::SkipBytes(int size)
 
   rc = fseek(fInputFile, size + rndup, SEEK_CUR);
 
-  if(rc != 0 && errno == ESPIPE)
+  // pipes and decompressed streams can't seek
+  if(rc != 0)
   {
+    Reserve(size);
     fReader[0].ReadRaw(fBuffer, size);
   }
 }
@@ -363,7 +474,7 @@ void DelphesSTDHEPReader::ReadSTDHEP()
   // Extracting the number of particles
   fReader[0].ReadValue(&fEventSize, 4);
 
-  if(fEventSize >= kBufferSize)
+  if(fEventSize < 0 || fEventSize >= kMaxEventSize)
   {
     throw runtime_error("too many particles in event");
   }
@@ -371,6 +482,7 @@ void DelphesSTDHEPReader::ReadSTDHEP()
   // 4*n + 4*n + 8*n + 8*n + 40*n + 32*n +
   // 4 + 4 + 4 + 4 + 4 + 4 = 96*n + 24
 
+  Reserve(96 * fEventSize + 24);
   fReader[0].ReadRaw(fBuffer, 96 * fEventSize + 24);
 
   fReader[1].SetBuffer(fBuffer);
@@ -387,14 +499,30 @@ void DelphesSTDHEPReader::ReadSTDHEP()
   fReader[5].ReadValue(&phepSize, 4);
   fReader[6].ReadValue(&vhepSize, 4);
 
-  if(fEventSize < 0 ||
-     fEventSize != (int)idhepSize      || fEventSize != (int)isthepSize     ||
+  if(fEventSize != (int)idhepSize      || fEventSize != (int)isthepSize     ||
      (2*fEventSize) != (int)jmohepSize || (2*fEventSize) != (int)jdahepSize ||
      (5*fEventSize) != (int)phepSize   || (4*fEventSize) != (int)vhepSize)
   {
     throw runtime_error("Inconsistent size of arrays. File is probably corrupted.");
   }
 
+  fStatus.resize(fEventSize);
+  fPID.resize(fEventSize);
+  fMothers.resize(2 * fEventSize);
+  fDaughters.resize(2 * fEventSize);
+  fMomenta.resize(5 * fEventSize);
+  fVertices.resize(4 * fEventSize);
+
+  if(fEventSize > 0)
+  {
+    fReader[1].ReadArray(&fStatus[0], fEventSize, 4);
+    fReader[2].ReadArray(&fPID[0], fEventSize, 4);
+    fReader[3].ReadArray(&fMothers[0], 2 * fEventSize, 4);
+    fReader[4].ReadArray(&fDaughters[0], 2 * fEventSize, 4);
+    fReader[5].ReadArray(&fMomenta[0], 5 * fEventSize, 8);
+    fReader[6].ReadArray(&fVertices[0], 4 * fEventSize, 8);
+  }
+
   fWeight = 1.0;
   fAlphaQED = 0.0;
   fAlphaQCD = 0.0;
@@ -439,14 +567,14 @@ void DelphesSTDHEPReader::AnalyzeEvent(ExRootTreeBranch *branch, long long event
 
   element = static_cast<LHEFEvent *>(branch->NewEntry());
 
-  element->Number = fEventNumber;
+  element->Number = fEvent.number;
 
   element->ProcessID = 0;
 
-  element->Weight = fWeight;
-  element->ScalePDF = fScale[0];
-  element->AlphaQED = fAlphaQED;
-  element->AlphaQCD = fAlphaQCD;
+  element->Weight = fEvent.weight;
+  element->ScalePDF = fEvent.scalePDF;
+  element->AlphaQED = fEvent.alphaQED;
+  element->AlphaQCD = fEvent.alphaQCD;
 
   element->ReadTime = readStopWatch->RealTime();
   element->ProcTime = procStopWatch->RealTime();
@@ -454,12 +582,9 @@ void DelphesSTDHEPReader::AnalyzeEvent(ExRootTreeBranch *branch, long long event
 
 //---------------------------------------------------------------------------
 
-void DelphesSTDHEPReader::AnalyzeParticles(DelphesFactory *factory,
-  TObjArray *allParticleOutputArray,
-  TObjArray *stableParticleOutputArray,
-  TObjArray *partonOutputArray)
+void DelphesSTDHEPReader::AnalyzeParticles()
 {
-  Candidate *candidate;
+  DelphesStagedParticle particle;
   TParticlePDG *pdgParticle;
   int pdgCode;
 
@@ -470,57 +595,53 @@ void DelphesSTDHEPReader::AnalyzeParticles(DelphesFactory *factory,
 
   for(number = 0; number < fEventSize; ++number)
   {
-    fReader[1].ReadValue(&status, 4);
-    fReader[2].ReadValue(&pid, 4);
-    fReader[3].ReadValue(&m1, 4);
-    fReader[3].ReadValue(&m2, 4);
-    fReader[4].ReadValue(&d1, 4);
-    fReader[4].ReadValue(&d2, 4);
+    status = fStatus[number];
+    pid = fPID[number];
+    m1 = fMothers[2 * number];
+    m2 = fMothers[2 * number + 1];
+    d1 = fDaughters[2 * number];
+    d2 = fDaughters[2 * number + 1];
 
-    fReader[5].ReadValue(&px, 8);
-    fReader[5].ReadValue(&py, 8);
-    fReader[5].ReadValue(&pz, 8);
-    fReader[5].ReadValue(&e, 8);
-    fReader[5].ReadValue(&mass, 8);
+    px = fMomenta[5 * number];
+    py = fMomenta[5 * number + 1];
+    pz = fMomenta[5 * number + 2];
+    e = fMomenta[5 * number + 3];
+    mass = fMomenta[5 * number + 4];
 
-    fReader[6].ReadValue(&x, 8);
-    fReader[6].ReadValue(&y, 8);
-    fReader[6].ReadValue(&z, 8);
-    fReader[6].ReadValue(&t, 8);
+    x = fVertices[4 * number];
+    y = fVertices[4 * number + 1];
+    z = fVertices[4 * number + 2];
+    t = fVertices[4 * number + 3];
 
-    candidate = factory->NewCandidate();
+    particle.PID = pid;
+    pdgCode = TMath::Abs(particle.PID);
 
-    candidate->PID = pid;
-    pdgCode = TMath::Abs(candidate->PID);
+    particle.Status = status;
 
-    candidate->Status = status;
+    particle.M1 = m1 - 1;
+    particle.M2 = m2 - 1;
 
-    candidate->M1 = m1 - 1;
-    candidate->M2 = m2 - 1;
-
-    candidate->D1 = d1 - 1;
-    candidate->D2 = d2 - 1;
+    particle.D1 = d1 - 1;
+    particle.D2 = d2 - 1;
 
     pdgParticle = fPDG->GetParticle(pid);
-    candidate->Charge = pdgParticle ? int(pdgParticle->Charge() / 3.0) : -999;
-    candidate->Mass = mass;
-
-    candidate->Momentum.SetPxPyPzE(px, py, pz, e);
+    particle.Charge = pdgParticle ? int(pdgParticle->Charge() / 3.0) : -999;
+    particle.Mass = mass;
 
-    candidate->Position.SetXYZT(x, y, z, t);
+    particle.Px = px;
+    particle.Py = py;
+    particle.Pz = pz;
+    particle.E = e;
 
-    allParticleOutputArray->Add(candidate);
+    particle.X = x;
+    particle.Y = y;
+    particle.Z = z;
+    particle.T = t;
 
-    if(!pdgParticle) continue;
+    particle.Stable = pdgParticle && status == 1;
+    particle.Parton = pdgParticle && !particle.Stable && (pdgCode <= 5 || pdgCode == 21 || pdgCode == 15);
 
-    if(status == 1)
-    {
-      stableParticleOutputArray->Add(candidate);
-    }
-    else if(pdgCode <= 5 || pdgCode == 21 || pdgCode == 15)
-    {
-      partonOutputArray->Add(candidate);
-    }
+    fParticles.push_back(particle);
   }
 }
 
@@ -23,6 +23,9 @@
  *
  *  Reads STDHEP file
  *
+ *  With SetReadAhead, events are parsed on a background thread and
+ *  ReadBlock returns one complete event per call.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
@@ -30,6 +33,7 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include "classes/DelphesReadAhead.h"
 #include "classes/DelphesXDRReader.h"
 
 class TObjArray;
@@ -57,8 +61,15 @@ public:
   DelphesSTDHEPReader();
   ~DelphesSTDHEPReader();
 
+  // number of events parsed ahead, 0 to parse while reading
+  void SetReadAhead(int events) { fReadAheadSize = events; }
+
+  // starts reading ahead if enabled
   void SetInputFile(FILE *inputFile);
 
+  // must be called before the input file is closed
+  void StopReadAhead();
+
   void Clear();
   bool EventReady();
 
@@ -71,11 +82,21 @@ public:
     TStopwatch *readStopWatch, TStopwatch *procStopWatch);
 
 private:
-  void AnalyzeParticles(DelphesFactory *factory,
-    TObjArray *allParticleOutputArray,
-    TObjArray *stableParticleOutputArray,
-    TObjArray *partonOutputArray);
+  struct EventRecord: public DelphesStagedEvent
+  {
+    int number;
+    double weight, scalePDF, alphaQCD, alphaQED;
+  };
 
+  bool Complete() const;
+
+  bool ParseBlock();
+  bool ReadEvent(EventRecord &event);
+  void FinishEvent(EventRecord &event);
+
+  void AnalyzeParticles();
+
+  void Reserve(int size);
   void SkipBytes(int size);
   void SkipArray(int elsize);
 
@@ -91,6 +112,7 @@ private:
   DelphesXDRReader fReader[7];
 
   uint8_t *fBuffer;
+  int fBufferSize;
 
   TDatabasePDG *fPDG;
 
@@ -100,6 +122,17 @@ private:
 
   uint32_t fScaleSize;
   double fScale[10];
+
+  // particle arrays of the current event, kept at the largest size seen
+  std::vector<int32_t> fStatus, fPID, fMothers, fDaughters;
+  std::vector<double> fMomenta, fVertices;
+
+  std::vector<DelphesStagedParticle> fParticles;
+
+  EventRecord fEvent;
+
+  int fReadAheadSize;
+  DelphesReadAhead<EventRecord> *fReadAhead;
 };
 
 #endif // DelphesSTDHEPReader_h
@@ -0,0 +1,494 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesScheduler
+ *
+ *  Runs the modules of one event as a dataflow graph.
+ *
+ */
+
+#include "classes/DelphesScheduler.h"
+#include "classes/DelphesProfiler.h"
+
+#include "ExRootAnalysis/ExRootTask.h"
+
+#include "TRandom3.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace
+{
+
+// generator of the module running on this thread
+thread_local TRandom *gModuleRandom = 0;
+
+// installed as gRandom, forwards to the generator of the running module
+class DelphesSchedulerRandom: public TRandom
+{
+public:
+  DelphesSchedulerRandom(TRandom *fallback) :
+    fFallback(fallback) {}
+
+  Double_t Rndm() { return Current()->Rndm(); }
+  void RndmArray(Int_t n, Float_t *array) { Current()->RndmArray(n, array); }
+  void RndmArray(Int_t n, Double_t *array) { Current()->RndmArray(n, array); }
+  void SetSeed(ULong_t seed = 0) { Current()->SetSeed(seed); }
+  UInt_t GetSeed() const { return Current()->GetSeed(); }
+
+private:
+  TRandom *Current() const { return gModuleRandom ? gModuleRandom : fFallback; }
+
+  TRandom *fFallback;
+};
+
+//------------------------------------------------------------------------------
+
+double Now()
+{
+  return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//------------------------------------------------------------------------------
+
+// seeds do not change when modules are added or reordered
+UInt_t ModuleSeed(UInt_t seed, const char *name)
+{
+  UInt_t hash = 2166136261U;
+
+  if(seed == 0) return 0;
+
+  while(*name)
+  {
+    hash = (hash ^ UChar_t(*name++)) * 16777619U;
+  }
+
+  hash ^= seed;
+  return hash == 0 ? 1 : hash;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+DelphesScheduler::DelphesScheduler(int numberOfThreads, UInt_t randomSeed) :
+  fNumberOfThreads(numberOfThreads > 0 ? numberOfThreads : 1), fRandomSeed(randomSeed),
+  fRandom(0), fDefaultRandom(gRandom), fProfiler(0),
+  fEventNumber(0), fStop(false), fQueued(0), fRemaining(0), fFailed(false),
+  fEventStart(0.0), fEventTime(0.0), fCriticalPathTime(0.0),
+  fSumEventTime(0.0), fSumCriticalPathTime(0.0), fSumModuleTime(0.0), fEvents(0)
+{
+  int i;
+
+  fRandom = new DelphesSchedulerRandom(fDefaultRandom);
+  gRandom = fRandom;
+
+  for(i = 0; i < fNumberOfThreads; ++i)
+  {
+    fQueues.push_back(new Queue);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesScheduler::~DelphesScheduler()
+{
+  vector<thread>::iterator itThread;
+  vector<Node *>::iterator itNode;
+  vector<Queue *>::iterator itQueue;
+
+  {
+    lock_guard<mutex> lock(fMutex);
+    fStop = true;
+  }
+  fCondition.notify_all();
+  fWorkCondition.notify_all();
+
+  for(itThread = fThreads.begin(); itThread != fThreads.end(); ++itThread)
+  {
+    itThread->join();
+  }
+
+  if(gRandom == fRandom) gRandom = fDefaultRandom;
+  delete fRandom;
+
+  for(itNode = fNodes.begin(); itNode != fNodes.end(); ++itNode)
+  {
+    delete(*itNode)->random;
+    delete *itNode;
+  }
+
+  for(itQueue = fQueues.begin(); itQueue != fQueues.end(); ++itQueue)
+  {
+    delete *itQueue;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesScheduler::AddModule(ExRootTask *task, const vector<string> &inputs,
+  const vector<string> &outputs, const vector<string> &dependencies, bool readOnly)
+{
+  size_t i, index;
+  Node *node, *other;
+  vector<string>::const_iterator itName;
+  stringstream message;
+
+  index = fNodes.size();
+
+  node = new Node;
+  node->task = task;
+  node->random = new TRandom3(ModuleSeed(fRandomSeed, task->GetName()));
+  node->inputs = inputs;
+  node->outputs = outputs;
+  node->readOnly = readOnly;
+  node->pending = 0;
+  node->start = 0.0;
+  node->stop = 0.0;
+  node->pathTime = 0.0;
+  node->pathPredecessor = index;
+  node->sumTime = 0.0;
+  node->criticalCount = 0;
+
+  fNodes.push_back(node);
+
+  // modules exporting the imported arrays
+
+  for(itName = inputs.begin(); itName != inputs.end(); ++itName)
+  {
+    for(i = 0; i < index; ++i)
+    {
+      other = fNodes[i];
+      if(find(other->outputs.begin(), other->outputs.end(), *itName) != other->outputs.end())
+      {
+        Link(i, index);
+      }
+    }
+  }
+
+  // explicit dependencies
+
+  for(itName = dependencies.begin(); itName != dependencies.end(); ++itName)
+  {
+    for(i = 0; i < index; ++i)
+    {
+      if(*itName == fNodes[i]->task->GetName()) break;
+    }
+    if(i == index)
+    {
+      message << "module '" << *itName << "' in DependsOn of module '" << task->GetName();
+      message << "' is not executed before it";
+      throw runtime_error(message.str());
+    }
+    Link(i, index);
+  }
+
+  // modules that are not read-only keep the execution path order with all
+  // other modules, since the candidates they modify can also be reached
+  // through the arrays of other modules
+
+  for(i = 0; i < index; ++i)
+  {
+    if(!node->readOnly || !fNodes[i]->readOnly) Link(i, index);
+  }
+
+  if(node->predecessors.empty()) fRoots.push_back(index);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesScheduler::Link(size_t from, size_t to)
+{
+  vector<size_t> &predecessors = fNodes[to]->predecessors;
+
+  if(find(predecessors.begin(), predecessors.end(), from) != predecessors.end()) return;
+
+  predecessors.push_back(from);
+  fNodes[from]->successors.push_back(to);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesScheduler::Start()
+{
+  size_t worker;
+
+  for(worker = 1; worker < size_t(fNumberOfThreads); ++worker)
+  {
+    fThreads.push_back(thread(&DelphesScheduler::Work, this, worker));
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesScheduler::ProcessEvent()
+{
+  size_t i;
+  Node *node, *other;
+  vector<size_t>::iterator itIndex;
+  vector<size_t>::const_iterator itRoot;
+
+  if(fThreads.empty() && fNumberOfThreads > 1) Start();
+
+  for(i = 0; i < fNodes.size(); ++i)
+  {
+    fNodes[i]->pending = fNodes[i]->predecessors.size();
+  }
+
+  fFailed = false;
+  fError = exception_ptr();
+
+  fEventStart = Now();
+  fRemaining = fNodes.size();
+
+  for(itRoot = fRoots.begin(); itRoot != fRoots.end(); ++itRoot)
+  {
+    Push(0, *itRoot);
+  }
+
+  {
+    lock_guard<mutex> lock(fMutex);
+    ++fEventNumber;
+  }
+  fCondition.notify_all();
+
+  // the calling thread is the first worker
+  RunEvent(0);
+
+  fEventTime = Now() - fEventStart;
+
+  if(fFailed) rethrow_exception(fError);
+
+  // longest chain of dependent modules,
+  // predecessors always come first in the execution path
+
+  fCriticalPathTime = 0.0;
+  node = 0;
+  for(i = 0; i < fNodes.size(); ++i)
+  {
+    other = fNodes[i];
+    other->pathTime = 0.0;
+    other->pathPredecessor = i;
+    for(itIndex = other->predecessors.begin(); itIndex != other->predecessors.end(); ++itIndex)
+    {
+      if(fNodes[*itIndex]->pathTime > other->pathTime)
+      {
+        other->pathTime = fNodes[*itIndex]->pathTime;
+        other->pathPredecessor = *itIndex;
+      }
+    }
+    other->pathTime += other->stop - other->start;
+    other->sumTime += other->stop - other->start;
+    fSumModuleTime += other->stop - other->start;
+
+    if(other->pathTime > fCriticalPathTime)
+    {
+      fCriticalPathTime = other->pathTime;
+      node = other;
+    }
+  }
+
+  while(node)
+  {
+    ++node->criticalCount;
+    other = fNodes[node->pathPredecessor];
+    node = other != node ? other : 0;
+  }
+
+  fSumEventTime += fEventTime;
+  fSumCriticalPathTime += fCriticalPathTime;
+  ++fEvents;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesScheduler::Work(size_t worker)
+{
+  Long64_t eventNumber = 0;
+
+  while(true)
+  {
+    {
+      unique_lock<mutex> lock(fMutex);
+      while(!fStop && fEventNumber == eventNumber)
+      {
+        fCondition.wait(lock);
+      }
+      if(fStop) return;
+      eventNumber = fEventNumber;
+    }
+
+    RunEvent(worker);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesScheduler::RunEvent(size_t worker)
+{
+  while(true)
+  {
+    if(RunNext(worker)) continue;
+
+    unique_lock<mutex> lock(fMutex);
+    while(!fStop && fQueued == 0 && fRemaining > 0)
+    {
+      fWorkCondition.wait(lock);
+    }
+    if(fStop || fRemaining == 0) return;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+bool DelphesScheduler::RunNext(size_t worker)
+{
+  size_t i, victim, index;
+  bool found = false;
+
+  // newest module of the own queue first, then the oldest module of the others
+
+  for(i = 0; i < fQueues.size() && !found; ++i)
+  {
+    victim = (worker + i) % fQueues.size();
+    Queue *queue = fQueues[victim];
+    lock_guard<mutex> lock(queue->mutex);
+    if(queue->nodes.empty()) continue;
+    if(i == 0)
+    {
+      index = queue->nodes.back();
+      queue->nodes.pop_back();
+    }
+    else
+    {
+      index = queue->nodes.front();
+      queue->nodes.pop_front();
+    }
+    found = true;
+  }
+
+  if(!found) return false;
+
+  {
+    lock_guard<mutex> lock(fMutex);
+    --fQueued;
+  }
+
+  Run(worker, index);
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesScheduler::Run(size_t worker, size_t index)
+{
+  Node *node = fNodes[index];
+  vector<size_t>::iterator itIndex;
+  DelphesProfiler::Sample sample;
+
+  node->start = Now() - fEventStart;
+
+  // after a failure the remaining modules are only counted down
+  if(!fFailed)
+  {
+    gModuleRandom = node->random;
+    if(fProfiler) fProfiler->Start(sample);
+    try
+    {
+      if(node->task->IsActive()) node->task->Process();
+    }
+    catch(...)
+    {
+      lock_guard<mutex> lock(fMutex);
+      if(!fFailed) fError = current_exception();
+      fFailed = true;
+    }
+    if(fProfiler) fProfiler->Stop(index, sample, worker);
+    gModuleRandom = 0;
+  }
+
+  node->stop = Now() - fEventStart;
+
+  for(itIndex = node->successors.begin(); itIndex != node->successors.end(); ++itIndex)
+  {
+    if(--fNodes[*itIndex]->pending == 0) Push(worker, *itIndex);
+  }
+
+  if(--fRemaining == 0)
+  {
+    // wake the threads waiting for a module, the event is done
+    lock_guard<mutex> lock(fMutex);
+    fWorkCondition.notify_all();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesScheduler::Push(size_t worker, size_t index)
+{
+  Queue *queue = fQueues[worker];
+
+  {
+    lock_guard<mutex> lock(queue->mutex);
+    queue->nodes.push_back(index);
+  }
+
+  {
+    lock_guard<mutex> lock(fMutex);
+    ++fQueued;
+  }
+  fWorkCondition.notify_one();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesScheduler::PrintSummary(ostream &out) const
+{
+  size_t i;
+  Node *node;
+  double scale;
+
+  if(fEvents == 0) return;
+
+  scale = 1.0e3 / fEvents;
+
+  out << "** INFO: scheduler: " << fNodes.size() << " modules, " << fNumberOfThreads << " threads, " << fEvents << " events" << endl;
+  out << fixed << setprecision(3);
+  out << "** INFO: mean time per event " << fSumEventTime * scale << " ms, ";
+  out << "sum of modules " << fSumModuleTime * scale << " ms, ";
+  out << "critical path " << fSumCriticalPathTime * scale << " ms" << endl;
+  out << "** INFO: modules on the critical path (fraction of events, mean time in ms):" << endl;
+
+  for(i = 0; i < fNodes.size(); ++i)
+  {
+    node = fNodes[i];
+    if(node->criticalCount == 0) continue;
+    out << "**   " << left << setw(30) << node->task->GetName() << right;
+    out << setw(8) << double(node->criticalCount) / fEvents;
+    out << setw(12) << node->sumTime * scale << endl;
+  }
+
+  out.unsetf(ios::floatfield);
+  out << setprecision(6);
+}
@@ -0,0 +1,147 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesScheduler_h
+#define DelphesScheduler_h
+
+/** \class DelphesScheduler
+ *
+ *  Runs the modules of one event as a dataflow graph.
+ *
+ *  A module depends on the modules whose arrays it imports and
+ *  on the modules listed in its DependsOn parameter. Only modules declared
+ *  read-only (DelphesModule::IsReadOnly) run concurrently with each other,
+ *  the other modules keep the execution path order with all modules.
+ *  Modules whose dependencies are done run concurrently on a pool of
+ *  threads with one work-stealing queue per thread, idle threads sleep
+ *  until a module is queued or the event is done.
+ *
+ *  Every module draws its random numbers from its own generator,
+ *  so that the results do not depend on the number of threads.
+ *
+ *  The time of the longest chain of dependent modules (critical path)
+ *  is measured for every event and summarized by PrintSummary.
+ *  Modules can also be timed by a DelphesProfiler, to which they must
+ *  have been added in the same order.
+ *
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Rtypes.h"
+
+class TRandom;
+class ExRootTask;
+class DelphesProfiler;
+
+class DelphesScheduler
+{
+public:
+  DelphesScheduler(int numberOfThreads = 1, UInt_t randomSeed = 0);
+
+  ~DelphesScheduler();
+
+  // modules must be added in execution path order,
+  // array names are "<module>/<array>"
+  void AddModule(ExRootTask *task, const std::vector<std::string> &inputs,
+    const std::vector<std::string> &outputs, const std::vector<std::string> &dependencies,
+    bool readOnly = false);
+
+  // runs all modules of the current event, rethrows the first exception
+  void ProcessEvent();
+
+  void SetProfiler(DelphesProfiler *profiler) { fProfiler = profiler; }
+
+  void PrintSummary(std::ostream &out = std::cout) const;
+
+  int GetNumberOfThreads() const { return fNumberOfThreads; }
+
+  // seconds, last event
+  double GetCriticalPathTime() const { return fCriticalPathTime; }
+  double GetEventTime() const { return fEventTime; }
+
+private:
+  struct Node
+  {
+    ExRootTask *task;
+    TRandom *random;
+
+    std::vector<std::string> inputs, outputs;
+    std::vector<size_t> predecessors, successors;
+    bool readOnly;
+
+    std::atomic<int> pending;
+
+    double start, stop; // seconds since the start of the event
+    double pathTime; // longest chain of modules ending with this one
+    size_t pathPredecessor;
+
+    double sumTime;
+    Long64_t criticalCount;
+  };
+
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<size_t> nodes;
+  };
+
+  void Start();
+  void Work(size_t worker);
+  void RunEvent(size_t worker);
+  bool RunNext(size_t worker);
+  void Run(size_t worker, size_t index);
+  void Push(size_t worker, size_t index);
+  void Link(size_t from, size_t to);
+
+  int fNumberOfThreads;
+  UInt_t fRandomSeed;
+
+  TRandom *fRandom, *fDefaultRandom;
+
+  DelphesProfiler *fProfiler;
+
+  std::vector<Node *> fNodes;
+  std::vector<size_t> fRoots;
+  std::vector<Queue *> fQueues;
+
+  std::vector<std::thread> fThreads;
+  std::mutex fMutex;
+  std::condition_variable fCondition, fWorkCondition;
+  Long64_t fEventNumber;
+  bool fStop;
+  int fQueued; // modules in the queues, guarded by fMutex
+
+  std::atomic<int> fRemaining;
+  std::atomic<bool> fFailed;
+  std::exception_ptr fError;
+
+  double fEventStart, fEventTime, fCriticalPathTime;
+  double fSumEventTime, fSumCriticalPathTime, fSumModuleTime;
+  Long64_t fEvents;
+};
+
+#endif // DelphesScheduler_h
@@ -27,8 +27,10 @@
 #include "classes/DelphesStream.h"
 
 #include <errno.h>
+#include <float.h>
 #include <limits.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -39,6 +41,35 @@ using namespace std;
 
 //------------------------------------------------------------------------------
 
+// powers of ten exactly representable as double
+static const double kPowersOfTen[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+#if LDBL_MANT_DIG == 64 && (defined(__x86_64__) || defined(__i386__))
+// powers of ten exactly representable as x87 extended precision
+static const long double kLongPowersOfTen[] = {
+  1e0L, 1e1L, 1e2L, 1e3L, 1e4L, 1e5L, 1e6L, 1e7L, 1e8L, 1e9L, 1e10L, 1e11L, 1e12L, 1e13L,
+  1e14L, 1e15L, 1e16L, 1e17L, 1e18L, 1e19L, 1e20L, 1e21L, 1e22L, 1e23L, 1e24L, 1e25L, 1e26L, 1e27L};
+#endif
+
+static inline bool IsDigit(char c)
+{
+  return (unsigned char)(c - '0') < 10;
+}
+
+static inline bool IsSpace(char c)
+{
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static inline bool IsAlnum(char c)
+{
+  return IsDigit(c) || (unsigned char)((c | 0x20) - 'a') < 26;
+}
+
+//------------------------------------------------------------------------------
+
 bool DelphesStream::fFirstLongMin = true;
 bool DelphesStream::fFirstLongMax = true;
 bool DelphesStream::fFirstHugePos = true;
@@ -56,6 +87,8 @@ DelphesStream::DelphesStream(char *buffer) :
 
 bool DelphesStream::ReadDbl(double &value)
 {
+  if(ReadFastDbl(value)) return true;
+
   char *start = fBuffer;
   errno = 0;
   value = strtod(start, &fBuffer);
@@ -85,6 +118,8 @@ bool DelphesStream::ReadDbl(double &value)
 
 bool DelphesStream::ReadInt(int &value)
 {
+  if(ReadFastInt(value)) return true;
+
   char *start = fBuffer;
   errno = 0;
   value = strtol(start, &fBuffer, 10);
@@ -105,3 +140,153 @@ bool DelphesStream::ReadInt(int &value)
 }
 
 //------------------------------------------------------------------------------
+
+// parses [+-]digits[.digits][(e|E)[+-]digits] with at most 19 significant digits,
+// returns false without consuming anything when strtod is needed
+bool DelphesStream::ReadFastDbl(double &value)
+{
+  char *p = fBuffer;
+  uint64_t mantissa = 0;
+  int digits = 0, exponent = 0, power = 0;
+  bool negative = false, negativePower = false, seen = false, point = false;
+  int i;
+
+  while(IsSpace(*p)) ++p;
+
+  if(*p == '-')
+  {
+    negative = true;
+    ++p;
+  }
+  else if(*p == '+')
+  {
+    ++p;
+  }
+
+  for(;; ++p)
+  {
+    if(IsDigit(*p))
+    {
+      seen = true;
+      if(mantissa > 0 || *p != '0')
+      {
+        if(++digits > 19) return false;
+        mantissa = mantissa * 10 + (*p - '0');
+      }
+      if(point) --exponent;
+    }
+    else if(*p == '.' && !point)
+    {
+      point = true;
+    }
+    else
+    {
+      break;
+    }
+  }
+
+  if(!seen) return false;
+
+  if(*p == 'e' || *p == 'E')
+  {
+    char *q = p + 1;
+    if(*q == '-')
+    {
+      negativePower = true;
+      ++q;
+    }
+    else if(*q == '+')
+    {
+      ++q;
+    }
+    if(IsDigit(*q))
+    {
+      for(i = 0; IsDigit(*q); ++q, ++i)
+      {
+        if(i == 4) return false;
+        power = power * 10 + (*q - '0');
+      }
+      p = q;
+      exponent += negativePower ? -power : power;
+    }
+  }
+
+  // leave anything unusual, like hexadecimal numbers, to strtod
+  if(IsAlnum(*p) || *p == '.') return false;
+
+  if(mantissa == 0)
+  {
+    value = negative ? -0.0 : 0.0;
+    fBuffer = p;
+    return true;
+  }
+
+#if FLT_EVAL_METHOD == 0
+  // both operands are exact, so a single rounding gives the correct result
+  if(mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22)
+  {
+    value = double(mantissa);
+    value = exponent < 0 ? value / kPowersOfTen[-exponent] : value * kPowersOfTen[exponent];
+    value = negative ? -value : value;
+    fBuffer = p;
+    return true;
+  }
+#endif
+
+#if LDBL_MANT_DIG == 64 && (defined(__x86_64__) || defined(__i386__))
+  // one rounding to 64 bits, then to 53 bits, unless close to a halfway case
+  if(exponent >= -27 && exponent <= 27)
+  {
+    long double result = (long double)mantissa;
+    uint64_t bits;
+
+    result = exponent < 0 ? result / kLongPowersOfTen[-exponent] : result * kLongPowersOfTen[exponent];
+    // the explicit 64-bit significand comes first in the little-endian x87 format
+    memcpy(&bits, &result, sizeof(bits));
+    if((bits & 0x7FF) < 0x3FF || (bits & 0x7FF) > 0x401)
+    {
+      value = double(result);
+      value = negative ? -value : value;
+      fBuffer = p;
+      return true;
+    }
+  }
+#endif
+
+  return false;
+}
+
+//------------------------------------------------------------------------------
+
+bool DelphesStream::ReadFastInt(int &value)
+{
+  char *p = fBuffer;
+  int result = 0, digits = 0;
+  bool negative = false;
+
+  while(IsSpace(*p)) ++p;
+
+  if(*p == '-')
+  {
+    negative = true;
+    ++p;
+  }
+  else if(*p == '+')
+  {
+    ++p;
+  }
+
+  for(; IsDigit(*p); ++p, ++digits)
+  {
+    if(digits == 9) return false;
+    result = result * 10 + (*p - '0');
+  }
+
+  if(digits == 0) return false;
+
+  value = negative ? -result : result;
+  fBuffer = p;
+  return true;
+}
+
+//------------------------------------------------------------------------------
@@ -23,6 +23,9 @@
  *
  *  Provides an interface to manipulate c strings as if they were input streams
  *
+ *  Plain decimal numbers are parsed in place with correct rounding,
+ *  everything else (hexadecimal, inf, nan, out of range) is passed to strtod/strtol.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
@@ -36,6 +39,9 @@ public:
   bool ReadInt(int &value);
 
 private:
+  bool ReadFastDbl(double &value);
+  bool ReadFastInt(int &value);
+
   char *fBuffer;
 
   static bool fFirstLongMin;
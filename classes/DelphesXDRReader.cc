@@ -30,6 +30,14 @@
 #include <stdio.h>
 #include <string.h>
 
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 //------------------------------------------------------------------------------
 
 DelphesXDRReader::DelphesXDRReader() :
@@ -120,3 +128,89 @@ void DelphesXDRReader::ReadString(void *value, int maxSize)
 }
 
 //------------------------------------------------------------------------------
+
+void DelphesXDRReader::ReadArray(void *values, int count, int size)
+{
+  if(count <= 0) return;
+
+  if(fBuffer)
+  {
+    SwapArray(values, fBuffer + fOffset, count, size);
+    fOffset += count * size;
+  }
+  else if(fFile)
+  {
+    fread(values, size, count, fFile);
+    SwapArray(values, values, count, size);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesXDRReader::SwapArray(void *values, const void *source, size_t count, int size)
+{
+  uint8_t *dst = (uint8_t *)values;
+  const uint8_t *src = (const uint8_t *)source;
+  size_t i, bytes;
+  uint32_t value32;
+  uint64_t value64;
+
+  bytes = count * size;
+  i = 0;
+
+  // 16 bytes at a time, four 32-bit or two 64-bit values
+#if defined(__SSSE3__)
+  const __m128i mask = size == 4 ?
+    _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3) :
+    _mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+  for(; i + 16 <= bytes; i += 16)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_shuffle_epi8(x, mask));
+  }
+#elif defined(__SSE2__)
+  for(; i + 16 <= bytes; i += 16)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+    x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+    if(size == 4)
+    {
+      x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+      x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+    }
+    else
+    {
+      x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+      x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+    }
+    _mm_storeu_si128((__m128i *)(dst + i), x);
+  }
+#elif defined(__ARM_NEON)
+  for(; i + 16 <= bytes; i += 16)
+  {
+    uint8x16_t x = vld1q_u8(src + i);
+    vst1q_u8(dst + i, size == 4 ? vrev32q_u8(x) : vrev64q_u8(x));
+  }
+#endif
+
+  if(size == 4)
+  {
+    for(; i < bytes; i += 4)
+    {
+      memcpy(&value32, src + i, 4);
+      value32 = __builtin_bswap32(value32);
+      memcpy(dst + i, &value32, 4);
+    }
+  }
+  else
+  {
+    for(; i < bytes; i += 8)
+    {
+      memcpy(&value64, src + i, 8);
+      value64 = __builtin_bswap64(value64);
+      memcpy(dst + i, &value64, 8);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
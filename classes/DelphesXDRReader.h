@@ -27,6 +27,7 @@
  *
  */
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 
@@ -43,6 +44,12 @@ public:
   void ReadValue(void *value, int size);
   void ReadString(void *value, int maxSize);
 
+  // reads count values of 4 or 8 bytes, converted as a whole array
+  void ReadArray(void *values, int count, int size);
+
+  // converts count values of 4 or 8 bytes, values and source may be the same
+  static void SwapArray(void *values, const void *source, size_t count, int size);
+
 private:
   FILE *fFile;
   uint8_t *fBuffer;
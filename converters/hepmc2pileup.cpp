@@ -34,6 +34,7 @@
 
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesInputStream.h"
 #include "classes/DelphesHepMCReader.h"
 #include "classes/DelphesPileUpWriter.h"
 
@@ -58,6 +59,7 @@ int main(int argc, char *argv[])
 {
   char appName[] = "hepmc2pileup";
   stringstream message;
+  DelphesInputStream *inputStream = 0;
   FILE *inputFile = 0;
   DelphesFactory *factory = 0;
   TObjArray *stableParticleOutputArray = 0, *allParticleOutputArray = 0, *partonOutputArray = 0;
@@ -107,32 +109,30 @@ int main(int argc, char *argv[])
       if(i == argc || strncmp(argv[i], "-", 2) == 0)
       {
         cout << "** Reading standard input" << endl;
-        inputFile = stdin;
-        length = -1;
+        inputStream = new DelphesInputStream(0);
       }
       else
       {
         cout << "** Reading " << argv[i] << endl;
-        inputFile = fopen(argv[i], "r");
+        inputStream = new DelphesInputStream(argv[i]);
 
-        if(inputFile == NULL)
+        if(inputStream->GetSize() <= 0)
         {
-          message << "can't open " << argv[i];
-          throw runtime_error(message.str());
-        }
-
-        fseek(inputFile, 0L, SEEK_END);
-        length = ftello(inputFile);
-        fseek(inputFile, 0L, SEEK_SET);
-
-        if(length <= 0)
-        {
-          fclose(inputFile);
+          delete inputStream;
+          inputStream = 0;
           ++i;
           continue;
         }
       }
 
+      if(inputStream->GetCompression() != DelphesInputStream::kNone)
+      {
+        cout << "** Decompressing " << inputStream->GetCompressionName() << " input" << endl;
+      }
+
+      inputFile = inputStream->GetFile();
+      length = inputStream->GetSize();
+
       reader->SetInputFile(inputFile);
 
       ExRootProgressBar progressBar(length);
@@ -164,14 +164,20 @@ int main(int argc, char *argv[])
           factory->Clear();
           reader->Clear();
         }
-        progressBar.Update(ftello(inputFile), eventCounter);
+        progressBar.Update(inputStream->GetPosition(), eventCounter);
+      }
+
+      if(ferror(inputFile))
+      {
+        message << "can't read " << (i == argc ? "standard input" : argv[i]);
+        throw runtime_error(message.str());
       }
 
-      fseek(inputFile, 0L, SEEK_END);
-      progressBar.Update(ftello(inputFile), eventCounter, kTRUE);
+      progressBar.Update(length, eventCounter, kTRUE);
       progressBar.Finish();
 
-      if(inputFile != stdin) fclose(inputFile);
+      delete inputStream;
+      inputStream = 0;
 
       ++i;
     } while(i < argc);
@@ -0,0 +1,121 @@
+#!/usr/bin/env python
+
+# Streams batches of Papu training tensors from the PapuDelphesTrain ROOT
+# files through DelphesPapuLoader in libDelphes, instead of converting the
+# whole files to .npz with convert.py first.
+#
+#   loader = PapuLoader(files, batch_size=64, shard=rank, shards=world_size)
+#   for epoch in range(epochs):
+#       for batch in loader:
+#           train(batch['x'], batch['met'], batch['jet1'], batch['jet2'])
+#
+# With layout='infer', the PapuDelphesInfer files are read as by
+# convert_infer.py: x has the isolep feature in addition, and the batches
+# have the genz and recz arrays.
+
+import ctypes
+import os
+import sys
+
+import numpy as np
+
+_lib = None
+
+def _load(path=None):
+    global _lib
+    if _lib is not None:
+        return _lib
+    if path is None:
+        path = os.environ.get('DELPHES_LIBRARY', 'libDelphes.so')
+    lib = ctypes.CDLL(path)
+
+    u16 = ctypes.POINTER(ctypes.c_uint16)
+    lib.DelphesPapuLoader_New.restype = ctypes.c_void_p
+    lib.DelphesPapuLoader_New.argtypes = [ctypes.POINTER(ctypes.c_char_p), ctypes.c_int, ctypes.c_size_t,
+                                          ctypes.c_size_t, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int,
+                                          ctypes.c_int]
+    lib.DelphesPapuLoader_Delete.argtypes = [ctypes.c_void_p]
+    lib.DelphesPapuLoader_GetEntries.restype = ctypes.c_longlong
+    lib.DelphesPapuLoader_GetEntries.argtypes = [ctypes.c_void_p]
+    lib.DelphesPapuLoader_GetNumberOfBatches.restype = ctypes.c_longlong
+    lib.DelphesPapuLoader_GetNumberOfBatches.argtypes = [ctypes.c_void_p]
+    lib.DelphesPapuLoader_Reset.argtypes = [ctypes.c_void_p]
+    lib.DelphesPapuLoader_Next.restype = ctypes.c_longlong
+    lib.DelphesPapuLoader_Next.argtypes = [ctypes.c_void_p, u16, u16, u16, u16, u16, u16, u16]
+
+    _lib = lib
+    return lib
+
+
+class PapuLoader(object):
+    # number of features and arrays of each layout, in the order of DelphesPapuLoader::Layout
+    LAYOUTS = {'train': (0, 13, ['x', 'met', 'recoil', 'jet1', 'jet2']),
+               'infer': (1, 14, ['x', 'met', 'recoil', 'jet1', 'jet2', 'genz', 'recz'])}
+
+    def __init__(self, files, batch_size, max_particles=9000, shard=0, shards=1,
+                 threads=2, prefetch=4, drop_last=False, layout='train', library=None):
+        if layout not in self.LAYOUTS:
+            raise ValueError('unknown layout %r' % layout)
+        self._lib = _load(library)
+        if isinstance(files, str):
+            files = [files]
+        names = (ctypes.c_char_p * len(files))(*[f.encode() for f in files])
+        index, self.n_features, self._order = self.LAYOUTS[layout]
+        self._handle = self._lib.DelphesPapuLoader_New(names, len(files), batch_size, max_particles,
+                                                       shard, shards, threads, prefetch, index)
+        if not self._handle:
+            raise RuntimeError('cannot open %s' % ', '.join(files))
+        self.batch_size = batch_size
+        self.max_particles = max_particles
+        self.drop_last = drop_last
+        self._started = False
+
+    def __del__(self):
+        if getattr(self, '_handle', None):
+            self._lib.DelphesPapuLoader_Delete(self._handle)
+            self._handle = None
+
+    @property
+    def entries(self):
+        return self._lib.DelphesPapuLoader_GetEntries(self._handle)
+
+    def __len__(self):
+        if self.drop_last:
+            return self.entries // self.batch_size
+        return self._lib.DelphesPapuLoader_GetNumberOfBatches(self._handle)
+
+    def __iter__(self):
+        # the first pass uses the batches prefetched since construction
+        if self._started:
+            self._lib.DelphesPapuLoader_Reset(self._handle)
+        self._started = True
+
+        n = self.batch_size
+        shapes = {'x': (n, self.max_particles, self.n_features),
+                  'met': (n, 2), 'recoil': (n, 2), 'jet1': (n, 4), 'jet2': (n, 4),
+                  'genz': (n, 2), 'recz': (n, 2)}
+        order = self._order
+        u16 = ctypes.POINTER(ctypes.c_uint16)
+
+        while True:
+            batch = dict((k, np.empty(shapes[k], dtype=np.float16)) for k in order)
+            pointers = [batch[k].ctypes.data_as(u16) for k in order]
+            # genz and recz are not filled with the train layout
+            pointers += [None] * (7 - len(pointers))
+            size = self._lib.DelphesPapuLoader_Next(self._handle, *pointers)
+            if size < 0:
+                raise RuntimeError('DelphesPapuLoader failed')
+            if size == 0 or (self.drop_last and size < n):
+                return
+            if size < n:
+                batch = dict((k, v[:size]) for k, v in batch.items())
+            yield batch
+
+
+if __name__ == '__main__':
+    assert len(sys.argv) >= 2
+
+    loader = PapuLoader(sys.argv[1:], batch_size=64)
+    print('%i entries in %i batches' % (loader.entries, len(loader)))
+    for batch in loader:
+        print(dict((k, v.shape) for k, v in batch.items()))
@@ -267,6 +267,28 @@ OPT_LIBS += -L$(PYTHIA8)/lib -lpythia8 -ldl -lz
 endif
 endif
 
+# compressed input files, gzip is always supported
+CXXFLAGS += -DHAS_ZLIB
+OPT_LIBS += -lz
+
+ifneq ($(ZSTD),)
+$(info zstd input decompression is requested)
+CXXFLAGS += -DHAS_ZSTD -I$(ZSTD)/include
+OPT_LIBS += -L$(ZSTD)/lib -lzstd
+endif
+
+ifneq ($(XZ),)
+$(info xz input decompression is requested)
+CXXFLAGS += -DHAS_LZMA -I$(XZ)/include
+OPT_LIBS += -L$(XZ)/lib -llzma
+endif
+
+ifneq ($(LZ4),)
+$(info lz4 input decompression is requested)
+CXXFLAGS += -DHAS_LZ4 -I$(LZ4)/include
+OPT_LIBS += -L$(LZ4)/lib -llz4
+endif
+
 DELPHES_LIBS += $(OPT_LIBS)
 DISPLAY_LIBS += $(OPT_LIBS)
 
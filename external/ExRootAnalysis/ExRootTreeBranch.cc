@@ -10,8 +10,18 @@
 
 #include "ExRootAnalysis/ExRootTreeBranch.h"
 
+#include "TBranch.h"
+#include "TClass.h"
 #include "TClonesArray.h"
+#include "TDataMember.h"
+#include "TDataType.h"
 #include "TFile.h"
+#include "TLeaf.h"
+#include "TList.h"
+#include "TMath.h"
+#include "TMemFile.h"
+#include "TObjArray.h"
+#include "TObjString.h"
 #include "TString.h"
 #include "TTree.h"
 
@@ -23,7 +33,86 @@ using namespace std;
 
 //------------------------------------------------------------------------------
 
-ExRootTreeBranch::ExRootTreeBranch(const char *name, TClass *cl, TTree *tree) :
+class ExRootTreeColumn
+{
+public:
+  virtual ~ExRootTreeColumn() {}
+  virtual void Fill(TClonesArray *data, Int_t size) = 0;
+  virtual TBranch *GetBranch() const = 0;
+};
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+
+// copies the data member of type T at the given offset of every entry
+// into an array of type S attached to a leaf of the given type
+template <typename T, typename S = T>
+class ExRootTreeColumnT: public ExRootTreeColumn
+{
+public:
+  ExRootTreeColumnT(TTree *tree, const char *name, const char *counter, char type, Long_t offset, Int_t basketSize) :
+    fValues(1), fOffset(offset), fBranch(0)
+  {
+    fBranch = tree->Branch(name, &fValues[0], Form("%s[%s]/%c", name, counter, type), basketSize);
+  }
+
+  void Fill(TClonesArray *data, Int_t size)
+  {
+    Int_t i;
+
+    if(size > Int_t(fValues.size()))
+    {
+      fValues.resize(size);
+      fBranch->SetAddress(&fValues[0]);
+    }
+
+    for(i = 0; i < size; ++i)
+    {
+      fValues[i] = *reinterpret_cast<const T *>(reinterpret_cast<const char *>(data->UncheckedAt(i)) + fOffset);
+    }
+  }
+
+  TBranch *GetBranch() const { return fBranch; }
+
+private:
+  vector<S> fValues;
+  Long_t fOffset;
+  TBranch *fBranch;
+};
+
+//------------------------------------------------------------------------------
+
+ExRootTreeColumn *NewColumn(TTree *tree, const char *name, const char *counter, Int_t type, Long_t offset, Int_t basketSize)
+{
+  switch(type)
+  {
+    case kChar_t: return new ExRootTreeColumnT<Char_t>(tree, name, counter, 'B', offset, basketSize);
+    case kUChar_t: return new ExRootTreeColumnT<UChar_t>(tree, name, counter, 'b', offset, basketSize);
+    case kShort_t: return new ExRootTreeColumnT<Short_t>(tree, name, counter, 'S', offset, basketSize);
+    case kUShort_t: return new ExRootTreeColumnT<UShort_t>(tree, name, counter, 's', offset, basketSize);
+    case kInt_t: return new ExRootTreeColumnT<Int_t>(tree, name, counter, 'I', offset, basketSize);
+    case kUInt_t: return new ExRootTreeColumnT<UInt_t>(tree, name, counter, 'i', offset, basketSize);
+    case kLong_t: return new ExRootTreeColumnT<Long_t>(tree, name, counter, 'G', offset, basketSize);
+    case kULong_t: return new ExRootTreeColumnT<ULong_t>(tree, name, counter, 'g', offset, basketSize);
+    case kLong64_t: return new ExRootTreeColumnT<Long64_t>(tree, name, counter, 'L', offset, basketSize);
+    case kULong64_t: return new ExRootTreeColumnT<ULong64_t>(tree, name, counter, 'l', offset, basketSize);
+    case kFloat_t:
+    case kFloat16_t: return new ExRootTreeColumnT<Float_t>(tree, name, counter, 'F', offset, basketSize);
+    case kDouble_t:
+    case kDouble32_t: return new ExRootTreeColumnT<Double_t>(tree, name, counter, 'D', offset, basketSize);
+    case kBool_t: return new ExRootTreeColumnT<Bool_t, Char_t>(tree, name, counter, 'O', offset, basketSize);
+    default: return 0;
+  }
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+ExRootTreeBranch::ExRootTreeBranch(const char *name, TClass *cl, TTree *tree, const char *fields,
+  Bool_t flat, Int_t basketSize) :
   fSize(0), fCapacity(1), fData(0)
 {
   stringstream message;
@@ -36,10 +125,26 @@ ExRootTreeBranch::ExRootTreeBranch(const char *name, TClass *cl, TTree *tree) :
     fData->SetName(name);
     fData->ExpandCreateFast(fCapacity);
     fData->Clear();
-    if(tree)
+    if(tree && flat)
     {
-      tree->Branch(name, &fData, 64000);
-      tree->Branch(TString(name) + "_size", &fSize, TString(name) + "_size/I");
+      fBranches.push_back(tree->Branch(TString(name) + "_size", &fSize, TString(name) + "_size/I"));
+      CreateColumns(name, cl, tree, fields, basketSize);
+    }
+    else if(tree)
+    {
+      fBranches.push_back(tree->Branch(name, &fData, basketSize));
+      fBranches.push_back(tree->Branch(TString(name) + "_size", &fSize, TString(name) + "_size/I"));
+      if(fields && *fields)
+      {
+        if(CheckFields(name, cl, fields, basketSize))
+        {
+          SelectFields(name, tree, fields);
+        }
+        else
+        {
+          cout << "** WARNING: selected fields of branch '" << name << "' can't be read back, writing all fields" << endl;
+        }
+      }
     }
   }
   else
@@ -53,11 +158,181 @@ ExRootTreeBranch::ExRootTreeBranch(const char *name, TClass *cl, TTree *tree) :
 
 ExRootTreeBranch::~ExRootTreeBranch()
 {
+  vector<ExRootTreeColumn *>::iterator itColumns;
+  for(itColumns = fColumns.begin(); itColumns != fColumns.end(); ++itColumns)
+  {
+    delete *itColumns;
+  }
+
   if(fData) delete fData;
 }
 
 //------------------------------------------------------------------------------
 
+void ExRootTreeBranch::CreateColumns(const char *name, TClass *cl, TTree *tree, const char *fields, Int_t basketSize)
+{
+  TDataMember *member;
+  TObjArray *tokens = 0;
+  ExRootTreeColumn *column;
+  TString counter, columnName;
+  Int_t i, size, type;
+
+  if(fields && *fields) tokens = TString(fields).Tokenize(" \t");
+
+  counter = TString(name) + "_size";
+
+  TIter itDataMembers(cl->GetListOfDataMembers());
+  while((member = static_cast<TDataMember *>(itDataMembers.Next())))
+  {
+    if(!member->IsPersistent() || !member->IsBasic() || (member->Property() & kIsStatic)) continue;
+    if(member->GetArrayDim() > 1) continue;
+    if(tokens && !tokens->FindObject(member->GetName())) continue;
+
+    type = member->GetDataType()->GetType();
+
+    // fixed size arrays are written as one column per element
+    size = member->GetArrayDim() == 1 ? member->GetMaxIndex(0) : 0;
+    for(i = 0; i < TMath::Max(size, 1); ++i)
+    {
+      columnName = TString(name) + "_" + member->GetName();
+      if(size > 0) columnName += TString::Format("_%d", i);
+
+      column = NewColumn(tree, columnName, counter, type, member->GetOffset() + i * member->GetDataType()->Size(), basketSize);
+      if(!column) break;
+
+      fColumns.push_back(column);
+      fBranches.push_back(column->GetBranch());
+    }
+  }
+
+  if(tokens) delete tokens;
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeBranch::FillColumns()
+{
+  vector<ExRootTreeColumn *>::iterator itColumns;
+  for(itColumns = fColumns.begin(); itColumns != fColumns.end(); ++itColumns)
+  {
+    (*itColumns)->Fill(fData, fSize);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeBranch::SetCompressionSettings(Int_t settings)
+{
+  vector<TBranch *>::iterator itBranches;
+  for(itBranches = fBranches.begin(); itBranches != fBranches.end(); ++itBranches)
+  {
+    if(*itBranches) (*itBranches)->SetCompressionSettings(settings);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeBranch::SelectFields(const char *name, TTree *tree, const char *fields)
+{
+  TBranch *branch, *subBranch;
+  TObjArray *subBranches, *leaves, *tokens;
+  TString prefix, field;
+  Int_t i, j, position;
+
+  branch = tree->GetBranch(name);
+  if(!branch) return;
+
+  tokens = TString(fields).Tokenize(" \t");
+
+  // remove the split sub-branches of all other data members,
+  // TObject data members are kept for references
+  prefix = TString(name) + ".";
+  subBranches = branch->GetListOfBranches();
+  for(i = subBranches->GetEntriesFast() - 1; i >= 0; --i)
+  {
+    subBranch = static_cast<TBranch *>(subBranches->At(i));
+
+    field = subBranch->GetName();
+    if(field.BeginsWith(prefix)) field.Remove(0, prefix.Length());
+    position = field.First('.');
+    if(position >= 0) field.Remove(position);
+    position = field.First('[');
+    if(position >= 0) field.Remove(position);
+
+    if(field == "fUniqueID" || field == "fBits" || tokens->FindObject(field.Data())) continue;
+
+    leaves = subBranch->GetListOfLeaves();
+    for(j = 0; j < leaves->GetEntriesFast(); ++j)
+    {
+      tree->GetListOfLeaves()->Remove(leaves->At(j));
+    }
+    subBranches->RemoveAt(i);
+    delete subBranch;
+  }
+  subBranches->Compress();
+  tree->GetListOfLeaves()->Compress();
+
+  delete tokens;
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t ExRootTreeBranch::CheckFields(const char *name, TClass *cl, const char *fields, Int_t basketSize)
+{
+  // writes one entry with the selected fields to a file in memory and
+  // reads it back, as ExRootTreeReader and TTree::Draw do
+  TDirectory::TContext context;
+  TMemFile file("ExRootTreeBranchCheck.root", "RECREATE");
+  TClonesArray *data, *readData;
+  TTree *tree;
+  TBranch *branch, *subBranch;
+  TObjArray *subBranches;
+  Bool_t result = kFALSE;
+  Int_t i;
+
+  data = new TClonesArray(cl, 1);
+  data->ExpandCreateFast(1);
+
+  tree = new TTree("ExRootTreeBranchCheck", "");
+  tree->Branch(name, &data, basketSize);
+  SelectFields(name, tree, fields);
+  tree->Fill();
+  file.Write();
+  delete tree;
+  delete data;
+
+  tree = static_cast<TTree *>(file.Get("ExRootTreeBranchCheck"));
+  if(!tree) return kFALSE;
+
+  readData = new TClonesArray(cl, 1);
+  branch = tree->GetBranch(name);
+  if(branch)
+  {
+    branch->SetAddress(&readData);
+    if(branch->GetEntry(0) > 0 && readData->GetEntriesFast() == 1)
+    {
+      result = kTRUE;
+
+      // the selected leaves of the entry, fUniqueID and fBits are always kept
+      subBranches = branch->GetListOfBranches();
+      for(i = 0; i < subBranches->GetEntriesFast(); ++i)
+      {
+        subBranch = static_cast<TBranch *>(subBranches->At(i));
+        if(TString(subBranch->GetName()).Contains("[")) continue;
+        result = tree->Draw(subBranch->GetName(), "", "goff") == 1;
+        if(!result) break;
+      }
+    }
+  }
+
+  delete tree;
+  delete readData;
+
+  return result;
+}
+
+//------------------------------------------------------------------------------
+
 TObject *ExRootTreeBranch::NewEntry()
 {
   if(!fData) return 0;
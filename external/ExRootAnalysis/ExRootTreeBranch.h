@@ -6,27 +6,56 @@
  *  Class handling object creation.
  *  It is also used for output ROOT tree branches
  *
+ *  If a space separated list of fields is given,
+ *  only these data members of the class are written to the tree.
+ *  The split sub-branches of the other data members are removed,
+ *  after checking on a file in memory that an entry written this way
+ *  is read back by TBranch::GetEntry and TTree::Draw.
+ *  Otherwise, all data members are written.
+ *
+ *  In the flat layout, every data member of basic type is written
+ *  as a variable length array <name>_<member>[<name>_size]
+ *  instead of a split TClonesArray branch, and is read back
+ *  without any streamer. Other data members are not written.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
 
 #include "Rtypes.h"
 
+#include <vector>
+
 class TTree;
+class TBranch;
 class TClonesArray;
+class ExRootTreeColumn;
 
 class ExRootTreeBranch
 {
 public:
-  ExRootTreeBranch(const char *name, TClass *cl, TTree *tree = 0);
+  ExRootTreeBranch(const char *name, TClass *cl, TTree *tree = 0, const char *fields = 0,
+    Bool_t flat = kFALSE, Int_t basketSize = 64000);
   ~ExRootTreeBranch();
 
   TObject *NewEntry();
   void Clear();
 
+  // copies the entries to the flat arrays, called before the tree is filled
+  void FillColumns();
+
+  void SetCompressionSettings(Int_t settings);
+
 private:
+  Bool_t CheckFields(const char *name, TClass *cl, const char *fields, Int_t basketSize);
+  void SelectFields(const char *name, TTree *tree, const char *fields);
+  void CreateColumns(const char *name, TClass *cl, TTree *tree, const char *fields, Int_t basketSize);
+
   Int_t fSize, fCapacity; //!
   TClonesArray *fData; //!
+
+  std::vector<TBranch *> fBranches; //!
+  std::vector<ExRootTreeColumn *> fColumns; //!
 };
 
 #endif /* ExRootTreeBranch */
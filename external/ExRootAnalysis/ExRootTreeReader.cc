@@ -3,15 +3,20 @@
  *
  *  Class simplifying access to ROOT tree branches
  *
+ *  Only the used branches are read, through a tree cache that is
+ *  restricted to them from the first entry on.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
 
 #include "ExRootAnalysis/ExRootTreeReader.h"
 
+#include "RVersion.h"
 #include "TBranchElement.h"
 #include "TCanvas.h"
 #include "TClonesArray.h"
+#include "TEnv.h"
 #include "TH2.h"
 #include "TStyle.h"
 
@@ -19,10 +24,13 @@
 
 using namespace std;
 
+static const Long64_t kCacheSize = 30000000;
+
 //------------------------------------------------------------------------------
 
 ExRootTreeReader::ExRootTreeReader(TTree *tree) :
-  fChain(tree), fCurrentTree(-1)
+  fChain(tree), fCurrentTree(-1),
+  fCacheSize(kCacheSize), fAsyncPrefetching(kFALSE), fCacheConfigured(kFALSE)
 {
 }
 
@@ -58,6 +66,8 @@ Bool_t ExRootTreeReader::ReadEntry(Long64_t entry)
     }
   }
 
+  if(!fCacheConfigured) ConfigureCache();
+
   TBranchMap::iterator itBranchMap;
   TBranch *branch;
 
@@ -103,6 +113,9 @@ TClonesArray *ExRootTreeReader::UseBranch(const char *branchName)
           array->SetName(branchName);
           fBranchMap.insert(make_pair(branchName, make_pair(branch, array)));
           branch->SetAddress(&array);
+
+          // the cache does not learn branches any more once it is set up
+          if(fCacheConfigured && fCacheSize > 0) AddBranchToCache(branch);
         }
       }
     }
@@ -118,6 +131,59 @@ TClonesArray *ExRootTreeReader::UseBranch(const char *branchName)
 
 //------------------------------------------------------------------------------
 
+void ExRootTreeReader::ConfigureCache()
+{
+  // Restrict the tree cache to the used branches and leaves.
+  TBranchMap::iterator itBranchMap;
+  TBranch *branch;
+
+  fCacheConfigured = kTRUE;
+
+  if(fCacheSize <= 0) return;
+
+  // must be set before the cache is created
+  if(fAsyncPrefetching) gEnv->SetValue("TFile.AsyncPrefetching", 1);
+
+  fChain->SetCacheSize(fCacheSize);
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 10, 0)
+  // read the baskets of a whole cluster of entries at once
+  fChain->SetClusterPrefetch(kTRUE);
+#endif
+
+  for(itBranchMap = fBranchMap.begin(); itBranchMap != fBranchMap.end(); ++itBranchMap)
+  {
+    branch = itBranchMap->second.first;
+    if(branch) AddBranchToCache(branch);
+  }
+
+  fChain->StopCacheLearningPhase();
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeReader::AddBranchToCache(TBranch *branch)
+{
+  TBranch *subBranch;
+  TObjArray *subBranches;
+  Int_t i;
+
+  fChain->AddBranchToCache(branch->GetName(), kFALSE);
+
+  // leaves disabled with SetBranchStatus stay out of the cache
+  subBranches = branch->GetListOfBranches();
+  for(i = 0; i < subBranches->GetEntriesFast(); ++i)
+  {
+    subBranch = static_cast<TBranch *>(subBranches->At(i));
+    if(!subBranch->TestBit(kDoNotProcess))
+    {
+      fChain->AddBranchToCache(subBranch->GetName(), kTRUE);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
 Bool_t ExRootTreeReader::Notify()
 {
   // Called when loading a new file.
@@ -5,6 +5,9 @@
  *
  *  Class simplifying access to ROOT tree branches
  *
+ *  Only the used branches are read, through a tree cache that is
+ *  restricted to them from the first entry on.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
@@ -23,18 +26,33 @@ public:
   ~ExRootTreeReader();
 
   void SetTree(TTree *tree) { fChain = tree; }
+  TTree *GetTree() const { return fChain; }
 
   Long64_t GetEntries() const { return fChain ? static_cast<Long64_t>(fChain->GetEntries()) : 0; }
   Bool_t ReadEntry(Long64_t entry);
 
   TClonesArray *UseBranch(const char *branchName);
 
+  // size of the tree cache in bytes, 0 disables the cache
+  void SetCacheSize(Long64_t size) { fCacheSize = size; }
+
+  // fill the tree cache on a background thread, off by default,
+  // sets ROOT's process-wide TFile.AsyncPrefetching
+  void SetAsyncPrefetching(Bool_t enable) { fAsyncPrefetching = enable; }
+
 private:
   Bool_t Notify();
 
+  void ConfigureCache();
+  void AddBranchToCache(TBranch *branch);
+
   TTree *fChain; //! pointer to the analyzed TTree or TChain
   Int_t fCurrentTree; //! current Tree number in a TChain
 
+  Long64_t fCacheSize; //!
+  Bool_t fAsyncPrefetching; //!
+  Bool_t fCacheConfigured; //!
+
   typedef std::map<TString, std::pair<TBranch *, TClonesArray *> > TBranchMap;
 
   TBranchMap fBranchMap; //!
@@ -22,7 +22,8 @@
 using namespace std;
 
 ExRootTreeWriter::ExRootTreeWriter(TFile *file, const char *treeName) :
-  fFile(file), fTree(0), fTreeName(treeName)
+  fFile(file), fTree(0), fTreeName(treeName),
+  fFlatLayout(kFALSE), fBasketSize(64000), fCompressionSettings(-1)
 {
 }
 
@@ -41,10 +42,11 @@ ExRootTreeWriter::~ExRootTreeWriter()
 
 //------------------------------------------------------------------------------
 
-ExRootTreeBranch *ExRootTreeWriter::NewBranch(const char *name, TClass *cl)
+ExRootTreeBranch *ExRootTreeWriter::NewBranch(const char *name, TClass *cl, const char *fields)
 {
   if(!fTree) fTree = NewTree();
-  ExRootTreeBranch *branch = new ExRootTreeBranch(name, cl, fTree);
+  ExRootTreeBranch *branch = new ExRootTreeBranch(name, cl, fTree, fields, fFlatLayout, fBasketSize);
+  if(fCompressionSettings >= 0) branch->SetCompressionSettings(fCompressionSettings);
   fBranches.insert(branch);
   return branch;
 }
@@ -53,7 +55,15 @@ ExRootTreeBranch *ExRootTreeWriter::NewBranch(const char *name, TClass *cl)
 
 void ExRootTreeWriter::Fill()
 {
-  if(fTree) fTree->Fill();
+  if(!fTree) return;
+
+  set<ExRootTreeBranch *>::iterator itBranches;
+  for(itBranches = fBranches.begin(); itBranches != fBranches.end(); ++itBranches)
+  {
+    (*itBranches)->FillColumns();
+  }
+
+  fTree->Fill();
 }
 
 //------------------------------------------------------------------------------
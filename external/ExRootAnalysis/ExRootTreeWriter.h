@@ -27,7 +27,12 @@ public:
   void SetTreeFile(TFile *file) { fFile = file; }
   void SetTreeName(const char *name) { fTreeName = name; }
 
-  ExRootTreeBranch *NewBranch(const char *name, TClass *cl);
+  // settings applied to the branches created afterwards
+  void SetFlatLayout(Bool_t flat) { fFlatLayout = flat; }
+  void SetBasketSize(Int_t size) { fBasketSize = size; }
+  void SetCompressionSettings(Int_t settings) { fCompressionSettings = settings; }
+
+  ExRootTreeBranch *NewBranch(const char *name, TClass *cl, const char *fields = 0);
 
   void Clear();
   void Fill();
@@ -41,6 +46,10 @@ private:
 
   TString fTreeName; //!
 
+  Bool_t fFlatLayout; //!
+  Int_t fBasketSize; //!
+  Int_t fCompressionSettings; //!
+
   std::set<ExRootTreeBranch *> fBranches; //!
 
   ClassDef(ExRootTreeWriter, 1)
@@ -0,0 +1,200 @@
+/*
+---- Hector the simulator ----
+   A fast simulator of particles through generic beamlines.
+   J. de Favereau, X. Rouby ~~~ hector_devel@cp3.phys.ucl.ac.be
+
+        http://www.fynu.ucl.ac.be/hector.html
+
+   Centre de Physique des Particules et de Phénoménologie (CP3)
+   Université Catholique de Louvain (UCL)
+*/
+
+/// \file H_CompiledBeamLine.cc
+/// \brief Fast transport of particles through a fixed beamline.
+
+// Units : angles [rad], distances [m], energies [GeV], c=[1].
+
+// c++ #includes
+#include <cmath>
+#include <vector>
+
+// ROOT #includes
+#include "TMatrix.h"
+
+// local #includes
+#include "H_CompiledBeamLine.h"
+#include "H_AbstractBeamLine.h"
+#include "H_OpticalElement.h"
+#include "H_Aperture.h"
+
+using namespace std;
+
+namespace {
+	// relative mass and absolute charge differences below which the cached matrices are used
+	const double MASS_TOLERANCE = 1e-6;
+	const double CHARGE_TOLERANCE = 1e-6;
+
+	void fillMatrix(const H_OpticalElement * element, const double eloss, const double p_mass, const double p_charge, double * mat) {
+		TMatrix temp_mat = element->getMatrix(eloss,p_mass,p_charge);
+		const float * array = temp_mat.GetMatrixArray();
+		for (int i=0; i<MDIM*MDIM; i++) mat[i] = array[i];
+	}
+}
+
+H_CompiledBeamLine::H_CompiledBeamLine(const H_AbstractBeamLine * beamline, const double emin, const double emax,
+	const double estep, const double p_mass, const double p_charge) :
+	eloss_min(emin), eloss_step(estep), number_eloss(0), number_varying(0), mass(p_mass), charge(p_charge) {
+
+	number_eloss = (estep > 0 && emax > emin) ? (int) ceil((emax-emin)/estep) + 1 : 0;
+
+	const int N = beamline->getNumberOfElements();
+	double first[MDIM*MDIM], last[MDIM*MDIM];
+	elements.resize(N);
+	for (int i=0; i<N; i++) {
+		const H_OpticalElement * element = beamline->getElement((unsigned int) i);
+		Element & el = elements[i];
+		el.element = element;
+		el.x = element->getX();
+		el.tx = tan(element->getTX()/URAD)*URAD;
+		el.y = element->getY();
+		el.ty = tan(element->getTY()/URAD)*URAD;
+		el.s = element->getS()+element->getLength();
+		el.aperture = element->getAperture()->getType()!=NONE;
+		el.offset = matrices.size();
+
+		if(number_eloss == 0) {
+			el.varying = true;
+			continue;
+		}
+
+		// energy independent elements are stored once
+		fillMatrix(element,eloss_min,mass,charge,first);
+		fillMatrix(element,eloss_min+(number_eloss-1)*eloss_step,mass,charge,last);
+		el.varying = false;
+		for (int k=0; k<MDIM*MDIM; k++) if(first[k]!=last[k]) el.varying = true;
+
+		if(!el.varying) {
+			matrices.insert(matrices.end(),first,first+MDIM*MDIM);
+			continue;
+		}
+
+		number_varying++;
+		matrices.resize(el.offset + number_eloss*MDIM*MDIM);
+		for (int j=0; j<number_eloss; j++) {
+			fillMatrix(element,eloss_min+j*eloss_step,mass,charge,&matrices[el.offset + j*MDIM*MDIM]);
+		}
+	}
+}
+
+void H_CompiledBeamLine::multiply(double vec[MDIM], const double * mat) {
+	double temp_vec[MDIM];
+	for (int j=0; j<MDIM; j++) {
+		double sum = 0;
+		for (int i=0; i<MDIM; i++) sum += vec[i]*mat[i*MDIM+j];
+		temp_vec[j] = sum;
+	}
+	for (int j=0; j<MDIM; j++) vec[j] = temp_vec[j];
+}
+
+bool H_CompiledBeamLine::propagate(const H_BeamParticle & particle, const double position, double xys[LENGTH_VEC],
+	vector<double> * path) const {
+
+	extern bool relative_energy;
+
+	const double energy = particle.getE();
+	const double energy_loss = BE-energy;
+
+	double vec[MDIM] = {particle.getX()/URAD, tan(particle.getTX()/URAD), particle.getY()/URAD, tan(particle.getTY()/URAD),
+		relative_energy ? energy-BE : energy, 1};
+
+	// interpolation on the energy loss grid, exact matrices outside
+	// the mass and charge are compared with a tolerance, they are often given in single precision
+	bool exact = number_eloss == 0 || fabs(particle.getM()-mass) > MASS_TOLERANCE*fabs(mass)
+		|| fabs(particle.getQ()-charge) > CHARGE_TOLERANCE;
+	int index = 0;
+	double t = 0;
+	if(!exact) {
+		const double u = (energy_loss-eloss_min)/eloss_step;
+		index = (int) floor(u);
+		if(index < 0 || index > number_eloss-1 || (index == number_eloss-1 && u > index)) exact = true;
+		else {
+			if(index == number_eloss-1) index--;
+			t = u - index;
+		}
+	}
+
+	// previous and current positions, as in H_BeamParticle::positions
+	double previous[LENGTH_VEC] = {particle.getX(), particle.getTX(), particle.getY(), particle.getTY(), particle.getS()};
+	double current[LENGTH_VEC];
+	double mat[MDIM*MDIM];
+
+	// propagate(position) does nothing when position is not after the initial one,
+	// when it is not reachable or when it falls on a zero length element
+	const double initial_s = previous[INDEX_S];
+	bool reached = (position <= initial_s);
+	bool interpolated = false;
+
+	const int N = elements.size();
+	for (int i=0; i<N; i++) {
+		const Element & el = elements[i];
+		const double * element_mat;
+		if(exact) {
+			fillMatrix(el.element,energy_loss,particle.getM(),particle.getQ(),mat);
+			element_mat = mat;
+		} else if(!el.varying) {
+			element_mat = &matrices[el.offset];
+		} else {
+			const double * mat1 = &matrices[el.offset + index*MDIM*MDIM];
+			const double * mat2 = mat1 + MDIM*MDIM;
+			for (int k=0; k<MDIM*MDIM; k++) mat[k] = mat1[k] + t*(mat2[k]-mat1[k]);
+			element_mat = mat;
+		}
+
+		vec[0] -= el.x;
+		vec[1] -= el.tx;
+		vec[2] -= el.y;
+		vec[3] -= el.ty;
+		multiply(vec,element_mat);
+		vec[0] += el.x;
+		vec[1] += el.tx;
+		vec[2] += el.y;
+		vec[3] += el.ty;
+
+		current[INDEX_X] = vec[0]*URAD;
+		current[INDEX_TX] = atan(vec[1])*URAD;
+		current[INDEX_Y] = vec[2]*URAD;
+		current[INDEX_TY] = atan(vec[3])*URAD;
+		current[INDEX_S] = el.s;
+
+		if(path) path->insert(path->end(),current,current+LENGTH_VEC);
+
+		// same as H_BeamParticle::stopped, on the entrance and exit of the element
+		if(el.aperture && !(el.element->isInside(previous[INDEX_X],previous[INDEX_Y]) && el.element->isInside(current[INDEX_X],current[INDEX_Y])))
+			return false;
+
+		// same as H_BeamParticle::propagate(position), linear interpolation of x and y
+		if(!reached && current[INDEX_S] >= position) {
+			reached = true;
+			const double l = current[INDEX_S] - previous[INDEX_S];
+			if(l != 0) {
+				interpolated = true;
+				const double f = (position - previous[INDEX_S])/l;
+				xys[INDEX_X] = previous[INDEX_X] + f*(current[INDEX_X] - previous[INDEX_X]);
+				xys[INDEX_Y] = previous[INDEX_Y] + f*(current[INDEX_Y] - previous[INDEX_Y]);
+				xys[INDEX_TX] = previous[INDEX_TX];
+				xys[INDEX_TY] = previous[INDEX_TY];
+				xys[INDEX_S] = position;
+			}
+		}
+
+		for (int k=0; k<LENGTH_VEC; k++) previous[k] = current[k];
+	}
+
+	// the particle is then left with the coordinates at the end of the beamline set by computePath
+	if(!interpolated) {
+		for (int k=0; k<LENGTH_VEC; k++) xys[k] = previous[k];
+		xys[INDEX_S] = initial_s;
+	}
+
+	return true;
+}
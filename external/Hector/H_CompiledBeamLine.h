@@ -0,0 +1,79 @@
+#ifndef _H_CompiledBeamLine_
+#define _H_CompiledBeamLine_
+
+/*
+---- Hector the simulator ----
+   A fast simulator of particles through generic beamlines.
+   J. de Favereau, X. Rouby ~~~ hector_devel@cp3.phys.ucl.ac.be
+
+        http://www.fynu.ucl.ac.be/hector.html
+
+   Centre de Physique des Particules et de Phénoménologie (CP3)
+   Université Catholique de Louvain (UCL)
+*/
+
+/// \file H_CompiledBeamLine.h
+/// \brief Fast transport of particles through a fixed beamline.
+
+// c++ #includes
+#include <vector>
+
+// local #includes
+#include "H_Parameters.h"
+#include "H_BeamParticle.h"
+
+class H_AbstractBeamLine;
+class H_OpticalElement;
+
+/// \brief Fast transport of particles through a fixed beamline.
+///
+/// The transfer matrices of all elements are computed once on a grid of
+/// energy losses and linearly interpolated for each particle.
+/// Energy independent elements (drifts) are stored once.
+/// The aperture checks of H_BeamParticle::stopped are done in the transport loop
+/// and the positions are only stored when requested.
+/// Particles outside the grid, or with another mass or charge (within 1e-6), use the exact matrices.
+class H_CompiledBeamLine {
+
+	public:
+		/// @param beamline must have its elements in place (after calcMatrix), it must outlive this object
+		/// @param eloss_min, eloss_max, eloss_step define the energy loss grid [GeV]
+		/// @param p_mass, p_charge are the mass [GeV] and charge [e] of the cached particles
+		H_CompiledBeamLine(const H_AbstractBeamLine * beamline, const double eloss_min, const double eloss_max,
+			const double eloss_step, const double p_mass = MP, const double p_charge = QP);
+		~H_CompiledBeamLine() {};
+
+		/// Equivalent to particle.computePath(beamline), particle.stopped(beamline) and particle.propagate(position).
+		/// Returns false if the particle hits an aperture, otherwise fills xys with
+		/// (x [\f$ \mu \f$m], \f$ \theta_x \f$ [\f$ \mu \f$rad], y, \f$ \theta_y \f$, s [m]) at position.
+		/// As in propagate(position), if position is not reached the coordinates are
+		/// those at the end of the beamline, with the initial s.
+		/// If path is given, the positions after each element are appended to it (LENGTH_VEC values each).
+		bool propagate(const H_BeamParticle & particle, const double position, double xys[LENGTH_VEC],
+			std::vector<double> * path = 0) const;
+
+		/// Returns the number of elements with cached matrices depending on the energy loss
+		int getNumberOfVaryingElements() const { return number_varying; };
+
+	private:
+		struct Element {
+			const H_OpticalElement * element;
+			double x, tx, y, ty; // misalignments, as applied in H_BeamParticle::computePath
+			double s; // exit position [m]
+			bool aperture;
+			bool varying; // depends on the energy loss
+			unsigned int offset; // position of the first cached matrix
+		};
+
+		/// row vector times 6x6 matrix, in place
+		static void multiply(double vec[MDIM], const double * mat);
+
+		std::vector<Element> elements;
+		std::vector<double> matrices;
+
+		double eloss_min, eloss_step;
+		int number_eloss, number_varying;
+		double mass, charge;
+};
+
+#endif
@@ -4,7 +4,6 @@
 #include <TVector3.h>
 #include <TMatrixD.h>
 #include <TMatrixDSym.h>
-#include <TDecompChol.h>
 #include <TRandom.h>
 
 #include "SolGridCov.h"
@@ -37,32 +36,38 @@ ObsTrk::~ObsTrk()
 TVectorD ObsTrk::XPtoPar(TVector3 x, TVector3 p, Double_t Q)
 {
   TVectorD Par(5);
+  Double_t xx[3] = { x(0), x(1), x(2) };
+  Double_t pp[3] = { p(0), p(1), p(2) };
+  XPtoPar(xx, pp, Q, fB, Par.GetMatrixArray());
+  return Par;
+}
+
+void ObsTrk::XPtoPar(const Double_t *x, const Double_t *p, Double_t Q, Double_t B, Double_t *Par)
+{
   // Transverse parameters
-  Double_t a = -Q * fB * 0.2998; // Units are Tesla, GeV and m
-  Double_t pt = p.Pt();
+  Double_t a = -Q * B * 0.2998; // Units are Tesla, GeV and m
+  Double_t pt = TMath::Sqrt(p[0] * p[0] + p[1] * p[1]);
   Double_t C = a / (2 * pt); // Half curvature
 
-  Double_t r2 = x.Perp2();
-  Double_t cross = x(0) * p(1) - x(1) * p(0);
+  Double_t r2 = x[0] * x[0] + x[1] * x[1];
+  Double_t cross = x[0] * p[1] - x[1] * p[0];
   Double_t T = TMath::Sqrt(pt * pt - 2 * a * cross + a * a * r2);
-  Double_t phi0 = TMath::ATan2((p(1) - a * x(0)) / T, (p(0) + a * x(1)) / T); // Phi0
+  Double_t phi0 = TMath::ATan2((p[1] - a * x[0]) / T, (p[0] + a * x[1]) / T); // Phi0
   Double_t D; // Impact parameter D
   if (pt < 10.0) D = (T - pt) / a;
   else D = (-2 * cross + a * r2) / (T + pt);
 
-  Par(0) = D; // Store D
-  Par(1) = phi0; // Store phi0
-  Par(2) = C; // Store C
+  Par[0] = D; // Store D
+  Par[1] = phi0; // Store phi0
+  Par[2] = C; // Store C
   // Longitudinal parameters
-  Double_t B = C * TMath::Sqrt(TMath::Max(r2 - D * D,0.0) / (1 + 2 * C * D));
-  Double_t st = TMath::ASin(B) / C;
-  Double_t ct = p(2) / pt;
-  Double_t z0 = x(2) - ct * st;
-
-  Par(3) = z0; // Store z0
-  Par(4) = ct; // Store cot(theta)
+  Double_t B2 = C * TMath::Sqrt(TMath::Max(r2 - D * D,0.0) / (1 + 2 * C * D));
+  Double_t st = TMath::ASin(B2) / C;
+  Double_t ct = p[2] / pt;
+  Double_t z0 = x[2] - ct * st;
 
-  return Par;
+  Par[3] = z0; // Store z0
+  Par[4] = ct; // Store cot(theta)
 }
 
 TVector3 ObsTrk::ParToX(TVectorD Par)
@@ -101,9 +106,17 @@ Double_t ObsTrk::ParToQ(TVectorD Par)
 
 TVectorD ObsTrk::GenToObsPar(TVectorD gPar, SolGridCov *GC)
 {
-  TVector3 p = ParToP(gPar);
-  Double_t pt = p.Pt();
-  Double_t tanTh = 1.0 / TMath::Abs(gPar(4));
+  TVectorD oPar(5);
+  Double_t cov[SolGridCov::kPackedSize];
+  SmearPar(gPar.GetMatrixArray(), fB, GC, oPar.GetMatrixArray(), cov);
+  SolGridCov::Unpack(cov, fCov);
+  return oPar;
+}
+
+void ObsTrk::SmearPar(const Double_t *gPar, Double_t B, SolGridCov *GC, Double_t *oPar, Double_t *cov)
+{
+  Double_t pt = B * 0.2998 / TMath::Abs(2 * gPar[2]);
+  Double_t tanTh = 1.0 / TMath::Abs(gPar[4]);
   Double_t angd = TMath::ATan(tanTh) * 180. / TMath::Pi();
   // Check ranges
   Double_t minPt = GC->GetMinPt ();
@@ -116,26 +129,31 @@ TVectorD ObsTrk::GenToObsPar(TVectorD gPar, SolGridCov *GC)
   Double_t maxAn = GC->GetMaxAng();
   if (angd > maxAn) cout << "Warning ObsTrk::GenToObsPar: angle " << angd
     << " is above grid range of " << maxAn << endl;
-  TMatrixDSym Cov = GC->GetCov(pt, angd);
-  fCov = Cov;
-  // Now do Choleski decomposition and random number extraction, with appropriate stabilization
-  TMatrixDSym CvN = Cov;
-  TMatrixDSym DCv(5); DCv.Zero();
-  TMatrixDSym DCvInv(5); DCvInv.Zero();
-  for (Int_t id = 0; id < 5; id++)
+  GC->GetCov(pt, angd, cov);
+  // Now do Choleski decomposition and random number extraction
+  // The grid is positive definite, the normalization is done in Cholesky for stability
+  Double_t L[SolGridCov::kPackedSize];
+  if (!SolGridCov::Cholesky(cov, L))
+  {
+    for (Int_t k = 0; k < SolGridCov::kPackedSize; k++) L[k] = 0.0;
+  }
+  Double_t r[SolGridCov::kSize];
+  for (Int_t i = 0; i < SolGridCov::kSize; i++) r[i] = gRandom->Gaus(0.0, 1.0); // Array of normal random numbers
+  for (Int_t i = 0; i < SolGridCov::kSize; i++) // Observed parameter vector
   {
-    Double_t dVal = TMath::Sqrt(Cov(id, id));
-    DCv   (id, id) = dVal;
-    DCvInv(id, id) = 1.0 / dVal;
+    Double_t s = 0.0;
+    for (Int_t j = 0; j <= i; j++) s += L[SolGridCov::Index(i, j)] * r[j];
+    oPar[i] = gPar[i] + s;
   }
-  CvN.Similarity(DCvInv); // Normalize diagonal to 1
-  TDecompChol Chl(CvN);
-  Bool_t OK = Chl.Decompose(); // Choleski decomposition of normalized matrix
-  TMatrixD U = Chl.GetU(); // Get Upper triangular matrix
-  TMatrixD Ut(TMatrixD::kTransposed, U); // Transposed of U (lower triangular)
-  TVectorD r(5);
-  for (Int_t i = 0; i < 5; i++) r(i) = gRandom->Gaus(0.0, 1.0); // Array of normal random numbers
-  TVectorD oPar = gPar + DCv * (Ut * r); // Observed parameter vector
+}
 
-  return oPar;
+void ObsTrk::SmearTracks(Int_t n, const Double_t *x, const Double_t *p, const Double_t *Q, Double_t B,
+                         SolGridCov *GC, Double_t *oPar, Double_t *cov)
+{
+  Double_t gPar[SolGridCov::kSize];
+  for (Int_t i = 0; i < n; i++)
+  {
+    XPtoPar(&x[3 * i], &p[3 * i], Q[i], B, gPar);
+    SmearPar(gPar, B, GC, &oPar[SolGridCov::kSize * i], &cov[SolGridCov::kPackedSize * i]);
+  }
 }
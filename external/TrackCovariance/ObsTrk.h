@@ -52,6 +52,14 @@ public:
   // D, phi0, C, z0, cot(th)
   TVectorD GetObsPar() { return fObsPar; }
   TMatrixDSym GetCov() { return fCov; }
+  //
+  // Allocation free smearing of n tracks in one pass
+  // x[3 * n] origins, p[3 * n] momenta, Q[n] charges, B magnetic field in Tesla
+  // Output: oPar[5 * n] observed (D, phi0, C, z0, cot(th)), cov[15 * n] packed covariances
+  static void SmearTracks(Int_t n, const Double_t *x, const Double_t *p, const Double_t *Q, Double_t B,
+                          SolGridCov *GC, Double_t *oPar, Double_t *cov);
+  static void XPtoPar(const Double_t *x, const Double_t *p, Double_t Q, Double_t B, Double_t *Par);
+  static void SmearPar(const Double_t *gPar, Double_t B, SolGridCov *GC, Double_t *oPar, Double_t *cov);
 };
 
 #endif
@@ -1,7 +1,17 @@
+#include <algorithm>
 #include <iostream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <TMath.h>
 #include <TVectorD.h>
+#include <TMatrixD.h>
 #include <TMatrixDSym.h>
 #include <TDecompChol.h>
 #include <TMatrixDSymEigen.h>
@@ -12,60 +22,189 @@
 
 using namespace std;
 
-SolGridCov::SolGridCov()
+// Cache file layout: header, pt grid, angle grid, packed covariance grid
+namespace
+{
+struct SolGridCovHeader
+{
+  char magic[8];
+  ULong64_t key;
+  Int_t npt;
+  Int_t nang;
+};
+
+const char kSolGridCovMagic[8] = { 'S', 'G', 'C', 'O', 'V', '0', '1', 0 };
+
+// FNV-1a hash
+ULong64_t HashBytes(ULong64_t h, const void *data, size_t size)
+{
+  const unsigned char *c = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; i++)
+  {
+    h ^= c[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+}
+
+SolGridCov::SolGridCov() :
+  fNpt(0), fPta(0), fNang(0), fAnga(0), fCov(0), fMap(0), fMapSize(0)
 {
   // Define pt-polar angle grid
-  fNpt = 22;
-  fPta.ResizeTo(fNpt);
   Double_t p[] = { 0.1, 0.2, 0.5, 0.7, 1., 2., 3., 4., 6., 8., 10., 15.,
                    20., 25., 30., 40., 50., 60., 80., 100., 150., 200. };
-  for (Int_t ip = 0; ip < fNpt; ip++) fPta(ip) = p[ip];
-
-  fNang = 13;
-  fAnga.ResizeTo(fNang);
   Double_t a[] = { 10., 15., 20., 25., 30., 35., 40., 45., 50., 60., 70., 80., 90. };
-  for (Int_t ia = 0; ia < fNang; ia++) fAnga(ia) = a[ia];
-  fCov = new TMatrixDSym[fNpt * fNang];
-  for (Int_t ip = 0; ip < fNpt; ip++)
-  {
-    for (Int_t ia = 0; ia < fNang; ia++) fCov[ip * fNang + ia].ResizeTo(5, 5);
-  }
+  SetGrid(22, p, 13, a);
+}
+
+SolGridCov::SolGridCov(Int_t Npt, const Double_t *pt, Int_t Nang, const Double_t *ang) :
+  fNpt(0), fPta(0), fNang(0), fAnga(0), fCov(0), fMap(0), fMapSize(0)
+{
+  SetGrid(Npt, pt, Nang, ang);
 }
 
 SolGridCov::~SolGridCov()
 {
-  delete[] fCov;
+  delete[] fPta;
+  delete[] fAnga;
+  ReleaseCov();
+}
+
+void SolGridCov::SetGrid(Int_t Npt, const Double_t *pt, Int_t Nang, const Double_t *ang)
+{
+  fNpt = Npt;
+  fPta = new Double_t[fNpt];
+  for (Int_t ip = 0; ip < fNpt; ip++) fPta[ip] = pt[ip];
+
+  fNang = Nang;
+  fAnga = new Double_t[fNang];
+  for (Int_t ia = 0; ia < fNang; ia++) fAnga[ia] = ang[ia];
+
+  fCov = new Double_t[fNpt * fNang * kPackedSize];
+  for (Int_t i = 0; i < fNpt * fNang * kPackedSize; i++) fCov[i] = 0.0;
+}
+
+void SolGridCov::ReleaseCov()
+{
+  if (fMap) munmap(fMap, fMapSize);
+  else delete[] fCov;
+  fMap = 0;
+  fMapSize = 0;
+  fCov = 0;
 }
 
 void SolGridCov::Calc(SolGeom *G)
 {
-  TVectorD pta = fPta;
-  TVectorD anga = fAnga;
+  // Grid read from cache is mapped read only
+  if (fMap)
+  {
+    ReleaseCov();
+    fCov = new Double_t[fNpt * fNang * kPackedSize];
+  }
   Bool_t Res = kTRUE; Bool_t MS = kTRUE; // Resolution and multiple scattering flags
   for (Int_t ip = 0; ip < fNpt; ip++) // Loop on pt grid
   {
-    Int_t ipt = TMath::Nint(10 * pta(ip));
     for (Int_t ia = 0; ia < fNang; ia++) // Loop on angle grid
     {
-      Double_t th = TMath::Pi() * (anga(ia)) / 180.;
+      Double_t th = TMath::Pi() * (fAnga[ia]) / 180.;
       Double_t x[3], p[3];
       x[0] = 0; x[1] = 0; x[2] = 0; // Set origin
-      p[0] = pta(ip); p[1] = 0; p[2] = pta(ip) / TMath::Tan(th);
+      p[0] = fPta[ip]; p[1] = 0; p[2] = fPta[ip] / TMath::Tan(th);
       //
-      SolTrack *tr = new SolTrack(x, p, G); // Initialize track
-      tr->CovCalc(Res, MS); // Calculate covariance
-      fCov[ip * fNang + ia] = tr->Cov(); // Get covariance
+      SolTrack tr(x, p, G); // Initialize track
+      tr.CovCalc(Res, MS); // Calculate covariance
+      TMatrixDSym Cv = tr.Cov(); // Get covariance
+      // Validate once here: bilinear interpolation inside the grid is a convex
+      // combination of positive definite matrices and stays positive definite
+      PosDef(Cv);
+      Pack(Cv, &fCov[(ip * fNang + ia) * kPackedSize]);
     }
   }
 }
+
+ULong64_t SolGridCov::Key(SolGeom *G, const char *geometry, Double_t Bz) const
+{
+  ULong64_t h = 14695981039346656037ULL;
+  Double_t B = G->B();
+  h = HashBytes(h, geometry, strlen(geometry));
+  h = HashBytes(h, &B, sizeof(B));
+  h = HashBytes(h, &Bz, sizeof(Bz));
+  h = HashBytes(h, &fNpt, sizeof(fNpt));
+  h = HashBytes(h, fPta, fNpt * sizeof(Double_t));
+  h = HashBytes(h, &fNang, sizeof(fNang));
+  h = HashBytes(h, fAnga, fNang * sizeof(Double_t));
+  return h;
+}
+
+Bool_t SolGridCov::ReadCache(const char *fileName, ULong64_t key)
+{
+  size_t nCov = size_t(fNpt) * fNang * kPackedSize;
+  size_t size = sizeof(SolGridCovHeader) + (fNpt + fNang + nCov) * sizeof(Double_t);
+
+  int fd = open(fileName, O_RDONLY);
+  if (fd < 0) return kFALSE;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || size_t(st.st_size) != size)
+  {
+    close(fd);
+    return kFALSE;
+  }
+
+  void *map = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return kFALSE;
+
+  const SolGridCovHeader *header = static_cast<const SolGridCovHeader *>(map);
+  const Double_t *pta = reinterpret_cast<const Double_t *>(header + 1);
+  const Double_t *anga = pta + fNpt;
+  if (memcmp(header->magic, kSolGridCovMagic, sizeof(kSolGridCovMagic)) != 0 ||
+      header->key != key || header->npt != fNpt || header->nang != fNang ||
+      memcmp(pta, fPta, fNpt * sizeof(Double_t)) != 0 ||
+      memcmp(anga, fAnga, fNang * sizeof(Double_t)) != 0)
+  {
+    munmap(map, size);
+    return kFALSE;
+  }
+
+  ReleaseCov();
+  fMap = map;
+  fMapSize = size;
+  fCov = const_cast<Double_t *>(anga + fNang);
+  return kTRUE;
+}
+
+Bool_t SolGridCov::WriteCache(const char *fileName, ULong64_t key) const
+{
+  SolGridCovHeader header;
+  memcpy(header.magic, kSolGridCovMagic, sizeof(kSolGridCovMagic));
+  header.key = key;
+  header.npt = fNpt;
+  header.nang = fNang;
+
+  // Write to a temporary file and rename it, so that concurrent jobs never read a partial grid
+  stringstream tmpName;
+  tmpName << fileName << ".tmp" << getpid();
+
+  FILE *file = fopen(tmpName.str().c_str(), "wb");
+  if (!file) return kFALSE;
+  Bool_t OK = fwrite(&header, sizeof(header), 1, file) == 1;
+  OK = OK && fwrite(fPta, sizeof(Double_t), fNpt, file) == size_t(fNpt);
+  OK = OK && fwrite(fAnga, sizeof(Double_t), fNang, file) == size_t(fNang);
+  OK = OK && fwrite(fCov, sizeof(Double_t) * kPackedSize, fNpt * fNang, file) == size_t(fNpt * fNang);
+  OK = (fclose(file) == 0) && OK;
+  if (OK) OK = rename(tmpName.str().c_str(), fileName) == 0;
+  if (!OK) remove(tmpName.str().c_str());
+  return OK;
+}
 // Find bin in grid
-Int_t SolGridCov::GetMinIndex(Double_t xval, Int_t N, TVectorD x)
+Int_t SolGridCov::GetMinIndex(Double_t xval, Int_t N, const Double_t *x) const
 {
-  Int_t min = -1; // default for xval below the lower limit
-  if (xval < x(0))return min;
-  if (xval>x(N - 1)){ min = N; return min; }
-  for (Int_t i = 0; i < N; i++) if (xval>x(i))min = i;
-  return min;
+  if (xval < x[0]) return -1; // default for xval below the lower limit
+  if (xval > x[N - 1]) return N;
+  // Last point strictly below xval
+  return Int_t(lower_bound(x, x + N, xval) - x) - 1;
 }
 // Force positive definitness in normalized matrix
 TMatrixDSym SolGridCov::MakePosDef(TMatrixDSym NormMat)
@@ -111,47 +250,124 @@ TMatrixDSym SolGridCov::MakePosDef(TMatrixDSym NormMat)
   }
   return rMatN;
 }
+// Check positive definiteness and recover if needed
+void SolGridCov::PosDef(TMatrixDSym &Cv)
+{
+  TMatrixDSym CvN = Cv;
+  TMatrixDSym DCvInv(kSize); DCvInv.Zero();
+  for (Int_t id = 0; id < kSize; id++) DCvInv(id, id) = 1.0 / TMath::Sqrt(Cv(id, id));
+  CvN.Similarity(DCvInv); // Normalize diagonal to 1
+  TDecompChol Chl(CvN);
+  if (!Chl.Decompose())
+  {
+    cout << "SolGridCov::PosDef: Covariance matrix not positive definite. Recovering ...." << endl;
+    TMatrixDSym rCv = MakePosDef(CvN); CvN = rCv;
+    TMatrixDSym DCv(kSize); DCv.Zero();
+    for (Int_t id = 0; id < kSize; id++) DCv(id, id) = TMath::Sqrt(Cv(id, id));
+    Cv = CvN.Similarity(DCv); // Restore diagonal
+  }
+}
+// Packed matrix conversions
+void SolGridCov::Pack(const TMatrixDSym &M, Double_t *cov)
+{
+  for (Int_t i = 0; i < kSize; i++)
+  {
+    for (Int_t j = 0; j <= i; j++) cov[Index(i, j)] = M(i, j);
+  }
+}
+
+void SolGridCov::Unpack(const Double_t *cov, TMatrixDSym &M)
+{
+  M.ResizeTo(kSize, kSize);
+  for (Int_t i = 0; i < kSize; i++)
+  {
+    for (Int_t j = 0; j <= i; j++)
+    {
+      M(i, j) = cov[Index(i, j)];
+      M(j, i) = M(i, j);
+    }
+  }
+}
+// Choleski decomposition of the matrix normalized to 1 on the diagonal
+Bool_t SolGridCov::Cholesky(const Double_t *cov, Double_t *L)
+{
+  Double_t d[kSize];
+  for (Int_t i = 0; i < kSize; i++)
+  {
+    if (!(cov[Index(i, i)] > 0.0)) return kFALSE;
+    d[i] = TMath::Sqrt(cov[Index(i, i)]);
+  }
+  for (Int_t i = 0; i < kSize; i++)
+  {
+    for (Int_t j = 0; j <= i; j++)
+    {
+      Double_t s = cov[Index(i, j)] / (d[i] * d[j]);
+      for (Int_t k = 0; k < j; k++) s -= L[Index(i, k)] * L[Index(j, k)];
+      if (i == j)
+      {
+        if (s <= 0.0) return kFALSE;
+        L[Index(i, i)] = TMath::Sqrt(s);
+      }
+      else L[Index(i, j)] = s / L[Index(j, j)];
+    }
+  }
+  // Restore the scale: L = D * Ln
+  for (Int_t i = 0; i < kSize; i++)
+  {
+    for (Int_t j = 0; j <= i; j++) L[Index(i, j)] *= d[i];
+  }
+  return kTRUE;
+}
 // Interpolate covariance matrix: Bi-linear interpolation
-TMatrixDSym SolGridCov::GetCov(Double_t pt, Double_t ang)
+void SolGridCov::GetCov(Double_t pt, Double_t ang, Double_t *cov)
 {
   // pt in GeV and ang in degrees
   Int_t minPt = GetMinIndex(pt, fNpt, fPta);
   if (minPt == -1)minPt = 0;
-  if (minPt == fNpt - 1)minPt = fNpt - 2;
-  Double_t dpt = fPta(minPt + 1) - fPta(minPt);
+  if (minPt >= fNpt - 1)minPt = fNpt - 2;
+  Double_t dpt = fPta[minPt + 1] - fPta[minPt];
   // Put ang in 0-90 range
   ang = TMath::Abs(ang);
   while (ang > 90.)ang -= 90.;  // Needs to be fixed
   Int_t minAng = GetMinIndex(ang, fNang, fAnga);
   if (minAng == -1)minAng = 0;
-  if (minAng == fNang - 1)minAng = fNang - 2;
-  Double_t dang = fAnga(minAng + 1) - fAnga(minAng);
+  if (minAng >= fNang - 1)minAng = fNang - 2;
+  Double_t dang = fAnga[minAng + 1] - fAnga[minAng];
   //
-  Double_t tpt = (pt - fPta(minPt)) / dpt;
-  Double_t tang = (ang - fAnga(minAng)) / dang;
+  Double_t tpt = (pt - fPta[minPt]) / dpt;
+  Double_t tang = (ang - fAnga[minAng]) / dang;
   //
-  TMatrixDSym C11 = fCov[minPt * fNang + minAng];
-  TMatrixDSym C12 = fCov[minPt * fNang + minAng + 1];
-  TMatrixDSym C21 = fCov[(minPt + 1) * fNang + minAng];
-  TMatrixDSym C22 = fCov[(minPt + 1) * fNang + minAng + 1];
-  TMatrixDSym Cv = ((1-tpt) * (1-tang)) * C11 +
-                   ((1-tpt) *    tang ) * C12 +
-                   (   tpt  * (1-tang)) * C21 +
-                   (   tpt  *    tang ) * C22;
-  // Check for positive definiteness
-  TMatrixDSym CvN = Cv;
-  TMatrixDSym DCvInv(5); DCvInv.Zero();
-  for (Int_t id = 0; id < 5; id++) DCvInv(id, id) = 1.0 / TMath::Sqrt(Cv(id, id));
-  CvN.Similarity(DCvInv); // Normalize diagonal to 1
-  TDecompChol Chl(CvN);
-  if (!Chl.Decompose())
+  const Double_t *C11 = &fCov[(minPt * fNang + minAng) * kPackedSize];
+  const Double_t *C12 = C11 + kPackedSize;
+  const Double_t *C21 = C11 + fNang * kPackedSize;
+  const Double_t *C22 = C21 + kPackedSize;
+  Double_t w11 = (1-tpt) * (1-tang);
+  Double_t w12 = (1-tpt) *    tang;
+  Double_t w21 =    tpt  * (1-tang);
+  Double_t w22 =    tpt  *    tang;
+  for (Int_t k = 0; k < kPackedSize; k++)
   {
-    cout << "SolGridCov::GetCov: Interpolated matrix not positive definite. Recovering ...." << endl;
-    TMatrixDSym rCv = MakePosDef(CvN); CvN = rCv;
-    TMatrixDSym DCv(5); DCv.Zero();
-    for (Int_t id = 0; id < 5; id++) DCv(id, id) = TMath::Sqrt(Cv(id, id));
-    Cv = CvN.Similarity(DCv); // Normalize diagonal to 1
+    cov[k] = w11 * C11[k] + w12 * C12[k] + w21 * C21[k] + w22 * C22[k];
   }
+  // Outside the grid the extrapolation may not be positive definite
+  if (tpt < 0.0 || tpt > 1.0 || tang < 0.0 || tang > 1.0)
+  {
+    Double_t L[kPackedSize];
+    if (!Cholesky(cov, L))
+    {
+      TMatrixDSym Cv;
+      Unpack(cov, Cv);
+      PosDef(Cv);
+      Pack(Cv, cov);
+    }
+  }
+}
 
+TMatrixDSym SolGridCov::GetCov(Double_t pt, Double_t ang)
+{
+  Double_t cov[kPackedSize];
+  GetCov(pt, ang, cov);
+  TMatrixDSym Cv(kSize);
+  Unpack(cov, Cv);
   return Cv;
 }
@@ -1,7 +1,6 @@
 #ifndef G__SOLGRIDCOV_H
 #define G__SOLGRIDCOV_H
 
-#include <TVectorD.h>
 #include <TMatrixDSym.h>
 
 class SolGeom;
@@ -10,26 +9,51 @@ class SolGeom;
 
 class SolGridCov{
   // Class to handle storing and retrieving/interpolation of covariance matrices
+  // Matrices are stored as packed lower triangles: element (i, j), j <= i, is at Index(i, j)
+public:
+  static const Int_t kSize = 5;        // Number of track parameters
+  static const Int_t kPackedSize = 15; // Number of independent elements
 private:
   Int_t fNpt;        // Number of pt points in grid
-  TVectorD fPta;     // Array of pt points in GeV
+  Double_t *fPta;    // Array of pt points in GeV
   Int_t fNang;       // Number of angle points in grid
-  TVectorD fAnga;    // Array of angle points in degrees
-  TMatrixDSym *fCov; // Pointers to grid of covariance matrices
+  Double_t *fAnga;   // Array of angle points in degrees
+  Double_t *fCov;    // Grid of packed covariance matrices, positive definite after Calc
+  void *fMap;        // Mapped cache file, fCov points into it when the grid is read from cache
+  size_t fMapSize;   // Size of the mapped cache file
   // Service routines
-  Int_t GetMinIndex(Double_t xval, Int_t N, TVectorD x); // Find bin
+  Int_t GetMinIndex(Double_t xval, Int_t N, const Double_t *x) const; // Find bin
   TMatrixDSym MakePosDef(TMatrixDSym NormMat); // Force positive definitness
+  void PosDef(TMatrixDSym &Cv); // Force positive definitness of unnormalized matrix
+  void SetGrid(Int_t Npt, const Double_t *pt, Int_t Nang, const Double_t *ang);
+  void ReleaseCov();
 public:
   SolGridCov();
+  // Npt pt points in GeV and Nang angle points in degrees, both in increasing order
+  SolGridCov(Int_t Npt, const Double_t *pt, Int_t Nang, const Double_t *ang);
   ~SolGridCov();
 
   void Calc(SolGeom *G);
 
+  // Grid cache
+  // The key identifies the geometry description, the magnetic fields and the grid points
+  ULong64_t Key(SolGeom *G, const char *geometry, Double_t Bz) const;
+  Bool_t ReadCache(const char *fileName, ULong64_t key); // Returns kFALSE if missing or stale
+  Bool_t WriteCache(const char *fileName, ULong64_t key) const;
+
+  // Packed matrix service routines
+  static Int_t Index(Int_t i, Int_t j) { return i >= j ? i * (i + 1) / 2 + j : j * (j + 1) / 2 + i; }
+  static void Pack(const TMatrixDSym &M, Double_t *cov);
+  static void Unpack(const Double_t *cov, TMatrixDSym &M);
+  // Lower triangular L with cov = L * L^T, returns kFALSE if cov is not positive definite
+  static Bool_t Cholesky(const Double_t *cov, Double_t *L);
+
   // Covariance interpolation
-  Double_t GetMinPt()  { return fPta(0); }
-  Double_t GetMaxPt()  { return fPta(fNpt - 1); }
-  Double_t GetMinAng() { return fAnga(0); }
-  Double_t GetMaxAng() { return fAnga(fNang - 1); }
+  Double_t GetMinPt()  const { return fPta[0]; }
+  Double_t GetMaxPt()  const { return fPta[fNpt - 1]; }
+  Double_t GetMinAng() const { return fAnga[0]; }
+  Double_t GetMaxAng() const { return fAnga[fNang - 1]; }
+  void GetCov(Double_t pt, Double_t ang, Double_t *cov); // Packed, allocation free inside the grid
   TMatrixDSym GetCov(Double_t pt, Double_t ang);
 };
 
@@ -29,6 +29,7 @@
 #include "modules/BTagging.h"
 
 #include "classes/DelphesClasses.h"
+#include "classes/DelphesEfficiencyTable.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
 
@@ -50,7 +51,7 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 BTagging::BTagging() :
-  fItJetInputArray(0)
+  fWorkingPoints(0), fItJetInputArray(0)
 {
 }
 
@@ -64,35 +65,9 @@ BTagging::~BTagging()
 
 void BTagging::Init()
 {
-  map<Int_t, DelphesFormula *>::iterator itEfficiencyMap;
-  ExRootConfParam param;
-  DelphesFormula *formula;
-  Int_t i, size;
-
-  fBitNumber = GetInt("BitNumber", 0);
-
-  // read efficiency formulas
-  param = GetParam("EfficiencyFormula");
-  size = param.GetSize();
-
-  fEfficiencyMap.clear();
-  for(i = 0; i < size / 2; ++i)
-  {
-    formula = new DelphesFormula;
-    formula->Compile(param[i * 2 + 1].GetString());
-
-    fEfficiencyMap[param[i * 2].GetInt()] = formula;
-  }
-
-  // set default efficiency formula
-  itEfficiencyMap = fEfficiencyMap.find(0);
-  if(itEfficiencyMap == fEfficiencyMap.end())
-  {
-    formula = new DelphesFormula;
-    formula->Compile("0.0");
-
-    fEfficiencyMap[0] = formula;
-  }
+  // read efficiency formulas of all working points
+  fWorkingPoints = new DelphesWorkingPoints;
+  fWorkingPoints->Read(this);
 
   // import input array(s)
 
@@ -104,16 +79,8 @@ void BTagging::Init()
 
 void BTagging::Finish()
 {
-  map<Int_t, DelphesFormula *>::iterator itEfficiencyMap;
-  DelphesFormula *formula;
-
   if(fItJetInputArray) delete fItJetInputArray;
-
-  for(itEfficiencyMap = fEfficiencyMap.begin(); itEfficiencyMap != fEfficiencyMap.end(); ++itEfficiencyMap)
-  {
-    formula = itEfficiencyMap->second;
-    if(formula) delete formula;
-  }
+  if(fWorkingPoints) delete fWorkingPoints;
 }
 
 //------------------------------------------------------------------------------
@@ -121,52 +88,44 @@ void BTagging::Finish()
 void BTagging::Process()
 {
   Candidate *jet;
-  Double_t pt, eta, phi, e;
-  map<Int_t, DelphesFormula *>::iterator itEfficiencyMap;
-  DelphesFormula *formula;
+  Double_t pt, eta, phi, e, eff, effAlgo, effPhys;
+  DelphesEfficiencyMap *efficiencyMap;
+  DelphesEfficiencyTable *table, *tableAlgo, *tablePhys;
+  Int_t i, size, bitNumber;
+
+  size = fWorkingPoints->GetSize();
 
   // loop over all input jets
   fItJetInputArray->Reset();
   while((jet = static_cast<Candidate *>(fItJetInputArray->Next())))
   {
     const TLorentzVector &jetMomentum = jet->Momentum;
-    eta = jetMomentum.Eta();
-    phi = jetMomentum.Phi();
-    pt = jetMomentum.Pt();
+    eta = jet->MomentumEta();
+    phi = jet->MomentumPhi();
+    pt = jet->MomentumPt();
     e = jetMomentum.E();
 
-    // find an efficiency formula
-    itEfficiencyMap = fEfficiencyMap.find(jet->Flavor);
-    if(itEfficiencyMap == fEfficiencyMap.end())
-    {
-      itEfficiencyMap = fEfficiencyMap.find(0);
-    }
-    formula = itEfficiencyMap->second;
-
-    // apply an efficiency formula
-    jet->BTag |= (gRandom->Uniform() <= formula->Eval(pt, eta, phi, e)) << fBitNumber;
-
-    // find an efficiency formula for algo flavor definition
-    itEfficiencyMap = fEfficiencyMap.find(jet->FlavorAlgo);
-    if(itEfficiencyMap == fEfficiencyMap.end())
-    {
-      itEfficiencyMap = fEfficiencyMap.find(0);
-    }
-    formula = itEfficiencyMap->second;
-
-    // apply an efficiency formula
-    jet->BTagAlgo |= (gRandom->Uniform() <= formula->Eval(pt, eta, phi, e)) << fBitNumber;
-
-    // find an efficiency formula for phys flavor definition
-    itEfficiencyMap = fEfficiencyMap.find(jet->FlavorPhys);
-    if(itEfficiencyMap == fEfficiencyMap.end())
+    // loop over all working points
+    for(i = 0; i < size; ++i)
     {
-      itEfficiencyMap = fEfficiencyMap.find(0);
+      efficiencyMap = fWorkingPoints->GetEfficiencyMap(i);
+      bitNumber = fWorkingPoints->GetBitNumber(i);
+
+      // find efficiency tables for the standard, algo and phys flavor definitions,
+      // which usually agree and then need to be evaluated only once
+      table = efficiencyMap->Find(jet->Flavor);
+      tableAlgo = efficiencyMap->Find(jet->FlavorAlgo);
+      tablePhys = efficiencyMap->Find(jet->FlavorPhys);
+
+      eff = table->Eval(pt, eta, phi, e);
+      effAlgo = (tableAlgo == table) ? eff : tableAlgo->Eval(pt, eta, phi, e);
+      effPhys = (tablePhys == table) ? eff : (tablePhys == tableAlgo) ? effAlgo : tablePhys->Eval(pt, eta, phi, e);
+
+      // apply efficiencies
+      jet->BTag |= (gRandom->Uniform() <= eff) << bitNumber;
+      jet->BTagAlgo |= (gRandom->Uniform() <= effAlgo) << bitNumber;
+      jet->BTagPhys |= (gRandom->Uniform() <= effPhys) << bitNumber;
     }
-    formula = itEfficiencyMap->second;
-
-    // apply an efficiency formula
-    jet->BTagPhys |= (gRandom->Uniform() <= formula->Eval(pt, eta, phi, e)) << fBitNumber;
   }
 }
 
@@ -25,16 +25,17 @@
  *  applies b-tagging efficiency (miss identification rate) formulas
  *  and sets b-tagging flags 
  *
+ *  Several working points can be applied in the same pass over the jets,
+ *  see DelphesWorkingPoints.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
 
 #include "classes/DelphesModule.h"
 
-#include <map>
-
 class TObjArray;
-class DelphesFormula;
+class DelphesWorkingPoints;
 
 class BTagging: public DelphesModule
 {
@@ -47,11 +48,7 @@ public:
   void Finish();
 
 private:
-  Int_t fBitNumber;
-
-#if !defined(__CINT__) && !defined(__CLING__)
-  std::map<Int_t, DelphesFormula *> fEfficiencyMap; //!
-#endif
+  DelphesWorkingPoints *fWorkingPoints; //!
 
   TIterator *fItJetInputArray; //!
 
@@ -232,7 +232,6 @@ void Calorimeter::Process()
   number = -1;
   while((particle = static_cast<Candidate *>(fItParticleInputArray->Next())))
   {
-    const TLorentzVector &particlePosition = particle->Position;
     ++number;
 
     pdgCode = TMath::Abs(particle->PID);
@@ -252,7 +251,7 @@ void Calorimeter::Process()
     if(ecalFraction < 1.0E-9 && hcalFraction < 1.0E-9) continue;
 
     // find eta bin [1, fEtaBins.size - 1]
-    itEtaBin = lower_bound(fEtaBins.begin(), fEtaBins.end(), particlePosition.Eta());
+    itEtaBin = lower_bound(fEtaBins.begin(), fEtaBins.end(), particle->PositionEta());
     if(itEtaBin == fEtaBins.begin() || itEtaBin == fEtaBins.end()) continue;
     etaBin = distance(fEtaBins.begin(), itEtaBin);
 
@@ -260,7 +259,7 @@ void Calorimeter::Process()
     phiBins = fPhiBins[etaBin];
 
     // find phi bin [1, phiBins.size - 1]
-    itPhiBin = lower_bound(phiBins->begin(), phiBins->end(), particlePosition.Phi());
+    itPhiBin = lower_bound(phiBins->begin(), phiBins->end(), particle->PositionPhi());
     if(itPhiBin == phiBins->begin() || itPhiBin == phiBins->end()) continue;
     phiBin = distance(phiBins->begin(), itPhiBin);
 
@@ -278,7 +277,6 @@ void Calorimeter::Process()
   number = -1;
   while((track = static_cast<Candidate *>(fItTrackInputArray->Next())))
   {
-    const TLorentzVector &trackPosition = track->Position;
     ++number;
 
     pdgCode = TMath::Abs(track->PID);
@@ -296,7 +294,7 @@ void Calorimeter::Process()
     fHCalTrackFractions.push_back(hcalFraction);
 
     // find eta bin [1, fEtaBins.size - 1]
-    itEtaBin = lower_bound(fEtaBins.begin(), fEtaBins.end(), trackPosition.Eta());
+    itEtaBin = lower_bound(fEtaBins.begin(), fEtaBins.end(), track->PositionEta());
     if(itEtaBin == fEtaBins.begin() || itEtaBin == fEtaBins.end()) continue;
     etaBin = distance(fEtaBins.begin(), itEtaBin);
 
@@ -304,7 +302,7 @@ void Calorimeter::Process()
     phiBins = fPhiBins[etaBin];
 
     // find phi bin [1, phiBins.size - 1]
-    itPhiBin = lower_bound(phiBins->begin(), phiBins->end(), trackPosition.Phi());
+    itPhiBin = lower_bound(phiBins->begin(), phiBins->end(), track->PositionPhi());
     if(itPhiBin == phiBins->begin() || itPhiBin == phiBins->end()) continue;
     phiBin = distance(phiBins->begin(), itPhiBin);
 
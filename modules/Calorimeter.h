@@ -48,6 +48,9 @@ public:
   void Process();
   void Finish();
 
+  // builds new candidates from the imported ones
+  Bool_t IsReadOnly() const { return kTRUE; }
+
 private:
   typedef std::map<Long64_t, std::pair<Double_t, Double_t> > TFractionMap; //!
   typedef std::map<Double_t, std::set<Double_t> > TBinMap; //!
@@ -30,6 +30,8 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesProfiler.h"
+#include "classes/DelphesScheduler.h"
 
 #include "ExRootAnalysis/ExRootClassifier.h"
 #include "ExRootAnalysis/ExRootConfReader.h"
@@ -58,7 +60,7 @@
 using namespace std;
 
 Delphes::Delphes(const char *name) :
-  fFactory(0)
+  fFactory(0), fScheduler(0), fProfiler(0)
 {
   TFolder *folder = new TFolder(name, "");
   fFactory = new DelphesFactory("ObjectFactory");
@@ -76,6 +78,8 @@ Delphes::Delphes(const char *name) :
 
 Delphes::~Delphes()
 {
+  if(fScheduler) delete fScheduler;
+  if(fProfiler) delete fProfiler;
   TFolder *folder = GetFolder();
   if(folder)
   {
@@ -154,3 +158,143 @@ void Delphes::Finish()
 }
 
 //------------------------------------------------------------------------------
+
+void Delphes::InitTask()
+{
+  ExRootTask::InitTask();
+
+  if(GetConfReader()->GetBool("::Profile", false)) InitProfiler();
+
+  // the arrays used by the modules are known once they are initialized
+  if(GetConfReader()->GetInt("::NumberOfThreads", 0) > 0) InitScheduler();
+}
+
+//------------------------------------------------------------------------------
+
+void Delphes::ProcessTask()
+{
+  if(fScheduler)
+  {
+    Process();
+    fScheduler->ProcessEvent();
+  }
+  else if(fProfiler)
+  {
+    Process();
+    ProcessSubTasks();
+  }
+  else
+  {
+    ExRootTask::ProcessTask();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Delphes::ProcessSubTasks()
+{
+  ExRootTask *task;
+  DelphesProfiler::Sample sample;
+  Int_t index = 0;
+
+  if(!fProfiler)
+  {
+    ExRootTask::ProcessSubTasks();
+    return;
+  }
+
+  TIter itTasks(GetListOfTasks());
+  while((task = static_cast<ExRootTask *>(itTasks.Next())))
+  {
+    fProfiler->Start(sample);
+    task->ProcessTask();
+    fProfiler->Stop(index++, sample);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Delphes::FinishTask()
+{
+  ExRootTask::FinishTask();
+
+  if(fScheduler)
+  {
+    fScheduler->PrintSummary();
+    delete fScheduler;
+    fScheduler = 0;
+  }
+
+  if(fProfiler)
+  {
+    fProfiler->PrintSummary();
+    delete fProfiler;
+    fProfiler = 0;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Delphes::InitProfiler()
+{
+  TTask *task;
+
+  fProfiler = new DelphesProfiler(GetConfReader()->GetString("::ProfileTrace", ""));
+
+  TIter itTasks(GetListOfTasks());
+  while((task = static_cast<TTask *>(itTasks.Next())))
+  {
+    fProfiler->AddModule(task->GetName());
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Delphes::InitScheduler()
+{
+  ExRootConfReader *confReader = GetConfReader();
+  Int_t numberOfThreads = confReader->GetInt("::NumberOfThreads", 0);
+  vector<string> inputs, outputs, dependencies;
+  bool readOnly;
+  ExRootConfParam param;
+  DelphesModule *module;
+  TTask *task;
+  Long_t i;
+
+  if(numberOfThreads > 1) ROOT::EnableThreadSafety();
+
+  fFactory->SetThreadSafe(numberOfThreads > 1);
+  Candidate::SetKinematicsCache(numberOfThreads <= 1);
+  fScheduler = new DelphesScheduler(numberOfThreads, confReader->GetInt("::RandomSeed", 0));
+  fScheduler->SetProfiler(fProfiler);
+
+  TIter itTasks(GetListOfTasks());
+  while((task = static_cast<TTask *>(itTasks.Next())))
+  {
+    inputs.clear();
+    outputs.clear();
+    dependencies.clear();
+    readOnly = false;
+
+    if(task->InheritsFrom(DelphesModule::Class()))
+    {
+      module = static_cast<DelphesModule *>(task);
+      inputs = module->GetImportedArrays();
+      outputs = module->GetExportedArrays();
+      readOnly = module->IsReadOnly();
+    }
+
+    param = confReader->GetParam(TString(task->GetName()) + "::DependsOn");
+    for(i = 0; i < param.GetSize(); ++i)
+    {
+      dependencies.push_back(param[i].GetString());
+    }
+
+    fScheduler->AddModule(static_cast<ExRootTask *>(task), inputs, outputs, dependencies, readOnly);
+  }
+
+  cout << "** INFO: running " << GetListOfTasks()->GetSize() << " modules on ";
+  cout << numberOfThreads << " threads" << endl;
+}
+
+//------------------------------------------------------------------------------
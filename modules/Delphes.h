@@ -24,6 +24,16 @@
  *  Main Delphes module.
  *  Controls execution of all other modules.
  *
+ *  With NumberOfThreads set to 1 or more, the modules of each event
+ *  are run by DelphesScheduler as a dataflow graph derived from their
+ *  imported and exported arrays instead of in ExecutionPath order.
+ *  Only the modules declared read-only run concurrently with each other.
+ *  Every module then has its own random number generator.
+ *
+ *  With Profile set, the time, allocations and memory of every module
+ *  are printed at the end of the run, and written as a Chrome trace
+ *  JSON timeline to the file given by ProfileTrace.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
@@ -36,6 +46,8 @@ class TObjArray;
 class ExRootTreeWriter;
 
 class DelphesFactory;
+class DelphesScheduler;
+class DelphesProfiler;
 
 class Delphes: public DelphesModule
 {
@@ -47,15 +59,30 @@ public:
 
   DelphesFactory *GetFactory() const { return fFactory; }
 
+  // null unless ::Profile is set, deleted by FinishTask
+  DelphesProfiler *GetProfiler() const { return fProfiler; }
+
   void Clear();
 
   virtual void Init();
   virtual void Process();
   virtual void Finish();
 
+  virtual void InitTask();
+  virtual void ProcessTask();
+  virtual void FinishTask();
+
+  virtual void ProcessSubTasks();
+
 private:
+  void InitScheduler();
+  void InitProfiler();
+
   DelphesFactory *fFactory;
 
+  DelphesScheduler *fScheduler; //!
+  DelphesProfiler *fProfiler; //!
+
   ClassDef(Delphes, 1)
 };
 
@@ -99,11 +99,10 @@ void Efficiency::Process()
   fItInputArray->Reset();
   while((candidate = static_cast<Candidate *>(fItInputArray->Next())))
   {
-    const TLorentzVector &candidatePosition = candidate->Position;
     const TLorentzVector &candidateMomentum = candidate->Momentum;
-    eta = candidatePosition.Eta();
-    phi = candidatePosition.Phi();
-    pt = candidateMomentum.Pt();
+    eta = candidate->PositionEta();
+    phi = candidate->PositionPhi();
+    pt = candidate->MomentumPt();
     e = candidateMomentum.E();
     
     // apply an efficency formula
@@ -43,6 +43,9 @@ public:
   void Process();
   void Finish();
 
+  // only selects imported candidates
+  Bool_t IsReadOnly() const { return kTRUE; }
+
 private:
   DelphesFormula *fFormula; //!
 
@@ -43,6 +43,9 @@ public:
   void Process();
   void Finish();
 
+  // rescales clones, the imported candidates are only read
+  Bool_t IsReadOnly() const { return kTRUE; }
+
 private:
   DelphesFormula *fFormula; //!
 
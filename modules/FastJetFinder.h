@@ -58,6 +58,9 @@ public:
   void Process();
   void Finish();
 
+  // builds new candidates from the imported ones
+  Bool_t IsReadOnly() const { return kTRUE; }
+
 private:
   void *fPlugin; //!
   void *fRecomb; //!
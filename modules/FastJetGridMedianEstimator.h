@@ -48,6 +48,9 @@ public:
   void Process();
   void Finish();
 
+  // builds new candidates from the imported ones
+  Bool_t IsReadOnly() const { return kTRUE; }
+
 private:
   std::vector<fastjet::GridMedianBackgroundEstimator *> fEstimators; //!
 
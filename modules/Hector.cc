@@ -49,6 +49,7 @@
 
 #include "Hector/H_BeamLine.h"
 #include "Hector/H_BeamParticle.h"
+#include "Hector/H_CompiledBeamLine.h"
 #include "Hector/H_RecRPObject.h"
 
 using namespace std;
@@ -56,7 +57,7 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 Hector::Hector() :
-  fBeamLine(0), fItInputArray(0)
+  fBeamLine(0), fCompiledBeamLine(0), fItInputArray(0)
 {
 }
 
@@ -83,11 +84,19 @@ void Hector::Init()
   fSigmaT = GetDouble("SigmaT", 0.0);
   fEtaMin = GetDouble("EtaMin", 5.0);
 
+  // grid of energy losses (GeV) for the cached transfer matrices,
+  // the exact matrices are used outside the grid or if EnergyLossStep <= 0
+  fEnergyLossMin = GetDouble("EnergyLossMin", -50.0);
+  fEnergyLossMax = GetDouble("EnergyLossMax", 2100.0);
+  fEnergyLossStep = GetDouble("EnergyLossStep", 2.0);
+
   fBeamLine = new H_BeamLine(fDirection, fBeamLineLength + 0.1);
   fBeamLine->fill(GetString("BeamLineFile", "cards/LHCB1IR5_5TeV.tfs"), fDirection, GetString("IPName", "IP5"));
   fBeamLine->offsetElements(fOffsetS, fOffsetX);
   fBeamLine->calcMatrix();
 
+  fCompiledBeamLine = new H_CompiledBeamLine(fBeamLine, fEnergyLossMin, fEnergyLossMax, fEnergyLossStep);
+
   // import input array
 
   fInputArray = ImportArray(GetString("InputArray", "ParticlePropagator/stableParticles"));
@@ -103,6 +112,7 @@ void Hector::Init()
 void Hector::Finish()
 {
   if(fItInputArray) delete fItInputArray;
+  if(fCompiledBeamLine) delete fCompiledBeamLine;
   if(fBeamLine) delete fBeamLine;
 }
 
@@ -114,6 +124,7 @@ void Hector::Process()
   Double_t pz;
   Double_t x, y, z, tx, ty, theta;
   Double_t distance, time;
+  Double_t xys[LENGTH_VEC];
 
   const Double_t c_light = 2.99792458E8;
 
@@ -149,16 +160,13 @@ void Hector::Process()
     particle.smearAng(fSigmaX, fSigmaY, gRandom);
     particle.smearE(fSigmaE, gRandom);
 
-    particle.computePath(fBeamLine);
-
-    if(particle.stopped(fBeamLine)) continue;
-
-    particle.propagate(fDistance);
+    // transport, aperture checks and propagation to fDistance in one pass
+    if(!fCompiledBeamLine->propagate(particle, fDistance, xys)) continue;
 
     mother = candidate;
     candidate = static_cast<Candidate *>(candidate->Clone());
-    candidate->Position.SetXYZT(particle.getX(), particle.getY(), particle.getS(), time);
-    candidate->Momentum.SetPxPyPzE(particle.getTX(), particle.getTY(), 0.0, particle.getE());
+    candidate->Position.SetXYZT(xys[INDEX_X], xys[INDEX_Y], xys[INDEX_S], time);
+    candidate->Momentum.SetPxPyPzE(xys[INDEX_TX], xys[INDEX_TY], 0.0, particle.getE());
     candidate->AddCandidate(mother);
 
     fOutputArray->Add(candidate);
@@ -32,6 +32,7 @@
 class TIterator;
 class TObjArray;
 class H_BeamLine;
+class H_CompiledBeamLine;
 
 class Hector: public DelphesModule
 {
@@ -50,8 +51,10 @@ private:
   Double_t fOffsetX, fOffsetS;
   Double_t fSigmaE, fSigmaX, fSigmaY, fSigmaT;
   Double_t fEtaMin;
+  Double_t fEnergyLossMin, fEnergyLossMax, fEnergyLossStep;
 
   H_BeamLine *fBeamLine;
+  H_CompiledBeamLine *fCompiledBeamLine;
 
   TIterator *fItInputArray; //!
 
@@ -47,43 +47,194 @@
 
 #include <algorithm>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
+#include <vector>
 
 using namespace std;
 
 //------------------------------------------------------------------------------
 
-class IsolationClassifier : public ExRootClassifier
+// (eta, phi) bucket index of the isolation objects above PTMin,
+// built once per event and shared by all Isolation modules
+// reading the same isolation input array with the same PTMin,
+// Update is serialized so that modules run by concurrent scheduler
+// workers never read the cells while they are rebuilt
+
+class IsolationGrid
 {
 public:
-  IsolationClassifier() {}
+  enum Flags
+  {
+    kCharged = 1 << 0,
+    kPileUp = 1 << 1,
+    kPhoton = 1 << 2
+  };
+
+  static IsolationGrid *Acquire(const TObjArray *array, Double_t ptMin);
+  static void Release(IsolationGrid *grid);
+
+  void Update(Long64_t event);
+
+  Int_t GetEtaBin(Double_t eta) const;
+  Int_t GetPhiBin(Double_t phi) const;
+
+  static const Int_t fNumberOfEtaBins = 100;
+  static const Int_t fNumberOfPhiBins = 64;
+  static const Double_t fEtaMax;
 
-  Int_t GetCategory(TObject *object);
+  Double_t fEtaWidth, fPhiWidth;
 
+  // objects ordered by cell, the objects of cell i are in [fFirst[i], fFirst[i + 1])
+  vector<Int_t> fFirst;
+  vector<Double_t> fEta, fPhi, fPT;
+  vector<Int_t> fFlags;
+  vector<UInt_t> fUniqueID;
+
+private:
+  IsolationGrid(const TObjArray *array, Double_t ptMin);
+
+  typedef map<pair<const TObjArray *, Double_t>, IsolationGrid *> TGridMap;
+  static TGridMap fGrids;
+
+  const TObjArray *fArray;
   Double_t fPTMin;
+  Int_t fReferences;
+
+  mutex fMutex;
+
+  Long64_t fEvent;
+  Int_t fEntries;
+
+  vector<Int_t> fCells;
 };
 
+const Double_t IsolationGrid::fEtaMax = 5.0;
+
+IsolationGrid::TGridMap IsolationGrid::fGrids;
+
+//------------------------------------------------------------------------------
+
+IsolationGrid::IsolationGrid(const TObjArray *array, Double_t ptMin) :
+  fEtaWidth(2.0 * fEtaMax / fNumberOfEtaBins), fPhiWidth(2.0 * TMath::Pi() / fNumberOfPhiBins),
+  fArray(array), fPTMin(ptMin), fReferences(0), fEvent(-1), fEntries(-1)
+{
+}
+
+//------------------------------------------------------------------------------
+
+IsolationGrid *IsolationGrid::Acquire(const TObjArray *array, Double_t ptMin)
+{
+  IsolationGrid *&grid = fGrids[make_pair(array, ptMin)];
+  if(!grid) grid = new IsolationGrid(array, ptMin);
+  ++grid->fReferences;
+  return grid;
+}
+
 //------------------------------------------------------------------------------
 
-Int_t IsolationClassifier::GetCategory(TObject *object)
+void IsolationGrid::Release(IsolationGrid *grid)
 {
-  Candidate *track = static_cast<Candidate *>(object);
-  const TLorentzVector &momentum = track->Momentum;
+  if(--grid->fReferences > 0) return;
+  fGrids.erase(make_pair(grid->fArray, grid->fPTMin));
+  delete grid;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t IsolationGrid::GetEtaBin(Double_t eta) const
+{
+  // objects outside the grid are kept in the first and last bins
+  if(eta <= -fEtaMax) return 0;
+  if(eta >= fEtaMax) return fNumberOfEtaBins - 1;
+  return TMath::Min(Int_t((eta + fEtaMax) / fEtaWidth), fNumberOfEtaBins - 1);
+}
+
+//------------------------------------------------------------------------------
+
+Int_t IsolationGrid::GetPhiBin(Double_t phi) const
+{
+  return Int_t(TMath::Floor((phi + TMath::Pi()) / fPhiWidth));
+}
+
+//------------------------------------------------------------------------------
+
+void IsolationGrid::Update(Long64_t event)
+{
+  Candidate *isolation;
+  Int_t i, j, cell, size, sizeCells;
+  Double_t pt;
+
+  lock_guard<mutex> lock(fMutex);
+
+  size = fArray->GetEntriesFast();
+  if(event == fEvent && size == fEntries) return;
+
+  fEvent = event;
+  fEntries = size;
+
+  sizeCells = fNumberOfEtaBins * fNumberOfPhiBins;
+
+  fCells.assign(size, -1);
+  fFirst.assign(sizeCells + 1, 0);
+
+  // count the objects per cell
+  for(i = 0; i < size; ++i)
+  {
+    isolation = static_cast<Candidate *>(fArray->At(i));
+
+    if(isolation->MomentumPt() < fPTMin) continue;
 
-  if(momentum.Pt() < fPTMin) return -1;
+    cell = GetEtaBin(isolation->MomentumEta()) * fNumberOfPhiBins;
+    cell += (GetPhiBin(isolation->MomentumPhi()) % fNumberOfPhiBins + fNumberOfPhiBins) % fNumberOfPhiBins;
 
-  return 0;
+    fCells[i] = cell;
+    ++fFirst[cell + 1];
+  }
+
+  for(cell = 0; cell < sizeCells; ++cell)
+  {
+    fFirst[cell + 1] += fFirst[cell];
+  }
+
+  size = fFirst[sizeCells];
+  fEta.resize(size);
+  fPhi.resize(size);
+  fPT.resize(size);
+  fFlags.resize(size);
+  fUniqueID.resize(size);
+
+  // fill the cells, next holds the next free slot of each cell
+  vector<Int_t> next(fFirst.begin(), fFirst.end() - 1);
+  for(i = 0; i < fEntries; ++i)
+  {
+    if(fCells[i] < 0) continue;
+
+    isolation = static_cast<Candidate *>(fArray->At(i));
+
+    j = next[fCells[i]]++;
+    pt = isolation->MomentumPt();
+
+    fEta[j] = isolation->MomentumEta();
+    fPhi[j] = isolation->MomentumPhi();
+    fPT[j] = pt;
+    fFlags[j] = 0;
+    if(isolation->Charge != 0) fFlags[j] |= kCharged;
+    if(isolation->IsRecoPU) fFlags[j] |= kPileUp;
+    if(abs(isolation->PID) == 22) fFlags[j] |= kPhoton;
+    fUniqueID[j] = isolation->GetUniqueID();
+  }
 }
 
 //------------------------------------------------------------------------------
 
 Isolation::Isolation() :
-  fClassifier(0), fFilter(0),
+  fGrid(0),
   fItIsolationInputArray(0), fItCandidateInputArray(0),
   fItRhoInputArray(0)
 {
-  fClassifier = new IsolationClassifier;
 }
 
 //------------------------------------------------------------------------------
@@ -111,14 +262,14 @@ void Isolation::Init()
   fDeltaRMin = GetDouble("DeltaRMin", 0.01);
   fUseMiniCone = GetBool("UseMiniCone", false);
 
-  fClassifier->fPTMin = GetDouble("PTMin", 0.5);
+  fPTMin = GetDouble("PTMin", 0.5);
 
   // import input array(s)
 
   fIsolationInputArray = ImportArray(GetString("IsolationInputArray", "Delphes/partons"));
   fItIsolationInputArray = fIsolationInputArray->MakeIterator();
 
-  fFilter = new ExRootFilter(fIsolationInputArray);
+  fGrid = IsolationGrid::Acquire(fIsolationInputArray, fPTMin);
 
   fCandidateInputArray = ImportArray(GetString("CandidateInputArray", "Calorimeter/electrons"));
   fItCandidateInputArray = fCandidateInputArray->MakeIterator();
@@ -144,7 +295,7 @@ void Isolation::Init()
 void Isolation::Finish()
 {
   if(fItRhoInputArray) delete fItRhoInputArray;
-  if(fFilter) delete fFilter;
+  if(fGrid) IsolationGrid::Release(fGrid);
   if(fItCandidateInputArray) delete fItCandidateInputArray;
   if(fItIsolationInputArray) delete fItIsolationInputArray;
 }
@@ -153,41 +304,36 @@ void Isolation::Finish()
 
 void Isolation::Process()
 {
-  Candidate *candidate, *isolation, *object;
-  TObjArray *isolationArray;
+  Candidate *candidate, *object;
   Double_t sumChargedNoPU, sumChargedPU, sumNeutral, sumAllParticles, sumPho;
   Double_t sumDBeta, ratioDBeta, sumRhoCorr, ratioRhoCorr, sum, ratio;
+  Double_t candidateEta, candidatePhi, deltaEta, deltaPhi, deltaR2, pt;
+  Double_t deltaR2Max, deltaR2Min;
+  Int_t etaBin, etaBinMin, etaBinMax, phiBin, phiBinMin, sizePhiBins, cell, i, flags;
+  UInt_t candidateID;
   Bool_t pass = kFALSE;
   Double_t eta = 0.0;
   Double_t rho = 0.0;
 
-  // select isolation objects
-  fFilter->Reset();
-  isolationArray = fFilter->GetSubArray(fClassifier, 0);
-  TIter itIsolationArray(isolationArray);
+  const Double_t pi = TMath::Pi();
+
+  // index isolation objects, once per event for all modules sharing the grid
+  fGrid->Update(GetFactory()->GetEventCounter());
+
+  deltaR2Max = fDeltaRMax * fDeltaRMax;
+  deltaR2Min = fDeltaRMin * fDeltaRMin;
 
   // loop over all input jets
   fItCandidateInputArray->Reset();
   while((candidate = static_cast<Candidate *>(fItCandidateInputArray->Next())))
   {
     const TLorentzVector &candidateMomentum = candidate->Momentum;
-    eta = TMath::Abs(candidateMomentum.Eta());
+    candidateEta = candidate->MomentumEta();
+    candidatePhi = candidate->MomentumPhi();
+    candidateID = candidate->GetUniqueID();
+    eta = TMath::Abs(candidateEta);
 
-    // find rho
-    rho = 0.0;
-    if(fRhoInputArray)
-    {
-      fItRhoInputArray->Reset();
-      while((object = static_cast<Candidate *>(fItRhoInputArray->Next())))
-      {
-        if(eta >= object->Edges[0] && eta < object->Edges[1])
-        {
-          rho = object->Momentum.Pt();
-        }
-      }
-    }
-
-    // loop over all input tracks
+    // loop over the isolation objects in the cells overlapping the cone
 
     sumNeutral = 0.0;
     sumChargedNoPU = 0.0;
@@ -195,40 +341,64 @@ void Isolation::Process()
     sumAllParticles = 0.0;
     sumPho = 0.0;
 
-    itIsolationArray.Reset();
-    while((isolation = static_cast<Candidate *>(itIsolationArray.Next())))
-    {
-      const TLorentzVector &isolationMomentum = isolation->Momentum;
+    etaBinMin = fGrid->GetEtaBin(candidateEta - fDeltaRMax);
+    etaBinMax = fGrid->GetEtaBin(candidateEta + fDeltaRMax);
 
-      if(fUseMiniCone)
-      {
-        pass = candidateMomentum.DeltaR(isolationMomentum) <= fDeltaRMax && candidateMomentum.DeltaR(isolationMomentum) > fDeltaRMin;
-      }
-      else
-      {
-        pass = candidateMomentum.DeltaR(isolationMomentum) <= fDeltaRMax && candidate->GetUniqueID() != isolation->GetUniqueID();
-      }
+    phiBinMin = fGrid->GetPhiBin(candidatePhi - fDeltaRMax);
+    sizePhiBins = fGrid->GetPhiBin(candidatePhi + fDeltaRMax) - phiBinMin + 1;
+    if(sizePhiBins > IsolationGrid::fNumberOfPhiBins)
+    {
+      phiBinMin = 0;
+      sizePhiBins = IsolationGrid::fNumberOfPhiBins;
+    }
 
-      if(pass)
+    for(etaBin = etaBinMin; etaBin <= etaBinMax; ++etaBin)
+    {
+      for(phiBin = phiBinMin; phiBin < phiBinMin + sizePhiBins; ++phiBin)
       {
+        cell = etaBin * IsolationGrid::fNumberOfPhiBins;
+        cell += (phiBin % IsolationGrid::fNumberOfPhiBins + IsolationGrid::fNumberOfPhiBins) % IsolationGrid::fNumberOfPhiBins;
 
-        sumAllParticles += isolationMomentum.Pt();
-        if(isolation->Charge != 0)
+        for(i = fGrid->fFirst[cell]; i < fGrid->fFirst[cell + 1]; ++i)
         {
-          if(isolation->IsRecoPU)
+          deltaEta = fGrid->fEta[i] - candidateEta;
+          deltaPhi = fGrid->fPhi[i] - candidatePhi;
+          if(deltaPhi > pi) deltaPhi -= 2.0 * pi;
+          if(deltaPhi <= -pi) deltaPhi += 2.0 * pi;
+          deltaR2 = deltaEta * deltaEta + deltaPhi * deltaPhi;
+
+          if(fUseMiniCone)
           {
-            sumChargedPU += isolationMomentum.Pt();
+            pass = deltaR2 <= deltaR2Max && deltaR2 > deltaR2Min;
           }
           else
           {
-            sumChargedNoPU += isolationMomentum.Pt();
+            pass = deltaR2 <= deltaR2Max && candidateID != fGrid->fUniqueID[i];
+          }
+
+          if(!pass) continue;
+
+          pt = fGrid->fPT[i];
+          flags = fGrid->fFlags[i];
+
+          sumAllParticles += pt;
+          if(flags & IsolationGrid::kCharged)
+          {
+            if(flags & IsolationGrid::kPileUp)
+            {
+              sumChargedPU += pt;
+            }
+            else
+            {
+              sumChargedNoPU += pt;
+            }
+          }
+          else
+          {
+            sumNeutral += pt;
+            if(flags & IsolationGrid::kPhoton)
+              sumPho += pt;
           }
-        }
-        else
-        {
-          sumNeutral += isolationMomentum.Pt();
-	  if (abs(isolation->PID) == 22)
-	    sumPho += isolationMomentum.Pt();
         }
       }
     }
@@ -246,7 +416,6 @@ void Isolation::Process()
         }
       }
     }
-
     // correct sum for pile-up contamination
     sumDBeta = sumChargedNoPU + TMath::Max(sumNeutral - 0.5 * sumChargedPU, 0.0);
     sumRhoCorr = sumChargedNoPU + TMath::Max(sumNeutral - TMath::Max(rho, 0.0) * fDeltaRMax * fDeltaRMax * TMath::Pi(), 0.0);
@@ -34,8 +34,7 @@
 
 class TObjArray;
 
-class ExRootFilter;
-class IsolationClassifier;
+class IsolationGrid;
 
 class Isolation: public DelphesModule
 {
@@ -62,9 +61,9 @@ private:
 
   Bool_t fUseMiniCone;
 
-  IsolationClassifier *fClassifier; //!
+  Double_t fPTMin;
 
-  ExRootFilter *fFilter;
+  IsolationGrid *fGrid; //!
 
   TIterator *fItIsolationInputArray; //!
 
@@ -27,6 +27,7 @@
 #include "modules/JetFlavorAssociation.h"
 
 #include "classes/DelphesClasses.h"
+#include "classes/DelphesDeltaRMatcher.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
 
@@ -114,6 +115,7 @@ Int_t ParticleLHEFClassifier::GetCategory(TObject *object)
 //------------------------------------------------------------------------------
 
 JetFlavorAssociation::JetFlavorAssociation() :
+  fPartonMatcher(0), fParticleLHEFMatcher(0),
   fPartonClassifier(0), fPartonFilter(0), fParticleLHEFFilter(0),
   fItPartonInputArray(0), fItParticleInputArray(0),
   fItParticleLHEFInputArray(0), fItJetInputArray(0)
@@ -138,6 +140,9 @@ void JetFlavorAssociation::Init()
 
   fDeltaR = GetDouble("DeltaR", 0.5);
 
+  fPartonMatcher = new DelphesDeltaRMatcher;
+  fParticleLHEFMatcher = new DelphesDeltaRMatcher;
+
   fPartonClassifier->fPTMin = GetDouble("PartonPTMin", 0.0);
   fPartonClassifier->fEtaMax = GetDouble("PartonEtaMax", 2.5);
 
@@ -182,6 +187,9 @@ void JetFlavorAssociation::Finish()
   if(fItParticleLHEFInputArray) delete fItParticleLHEFInputArray;
   if(fItParticleInputArray) delete fItParticleInputArray;
   if(fItPartonInputArray) delete fItPartonInputArray;
+
+  if(fParticleLHEFMatcher) delete fParticleLHEFMatcher;
+  if(fPartonMatcher) delete fPartonMatcher;
 }
 
 //------------------------------------------------------------------------------
@@ -203,6 +211,15 @@ void JetFlavorAssociation::Process()
     fParticleLHEFFilter->Reset();
     partonLHEFArray = fParticleLHEFFilter->GetSubArray(fParticleLHEFClassifier, 0); // get the filtered parton array
   }
+
+  // index partons by eta and evaluate their jet independent properties once
+  fPartonMatcher->Fill(partonArray);
+  if(fParticleLHEFInputArray)
+  {
+    fParticleLHEFMatcher->Fill(partonLHEFArray);
+    ClassifyPartons(partonArray, partonLHEFArray);
+  }
+
   // loop over all input jets
   fItJetInputArray->Reset();
   while((jet = static_cast<Candidate *>(fItJetInputArray->Next())))
@@ -213,6 +230,63 @@ void JetFlavorAssociation::Process()
   }
 }
 
+//------------------------------------------------------------------------------
+
+void JetFlavorAssociation::ClassifyPartons(TObjArray *partonArray, TObjArray *partonLHEFArray)
+{
+  Candidate *parton, *partonLHEF;
+  Int_t i, j, size, sizeLHEF, daughterCounter;
+  Bool_t isGoodCandidate;
+
+  size = partonArray->GetEntriesFast();
+  sizeLHEF = partonLHEFArray ? partonLHEFArray->GetEntriesFast() : 0;
+
+  fAlgoPartons.assign(size, kFALSE);
+  fPhysicsPartons.assign(size, kTRUE);
+
+  // GetAlgoFlavor considers a parton if the first LHEF parton does not match it
+  // and if it has no quark or gluon daughters
+  for(i = 0; i < size && sizeLHEF > 0; ++i)
+  {
+    parton = static_cast<Candidate *>(partonArray->At(i));
+    partonLHEF = static_cast<Candidate *>(partonLHEFArray->At(0));
+
+    if(parton->Momentum.DeltaR(partonLHEF->Momentum) < 0.001 && parton->PID == partonLHEF->PID && partonLHEF->Charge == parton->Charge) continue;
+
+    // check the daughter
+    daughterCounter = 0;
+    if(parton->D1 != -1 || parton->D2 != -1)
+    {
+      // partons are only quarks || gluons
+      int daughterFlavor1 = -1;
+      int daughterFlavor2 = -1;
+      if(parton->D1 != -1) daughterFlavor1 = TMath::Abs(static_cast<Candidate *>(fParticleInputArray->At(parton->D1))->PID);
+      if(parton->D2 != -1) daughterFlavor2 = TMath::Abs(static_cast<Candidate *>(fParticleInputArray->At(parton->D2))->PID);
+      if((daughterFlavor1 == 1 || daughterFlavor1 == 2 || daughterFlavor1 == 3 || daughterFlavor1 == 4 || daughterFlavor1 == 5 || daughterFlavor1 == 21)) daughterCounter++;
+      if((daughterFlavor2 == 1 || daughterFlavor2 == 2 || daughterFlavor2 == 3 || daughterFlavor2 == 4 || daughterFlavor2 == 5 || daughterFlavor2 == 21)) daughterCounter++;
+    }
+    fAlgoPartons[i] = (daughterCounter == 0);
+  }
+
+  // GetPhysicsFlavor scans the LHEF partons with a single iterator shared by all partons
+  j = 0;
+  for(i = 0; i < size; ++i)
+  {
+    parton = static_cast<Candidate *>(partonArray->At(i));
+    isGoodCandidate = kTRUE;
+    while(j < sizeLHEF)
+    {
+      partonLHEF = static_cast<Candidate *>(partonLHEFArray->At(j++));
+      if(parton->Momentum.DeltaR(partonLHEF->Momentum) < 0.01 && parton->PID == partonLHEF->PID && partonLHEF->Charge == parton->Charge)
+      {
+        isGoodCandidate = kFALSE;
+        break;
+      }
+    }
+    fPhysicsPartons[i] = isGoodCandidate;
+  }
+}
+
 //------------------------------------------------------------------------------
 // Standard definition of jet flavor in
 // https://cmssdt.cern.ch/SDT/lxr/source/PhysicsTools/JetMCAlgos/plugins/JetPartonMatcher.cc?v=CMSSW_7_3_0_pre1
@@ -220,59 +294,33 @@ void JetFlavorAssociation::Process()
 void JetFlavorAssociation::GetAlgoFlavor(Candidate *jet, TObjArray *partonArray, TObjArray *partonLHEFArray)
 {
   float maxPt = 0;
-  int daughterCounter = 0;
-  Candidate *parton, *partonLHEF;
+  Candidate *parton;
   Candidate *tempParton = 0, *tempPartonHighestPt = 0;
   int pdgCode, pdgCodeMax = -1;
+  vector<pair<Int_t, Double_t> >::iterator itMatches;
 
-  TIter itPartonArray(partonArray);
-  TIter itPartonLHEFArray(partonLHEFArray);
-
-  itPartonArray.Reset();
-  while((parton = static_cast<Candidate *>(itPartonArray.Next())))
+  // loop over all partons within DeltaR, in input order
+  fPartonMatcher->FindWithin(jet->MomentumEta(), jet->MomentumPhi(), fDeltaR, fMatches);
+  for(itMatches = fMatches.begin(); itMatches != fMatches.end(); ++itMatches)
   {
+    parton = static_cast<Candidate *>(partonArray->At(itMatches->first));
+
     // default delphes method
     pdgCode = TMath::Abs(parton->PID);
     if(TMath::Abs(parton->PID) == 21) pdgCode = 0;
-    if(jet->Momentum.DeltaR(parton->Momentum) <= fDeltaR)
-    {
-      if(pdgCodeMax < pdgCode) pdgCodeMax = pdgCode;
-    }
+    if(pdgCodeMax < pdgCode) pdgCodeMax = pdgCode;
 
     if(!fParticleLHEFInputArray) continue;
 
-    itPartonLHEFArray.Reset();
-    while((partonLHEF = static_cast<Candidate *>(itPartonLHEFArray.Next())))
-    {
-      if(parton->Momentum.DeltaR(partonLHEF->Momentum) < 0.001 && parton->PID == partonLHEF->PID && partonLHEF->Charge == parton->Charge)
-      {
-        break;
-      }
+    if(!fAlgoPartons[itMatches->first]) continue;
 
-      // check the daughter
-      daughterCounter = 0;
-      if(parton->D1 != -1 || parton->D2 != -1)
-      {
-        // partons are only quarks || gluons
-        int daughterFlavor1 = -1;
-        int daughterFlavor2 = -1;
-        if(parton->D1 != -1) daughterFlavor1 = TMath::Abs(static_cast<Candidate *>(fParticleInputArray->At(parton->D1))->PID);
-        if(parton->D2 != -1) daughterFlavor2 = TMath::Abs(static_cast<Candidate *>(fParticleInputArray->At(parton->D2))->PID);
-        if((daughterFlavor1 == 1 || daughterFlavor1 == 2 || daughterFlavor1 == 3 || daughterFlavor1 == 4 || daughterFlavor1 == 5 || daughterFlavor1 == 21)) daughterCounter++;
-        if((daughterFlavor2 == 1 || daughterFlavor2 == 2 || daughterFlavor2 == 3 || daughterFlavor2 == 4 || daughterFlavor2 == 5 || daughterFlavor2 == 21)) daughterCounter++;
-      }
-      if(daughterCounter > 0) continue;
-      if(jet->Momentum.DeltaR(parton->Momentum) <= fDeltaR)
-      {
-        // if not yet found && pdgId is a c, take as c
-        if(TMath::Abs(parton->PID) == 4) tempParton = parton;
-        if(TMath::Abs(parton->PID) == 5) tempParton = parton;
-        if(parton->Momentum.Pt() > maxPt)
-        {
-          maxPt = parton->Momentum.Pt();
-          tempPartonHighestPt = parton;
-        }
-      }
+    // if not yet found && pdgId is a c, take as c
+    if(TMath::Abs(parton->PID) == 4) tempParton = parton;
+    if(TMath::Abs(parton->PID) == 5) tempParton = parton;
+    if(parton->Momentum.Pt() > maxPt)
+    {
+      maxPt = parton->Momentum.Pt();
+      tempPartonHighestPt = parton;
     }
   }
 
@@ -292,23 +340,23 @@ void JetFlavorAssociation::GetPhysicsFlavor(Candidate *jet, TObjArray *partonArr
   int partonCounter = 0;
   float biggerConeSize = 0.7;
   float dist;
-  bool isGoodCandidate;
   int contaminatingFlavor = 0;
   int motherCounter = 0;
   Candidate *parton, *partonLHEF, *mother1, *mother2;
   Candidate *tempParton = 0;
   vector<Candidate *> contaminations;
   vector<Candidate *>::iterator itContaminations;
-
-  TIter itPartonArray(partonArray);
-  TIter itPartonLHEFArray(partonLHEFArray);
+  vector<pair<Int_t, Double_t> >::iterator itMatches;
 
   contaminations.clear();
 
-  itPartonLHEFArray.Reset();
-  while((partonLHEF = static_cast<Candidate *>(itPartonLHEFArray.Next())))
+  // the distances are compared in single precision,
+  // so query slightly larger cones and apply the exact cuts below
+  fParticleLHEFMatcher->FindWithin(jet->MomentumEta(), jet->MomentumPhi(), fDeltaR * (1.0 + 1.0e-6), fMatches);
+  for(itMatches = fMatches.begin(); itMatches != fMatches.end(); ++itMatches)
   {
-    dist = jet->Momentum.DeltaR(partonLHEF->Momentum); // take the DR
+    partonLHEF = static_cast<Candidate *>(partonLHEFArray->At(itMatches->first));
+    dist = itMatches->second; // take the DR
 
     if(partonLHEF->Status == 1 && dist <= fDeltaR)
     {
@@ -317,22 +365,13 @@ void JetFlavorAssociation::GetPhysicsFlavor(Candidate *jet, TObjArray *partonArr
     }
   }
 
-  itPartonArray.Reset();
-  itPartonLHEFArray.Reset();
-  while((parton = static_cast<Candidate *>(itPartonArray.Next())))
+  fPartonMatcher->FindWithin(jet->MomentumEta(), jet->MomentumPhi(), biggerConeSize * (1.0 + 1.0e-6), fMatches);
+  for(itMatches = fMatches.begin(); itMatches != fMatches.end(); ++itMatches)
   {
-    dist = jet->Momentum.DeltaR(parton->Momentum); // take the DR
-    isGoodCandidate = true;
-    while((partonLHEF = static_cast<Candidate *>(itPartonLHEFArray.Next())))
-    {
-      if(parton->Momentum.DeltaR(partonLHEF->Momentum) < 0.01 && parton->PID == partonLHEF->PID && partonLHEF->Charge == parton->Charge)
-      {
-        isGoodCandidate = false;
-        break;
-      }
-    }
+    parton = static_cast<Candidate *>(partonArray->At(itMatches->first));
+    dist = itMatches->second; // take the DR
 
-    if(!isGoodCandidate) continue;
+    if(!fPhysicsPartons[itMatches->first]) continue;
 
     if(parton->D1 != -1 || parton->D2 != -1)
     {
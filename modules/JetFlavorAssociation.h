@@ -30,8 +30,11 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesModule.h"
 #include <map>
+#include <utility>
+#include <vector>
 
 class TObjArray;
+class DelphesDeltaRMatcher;
 class DelphesFormula;
 
 class ExRootFilter;
@@ -52,8 +55,21 @@ public:
   void GetPhysicsFlavor(Candidate *jet, TObjArray *partonArray, TObjArray *partonLHEFArray);
 
 private:
+  void ClassifyPartons(TObjArray *partonArray, TObjArray *partonLHEFArray);
+
   Double_t fDeltaR;
 
+  DelphesDeltaRMatcher *fPartonMatcher; //!
+  DelphesDeltaRMatcher *fParticleLHEFMatcher; //!
+
+#if !defined(__CINT__) && !defined(__CLING__)
+  std::vector<std::pair<Int_t, Double_t> > fMatches; //!
+
+  // jet independent parton properties used by GetAlgoFlavor and GetPhysicsFlavor
+  std::vector<Bool_t> fAlgoPartons; //!
+  std::vector<Bool_t> fPhysicsPartons; //!
+#endif
+
   PartonClassifier *fPartonClassifier; //!
   ParticleLHEFClassifier *fParticleLHEFClassifier; //!
 
@@ -43,6 +43,9 @@ public:
   void Process();
   void Finish();
 
+  // corrects clones, the imported jets are only read
+  Bool_t IsReadOnly() const { return kTRUE; }
+
 private:
   Double_t fJetPTMin;
 
@@ -27,6 +27,7 @@
 #include "modules/LeptonDressing.h"
 
 #include "classes/DelphesClasses.h"
+#include "classes/DelphesDeltaRMatcher.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
 
@@ -52,7 +53,7 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 LeptonDressing::LeptonDressing() :
-  fItDressingInputArray(0), fItCandidateInputArray(0)
+  fMatcher(0), fItDressingInputArray(0), fItCandidateInputArray(0)
 {
 }
 
@@ -68,6 +69,8 @@ void LeptonDressing::Init()
 {
   fDeltaR = GetDouble("DeltaRMax", 0.4);
 
+  fMatcher = new DelphesDeltaRMatcher;
+
   // import input array(s)
 
   fDressingInputArray = ImportArray(GetString("DressingInputArray", "Calorimeter/photons"));
@@ -87,6 +90,7 @@ void LeptonDressing::Finish()
 {
   if(fItCandidateInputArray) delete fItCandidateInputArray;
   if(fItDressingInputArray) delete fItDressingInputArray;
+  if(fMatcher) delete fMatcher;
 }
 
 //------------------------------------------------------------------------------
@@ -95,26 +99,33 @@ void LeptonDressing::Process()
 {
   Candidate *candidate, *dressing, *mother;
   TLorentzVector momentum;
+  vector<pair<Int_t, Double_t> >::iterator itMatches;
+  Int_t i;
+
+  // index all input dressing candidates by eta
+  fMatcher->Clear();
+  for(i = 0; i < fDressingInputArray->GetEntriesFast(); ++i)
+  {
+    dressing = static_cast<Candidate *>(fDressingInputArray->At(i));
+    if(dressing->MomentumPt() > 0.1)
+    {
+      fMatcher->Add(dressing->MomentumEta(), dressing->MomentumPhi(), i);
+    }
+  }
+  fMatcher->Sort();
 
   // loop over all input candidate
   fItCandidateInputArray->Reset();
   while((candidate = static_cast<Candidate *>(fItCandidateInputArray->Next())))
   {
-    const TLorentzVector &candidateMomentum = candidate->Momentum;
+    // sum all dressing candidates within DeltaR, in input order
+    fMatcher->FindWithin(candidate->MomentumEta(), candidate->MomentumPhi(), fDeltaR, fMatches);
 
-    // loop over all input tracks
-    fItDressingInputArray->Reset();
     momentum.SetPxPyPzE(0.0, 0.0, 0.0, 0.0);
-    while((dressing = static_cast<Candidate *>(fItDressingInputArray->Next())))
+    for(itMatches = fMatches.begin(); itMatches != fMatches.end(); ++itMatches)
     {
-      const TLorentzVector &dressingMomentum = dressing->Momentum;
-      if(dressingMomentum.Pt() > 0.1)
-      {
-        if(candidateMomentum.DeltaR(dressingMomentum) <= fDeltaR)
-        {
-          momentum += dressingMomentum;
-        }
-      }
+      dressing = static_cast<Candidate *>(fDressingInputArray->At(itMatches->first));
+      momentum += dressing->Momentum;
     }
 
     mother = candidate;
@@ -27,8 +27,12 @@
 
 #include "classes/DelphesModule.h"
 
+#include <utility>
+#include <vector>
+
 class TIterator;
 class TObjArray;
+class DelphesDeltaRMatcher;
 
 class LeptonDressing: public DelphesModule
 {
@@ -40,9 +44,18 @@ public:
   void Process();
   void Finish();
 
+  // dresses clones, the imported candidates are only read
+  Bool_t IsReadOnly() const { return kTRUE; }
+
 private:
   Double_t fDeltaR;
 
+  DelphesDeltaRMatcher *fMatcher; //!
+
+#if !defined(__CINT__) && !defined(__CLING__)
+  std::vector<std::pair<Int_t, Double_t> > fMatches; //!
+#endif
+
   TIterator *fItDressingInputArray; //!
 
   TIterator *fItCandidateInputArray; //!
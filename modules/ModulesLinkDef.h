@@ -51,6 +51,7 @@
 #include "modules/TauTagging.h"
 #include "modules/TrackCountingTauTagging.h"
 #include "modules/TreeWriter.h"
+#include "modules/PapuWriter.h"
 #include "modules/Merger.h"
 #include "modules/PuppiMerger.h"
 #include "modules/LeptonDressing.h"
@@ -110,6 +111,7 @@
 #pragma link C++ class TauTagging+;
 #pragma link C++ class TrackCountingTauTagging+;
 #pragma link C++ class TreeWriter+;
+#pragma link C++ class PapuWriter+;
 #pragma link C++ class Merger+;
 #pragma link C++ class PuppiMerger+;
 #pragma link C++ class LeptonDressing+;
@@ -99,11 +99,10 @@ void MomentumSmearing::Process()
   fItInputArray->Reset();
   while((candidate = static_cast<Candidate *>(fItInputArray->Next())))
   {
-    const TLorentzVector &candidatePosition = candidate->Position;
     const TLorentzVector &candidateMomentum = candidate->Momentum;
-    eta = candidatePosition.Eta();
-    phi = candidatePosition.Phi();
-    pt = candidateMomentum.Pt();
+    eta = candidate->PositionEta();
+    phi = candidate->PositionPhi();
+    pt = candidate->MomentumPt();
     e = candidateMomentum.E();
     res = fFormula->Eval(pt, eta, phi, e, candidate);
 
@@ -118,8 +117,8 @@ void MomentumSmearing::Process()
 
     mother = candidate;
     candidate = static_cast<Candidate *>(candidate->Clone());
-    eta = candidateMomentum.Eta();
-    phi = candidateMomentum.Phi();
+    eta = mother->MomentumEta();
+    phi = mother->MomentumPhi();
     candidate->Momentum.SetPtEtaPhiE(pt, eta, phi, pt * TMath::CosH(eta));
     //candidate->TrackResolution = fFormula->Eval(pt, eta, phi, e);
     candidate->TrackResolution = res;
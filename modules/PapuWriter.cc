@@ -0,0 +1,295 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class PapuWriter
+ *
+ *  Extracts the Papu training features from the particle-flow candidates
+ *  and writes them, together with the generator-level targets, directly
+ *  to a NumPy .npz archive with the same layout as PapuDelphesTrain.
+ *
+ */
+
+#include "modules/PapuWriter.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesNpyWriter.h"
+
+#include "TLorentzVector.h"
+#include "TMath.h"
+#include "TObjArray.h"
+#include "TString.h"
+#include "TVector2.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <stdlib.h>
+
+using namespace std;
+
+static const Int_t kNumberOfFeatures = 13;
+
+//------------------------------------------------------------------------------
+
+PapuWriter::PapuWriter() :
+  fWriter(0), fOrdering(0), fItInputArray(0), fItGenParticleInputArray(0),
+  fVertexInputArray(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+PapuWriter::~PapuWriter()
+{
+}
+
+//------------------------------------------------------------------------------
+
+void PapuWriter::Init()
+{
+  TString vertexInputArray;
+  vector<size_t> shape;
+
+  fMaxParticles = GetInt("MaxParticles", 9000);
+
+  fOrdering = new PapuClusterOrdering(GetInt("ClusterK", 4), GetInt("ClusterSize", 10));
+
+  // import input array(s)
+
+  fInputArray = ImportArray(GetString("InputArray", "RunPUPPI/PuppiParticles"));
+  fItInputArray = fInputArray->MakeIterator();
+
+  vertexInputArray = GetString("VertexInputArray", "VertexFinder/vertices");
+  if(vertexInputArray.Length() > 0) fVertexInputArray = ImportArray(vertexInputArray);
+
+  fGenParticleInputArray = ImportArray(GetString("GenParticleInputArray", "PileUpMerger/stableParticles"));
+  fItGenParticleInputArray = fGenParticleInputArray->MakeIterator();
+
+  fGenMissingETInputArray = ImportArray(GetString("GenMissingETInputArray", "GenMissingET/momentum"));
+  fGenJetInputArray = ImportArray(GetString("GenJetInputArray", "GenJetFinder/jets"));
+
+  // create output file
+
+  fWriter = new DelphesNpzWriter(GetString("OutputFile", "papu.npz"), GetBool("HalfPrecision", true));
+
+  shape.push_back(fMaxParticles);
+  shape.push_back(kNumberOfFeatures);
+  fWriter->AddArray("x", shape);
+  fWriter->AddArray("met", vector<size_t>(1, 2));
+  fWriter->AddArray("recoil", vector<size_t>(1, 2));
+  fWriter->AddArray("jet1", vector<size_t>(1, 4));
+  fWriter->AddArray("jet2", vector<size_t>(1, 4));
+
+  fRow.resize(fMaxParticles * kNumberOfFeatures);
+  fOutputParticles.reserve(fMaxParticles);
+}
+
+//------------------------------------------------------------------------------
+
+void PapuWriter::Finish()
+{
+  if(fWriter)
+  {
+    fWriter->Close();
+    delete fWriter;
+    fWriter = 0;
+  }
+  if(fOrdering) delete fOrdering;
+  if(fItGenParticleInputArray) delete fItGenParticleInputArray;
+  if(fItInputArray) delete fItInputArray;
+}
+
+//------------------------------------------------------------------------------
+
+Double_t PapuWriter::GetHardFraction(Candidate *candidate)
+{
+  Candidate *constituent, *track, *particle;
+  Double_t hard = 0.0, soft = 0.0;
+  TIter itConstituents(candidate->GetCandidates());
+  vector<Candidate *>::iterator itParticle, itEnd;
+
+  fHard.clear();
+  fSoft.clear();
+
+  // collect the generated particles behind the candidate,
+  // following the particle, track and tower cases of TreeWriter
+  while((constituent = static_cast<Candidate *>(itConstituents.Next())))
+  {
+    if(constituent->GetCandidates()->GetEntriesFast() == 0)
+    {
+      (constituent->IsPU ? fSoft : fHard).push_back(constituent);
+      continue;
+    }
+
+    track = static_cast<Candidate *>(constituent->GetCandidates()->At(0));
+    if(track->GetCandidates()->GetEntriesFast() == 0)
+    {
+      (track->IsPU ? fSoft : fHard).push_back(track);
+      continue;
+    }
+
+    TIter itTower(constituent->GetCandidates());
+    while((track = static_cast<Candidate *>(itTower.Next())))
+    {
+      particle = static_cast<Candidate *>(track->GetCandidates()->At(0));
+      (track->IsPU ? fSoft : fHard).push_back(particle);
+    }
+  }
+
+  // each generated particle is counted once
+  sort(fHard.begin(), fHard.end());
+  sort(fSoft.begin(), fSoft.end());
+
+  itEnd = unique(fHard.begin(), fHard.end());
+  for(itParticle = fHard.begin(); itParticle != itEnd; ++itParticle)
+  {
+    hard += (*itParticle)->Momentum.E();
+  }
+  itEnd = unique(fSoft.begin(), fSoft.end());
+  for(itParticle = fSoft.begin(); itParticle != itEnd; ++itParticle)
+  {
+    soft += (*itParticle)->Momentum.E();
+  }
+
+  return hard / (hard + soft);
+}
+
+//------------------------------------------------------------------------------
+
+static bool ComparePT(const PapuParticle &a, const PapuParticle &b)
+{
+  return a.pt > b.pt;
+}
+
+//------------------------------------------------------------------------------
+
+void PapuWriter::Process()
+{
+  Candidate *candidate;
+  PapuParticle particle;
+  vector<PapuParticle>::iterator itParticle;
+  TVector2 recoil, lepton;
+  Float_t npv, genmet = -99.0, genmetphi = -99.0;
+  Float_t met[2], jets[2][4];
+  Float_t *row;
+  Int_t i;
+
+  // generated missing transverse energy and hadronic recoil
+
+  if((candidate = static_cast<Candidate *>(fGenMissingETInputArray->At(0))))
+  {
+    genmet = candidate->Momentum.Pt();
+    genmetphi = (-candidate->Momentum).Phi();
+  }
+
+  met[0] = genmet;
+  met[1] = genmetphi;
+  fWriter->WriteRow("met", met);
+
+  recoil.SetMagPhi(genmet, genmetphi);
+  fItGenParticleInputArray->Reset();
+  while((candidate = static_cast<Candidate *>(fItGenParticleInputArray->Next())))
+  {
+    const TLorentzVector &momentum = candidate->Momentum;
+    if(momentum.Pt() > 10 && candidate->IsPU == 0 && (abs(candidate->PID) == 11 || abs(candidate->PID) == 13))
+    {
+      lepton.SetMagPhi(momentum.Pt(), momentum.Phi());
+      recoil += lepton;
+    }
+  }
+
+  met[0] = recoil.Mod();
+  met[1] = recoil.Phi();
+  fWriter->WriteRow("recoil", met);
+
+  // two leading generated jets
+
+  for(i = 0; i < 2; ++i)
+  {
+    jets[i][0] = jets[i][1] = jets[i][2] = jets[i][3] = -99.0;
+    if(i >= fGenJetInputArray->GetEntriesFast()) continue;
+
+    const TLorentzVector &momentum = static_cast<Candidate *>(fGenJetInputArray->At(i))->Momentum;
+    jets[i][0] = momentum.Pt();
+    jets[i][1] = momentum.Eta();
+    jets[i][2] = momentum.Phi();
+    jets[i][3] = momentum.E();
+  }
+
+  fWriter->WriteRow("jet1", jets[0]);
+  fWriter->WriteRow("jet2", jets[1]);
+
+  // particle-flow candidates
+
+  npv = fVertexInputArray ? fVertexInputArray->GetEntriesFast() : 0;
+
+  fInputParticles.clear();
+  fItInputArray->Reset();
+  while((candidate = static_cast<Candidate *>(fItInputArray->Next())))
+  {
+    const TLorentzVector &momentum = candidate->Momentum;
+
+    particle.npv = npv;
+    particle.pt = momentum.Pt();
+    particle.eta = momentum.Eta();
+    particle.phi = momentum.Phi();
+    particle.x = TMath::Cos(particle.phi);
+    particle.y = TMath::Sin(particle.phi);
+    particle.e = momentum.E();
+    particle.puppi = candidate->puppiW;
+    particle.hardfrac = GetHardFraction(candidate);
+    particle.pdgid = candidate->PID;
+    particle.charge = candidate->Charge;
+
+    if(candidate->Charge != 0)
+      particle.vtxid = (particle.hardfrac == 1) ? 0 : 1;
+    else
+      particle.vtxid = -1;
+
+    fInputParticles.push_back(particle);
+  }
+
+  sort(fInputParticles.begin(), fInputParticles.end(), ComparePT);
+
+  // if there are fewer than MaxParticles, pad with default values
+  fOrdering->Order(fInputParticles, fOutputParticles, fMaxParticles);
+
+  row = &fRow[0];
+  for(itParticle = fOutputParticles.begin(); itParticle != fOutputParticles.end(); ++itParticle)
+  {
+    *row++ = itParticle->pt;
+    *row++ = itParticle->eta;
+    *row++ = itParticle->phi;
+    *row++ = itParticle->e;
+    *row++ = itParticle->puppi;
+    *row++ = itParticle->pdgid;
+    *row++ = itParticle->hardfrac;
+    *row++ = itParticle->cluster_idx;
+    *row++ = itParticle->vtxid;
+    *row++ = itParticle->cluster_r;
+    *row++ = itParticle->cluster_hardch_pt;
+    *row++ = itParticle->cluster_puch_pt;
+    *row++ = itParticle->npv;
+  }
+
+  fWriter->WriteRow("x", &fRow[0]);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,77 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PapuWriter_h
+#define PapuWriter_h
+
+/** \class PapuWriter
+ *
+ *  Extracts the Papu training features from the particle-flow candidates
+ *  and writes them, together with the generator-level targets, directly
+ *  to a NumPy .npz archive with the same layout as PapuDelphesTrain.
+ *
+ */
+
+#include "classes/DelphesModule.h"
+#include "classes/DelphesPapuReader.h"
+
+#include <vector>
+
+class TObjArray;
+class TIterator;
+
+class Candidate;
+class DelphesNpzWriter;
+
+class PapuWriter: public DelphesModule
+{
+public:
+  PapuWriter();
+  ~PapuWriter();
+
+  void Init();
+  void Process();
+  void Finish();
+
+private:
+  Double_t GetHardFraction(Candidate *candidate);
+
+  Int_t fMaxParticles;
+
+  DelphesNpzWriter *fWriter; //!
+  PapuClusterOrdering *fOrdering; //!
+
+  std::vector<PapuParticle> fInputParticles; //!
+  std::vector<PapuParticle> fOutputParticles; //!
+  std::vector<Float_t> fRow; //!
+  std::vector<Candidate *> fHard; //!
+  std::vector<Candidate *> fSoft; //!
+
+  TIterator *fItInputArray; //!
+  TIterator *fItGenParticleInputArray; //!
+
+  const TObjArray *fInputArray; //!
+  const TObjArray *fVertexInputArray; //!
+  const TObjArray *fGenParticleInputArray; //!
+  const TObjArray *fGenMissingETInputArray; //!
+  const TObjArray *fGenJetInputArray; //!
+
+  ClassDef(PapuWriter, 1)
+};
+
+#endif
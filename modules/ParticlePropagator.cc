@@ -46,6 +46,7 @@
 #include "TString.h"
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
@@ -119,24 +120,37 @@ void ParticlePropagator::Finish()
 
 //------------------------------------------------------------------------------
 
+namespace
+{
+const Double_t c_light = 2.99792458E8;
+
+// kinds of propagation
+enum
+{
+  kOutside,
+  kStraight,
+  kHelix
+};
+
+// columns of the straight line and helix buffers
+enum
+{
+  kX, kY, kZ, kPx, kPy, kPz, kPt2, kE, kQ,
+  kXt, kYt, kZt, kT, kL, kValid,
+  kXd, kYd, kZd, kD0, kDZ, kPhip,
+  kNumberOfColumns
+};
+} // namespace
+
+//------------------------------------------------------------------------------
+
 void ParticlePropagator::Process()
 {
   Candidate *candidate, *mother, *particle;
-  TLorentzVector particlePosition, particleMomentum, beamSpotPosition;
-  Double_t px, py, pz, pt, pt2, e, q;
-  Double_t x, y, z, t, r, phi;
-  Double_t x_c, y_c, r_c, phi_c, phi_0;
-  Double_t x_t, y_t, z_t, r_t;
-  Double_t t1, t2, t3, t4, t5, t6;
-  Double_t t_z, t_r, t_ra, t_rb;
-  Double_t tmp, discr, discr2;
-  Double_t delta, gammam, omega, asinrho;
-  Double_t rcu, rc2, xd, yd, zd;
-  Double_t l, d0, dz, p, ctgTheta, phip, etap, alpha;
-  Double_t bsx, bsy, bsz;
-  Double_t s0, s1, sd;
-  
-  const Double_t c_light = 2.99792458E8;
+  TLorentzVector beamSpotPosition;
+  Double_t x, y, z, q, pt2;
+  Double_t *column;
+  Int_t i, kind, size, sizeStraight, sizeHelix;
 
   if(!fBeamSpotInputArray || fBeamSpotInputArray->GetSize() == 0)
     beamSpotPosition.SetXYZT(0.0, 0.0, 0.0, 0.0);
@@ -146,9 +160,28 @@ void ParticlePropagator::Process()
     beamSpotPosition = beamSpotCandidate.Position;
   }
 
-  fItInputArray->Reset();
-  while((candidate = static_cast<Candidate *>(fItInputArray->Next())))
+  fBeamSpot[0] = beamSpotPosition.X() * 1.0E-3;
+  fBeamSpot[1] = beamSpotPosition.Y() * 1.0E-3;
+  fBeamSpot[2] = beamSpotPosition.Z() * 1.0E-3;
+
+  // 1. gather the particles into columns, in [m] and [GeV]
+
+  size = fInputArray->GetEntriesFast();
+
+  fCandidates.clear();
+  fParticles.clear();
+  fKinds.clear();
+  fSlots.clear();
+
+  fStraight.resize(kNumberOfColumns * size);
+  fHelix.resize(kNumberOfColumns * size);
+
+  sizeStraight = 0;
+  sizeHelix = 0;
+
+  for(i = 0; i < size; ++i)
   {
+    candidate = static_cast<Candidate *>(fInputArray->At(i));
     if(candidate->GetCandidates()->GetEntriesFast() == 0)
     {
       particle = candidate;
@@ -158,16 +191,13 @@ void ParticlePropagator::Process()
       particle = static_cast<Candidate *>(candidate->GetCandidates()->At(0));
     }
 
-    particlePosition = particle->Position;
-    particleMomentum = particle->Momentum;
+    const TLorentzVector &particlePosition = particle->Position;
+    const TLorentzVector &particleMomentum = particle->Momentum;
+
     x = particlePosition.X() * 1.0E-3;
     y = particlePosition.Y() * 1.0E-3;
     z = particlePosition.Z() * 1.0E-3;
 
-    bsx = beamSpotPosition.X() * 1.0E-3;
-    bsy = beamSpotPosition.Y() * 1.0E-3;
-    bsz = beamSpotPosition.Z() * 1.0E-3;
-
     q = particle->Charge;
 
     // check that particle position is inside the cylinder
@@ -176,12 +206,7 @@ void ParticlePropagator::Process()
       continue;
     }
 
-    px = particleMomentum.Px();
-    py = particleMomentum.Py();
-    pz = particleMomentum.Pz();
-    pt = particleMomentum.Pt();
     pt2 = particleMomentum.Perp2();
-    e = particleMomentum.E();
 
     if(pt2 < 1.0E-9)
     {
@@ -189,6 +214,58 @@ void ParticlePropagator::Process()
     }
 
     if(TMath::Hypot(x, y) > fRadius || TMath::Abs(z) > fHalfLength)
+    {
+      kind = kOutside;
+      fSlots.push_back(-1);
+    }
+    else
+    {
+      if(TMath::Abs(q) < 1.0E-9 || TMath::Abs(fBz) < 1.0E-9)
+      {
+        kind = kStraight;
+        column = &fStraight[0];
+        fSlots.push_back(sizeStraight++);
+      }
+      else
+      {
+        kind = kHelix;
+        column = &fHelix[0];
+        fSlots.push_back(sizeHelix++);
+      }
+
+      column[kX * size + fSlots.back()] = x;
+      column[kY * size + fSlots.back()] = y;
+      column[kZ * size + fSlots.back()] = z;
+      column[kPx * size + fSlots.back()] = particleMomentum.Px();
+      column[kPy * size + fSlots.back()] = particleMomentum.Py();
+      column[kPz * size + fSlots.back()] = particleMomentum.Pz();
+      column[kPt2 * size + fSlots.back()] = pt2;
+      column[kE * size + fSlots.back()] = particleMomentum.E();
+      column[kQ * size + fSlots.back()] = q;
+    }
+
+    fCandidates.push_back(candidate);
+    fParticles.push_back(particle);
+    fKinds.push_back(kind);
+  }
+
+  // 2. propagate all particles of each kind in one pass
+
+  PropagateStraight(sizeStraight);
+  PropagateHelix(sizeHelix);
+
+  // 3. scatter the results, in the order of the input array
+
+  for(i = 0; i < Int_t(fKinds.size()); ++i)
+  {
+    candidate = fCandidates[i];
+    particle = fParticles[i];
+    kind = fKinds[i];
+
+    const TLorentzVector &particlePosition = particle->Position;
+    const TLorentzVector &particleMomentum = particle->Momentum;
+
+    if(kind == kOutside)
     {
       mother = candidate;
       candidate = static_cast<Candidate *>(candidate->Clone());
@@ -202,224 +279,314 @@ void ParticlePropagator::Process()
 
       fOutputArray->Add(candidate);
     }
-    else if(TMath::Abs(q) < 1.0E-9 || TMath::Abs(fBz) < 1.0E-9)
+    else if(kind == kStraight)
     {
-      // solve pt2*t^2 + 2*(px*x + py*y)*t - (fRadius2 - x*x - y*y) = 0
-      tmp = px * y - py * x;
-      discr2 = pt2 * fRadius2 - tmp * tmp;
-
-      if(discr2 < 0.0)
-      {
-        // no solutions
-        continue;
-      }
+      column = &fStraight[fSlots[i]];
 
-      tmp = px * x + py * y;
-      discr = TMath::Sqrt(discr2);
-      t1 = (-tmp + discr) / pt2;
-      t2 = (-tmp - discr) / pt2;
-      t = (t1 < 0.0) ? t2 : t1;
-
-      z_t = z + pz * t;
-      if(TMath::Abs(z_t) > fHalfLength)
-      {
-        t3 = (+fHalfLength - z) / pz;
-        t4 = (-fHalfLength - z) / pz;
-        t = (t3 < 0.0) ? t4 : t3;
-      }
-
-      x_t = x + px * t;
-      y_t = y + py * t;
-      z_t = z + pz * t;
-
-      l = TMath::Sqrt((x_t - x) * (x_t - x) + (y_t - y) * (y_t - y) + (z_t - z) * (z_t - z));
+      // no solutions
+      if(column[kValid * size] == 0.0) continue;
 
       mother = candidate;
       candidate = static_cast<Candidate *>(candidate->Clone());
 
       candidate->InitialPosition = particlePosition;
-      candidate->Position.SetXYZT(x_t * 1.0E3, y_t * 1.0E3, z_t * 1.0E3, particlePosition.T() + t * e * 1.0E3);
-      candidate->L = l * 1.0E3;
+      candidate->Position.SetXYZT(column[kXt * size] * 1.0E3, column[kYt * size] * 1.0E3, column[kZt * size] * 1.0E3,
+        particlePosition.T() + column[kT * size] * column[kE * size] * 1.0E3);
+      candidate->L = column[kL * size] * 1.0E3;
 
       candidate->Momentum = particleMomentum;
       candidate->AddCandidate(mother);
 
       fOutputArray->Add(candidate);
-      if(TMath::Abs(q) > 1.0E-9)
-      {
-        switch(TMath::Abs(candidate->PID))
-        {
-        case 11:
-          fElectronOutputArray->Add(candidate);
-          break;
-        case 13:
-          fMuonOutputArray->Add(candidate);
-          break;
-        default:
-          fChargedHadronOutputArray->Add(candidate);
-        }
-      }
-      else
-      {
-        fNeutralOutputArray->Add(candidate);
-      }
+      Dispatch(candidate, column[kQ * size]);
     }
     else
     {
+      column = &fHelix[fSlots[i]];
+
+      if(column[kValid * size] == 0.0) continue;
 
-      // 1.  initial transverse momentum p_{T0}: Part->pt
-      //     initial transverse momentum direction phi_0 = -atan(p_X0/p_Y0)
-      //     relativistic gamma: gamma = E/mc^2; gammam = gamma * m
-      //     gyration frequency omega = q/(gamma m) fBz
-      //     helix radius r = p_{T0} / (omega gamma m)
-
-      gammam = e * 1.0E9 / (c_light * c_light); // gammam in [eV/c^2]
-      omega = q * fBz / (gammam); // omega is here in [89875518/s]
-      r = pt / (q * fBz) * 1.0E9 / c_light; // in [m]
-
-      phi_0 = TMath::ATan2(py, px); // [rad] in [-pi, pi]
-
-      // 2. helix axis coordinates
-      x_c = x + r * TMath::Sin(phi_0);
-      y_c = y - r * TMath::Cos(phi_0);
-      r_c = TMath::Hypot(x_c, y_c);
-      phi_c = TMath::ATan2(y_c, x_c);
-      phi = phi_c;
-      if(x_c < 0.0) phi += TMath::Pi();
-
-      rcu = TMath::Abs(r);
-      rc2 = r_c * r_c;
-
-      // calculate coordinates of closest approach to track circle in transverse plane xd, yd, zd
-      xd = x_c * x_c * x_c - x_c * rcu * r_c + x_c * y_c * y_c;
-      xd = (rc2 > 0.0) ? xd / rc2 : -999;
-      yd = y_c * (-rcu * r_c + rc2);
-      yd = (rc2 > 0.0) ? yd / rc2 : -999;
-      zd = z + (TMath::Sqrt(xd * xd + yd * yd) - TMath::Sqrt(x * x + y * y)) * pz / pt;
-
-      // proper calculation of the DCAz coordinate
-      // s0: track circle parameter at the track origin
-      // s1: track circle parameter at the closest approach to beam pipe
-      // sd: s1-s0 signed angular difference
-      s0 = atan2(y - y_c, x - x_c);
-      s1 = atan2(yd - y_c, xd - x_c);
-      sd = atan2(sin(s1 - s0), cos(s1 - s0));
-      zd = z - r * pz / pt * sd;
-      
       // use perigee momentum rather than original particle
       // momentum, since the orignal particle momentum isn't known
 
-      px = TMath::Sign(1.0, r) * pt * (-y_c / r_c);
-      py = TMath::Sign(1.0, r) * pt * (x_c / r_c);
-      etap = particleMomentum.Eta();
-      phip = TMath::ATan2(py, px);
+      TLorentzVector perigeeMomentum;
+      perigeeMomentum.SetPtEtaPhiE(particleMomentum.Pt(), particleMomentum.Eta(), column[kPhip * size], particleMomentum.E());
 
-      particleMomentum.SetPtEtaPhiE(pt, etap, phip, particleMomentum.E());
+      // store these variables before cloning
+      if(particle == candidate)
+      {
+        particle->D0 = column[kD0 * size] * 1.0E3;
+        particle->DZ = column[kDZ * size] * 1.0E3;
+        particle->P = perigeeMomentum.P();
+        particle->PT = particleMomentum.Pt();
+        particle->CtgTheta = 1.0 / TMath::Tan(perigeeMomentum.Theta());
+        particle->Phi = column[kPhip * size];
+      }
 
-      // calculate additional track parameters (correct for beamspot position)
+      mother = candidate;
+      candidate = static_cast<Candidate *>(candidate->Clone());
 
-      d0 = ((x - bsx) * py - (y - bsy) * px) / pt;
-      dz = z - ((x - bsx) * px + (y - bsy) * py) / pt * (pz / pt);
-      p = particleMomentum.P();
-      ctgTheta = 1.0 / TMath::Tan(particleMomentum.Theta());
+      candidate->InitialPosition = particlePosition;
+      candidate->Position.SetXYZT(column[kXt * size] * 1.0E3, column[kYt * size] * 1.0E3, column[kZt * size] * 1.0E3,
+        particlePosition.T() + column[kT * size] * c_light * 1.0E3);
 
-      // 3. time evaluation t = TMath::Min(t_r, t_z)
-      //    t_r : time to exit from the sides
-      //    t_z : time to exit from the front or the back
-      t_r = 0.0; // in [ns]
-      int sign_pz = (pz > 0.0) ? 1 : -1;
-      if(pz == 0.0)
-        t_z = 1.0E99;
-      else
-        t_z = gammam / (pz * 1.0E9 / c_light) * (-z + fHalfLength * sign_pz);
+      candidate->Momentum = perigeeMomentum;
 
-      if(r_c + TMath::Abs(r) < fRadius)
-      {
-        // helix does not cross the cylinder sides
-        t = t_z;
-      }
-      else
-      {
-        asinrho = TMath::ASin((fRadius * fRadius - r_c * r_c - r * r) / (2 * TMath::Abs(r) * r_c));
-        delta = phi_0 - phi;
-        if(delta < -TMath::Pi()) delta += 2 * TMath::Pi();
-        if(delta > TMath::Pi()) delta -= 2 * TMath::Pi();
-        t1 = (delta + asinrho) / omega;
-        t2 = (delta + TMath::Pi() - asinrho) / omega;
-        t3 = (delta + TMath::Pi() + asinrho) / omega;
-        t4 = (delta - asinrho) / omega;
-        t5 = (delta - TMath::Pi() - asinrho) / omega;
-        t6 = (delta - TMath::Pi() + asinrho) / omega;
-
-        if(t1 < 0.0) t1 = 1.0E99;
-        if(t2 < 0.0) t2 = 1.0E99;
-        if(t3 < 0.0) t3 = 1.0E99;
-        if(t4 < 0.0) t4 = 1.0E99;
-        if(t5 < 0.0) t5 = 1.0E99;
-        if(t6 < 0.0) t6 = 1.0E99;
-
-        t_ra = TMath::Min(t1, TMath::Min(t2, t3));
-        t_rb = TMath::Min(t4, TMath::Min(t5, t6));
-        t_r = TMath::Min(t_ra, t_rb);
-        t = TMath::Min(t_r, t_z);
-      }
+      candidate->L = column[kL * size] * 1.0E3;
 
-      // 4. position in terms of x(t), y(t), z(t)
-      x_t = x_c + r * TMath::Sin(omega * t - phi_0);
-      y_t = y_c + r * TMath::Cos(omega * t - phi_0);
-      z_t = z + pz * 1.0E9 / c_light / gammam * t;
-      r_t = TMath::Hypot(x_t, y_t);
+      candidate->Xd = column[kXd * size] * 1.0E3;
+      candidate->Yd = column[kYd * size] * 1.0E3;
+      candidate->Zd = column[kZd * size] * 1.0E3;
 
-      // compute path length for an helix
+      candidate->AddCandidate(mother);
 
-      alpha = pz * 1.0E9 / c_light / gammam;
-      l = t * TMath::Sqrt(alpha * alpha + r * r * omega * omega);
+      fOutputArray->Add(candidate);
+      Dispatch(candidate, column[kQ * size]);
+    }
+  }
+}
 
-      if(r_t > 0.0)
-      {
+//------------------------------------------------------------------------------
 
-        // store these variables before cloning
-        if(particle == candidate)
-        {
-          particle->D0 = d0 * 1.0E3;
-          particle->DZ = dz * 1.0E3;
-          particle->P = p;
-          particle->PT = pt;
-          particle->CtgTheta = ctgTheta;
-          particle->Phi = phip;
-        }
-
-        mother = candidate;
-        candidate = static_cast<Candidate *>(candidate->Clone());
-
-        candidate->InitialPosition = particlePosition;
-        candidate->Position.SetXYZT(x_t * 1.0E3, y_t * 1.0E3, z_t * 1.0E3, particlePosition.T() + t * c_light * 1.0E3);
-
-        candidate->Momentum = particleMomentum;
-
-        candidate->L = l * 1.0E3;
-
-        candidate->Xd = xd * 1.0E3;
-        candidate->Yd = yd * 1.0E3;
-        candidate->Zd = zd * 1.0E3;
-
-        candidate->AddCandidate(mother);
-
-        fOutputArray->Add(candidate);
-        switch(TMath::Abs(candidate->PID))
-        {
-        case 11:
-          fElectronOutputArray->Add(candidate);
-          break;
-        case 13:
-          fMuonOutputArray->Add(candidate);
-          break;
-        default:
-          fChargedHadronOutputArray->Add(candidate);
-        }
-      }
+void ParticlePropagator::Dispatch(Candidate *candidate, Double_t q)
+{
+  if(TMath::Abs(q) > 1.0E-9)
+  {
+    switch(TMath::Abs(candidate->PID))
+    {
+    case 11:
+      fElectronOutputArray->Add(candidate);
+      break;
+    case 13:
+      fMuonOutputArray->Add(candidate);
+      break;
+    default:
+      fChargedHadronOutputArray->Add(candidate);
     }
   }
+  else
+  {
+    fNeutralOutputArray->Add(candidate);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// The propagation loops below work on the gathered columns of one kind of
+// trajectory, so the particle data is read sequentially.
+
+void ParticlePropagator::PropagateStraight(Int_t size)
+{
+  Int_t i, stride;
+  Double_t x, y, z, px, py, pz, pt2;
+  Double_t t, t1, t2, t3, t4, z_t, x_t, y_t;
+  Double_t tmp, discr2, discr;
+
+  if(size == 0) return;
+
+  stride = fStraight.size() / kNumberOfColumns;
+
+  const Double_t *col_x = &fStraight[kX * stride];
+  const Double_t *col_y = &fStraight[kY * stride];
+  const Double_t *col_z = &fStraight[kZ * stride];
+  const Double_t *col_px = &fStraight[kPx * stride];
+  const Double_t *col_py = &fStraight[kPy * stride];
+  const Double_t *col_pz = &fStraight[kPz * stride];
+  const Double_t *col_pt2 = &fStraight[kPt2 * stride];
+  Double_t *col_xt = &fStraight[kXt * stride];
+  Double_t *col_yt = &fStraight[kYt * stride];
+  Double_t *col_zt = &fStraight[kZt * stride];
+  Double_t *col_t = &fStraight[kT * stride];
+  Double_t *col_l = &fStraight[kL * stride];
+  Double_t *col_valid = &fStraight[kValid * stride];
+
+  for(i = 0; i < size; ++i)
+  {
+    x = col_x[i];
+    y = col_y[i];
+    z = col_z[i];
+    px = col_px[i];
+    py = col_py[i];
+    pz = col_pz[i];
+    pt2 = col_pt2[i];
+
+    // solve pt2*t^2 + 2*(px*x + py*y)*t - (fRadius2 - x*x - y*y) = 0
+    tmp = px * y - py * x;
+    discr2 = pt2 * fRadius2 - tmp * tmp;
+
+    col_valid[i] = (discr2 < 0.0) ? 0.0 : 1.0;
+
+    tmp = px * x + py * y;
+    discr = sqrt(discr2 < 0.0 ? 0.0 : discr2);
+    t1 = (-tmp + discr) / pt2;
+    t2 = (-tmp - discr) / pt2;
+    t = (t1 < 0.0) ? t2 : t1;
+
+    z_t = z + pz * t;
+    t3 = (+fHalfLength - z) / pz;
+    t4 = (-fHalfLength - z) / pz;
+    t = (fabs(z_t) > fHalfLength) ? ((t3 < 0.0) ? t4 : t3) : t;
+
+    x_t = x + px * t;
+    y_t = y + py * t;
+    z_t = z + pz * t;
+
+    col_xt[i] = x_t;
+    col_yt[i] = y_t;
+    col_zt[i] = z_t;
+    col_t[i] = t;
+    col_l[i] = sqrt((x_t - x) * (x_t - x) + (y_t - y) * (y_t - y) + (z_t - z) * (z_t - z));
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ParticlePropagator::PropagateHelix(Int_t size)
+{
+  Int_t i, stride;
+  Double_t x, y, z, px, py, pz, pt, e, q;
+  Double_t r, x_c, y_c, r_c, phi_c, phi_0, phi;
+  Double_t gammam, omega, rcu, rc2, xd, yd, zd;
+  Double_t s0, s1, sd, pxp, pyp, d0, dz;
+  Double_t t, t_z, t_r, t1, t2, t3, t4, t5, t6;
+  Double_t asinrho, delta, x_t, y_t, z_t, alpha;
+
+  const Double_t bsx = fBeamSpot[0];
+  const Double_t bsy = fBeamSpot[1];
+  const Double_t pi = TMath::Pi();
+
+  if(size == 0) return;
+
+  stride = fHelix.size() / kNumberOfColumns;
+
+  const Double_t *col_x = &fHelix[kX * stride];
+  const Double_t *col_y = &fHelix[kY * stride];
+  const Double_t *col_z = &fHelix[kZ * stride];
+  const Double_t *col_px = &fHelix[kPx * stride];
+  const Double_t *col_py = &fHelix[kPy * stride];
+  const Double_t *col_pz = &fHelix[kPz * stride];
+  const Double_t *col_pt2 = &fHelix[kPt2 * stride];
+  const Double_t *col_e = &fHelix[kE * stride];
+  const Double_t *col_q = &fHelix[kQ * stride];
+  Double_t *col_xt = &fHelix[kXt * stride];
+  Double_t *col_yt = &fHelix[kYt * stride];
+  Double_t *col_zt = &fHelix[kZt * stride];
+  Double_t *col_t = &fHelix[kT * stride];
+  Double_t *col_l = &fHelix[kL * stride];
+  Double_t *col_valid = &fHelix[kValid * stride];
+  Double_t *col_xd = &fHelix[kXd * stride];
+  Double_t *col_yd = &fHelix[kYd * stride];
+  Double_t *col_zd = &fHelix[kZd * stride];
+  Double_t *col_d0 = &fHelix[kD0 * stride];
+  Double_t *col_dz = &fHelix[kDZ * stride];
+  Double_t *col_phip = &fHelix[kPhip * stride];
+
+  for(i = 0; i < size; ++i)
+  {
+    x = col_x[i];
+    y = col_y[i];
+    z = col_z[i];
+    px = col_px[i];
+    py = col_py[i];
+    pz = col_pz[i];
+    pt = sqrt(col_pt2[i]);
+    e = col_e[i];
+    q = col_q[i];
+
+    // 1.  initial transverse momentum p_{T0}: Part->pt
+    //     initial transverse momentum direction phi_0 = -atan(p_X0/p_Y0)
+    //     relativistic gamma: gamma = E/mc^2; gammam = gamma * m
+    //     gyration frequency omega = q/(gamma m) fBz
+    //     helix radius r = p_{T0} / (omega gamma m)
+
+    gammam = e * 1.0E9 / (c_light * c_light); // gammam in [eV/c^2]
+    omega = q * fBz / (gammam); // omega is here in [89875518/s]
+    r = pt / (q * fBz) * 1.0E9 / c_light; // in [m]
+
+    phi_0 = atan2(py, px); // [rad] in [-pi, pi]
+
+    // 2. helix axis coordinates, sin(phi_0) = py/pt and cos(phi_0) = px/pt
+    x_c = x + r * py / pt;
+    y_c = y - r * px / pt;
+    r_c = sqrt(x_c * x_c + y_c * y_c);
+    phi_c = atan2(y_c, x_c);
+    phi = (x_c < 0.0) ? phi_c + pi : phi_c;
+
+    rcu = fabs(r);
+    rc2 = r_c * r_c;
+
+    // calculate coordinates of closest approach to track circle in transverse plane xd, yd, zd
+    xd = x_c * x_c * x_c - x_c * rcu * r_c + x_c * y_c * y_c;
+    xd = (rc2 > 0.0) ? xd / rc2 : -999;
+    yd = y_c * (-rcu * r_c + rc2);
+    yd = (rc2 > 0.0) ? yd / rc2 : -999;
+
+    // proper calculation of the DCAz coordinate
+    // s0: track circle parameter at the track origin
+    // s1: track circle parameter at the closest approach to beam pipe
+    // sd: s1-s0 signed angular difference
+    s0 = atan2(y - y_c, x - x_c);
+    s1 = atan2(yd - y_c, xd - x_c);
+    sd = atan2(sin(s1 - s0), cos(s1 - s0));
+    zd = z - r * pz / pt * sd;
+
+    // perigee momentum
+    pxp = ((r < 0.0) ? -1.0 : 1.0) * pt * (-y_c / r_c);
+    pyp = ((r < 0.0) ? -1.0 : 1.0) * pt * (x_c / r_c);
+
+    // calculate additional track parameters (correct for beamspot position)
+    d0 = ((x - bsx) * pyp - (y - bsy) * pxp) / pt;
+    dz = z - ((x - bsx) * pxp + (y - bsy) * pyp) / pt * (pz / pt);
+
+    // 3. time evaluation t = TMath::Min(t_r, t_z)
+    //    t_r : time to exit from the sides
+    //    t_z : time to exit from the front or the back
+    t_z = (pz == 0.0) ? 1.0E99 : gammam / (pz * 1.0E9 / c_light) * (-z + ((pz > 0.0) ? fHalfLength : -fHalfLength));
+
+    asinrho = TMath::ASin((fRadius2 - r_c * r_c - r * r) / (2 * fabs(r) * r_c));
+    delta = phi_0 - phi;
+    delta = (delta < -pi) ? delta + 2 * pi : delta;
+    delta = (delta > pi) ? delta - 2 * pi : delta;
+    t1 = (delta + asinrho) / omega;
+    t2 = (delta + pi - asinrho) / omega;
+    t3 = (delta + pi + asinrho) / omega;
+    t4 = (delta - asinrho) / omega;
+    t5 = (delta - pi - asinrho) / omega;
+    t6 = (delta - pi + asinrho) / omega;
+
+    t1 = (t1 < 0.0) ? 1.0E99 : t1;
+    t2 = (t2 < 0.0) ? 1.0E99 : t2;
+    t3 = (t3 < 0.0) ? 1.0E99 : t3;
+    t4 = (t4 < 0.0) ? 1.0E99 : t4;
+    t5 = (t5 < 0.0) ? 1.0E99 : t5;
+    t6 = (t6 < 0.0) ? 1.0E99 : t6;
+
+    t_r = fmin(fmin(t1, fmin(t2, t3)), fmin(t4, fmin(t5, t6)));
+
+    // helix does not cross the cylinder sides
+    t = (r_c + fabs(r) < fRadius) ? t_z : fmin(t_r, t_z);
+
+    // 4. position in terms of x(t), y(t), z(t)
+    x_t = x_c + r * sin(omega * t - phi_0);
+    y_t = y_c + r * cos(omega * t - phi_0);
+    z_t = z + pz * 1.0E9 / c_light / gammam * t;
+
+    // compute path length for an helix
+    alpha = pz * 1.0E9 / c_light / gammam;
+
+    col_xt[i] = x_t;
+    col_yt[i] = y_t;
+    col_zt[i] = z_t;
+    col_t[i] = t;
+    col_l[i] = t * sqrt(alpha * alpha + r * r * omega * omega);
+    col_valid[i] = (x_t * x_t + y_t * y_t > 0.0) ? 1.0 : 0.0;
+    col_xd[i] = xd;
+    col_yd[i] = yd;
+    col_zd[i] = zd;
+    col_d0[i] = d0;
+    col_dz[i] = dz;
+    col_phip[i] = atan2(pyp, pxp);
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -32,9 +32,12 @@
 
 #include "classes/DelphesModule.h"
 
+#include <vector>
+
 class TClonesArray;
 class TIterator;
 class TLorentzVector;
+class Candidate;
 
 class ParticlePropagator: public DelphesModule
 {
@@ -47,6 +50,11 @@ public:
   void Finish();
 
 private:
+  void PropagateStraight(Int_t size);
+  void PropagateHelix(Int_t size);
+
+  void Dispatch(Candidate *candidate, Double_t q);
+
   Double_t fRadius, fRadius2, fRadiusMax, fHalfLength, fHalfLengthMax;
   Double_t fBz;
 
@@ -61,6 +69,12 @@ private:
   TObjArray *fElectronOutputArray; //!
   TObjArray *fMuonOutputArray; //!
 
+  // particles are gathered into columns and propagated in batches
+  std::vector<Double_t> fStraight, fHelix; //!
+  std::vector<Candidate *> fCandidates, fParticles; //!
+  std::vector<Int_t> fKinds, fSlots; //!
+  Double_t fBeamSpot[3]; //!
+
   ClassDef(ParticlePropagator, 1)
 };
 
@@ -45,6 +45,9 @@ public:
   void Process();
   void Finish();
 
+  // only selects imported candidates
+  Bool_t IsReadOnly() const { return kTRUE; }
+
 private:
   Double_t fPTMin; //!
   Bool_t fInvert; //!
@@ -46,6 +46,9 @@ public:
   void Process();
   void Finish();
 
+  // classifies clones, the imported candidates are only read
+  Bool_t IsReadOnly() const { return kTRUE; }
+
 private:
   DelphesFormula *fPromptFormula;
   DelphesFormula *fNonPromptFormula;
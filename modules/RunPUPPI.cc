@@ -183,9 +183,9 @@ void RunPUPPI::Process()
   {
     momentum = candidate->Momentum;
     RecoObj curRecoObj;
-    curRecoObj.pt = momentum.Pt();
-    curRecoObj.eta = momentum.Eta();
-    curRecoObj.phi = momentum.Phi();
+    curRecoObj.pt = candidate->MomentumPt();
+    curRecoObj.eta = candidate->MomentumEta();
+    curRecoObj.phi = candidate->MomentumPhi();
     curRecoObj.m = momentum.M();
     particle = static_cast<Candidate *>(candidate->GetCandidates()->At(0)); //if(fApplyNoLep && TMath::Abs(candidate->PID) == 11) continue; //Dumb cut to minimize the nolepton on electron
     //if(fApplyNoLep && TMath::Abs(candidate->PID) == 13) continue;
@@ -237,9 +237,9 @@ void RunPUPPI::Process()
   {
     momentum = candidate->Momentum;
     RecoObj curRecoObj;
-    curRecoObj.pt = momentum.Pt();
-    curRecoObj.eta = momentum.Eta();
-    curRecoObj.phi = momentum.Phi();
+    curRecoObj.pt = candidate->MomentumPt();
+    curRecoObj.eta = candidate->MomentumEta();
+    curRecoObj.phi = candidate->MomentumPhi();
     curRecoObj.m = momentum.M();
     curRecoObj.charge = 0;
     particle = static_cast<Candidate *>(candidate->GetCandidates()->At(0));
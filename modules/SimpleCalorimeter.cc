@@ -209,7 +209,6 @@ void SimpleCalorimeter::Process()
   number = -1;
   while((particle = static_cast<Candidate *>(fItParticleInputArray->Next())))
   {
-    const TLorentzVector &particlePosition = particle->Position;
     ++number;
 
     pdgCode = TMath::Abs(particle->PID);
@@ -226,7 +225,7 @@ void SimpleCalorimeter::Process()
     if(fraction < 1.0E-9) continue;
 
     // find eta bin [1, fEtaBins.size - 1]
-    itEtaBin = lower_bound(fEtaBins.begin(), fEtaBins.end(), particlePosition.Eta());
+    itEtaBin = lower_bound(fEtaBins.begin(), fEtaBins.end(), particle->PositionEta());
     if(itEtaBin == fEtaBins.begin() || itEtaBin == fEtaBins.end()) continue;
     etaBin = distance(fEtaBins.begin(), itEtaBin);
 
@@ -234,7 +233,7 @@ void SimpleCalorimeter::Process()
     phiBins = fPhiBins[etaBin];
 
     // find phi bin [1, phiBins.size - 1]
-    itPhiBin = lower_bound(phiBins->begin(), phiBins->end(), particlePosition.Phi());
+    itPhiBin = lower_bound(phiBins->begin(), phiBins->end(), particle->PositionPhi());
     if(itPhiBin == phiBins->begin() || itPhiBin == phiBins->end()) continue;
     phiBin = distance(phiBins->begin(), itPhiBin);
 
@@ -252,7 +251,6 @@ void SimpleCalorimeter::Process()
   number = -1;
   while((track = static_cast<Candidate *>(fItTrackInputArray->Next())))
   {
-    const TLorentzVector &trackPosition = track->Position;
     ++number;
 
     pdgCode = TMath::Abs(track->PID);
@@ -268,7 +266,7 @@ void SimpleCalorimeter::Process()
     fTrackFractions.push_back(fraction);
 
     // find eta bin [1, fEtaBins.size - 1]
-    itEtaBin = lower_bound(fEtaBins.begin(), fEtaBins.end(), trackPosition.Eta());
+    itEtaBin = lower_bound(fEtaBins.begin(), fEtaBins.end(), track->PositionEta());
     if(itEtaBin == fEtaBins.begin() || itEtaBin == fEtaBins.end()) continue;
     etaBin = distance(fEtaBins.begin(), itEtaBin);
 
@@ -276,7 +274,7 @@ void SimpleCalorimeter::Process()
     phiBins = fPhiBins[etaBin];
 
     // find phi bin [1, phiBins.size - 1]
-    itPhiBin = lower_bound(phiBins->begin(), phiBins->end(), trackPosition.Phi());
+    itPhiBin = lower_bound(phiBins->begin(), phiBins->end(), track->PositionPhi());
     if(itPhiBin == phiBins->begin() || itPhiBin == phiBins->end()) continue;
     phiBin = distance(phiBins->begin(), itPhiBin);
 
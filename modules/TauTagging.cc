@@ -29,6 +29,8 @@
 #include "modules/TauTagging.h"
 
 #include "classes/DelphesClasses.h"
+#include "classes/DelphesDeltaRMatcher.h"
+#include "classes/DelphesEfficiencyTable.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
 
@@ -102,7 +104,7 @@ Int_t TauTaggingPartonClassifier::GetCategory(TObject *object)
 //------------------------------------------------------------------------------
 
 TauTagging::TauTagging() :
-  fClassifier(0), fFilter(0),
+  fWorkingPoints(0), fClassifier(0), fMatcher(0), fFilter(0),
   fItPartonInputArray(0), fItJetInputArray(0)
 {
 }
@@ -117,37 +119,11 @@ TauTagging::~TauTagging()
 
 void TauTagging::Init()
 {
-  map<Int_t, DelphesFormula *>::iterator itEfficiencyMap;
-  ExRootConfParam param;
-  DelphesFormula *formula;
-  Int_t i, size;
-
-  fBitNumber = GetInt("BitNumber", 0);
-
   fDeltaR = GetDouble("DeltaR", 0.5);
 
-  // read efficiency formulas
-  param = GetParam("EfficiencyFormula");
-  size = param.GetSize();
-
-  fEfficiencyMap.clear();
-  for(i = 0; i < size / 2; ++i)
-  {
-    formula = new DelphesFormula;
-    formula->Compile(param[i * 2 + 1].GetString());
-
-    fEfficiencyMap[param[i * 2].GetInt()] = formula;
-  }
-
-  // set default efficiency formula
-  itEfficiencyMap = fEfficiencyMap.find(0);
-  if(itEfficiencyMap == fEfficiencyMap.end())
-  {
-    formula = new DelphesFormula;
-    formula->Compile("0.0");
-
-    fEfficiencyMap[0] = formula;
-  }
+  // read efficiency formulas of all working points
+  fWorkingPoints = new DelphesWorkingPoints;
+  fWorkingPoints->Read(this);
 
   // import input array(s)
 
@@ -162,6 +138,8 @@ void TauTagging::Init()
 
   fFilter = new ExRootFilter(fPartonInputArray);
 
+  fMatcher = new DelphesDeltaRMatcher;
+
   fJetInputArray = ImportArray(GetString("JetInputArray", "FastJetFinder/jets"));
   fItJetInputArray = fJetInputArray->MakeIterator();
 }
@@ -170,19 +148,12 @@ void TauTagging::Init()
 
 void TauTagging::Finish()
 {
-  map<Int_t, DelphesFormula *>::iterator itEfficiencyMap;
-  DelphesFormula *formula;
-
+  if(fMatcher) delete fMatcher;
   if(fFilter) delete fFilter;
   if(fClassifier) delete fClassifier;
   if(fItJetInputArray) delete fItJetInputArray;
   if(fItPartonInputArray) delete fItPartonInputArray;
-
-  for(itEfficiencyMap = fEfficiencyMap.begin(); itEfficiencyMap != fEfficiencyMap.end(); ++itEfficiencyMap)
-  {
-    formula = itEfficiencyMap->second;
-    if(formula) delete formula;
-  }
+  if(fWorkingPoints) delete fWorkingPoints;
 }
 
 //------------------------------------------------------------------------------
@@ -193,14 +164,40 @@ void TauTagging::Process()
   TLorentzVector tauMomentum;
   Double_t pt, eta, phi, e, eff;
   TObjArray *tauArray;
-  map<Int_t, DelphesFormula *>::iterator itEfficiencyMap;
-  DelphesFormula *formula;
-  Int_t pdgCode, charge, i;
+  Int_t pdgCode, charge, i, j;
 
   // select taus
   fFilter->Reset();
   tauArray = fFilter->GetSubArray(fClassifier, 0);
 
+  // index the visible momenta of all taus by eta
+  fMatcher->Clear();
+  if(tauArray && fJetInputArray->GetEntriesFast() > 0)
+  {
+    for(j = 0; j < tauArray->GetEntriesFast(); ++j)
+    {
+      tau = static_cast<Candidate *>(tauArray->At(j));
+      if(tau->D1 < 0) continue;
+
+      if(tau->D1 >= fParticleInputArray->GetEntriesFast() || tau->D2 >= fParticleInputArray->GetEntriesFast())
+      {
+        throw runtime_error("tau's daughter index is greater than the ParticleInputArray size");
+      }
+
+      tauMomentum.SetPxPyPzE(0.0, 0.0, 0.0, 0.0);
+
+      for(i = tau->D1; i <= tau->D2; ++i)
+      {
+        daughter = static_cast<Candidate *>(fParticleInputArray->At(i));
+        if(TMath::Abs(daughter->PID) == 16) continue;
+        tauMomentum += daughter->Momentum;
+      }
+
+      fMatcher->Add(tauMomentum.Eta(), tauMomentum.Phi(), j);
+    }
+  }
+  fMatcher->Sort();
+
   // loop over all input jets
   fItJetInputArray->Reset();
   while((jet = static_cast<Candidate *>(fItJetInputArray->Next())))
@@ -208,52 +205,27 @@ void TauTagging::Process()
     const TLorentzVector &jetMomentum = jet->Momentum;
     pdgCode = 0;
     charge = gRandom->Uniform() > 0.5 ? 1 : -1;
-    eta = jetMomentum.Eta();
-    phi = jetMomentum.Phi();
-    pt = jetMomentum.Pt();
+    eta = jet->MomentumEta();
+    phi = jet->MomentumPhi();
+    pt = jet->MomentumPt();
     e = jetMomentum.E();
 
-    // loop over all input taus
-    if(tauArray)
+    // the last matching tau in input order sets the charge
+    fMatcher->FindWithin(eta, phi, fDeltaR, fMatches);
+    if(!fMatches.empty())
     {
-      TIter itTauArray(tauArray);
-      while((tau = static_cast<Candidate *>(itTauArray.Next())))
-      {
-        if(tau->D1 < 0) continue;
-
-        if(tau->D1 >= fParticleInputArray->GetEntriesFast() || tau->D2 >= fParticleInputArray->GetEntriesFast())
-        {
-          throw runtime_error("tau's daughter index is greater than the ParticleInputArray size");
-        }
-
-        tauMomentum.SetPxPyPzE(0.0, 0.0, 0.0, 0.0);
-
-        for(i = tau->D1; i <= tau->D2; ++i)
-        {
-          daughter = static_cast<Candidate *>(fParticleInputArray->At(i));
-          if(TMath::Abs(daughter->PID) == 16) continue;
-          tauMomentum += daughter->Momentum;
-        }
-
-        if(jetMomentum.DeltaR(tauMomentum) <= fDeltaR)
-        {
-          pdgCode = 15;
-          charge = tau->Charge;
-        }
-      }
+      tau = static_cast<Candidate *>(tauArray->At(fMatches.back().first));
+      pdgCode = 15;
+      charge = tau->Charge;
     }
-    // find an efficency formula
-    itEfficiencyMap = fEfficiencyMap.find(pdgCode);
-    if(itEfficiencyMap == fEfficiencyMap.end())
+
+    // apply the efficiencies of all working points
+    for(i = 0; i < fWorkingPoints->GetSize(); ++i)
     {
-      itEfficiencyMap = fEfficiencyMap.find(0);
+      eff = fWorkingPoints->GetEfficiencyMap(i)->Find(pdgCode)->Eval(pt, eta, phi, e);
+      jet->TauTag |= (gRandom->Uniform() <= eff) << fWorkingPoints->GetBitNumber(i);
+      if(i == 0) jet->TauWeight = eff;
     }
-    formula = itEfficiencyMap->second;
-
-    // apply an efficency formula
-    eff = formula->Eval(pt, eta, phi, e);
-    jet->TauTag |= (gRandom->Uniform() <= eff) << fBitNumber;
-    jet->TauWeight = eff;
 
     // set tau charge
     jet->Charge = charge;
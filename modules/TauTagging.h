@@ -25,6 +25,10 @@
  *  applies b-tagging efficiency (miss identification rate) formulas
  *  and sets b-tagging flags 
  *
+ *  Several working points can be applied in the same pass over the jets,
+ *  see DelphesWorkingPoints.
+ *  TauWeight is the efficiency of the main working point.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
@@ -34,10 +38,12 @@
 #include "ExRootAnalysis/ExRootResult.h"
 #include "classes/DelphesModule.h"
 
-#include <map>
+#include <utility>
+#include <vector>
 
 class TObjArray;
-class DelphesFormula;
+class DelphesDeltaRMatcher;
+class DelphesWorkingPoints;
 
 class ExRootFilter;
 class TauTaggingPartonClassifier;
@@ -53,16 +59,18 @@ public:
   void Finish();
 
 private:
-  Int_t fBitNumber;
-
   Double_t fDeltaR;
 
-#if !defined(__CINT__) && !defined(__CLING__)
-  std::map<Int_t, DelphesFormula *> fEfficiencyMap; //!
-#endif
+  DelphesWorkingPoints *fWorkingPoints; //!
 
   TauTaggingPartonClassifier *fClassifier; //!
 
+  DelphesDeltaRMatcher *fMatcher; //!
+
+#if !defined(__CINT__) && !defined(__CLING__)
+  std::vector<std::pair<Int_t, Double_t> > fMatches; //!
+#endif
+
   ExRootFilter *fFilter;
 
   TIterator *fItPartonInputArray; //!
@@ -40,9 +40,13 @@
 #include "TLorentzVector.h"
 #include "TMath.h"
 #include "TObjArray.h"
+#include "TSystem.h"
 
+#include <algorithm>
+#include <functional>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 
 using namespace std;
 
@@ -67,10 +71,63 @@ TrackCovariance::~TrackCovariance()
 
 void TrackCovariance::Init()
 {
+  ExRootConfParam paramPt, paramAngle;
+  Long_t i, sizePt, sizeAngle;
+  vector<Double_t> ptGrid, angleGrid;
+  const char *geometry;
+  string cacheFileName;
+  stringstream fileName;
+  ULong64_t key;
+
   fBz = GetDouble("Bz", 0.0);
-  fGeometry->Read(GetString("DetectorGeometry", ""));
+  geometry = GetString("DetectorGeometry", "");
+  fGeometry->Read(geometry);
+
+  // optional pt (GeV) and polar angle (degrees) points of the covariance grid
+
+  paramPt = GetParam("PtGrid");
+  sizePt = paramPt.GetSize();
+  paramAngle = GetParam("AngleGrid");
+  sizeAngle = paramAngle.GetSize();
+
+  if(sizePt > 0 || sizeAngle > 0)
+  {
+    for(i = 0; i < sizePt; ++i) ptGrid.push_back(paramPt[i].GetDouble());
+    for(i = 0; i < sizeAngle; ++i) angleGrid.push_back(paramAngle[i].GetDouble());
+
+    if(ptGrid.size() < 2 || angleGrid.size() < 2
+      || adjacent_find(ptGrid.begin(), ptGrid.end(), greater_equal<Double_t>()) != ptGrid.end()
+      || adjacent_find(angleGrid.begin(), angleGrid.end(), greater_equal<Double_t>()) != angleGrid.end())
+    {
+      throw runtime_error("PtGrid and AngleGrid must both contain at least two points in increasing order");
+    }
+
+    delete fCovariance;
+    fCovariance = new SolGridCov(ptGrid.size(), &ptGrid[0], angleGrid.size(), &angleGrid[0]);
+  }
 
-  fCovariance->Calc(fGeometry);
+  // the grid is cached in a file keyed by the geometry, the magnetic field and the grid points
+
+  if(GetBool("UseCovarianceCache", true))
+  {
+    key = fCovariance->Key(fGeometry, geometry, fBz);
+    fileName << GetString("CovarianceCacheDirectory", gSystem->TempDirectory());
+    fileName << "/TrackCovariance_" << hex << key << ".bin";
+    cacheFileName = fileName.str();
+
+    if(!fCovariance->ReadCache(cacheFileName.c_str(), key))
+    {
+      fCovariance->Calc(fGeometry);
+      if(!fCovariance->WriteCache(cacheFileName.c_str(), key))
+      {
+        cout << "** WARNING: cannot write covariance cache " << cacheFileName << endl;
+      }
+    }
+  }
+  else
+  {
+    fCovariance->Calc(fGeometry);
+  }
 
   // import input array
 
@@ -96,43 +153,76 @@ void TrackCovariance::Process()
   Candidate *candidate, *mother;
   Double_t mass, p, pt, q, ct;
   Double_t dd0, ddz, dphi, dct, dp, dpt;
-  
+  Double_t *par, *cov;
+  Int_t i, n;
+
+  // collect all tracks of the event and smear them in one pass
 
-  fItInputArray->Reset();
-  while((candidate = static_cast<Candidate *>(fItInputArray->Next())))
+  n = fInputArray->GetEntriesFast();
+
+  fX.resize(3 * n);
+  fP.resize(3 * n);
+  fQ.resize(n);
+  fObsPar.resize(SolGridCov::kSize * n);
+  fCov.resize(SolGridCov::kPackedSize * n);
+
+  for(i = 0; i < n; ++i)
   {
+    candidate = static_cast<Candidate *>(fInputArray->At(i));
     const TLorentzVector &candidatePosition = candidate->InitialPosition;
     const TLorentzVector &candidateMomentum = candidate->Momentum;
 
-    mass = candidateMomentum.M();
+    fX[3 * i] = candidatePosition.X();
+    fX[3 * i + 1] = candidatePosition.Y();
+    fX[3 * i + 2] = candidatePosition.Z();
+
+    fP[3 * i] = candidateMomentum.Px();
+    fP[3 * i + 1] = candidateMomentum.Py();
+    fP[3 * i + 2] = candidateMomentum.Pz();
 
-    ObsTrk track(candidatePosition.Vect(), candidateMomentum.Vect(), candidate->Charge, fBz, fCovariance);
+    fQ[i] = candidate->Charge;
+  }
+
+  if(n > 0) ObsTrk::SmearTracks(n, &fX[0], &fP[0], &fQ[0], fBz, fCovariance, &fObsPar[0], &fCov[0]);
+
+  for(i = 0; i < n; ++i)
+  {
+    candidate = static_cast<Candidate *>(fInputArray->At(i));
+    const TLorentzVector &candidatePosition = candidate->InitialPosition;
+
+    par = &fObsPar[SolGridCov::kSize * i];
+    cov = &fCov[SolGridCov::kPackedSize * i];
+
+    mass = candidate->Momentum.M();
 
     mother = candidate;
     candidate = static_cast<Candidate *>(candidate->Clone());
 
-    candidate->Momentum.SetVectM(track.GetObsP(), mass);
-    candidate->InitialPosition.SetXYZT(track.GetObsX().X(),track.GetObsX().Y(),track.GetObsX().Z(),candidatePosition.T());
+    // D, phi0, C, z0, cot(theta)
+    pt = fBz * 0.2998 / TMath::Abs(2 * par[2]);
+    ct = par[4];
+    q = TMath::Sign(1.0, -par[2]);
+
+    candidate->Momentum.SetXYZM(pt * TMath::Cos(par[1]), pt * TMath::Sin(par[1]), pt * ct, mass);
+    candidate->InitialPosition.SetXYZT(-par[0] * TMath::Sin(par[1]), par[0] * TMath::Cos(par[1]), par[3], candidatePosition.T());
 
     pt = candidate->Momentum.Pt();
     p  = candidate->Momentum.P();
-    q  = track.GetObsQ();
-    ct = track.GetObsPar()[4];
 
-    candidate->D0 = track.GetObsPar()[0];
-    candidate->DZ = track.GetObsPar()[3];
-    candidate->P  = track.GetObsP().Mag();
-    candidate->CtgTheta = track.GetObsPar()[4];
-    candidate->Phi = track.GetObsPar()[1];
+    candidate->D0 = par[0];
+    candidate->DZ = par[3];
+    candidate->P  = p;
+    candidate->CtgTheta = ct;
+    candidate->Phi = par[1];
 
     candidate->PT = pt;
     candidate->Charge = q;
 
-    dd0       = TMath::Sqrt(track.GetCov()(0, 0)); 
-    ddz       = TMath::Sqrt(track.GetCov()(3, 3)); 
-    dphi      = TMath::Sqrt(track.GetCov()(1, 1)); 
-    dct       = TMath::Sqrt(track.GetCov()(4, 4)); 
-    dpt       = 2 * TMath::Sqrt( track.GetCov()(2, 2))*pt*pt / (0.2998*fBz);
+    dd0       = TMath::Sqrt(cov[SolGridCov::Index(0, 0)]);
+    ddz       = TMath::Sqrt(cov[SolGridCov::Index(3, 3)]);
+    dphi      = TMath::Sqrt(cov[SolGridCov::Index(1, 1)]);
+    dct       = TMath::Sqrt(cov[SolGridCov::Index(4, 4)]);
+    dpt       = 2 * TMath::Sqrt(cov[SolGridCov::Index(2, 2)])*pt*pt / (0.2998*fBz);
     dp        = TMath::Sqrt((1.+ct*ct)*dpt*dpt + 4*pt*pt*ct*ct*dct*dct/(1.+ct*ct)/(1.+ct*ct));
 
     candidate->ErrorD0 = dd0;
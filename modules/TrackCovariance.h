@@ -30,6 +30,8 @@
 
 #include "classes/DelphesModule.h"
 
+#include <vector>
+
 class TIterator;
 class TObjArray;
 
@@ -46,6 +48,9 @@ public:
   void Process();
   void Finish();
 
+  // smears clones, the imported tracks are only read
+  Bool_t IsReadOnly() const { return kTRUE; }
+
 private:
   Double_t fBz;
 
@@ -58,6 +63,10 @@ private:
 
   TObjArray *fOutputArray; //!
 
+  // per event buffers for ObsTrk::SmearTracks
+  std::vector<Double_t> fX, fP, fQ; //!
+  std::vector<Double_t> fObsPar, fCov; //!
+
   ClassDef(TrackCovariance, 1)
 };
 
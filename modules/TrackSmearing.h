@@ -27,6 +27,9 @@ public:
   void Process();
   void Finish();
 
+  // smears clones, the imported tracks are only read
+  Bool_t IsReadOnly() const { return kTRUE; }
+
 private:
   Double_t ptError(const Double_t, const Double_t, const Double_t, const Double_t);
 
@@ -34,6 +34,7 @@
 #include "ExRootAnalysis/ExRootFilter.h"
 #include "ExRootAnalysis/ExRootResult.h"
 #include "ExRootAnalysis/ExRootTreeBranch.h"
+#include "ExRootAnalysis/ExRootTreeWriter.h"
 
 #include "TDatabasePDG.h"
 #include "TFormula.h"
@@ -48,12 +49,14 @@
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
+#include <vector>
 
 using namespace std;
 
 //------------------------------------------------------------------------------
 
-TreeWriter::TreeWriter()
+TreeWriter::TreeWriter() :
+  fFields(0)
 {
 }
 
@@ -89,18 +92,72 @@ void TreeWriter::Init()
   // import array with output from filter/classifier/jetfinder modules
 
   ExRootConfParam param = GetParam("Branch");
-  Long_t i, size;
-  TString branchName, branchClassName, branchInputArray;
+  ExRootConfParam fieldsParam;
+  Long_t i, j, size;
+  TString branchName, branchClassName, branchInputArray, branchFields, field;
   TClass *branchClass;
   TObjArray *array;
   ExRootTreeBranch *branch;
+  set<TString> fields;
+  set<TString>::iterator itFields;
+  TString algorithmName;
+  Int_t algorithm, level;
+
+  // compression of the branches, the output layout is set by the readers
+  // from the main configuration before they create their branches
+
+  if(GetParam("FlatLayout").GetSize() > 0)
+  {
+    throw runtime_error("FlatLayout must be set in the main configuration, not in the TreeWriter module.");
+  }
+
+  GetTreeWriter()->SetBasketSize(GetInt("BasketSize", 64000));
+
+  algorithmName = GetString("CompressionAlgorithm", "");
+  algorithmName.ToUpper();
+  if(algorithmName.Length() > 0)
+  {
+    if(algorithmName == "ZLIB")
+      algorithm = 1;
+    else if(algorithmName == "LZMA")
+      algorithm = 2;
+    else if(algorithmName == "LZ4")
+      algorithm = 4;
+    else if(algorithmName == "ZSTD")
+      algorithm = 5;
+    else
+    {
+      stringstream message;
+      message << "unknown compression algorithm '" << algorithmName << "'";
+      throw runtime_error(message.str());
+    }
+    level = GetInt("CompressionLevel", 1);
+    GetTreeWriter()->SetCompressionSettings(100 * algorithm + level);
+  }
 
   size = param.GetSize();
-  for(i = 0; i < size / 3; ++i)
+  i = 0;
+  while(i + 2 < size)
   {
-    branchInputArray = param[i * 3].GetString();
-    branchName = param[i * 3 + 1].GetString();
-    branchClassName = param[i * 3 + 2].GetString();
+    branchInputArray = param[i].GetString();
+    branchName = param[i + 1].GetString();
+    branchClassName = param[i + 2].GetString();
+    i += 3;
+
+    // optional list of fields, input array names always contain a '/'
+    fields.clear();
+    branchFields = "";
+    if(i < size && !TString(param[i].GetString()).Contains("/"))
+    {
+      fieldsParam = param[i];
+      for(j = 0; j < fieldsParam.GetSize(); ++j)
+      {
+        field = fieldsParam[j].GetString();
+        fields.insert(field);
+        branchFields += field + " ";
+      }
+      ++i;
+    }
 
     branchClass = gROOT->GetClass(branchClassName);
 
@@ -117,10 +174,19 @@ void TreeWriter::Init()
       continue;
     }
 
+    for(itFields = fields.begin(); itFields != fields.end(); ++itFields)
+    {
+      if(!branchClass->GetDataMember(*itFields))
+      {
+        cout << "** WARNING: class '" << branchClassName << "' has no field '" << *itFields << "'" << endl;
+      }
+    }
+
     array = ImportArray(branchInputArray);
-    branch = NewBranch(branchName, branchClass);
+    branch = NewBranch(branchName, branchClass, branchFields);
 
     fBranchMap.insert(make_pair(branch, make_pair(itClassMap->second, array)));
+    fFieldMap[branch] = fields;
   }
 }
 
@@ -132,6 +198,13 @@ void TreeWriter::Finish()
 
 //------------------------------------------------------------------------------
 
+Bool_t TreeWriter::IsSelected(const char *field) const
+{
+  return !fFields || fFields->empty() || fFields->count(field) > 0;
+}
+
+//------------------------------------------------------------------------------
+
 void TreeWriter::FillParticles(Candidate *candidate, TRefArray *array, bool verbose)
 {
 
@@ -565,26 +638,40 @@ void TreeWriter::ProcessParticles(ExRootTreeBranch *branch, TObjArray *array)
 
 //------------------------------------------------------------------------------
 
+static bool CompareSumPT2(const Candidate *candidate1, const Candidate *candidate2)
+{
+  return CompSumPT2<Candidate>::Instance()->Compare(candidate1, candidate2) < 0;
+}
+
+//------------------------------------------------------------------------------
+
 void TreeWriter::ProcessVertices(ExRootTreeBranch *branch, TObjArray *array)
 {
   TIter iterator(array);
   Candidate *candidate = 0, *constituent = 0;
   Vertex *entry = 0;
+  vector<Candidate *> vertices;
+  vector<Candidate *>::iterator itVertex;
 
   const Double_t c_light = 2.99792458E8;
 
   Double_t x, y, z, t, xError, yError, zError, tError, sigma, sumPT2, btvSumPT2, genDeltaZ, genSumPT2;
   UInt_t index, ndf;
+  Bool_t fillConstituents = IsSelected("Constituents");
 
-  CompBase *compare = Candidate::fgCompare;
-  Candidate::fgCompare = CompSumPT2<Candidate>::Instance();
-  array->Sort();
-  Candidate::fgCompare = compare;
-
-  // loop over all vertices
+  // sort by decreasing SumPT2 without swapping Candidate::fgCompare,
+  // which the modules running concurrently use to sort their arrays
   iterator.Reset();
   while((candidate = static_cast<Candidate *>(iterator.Next())))
   {
+    vertices.push_back(candidate);
+  }
+  stable_sort(vertices.begin(), vertices.end(), CompareSumPT2);
+
+  // loop over all vertices
+  for(itVertex = vertices.begin(); itVertex != vertices.end(); ++itVertex)
+  {
+    candidate = *itVertex;
 
     index = candidate->ClusterIndex;
     ndf = candidate->ClusterNDF;
@@ -624,6 +711,8 @@ void TreeWriter::ProcessVertices(ExRootTreeBranch *branch, TObjArray *array)
     entry->ErrorZ = zError;
     entry->ErrorT = tError;
 
+    if(!fillConstituents) continue;
+
     TIter itConstituents(candidate->GetCandidates());
     itConstituents.Reset();
     entry->Constituents.Clear();
@@ -645,7 +734,9 @@ void TreeWriter::ProcessTracks(ExRootTreeBranch *branch, TObjArray *array)
   Candidate *candidate = 0;
   Candidate *particle = 0;
   Track *entry = 0;
-  Double_t pt, signz, cosTheta, eta, rapidity, p, ctgTheta, phi;
+  Double_t pt, signz, cosTheta, eta, p, ctgTheta, phi;
+  Bool_t fillOuter = IsSelected("EtaOuter") || IsSelected("PhiOuter");
+  Bool_t fillCtgTheta = IsSelected("CtgTheta");
   const Double_t c_light = 2.99792458E8;
 
   // loop over all tracks
@@ -654,11 +745,6 @@ void TreeWriter::ProcessTracks(ExRootTreeBranch *branch, TObjArray *array)
   {
     const TLorentzVector &position = candidate->Position;
 
-    cosTheta = TMath::Abs(position.CosTheta());
-    signz = (position.Pz() >= 0.0) ? 1.0 : -1.0;
-    eta = (cosTheta == 1.0 ? signz * 999.9 : position.Eta());
-    rapidity = (cosTheta == 1.0 ? signz * 999.9 : position.Rapidity());
-
     entry = static_cast<Track *>(branch->NewEntry());
 
     entry->SetBit(kIsReferenced);
@@ -668,8 +754,15 @@ void TreeWriter::ProcessTracks(ExRootTreeBranch *branch, TObjArray *array)
 
     entry->Charge = candidate->Charge;
 
-    entry->EtaOuter = eta;
-    entry->PhiOuter = position.Phi();
+    if(fillOuter)
+    {
+      cosTheta = TMath::Abs(position.CosTheta());
+      signz = (position.Pz() >= 0.0) ? 1.0 : -1.0;
+      eta = (cosTheta == 1.0 ? signz * 999.9 : position.Eta());
+
+      entry->EtaOuter = eta;
+      entry->PhiOuter = position.Phi();
+    }
 
     entry->XOuter = position.X();
     entry->YOuter = position.Y();
@@ -697,12 +790,11 @@ void TreeWriter::ProcessTracks(ExRootTreeBranch *branch, TObjArray *array)
     pt = momentum.Pt();
     p = momentum.P();
     phi = momentum.Phi();
-    ctgTheta = (TMath::Tan(momentum.Theta()) != 0) ? 1 / TMath::Tan(momentum.Theta()) : 1e10;
+    ctgTheta = (fillCtgTheta && TMath::Tan(momentum.Theta()) != 0) ? 1 / TMath::Tan(momentum.Theta()) : 1e10;
 
     cosTheta = TMath::Abs(momentum.CosTheta());
     signz = (momentum.Pz() >= 0.0) ? 1.0 : -1.0;
     eta = (cosTheta == 1.0 ? signz * 999.9 : momentum.Eta());
-    rapidity = (cosTheta == 1.0 ? signz * 999.9 : momentum.Rapidity());
 
     entry->P = p;
     entry->PT = pt;
@@ -735,6 +827,7 @@ void TreeWriter::ProcessTowers(ExRootTreeBranch *branch, TObjArray *array)
   Candidate *candidate = 0;
   Tower *entry = 0;
   Double_t pt, signPz, cosTheta, eta, rapidity;
+  Bool_t fillParticles = IsSelected("Particles");
   const Double_t c_light = 2.99792458E8;
 
   // loop over all towers
@@ -769,7 +862,7 @@ void TreeWriter::ProcessTowers(ExRootTreeBranch *branch, TObjArray *array)
     entry->T = position.T() * 1.0E-3 / c_light;
     entry->NTimeHits = candidate->NTimeHits;
 
-    FillParticles(candidate, &entry->Particles);
+    if(fillParticles) FillParticles(candidate, &entry->Particles);
   }
 }
 
@@ -787,7 +880,12 @@ void TreeWriter::ProcessParticleFlowCandidates(ExRootTreeBranch *branch, TObjArr
   Candidate *candidate = 0;
   Candidate *particle = 0;
   ParticleFlowCandidate *entry = 0;
-  Double_t e, pt, signz, cosTheta, eta, rapidity, p, ctgTheta, phi;
+  Double_t e, pt, signz, cosTheta, eta, p, ctgTheta, phi;
+  Bool_t fillOuter = IsSelected("EtaOuter") || IsSelected("PhiOuter");
+  Bool_t fillCtgTheta = IsSelected("CtgTheta");
+  Bool_t fillLeadingGenPart = IsSelected("leadingGenPart_PT") || IsSelected("leadingGenPart_Eta")
+    || IsSelected("leadingGenPart_Phi") || IsSelected("leadingGenPart_E");
+  Bool_t fillParticles = IsSelected("Particles") || IsSelected("hardfrac") || IsSelected("pufrac");
   const Double_t c_light = 2.99792458E8;
 
   // loop over all tracks
@@ -800,11 +898,6 @@ void TreeWriter::ProcessParticleFlowCandidates(ExRootTreeBranch *branch, TObjArr
 
     const TLorentzVector &position = candidate->Position;
 
-    cosTheta = TMath::Abs(position.CosTheta());
-    signz = (position.Pz() >= 0.0) ? 1.0 : -1.0;
-    eta = (cosTheta == 1.0 ? signz * 999.9 : position.Eta());
-    rapidity = (cosTheta == 1.0 ? signz * 999.9 : position.Rapidity());
-
     entry = static_cast<ParticleFlowCandidate *>(branch->NewEntry());
 
     entry->SetBit(kIsReferenced);
@@ -820,8 +913,15 @@ void TreeWriter::ProcessParticleFlowCandidates(ExRootTreeBranch *branch, TObjArr
 
     entry->PuppiW = candidate->puppiW;
 
-    entry->EtaOuter = eta;
-    entry->PhiOuter = position.Phi();
+    if(fillOuter)
+    {
+      cosTheta = TMath::Abs(position.CosTheta());
+      signz = (position.Pz() >= 0.0) ? 1.0 : -1.0;
+      eta = (cosTheta == 1.0 ? signz * 999.9 : position.Eta());
+
+      entry->EtaOuter = eta;
+      entry->PhiOuter = position.Phi();
+    }
 
     entry->XOuter = position.X();
     entry->YOuter = position.Y();
@@ -854,7 +954,7 @@ void TreeWriter::ProcessParticleFlowCandidates(ExRootTreeBranch *branch, TObjArr
 
     p = momentum.P();
     phi = momentum.Phi();
-    ctgTheta = (TMath::Tan(momentum.Theta()) != 0) ? 1 / TMath::Tan(momentum.Theta()) : 1e10;
+    ctgTheta = (fillCtgTheta && TMath::Tan(momentum.Theta()) != 0) ? 1 / TMath::Tan(momentum.Theta()) : 1e10;
 
     entry->E = e;
     entry->P = p;
@@ -878,11 +978,14 @@ void TreeWriter::ProcessParticleFlowCandidates(ExRootTreeBranch *branch, TObjArr
     entry->VertexIndex = candidate->ClusterIndex;
     //else
 
-    TLorentzVector maxpart = findGenParticleCustom(candidate, &entry->Particles);
-    entry->leadingGenPart_PT = maxpart.Pt();
-    entry->leadingGenPart_Eta = maxpart.Eta();
-    entry->leadingGenPart_Phi = maxpart.Phi();
-    entry->leadingGenPart_E = maxpart.E();
+    if(fillLeadingGenPart)
+    {
+      TLorentzVector maxpart = findGenParticleCustom(candidate, &entry->Particles);
+      entry->leadingGenPart_PT = maxpart.Pt();
+      entry->leadingGenPart_Eta = maxpart.Eta();
+      entry->leadingGenPart_Phi = maxpart.Phi();
+      entry->leadingGenPart_E = maxpart.E();
+    }
 
     entry->Eem = candidate->Eem;
     entry->Ehad = candidate->Ehad;
@@ -894,6 +997,8 @@ void TreeWriter::ProcessParticleFlowCandidates(ExRootTreeBranch *branch, TObjArr
     entry->T = position.T() * 1.0E-3 / c_light;
     entry->NTimeHits = candidate->NTimeHits;
 
+    if(!fillParticles) continue;
+
     std::pair<TLorentzVector,TLorentzVector> p4s = FillParticlesCustom(candidate, &entry->Particles, false);
     TLorentzVector hard = p4s.first;
     TLorentzVector soft = p4s.second;
@@ -927,6 +1032,7 @@ void TreeWriter::ProcessPhotons(ExRootTreeBranch *branch, TObjArray *array)
   Candidate *candidate = 0;
   Photon *entry = 0;
   Double_t pt, signPz, cosTheta, eta, rapidity;
+  Bool_t fillParticles = IsSelected("Particles");
   const Double_t c_light = 2.99792458E8;
 
   array->Sort();
@@ -967,7 +1073,7 @@ void TreeWriter::ProcessPhotons(ExRootTreeBranch *branch, TObjArray *array)
     // 1: prompt -- 2: non prompt -- 3: fake
     entry->Status = candidate->Status;
 
-    FillParticles(candidate, &entry->Particles);
+    if(fillParticles) FillParticles(candidate, &entry->Particles);
   }
 }
 
@@ -1096,6 +1202,8 @@ void TreeWriter::ProcessJets(ExRootTreeBranch *branch, TObjArray *array)
   Jet *entry = 0;
   Double_t pt, signPz, cosTheta, eta, rapidity;
   Double_t ecalEnergy, hcalEnergy;
+  Bool_t fillConstituents = IsSelected("Constituents") || IsSelected("EhadOverEem");
+  Bool_t fillParticles = IsSelected("Particles");
   const Double_t c_light = 2.99792458E8;
   Int_t i;
 
@@ -1145,18 +1253,21 @@ void TreeWriter::ProcessJets(ExRootTreeBranch *branch, TObjArray *array)
 
     entry->Charge = candidate->Charge;
 
-    itConstituents.Reset();
-    entry->Constituents.Clear();
-    ecalEnergy = 0.0;
-    hcalEnergy = 0.0;
-    while((constituent = static_cast<Candidate *>(itConstituents.Next())))
+    if(fillConstituents)
     {
-      entry->Constituents.Add(constituent);
-      ecalEnergy += constituent->Eem;
-      hcalEnergy += constituent->Ehad;
-    }
+      itConstituents.Reset();
+      entry->Constituents.Clear();
+      ecalEnergy = 0.0;
+      hcalEnergy = 0.0;
+      while((constituent = static_cast<Candidate *>(itConstituents.Next())))
+      {
+        entry->Constituents.Add(constituent);
+        ecalEnergy += constituent->Eem;
+        hcalEnergy += constituent->Ehad;
+      }
 
-    entry->EhadOverEem = ecalEnergy > 0.0 ? hcalEnergy / ecalEnergy : 999.9;
+      entry->EhadOverEem = ecalEnergy > 0.0 ? hcalEnergy / ecalEnergy : 999.9;
+    }
 
     //---   Pile-Up Jet ID variables ----
 
@@ -1195,7 +1306,7 @@ void TreeWriter::ProcessJets(ExRootTreeBranch *branch, TObjArray *array)
     entry->ExclYmerge45 = candidate->ExclYmerge45;
     entry->ExclYmerge56 = candidate->ExclYmerge56;
 
-    FillParticles(candidate, &entry->Particles);
+    if(fillParticles) FillParticles(candidate, &entry->Particles);
   }
 }
 
@@ -1324,7 +1435,9 @@ void TreeWriter::Process()
     method = itBranchMap->second.first;
     array = itBranchMap->second.second;
 
+    fFields = &fFieldMap[branch];
     (this->*method)(branch, array);
+    fFields = 0;
   }
 }
 
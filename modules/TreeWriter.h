@@ -23,13 +23,26 @@
  *
  *  Fills ROOT tree branches.
  *
+ *  A branch can be restricted to a list of fields,
+ *  add Branch EFlowMerger/eflow ParticleFlowCandidate ParticleFlowCandidate {PT Eta Phi E}
+ *  in which case the other fields are neither computed nor written.
+ *
+ *  With "set FlatLayout true" in the main configuration, every branch,
+ *  including the Event and Weight branches of the readers, is written as
+ *  one variable length array per field (Jet_PT[Jet_size], ...) instead of
+ *  a split TClonesArray, which can be read without the Delphes dictionaries.
+ *  BasketSize, CompressionAlgorithm (ZLIB, LZMA, LZ4 or ZSTD)
+ *  and CompressionLevel tune the output branches.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
 
 #include "classes/DelphesModule.h"
 #include "TLorentzVector.h"
+#include "TString.h"
 #include <map>
+#include <set>
 
 class TClass;
 class TObjArray;
@@ -49,6 +62,8 @@ public:
   void Finish();
 
 private:
+  Bool_t IsSelected(const char *field) const;
+
   void FillParticles(Candidate *candidate, TRefArray *array, bool verbose=false);
   std::pair<TLorentzVector,TLorentzVector> FillParticlesCustom(Candidate *candidate, TRefArray *array, bool verbose=false);
   TLorentzVector findGenParticleCustom(Candidate *candidate, TRefArray *array, bool verbose=false);
@@ -77,6 +92,11 @@ private:
   TBranchMap fBranchMap; //!
 
   std::map<TClass *, TProcessMethod> fClassMap; //!
+
+  // selected fields of each branch, empty if all fields are written
+  std::map<ExRootTreeBranch *, std::set<TString> > fFieldMap; //!
+
+  const std::set<TString> *fFields; //!
 #endif
 
   ClassDef(TreeWriter, 2)
@@ -46,6 +46,9 @@ public:
   void Process();
   void Finish();
 
+  // only selects imported candidates
+  Bool_t IsReadOnly() const { return kTRUE; }
+
 private:
   Bool_t fUseUniqueID;
 
@@ -27,6 +27,7 @@ public:
   void Process();
   void Finish();
 
+
   void clusterize(const TObjArray &tracks, TObjArray &clusters);
   std::vector<Candidate *> vertices();
 
@@ -151,6 +151,13 @@ class AnalysisEvent(TChain):
      if name in self.vardict:
        delattr(self,name)
 
+   def columns(self, columns):
+     """Return a DelphesColumns.ColumnReader over the same files.
+        It reads the given "Branch.Field" columns of many events at once into NumPy arrays,
+        for vectorized analyses that do not need the per-event facilities."""
+     from DelphesColumns import ColumnReader
+     return ColumnReader(self, columns)
+
    def event(self):
      """Event number"""
      if self._branches["Event"]:
@@ -0,0 +1,93 @@
+"""Bulk columnar access to Delphes trees.
+
+Reads selected numeric fields ("Branch.Field") of many entries at once into
+NumPy arrays, through the DelphesColumnReader class of libDelphes.
+Floating point fields are returned as float64 arrays, integer fields as
+int64 arrays, or uint64 for unsigned 64 bit fields.
+For each branch, the array named after the branch holds the offsets of the
+entries read: the objects of the i-th entry are at offsets[i]:offsets[i+1]
+of the arrays of the branch fields.
+
+Example:
+  reader = ColumnReader("delphes_output.root", ["Jet.PT", "Jet.Eta"])
+  for columns in reader.iterate(100000):
+    offsets, pt = columns["Jet"], columns["Jet.PT"]
+    leadingPT = pt[offsets[:-1][offsets[1:] > offsets[:-1]]]
+"""
+
+import numpy
+import ROOT
+
+ROOT.gSystem.Load("libDelphes")
+
+def toArray(vector, dtype):
+  """Copy the contents of a std::vector into a NumPy array."""
+  size = vector.size()
+  if size == 0:
+    return numpy.zeros(0, dtype)
+  data = vector.data()
+  # the buffers returned by older PyROOT versions do not know their size
+  if hasattr(data, "SetSize"):
+    data.SetSize(size)
+  return numpy.frombuffer(data, dtype, size).copy()
+
+class ColumnReader(object):
+  """Reads selected fields of a Delphes tree into NumPy arrays.
+     inputFiles is a file name, a list of file names or a TChain, whose files are
+     read through a separate chain so that its own branches are left untouched.
+     columns is a list of "Branch.Field" names, for example "Jet.PT"."""
+
+  def __init__(self, inputFiles, columns, treeName="Delphes"):
+    self._chain = ROOT.TChain(treeName)
+    if isinstance(inputFiles, ROOT.TChain):
+      self._chain.Add(inputFiles)
+    elif isinstance(inputFiles, str):
+      self._chain.Add(inputFiles)
+    else:
+      for inputFile in inputFiles:
+        self._chain.Add(inputFile)
+    self._reader = ROOT.DelphesColumnReader(self._chain)
+    self._columns = []
+    self._branches = []
+    for column in columns:
+      if not "." in column:
+        raise ValueError("%r is not a Branch.Field column name" % column)
+      branch, field = column.split(".", 1)
+      self._reader.AddColumn(branch, field)
+      self._columns.append((column, branch, field))
+      if not branch in self._branches:
+        self._branches.append(branch)
+
+  def entries(self):
+    """Number of entries of the tree."""
+    return self._reader.GetEntries()
+
+  def read(self, first=0, size=-1):
+    """Read up to size entries starting at first, or up to the last entry if size < 0.
+       Returns a dictionary with the offsets of each branch and the values of each column."""
+    self._reader.ReadEntries(first, size)
+    return self._arrays()
+
+  def iterate(self, step=100000, first=0):
+    """Iterate over the tree by chunks of step entries, yielding the dictionaries of read()."""
+    while True:
+      entries = self._reader.ReadEntries(first, step)
+      if entries <= 0:
+        break
+      yield self._arrays()
+      first += entries
+
+  def _arrays(self):
+    arrays = {}
+    for branch in self._branches:
+      arrays[branch] = toArray(self._reader.GetOffsets(branch), numpy.int64)
+    for column, branch, field in self._columns:
+      columnType = self._reader.GetColumnType(branch, field)
+      if not ROOT.DelphesColumnReader.IsIntegerType(columnType):
+        arrays[column] = toArray(self._reader.GetColumn(branch, field), numpy.float64)
+      elif columnType in (ROOT.kULong_t, ROOT.kULong64_t):
+        # the bit patterns of the unsigned values are stored as Long64_t
+        arrays[column] = toArray(self._reader.GetIntegerColumn(branch, field), numpy.int64).view(numpy.uint64)
+      else:
+        arrays[column] = toArray(self._reader.GetIntegerColumn(branch, field), numpy.int64)
+    return arrays
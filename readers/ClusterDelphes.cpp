@@ -13,13 +13,14 @@
 
 #include "TFile.h"
 #include "TTree.h"
-#include "TLeaf.h"
 #include "TLorentzVector.h"
 
 #include "ExRootAnalysis/ExRootProgressBar.h"
 #include "ExRootAnalysis/ExRootTreeBranch.h"
 #include "ExRootAnalysis/ExRootTreeWriter.h"
 
+#include "classes/DelphesPapuReader.h"
+
 #include "fastjet/ClusterSequence.hh"
 #include "fastjet/ClusterSequenceArea.hh"
 #include "fastjet/JetDefinition.hh"
@@ -48,23 +49,6 @@ using namespace fastjet::contrib;
 
 static int NMAX = 1000;
 
-//---------------------------------------------------------------------------
-
-
-struct PFCand
-{
-  float pt = 0;
-  float eta = 0;
-  float phi = 0;
-  float e = 0;
-  float puppi = 1;
-  float charge = 1;
-  float hardfrac = 1;  
-  float vtxid = -1;
-};
-
-
-
 //---------------------------------------------------------------------------
 
 int main(int argc, char *argv[])
@@ -73,7 +57,7 @@ int main(int argc, char *argv[])
   srand(time(NULL));
 
   if(argc < 3) {
-    cout << " Usage: " << "PapuDelphes" << " input_file"
+    cout << " Usage: " << "ClusterDelphes" << " input_file"
          << " output_file" << endl;
     cout << " input_file - input file in ROOT format," << endl;
     cout << " output_file - output file in ROOT format" << endl;
@@ -89,14 +73,15 @@ int main(int argc, char *argv[])
   auto* fout = TFile::Open(argv[2], "RECREATE");
   auto* tout = new TTree("events", "events");
 
-  unsigned int nevt = itree->GetEntries();
-  TBranch* partbranch = (TBranch*)itree->GetBranch("Particle");
-  TBranch* pfbranch = (TBranch*)itree->GetBranch("ParticleFlowCandidate");
-  TBranch* genjetbranch = (TBranch*)itree->GetBranch("GenJet");
+  // only get leading gen jet
+  DelphesPapuReader reader(itree, DelphesPapuReader::kParticles | DelphesPapuReader::kGenJets);
+  reader.SetMaxGenJets(1);
+
+  unsigned int nevt = reader.GetEntries();
   std::cout << "NEVT: " << nevt << std::endl;
-  vector<PFCand> input_particles;
+  PapuEvent event;
 
-  vector<PFCand> output_particles;
+  vector<PapuParticle> output_particles;
   output_particles.reserve(NMAX);
 
   vector<float> vpt, veta, vphi, ve, vpuppi, vpdgid, vhardfrac;
@@ -110,22 +95,22 @@ int main(int argc, char *argv[])
   float pfjetpt=-99., pfjeteta=-99., pfjetphi=-99., pfjetm=-99.;
 
   // jet branches
-  TBranch* b_genjetpt = tout->Branch("genjetpt",&genjetpt, "genjetpt/F");
-  TBranch* b_genjeteta = tout->Branch("genjeteta",&genjeteta, "genjeteta/F");
-  TBranch* b_genjetphi = tout->Branch("genjetphi",&genjetphi, "genjetphi/F");
-  TBranch* b_genjetm = tout->Branch("genjetm",&genjetm, "genjetm/F");
-  TBranch* b_puppijetpt = tout->Branch("puppijetpt",&puppijetpt, "puppijetpt/F");
-  TBranch* b_puppijeteta = tout->Branch("puppijeteta",&puppijeteta, "puppijeteta/F");
-  TBranch* b_puppijetphi = tout->Branch("puppijetphi",&puppijetphi, "puppijetphi/F");
-  TBranch* b_puppijetm = tout->Branch("puppijetm",&puppijetm, "puppijetm/F");
-  TBranch* b_truthjetpt = tout->Branch("truthjetpt",&truthjetpt, "truthjetpt/F");
-  TBranch* b_truthjeteta = tout->Branch("truthjeteta",&truthjeteta, "truthjeteta/F");
-  TBranch* b_truthjetphi = tout->Branch("truthjetphi",&truthjetphi, "truthjetphi/F");
-  TBranch* b_truthjetm = tout->Branch("truthjetm",&truthjetm, "truthjetm/F");
-  TBranch* b_pfjetpt = tout->Branch("pfjetpt",&pfjetpt, "pfjetpt/F");
-  TBranch* b_pfjeteta = tout->Branch("pfjeteta",&pfjeteta, "pfjeteta/F");
-  TBranch* b_pfjetphi = tout->Branch("pfjetphi",&pfjetphi, "pfjetphi/F");
-  TBranch* b_pfjetm = tout->Branch("pfjetm",&pfjetm, "pfjetm/F");
+  tout->Branch("genjetpt",&genjetpt, "genjetpt/F");
+  tout->Branch("genjeteta",&genjeteta, "genjeteta/F");
+  tout->Branch("genjetphi",&genjetphi, "genjetphi/F");
+  tout->Branch("genjetm",&genjetm, "genjetm/F");
+  tout->Branch("puppijetpt",&puppijetpt, "puppijetpt/F");
+  tout->Branch("puppijeteta",&puppijeteta, "puppijeteta/F");
+  tout->Branch("puppijetphi",&puppijetphi, "puppijetphi/F");
+  tout->Branch("puppijetm",&puppijetm, "puppijetm/F");
+  tout->Branch("truthjetpt",&truthjetpt, "truthjetpt/F");
+  tout->Branch("truthjeteta",&truthjeteta, "truthjeteta/F");
+  tout->Branch("truthjetphi",&truthjetphi, "truthjetphi/F");
+  tout->Branch("truthjetm",&truthjetm, "truthjetm/F");
+  tout->Branch("pfjetpt",&pfjetpt, "pfjetpt/F");
+  tout->Branch("pfjeteta",&pfjeteta, "pfjeteta/F");
+  tout->Branch("pfjetphi",&pfjetphi, "pfjetphi/F");
+  tout->Branch("pfjetm",&pfjetm, "pfjetm/F");
   // PF cand branches
   tout->Branch("pt", &vpt);
   tout->Branch("eta", &veta);
@@ -137,8 +122,6 @@ int main(int argc, char *argv[])
 
 
   ExRootProgressBar progressBar(nevt);
-  
-  auto comp_p4 = [](auto &a, auto &b) { return a.pt > b.pt; };
 
   fastjet::JetDefinition *jetDef = new fastjet::JetDefinition(fastjet::antikt_algorithm,0.8);
 
@@ -150,54 +133,26 @@ int main(int argc, char *argv[])
   fastjet::contrib::SoftDrop softDrop = fastjet::contrib::SoftDrop(sdBeta,sdZcut,radius);
 
   for (unsigned int k=0; k<nevt; k++){
-    itree->GetEntry(k);
+    reader.ReadEntry(k, event);
 
     if (k%100==0)
       std::cout << k << " / " << nevt << std::endl;
 
-    unsigned int ngenjets = genjetbranch->GetEntries();
-    ngenjets = itree->GetLeaf("GenJet_size")->GetValue(0);
     TLorentzVector genjet;
-    for (unsigned int j=0; j<ngenjets; j++){
-      genjet.SetPtEtaPhiM(itree->GetLeaf("GenJet.PT")->GetValue(j),itree->GetLeaf("GenJet.Eta")->GetValue(j),itree->GetLeaf("GenJet.Phi")->GetValue(j),itree->GetLeaf("GenJet.Mass")->GetValue(j));
+    if (!event.genJets.empty()){
+      genjet = event.genJets[0];
       genjetpt = genjet.Pt();
       genjeteta = genjet.Eta();
       genjetphi = genjet.Phi();
       genjetm = genjet.M();
-      break;// only get leading gen jet
     }
 
-    input_particles.clear();
-    unsigned int npfs = pfbranch->GetEntries();
-    npfs = itree->GetLeaf("ParticleFlowCandidate_size")->GetValue(0);
-
-    for (unsigned int j=0; j<npfs; j++){
-      PFCand tmppf;
-      tmppf.pt = itree->GetLeaf("ParticleFlowCandidate.PT")->GetValue(j);
-      tmppf.eta = itree->GetLeaf("ParticleFlowCandidate.Eta")->GetValue(j);
-      tmppf.phi = itree->GetLeaf("ParticleFlowCandidate.Phi")->GetValue(j);
-      tmppf.e = itree->GetLeaf("ParticleFlowCandidate.E")->GetValue(j);
-      tmppf.puppi = itree->GetLeaf("ParticleFlowCandidate.PuppiW")->GetValue(j);
-      tmppf.hardfrac = itree->GetLeaf("ParticleFlowCandidate.hardfrac")->GetValue(j);
-      if (itree->GetLeaf("ParticleFlowCandidate.Charge")->GetValue(j)!=0){
-        if (itree->GetLeaf("ParticleFlowCandidate.hardfrac")->GetValue(j)==1)
-          tmppf.vtxid = 0;
-        else
-          tmppf.vtxid = 1;
-      }
-      else
-        tmppf.vtxid = -1;
-      input_particles.push_back(tmppf);
-    }
-
-    // sorting input particles by pT
-    sort(input_particles.begin(), input_particles.end(), comp_p4);
-
+    // input particles are sorted by pT
     vector<fastjet::PseudoJet> finalStates_puppi;
     vector<fastjet::PseudoJet> finalStates_truth;
     vector<fastjet::PseudoJet> finalStates_pf;
     int pfid = 0;
-    for(auto &p : input_particles){
+    for(auto &p : event.particles){
       if (p.vtxid==1)
 	continue; // Charged Hadron Subtraction
       TLorentzVector tmp;
@@ -343,14 +343,16 @@ int main(int argc, char *argv[])
       throw runtime_error(message.str());
     }
 
+    confReader = new ExRootConfReader;
+    confReader->ReadFile(argv[1]);
+
     treeWriter = new ExRootTreeWriter(outputFile, "Delphes");
+    // the layout applies to all branches, including the ones created here
+    treeWriter->SetFlatLayout(confReader->GetBool("::FlatLayout", false));
 
     branchEvent = treeWriter->NewBranch("Event", HepMCEvent::Class());
     branchWeight = treeWriter->NewBranch("Weight", Weight::Class());
 
-    confReader = new ExRootConfReader;
-    confReader->ReadFile(argv[1]);
-
     modularDelphes = new Delphes("Delphes");
     modularDelphes->SetConfReader(confReader);
     modularDelphes->SetTreeWriter(treeWriter);
@@ -33,7 +33,9 @@
 #include "TStopwatch.h"
 
 #include "classes/DelphesClasses.h"
+#include "classes/DelphesEventIndex.h"
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesInputStream.h"
 #include "classes/DelphesHepMCReader.h"
 #include "modules/Delphes.h"
 
@@ -58,6 +60,7 @@ int main(int argc, char *argv[])
 {
   char appName[] = "DelphesHepMC";
   stringstream message;
+  DelphesInputStream *inputStream = 0;
   FILE *inputFile = 0;
   TFile *outputFile = 0;
   TStopwatch readStopWatch, procStopWatch;
@@ -68,8 +71,9 @@ int main(int argc, char *argv[])
   DelphesFactory *factory = 0;
   TObjArray *stableParticleOutputArray = 0, *allParticleOutputArray = 0, *partonOutputArray = 0;
   DelphesHepMCReader *reader = 0;
-  Int_t i, maxEvents, skipEvents;
-  Long64_t length, eventCounter;
+  Int_t i, maxEvents, skipEvents, readAheadEvents;
+  Long64_t length, eventCounter, indexedEvents;
+  Bool_t useEventIndex;
 
   if(argc < 3)
   {
@@ -101,16 +105,20 @@ int main(int argc, char *argv[])
       throw runtime_error(message.str());
     }
 
+    confReader = new ExRootConfReader;
+    confReader->ReadFile(argv[1]);
+
     treeWriter = new ExRootTreeWriter(outputFile, "Delphes");
+    // the layout applies to all branches, including the ones created here
+    treeWriter->SetFlatLayout(confReader->GetBool("::FlatLayout", false));
 
     branchEvent = treeWriter->NewBranch("Event", HepMCEvent::Class());
     branchWeight = treeWriter->NewBranch("Weight", Weight::Class());
 
-    confReader = new ExRootConfReader;
-    confReader->ReadFile(argv[1]);
-
     maxEvents = confReader->GetInt("::MaxEvents", 0);
     skipEvents = confReader->GetInt("::SkipEvents", 0);
+    readAheadEvents = confReader->GetInt("::ReadAheadEvents", 0);
+    useEventIndex = confReader->GetBool("::EventIndex", true);
 
     if(maxEvents < 0)
     {
@@ -122,6 +130,11 @@ int main(int argc, char *argv[])
       throw runtime_error("SkipEvents must be zero or positive");
     }
 
+    if(readAheadEvents < 0)
+    {
+      throw runtime_error("ReadAheadEvents must be zero or positive");
+    }
+
     modularDelphes = new Delphes("Delphes");
     modularDelphes->SetConfReader(confReader);
     modularDelphes->SetTreeWriter(treeWriter);
@@ -132,6 +145,7 @@ int main(int argc, char *argv[])
     partonOutputArray = modularDelphes->ExportArray("partons");
 
     reader = new DelphesHepMCReader;
+    reader->SetReadAhead(readAheadEvents);
 
     modularDelphes->InitTask();
 
@@ -143,30 +157,47 @@ int main(int argc, char *argv[])
       if(i == argc || strncmp(argv[i], "-", 2) == 0)
       {
         cout << "** Reading standard input" << endl;
-        inputFile = stdin;
-        length = -1;
+        inputStream = new DelphesInputStream(0);
       }
       else
       {
         cout << "** Reading " << argv[i] << endl;
-        inputFile = fopen(argv[i], "r");
+        inputStream = new DelphesInputStream(argv[i]);
 
-        if(inputFile == NULL)
+        if(inputStream->GetSize() <= 0)
         {
-          message << "can't open " << argv[i];
-          throw runtime_error(message.str());
+          delete inputStream;
+          inputStream = 0;
+          ++i;
+          continue;
         }
+      }
 
-        fseek(inputFile, 0L, SEEK_END);
-        length = ftello(inputFile);
-        fseek(inputFile, 0L, SEEK_SET);
+      if(inputStream->GetCompression() != DelphesInputStream::kNone)
+      {
+        cout << "** Decompressing " << inputStream->GetCompressionName() << " input" << endl;
+      }
+
+      inputFile = inputStream->GetFile();
+      length = inputStream->GetSize();
+
+      // seek to the first processed event instead of parsing the skipped ones,
+      // the standard input (possibly a pipe) and compressed files are parsed
+      indexedEvents = 0;
+      if(useEventIndex && skipEvents > 0 && i < argc && strncmp(argv[i], "-", 2) != 0
+        && inputStream->GetCompression() == DelphesInputStream::kNone)
+      {
+        DelphesEventIndex index(argv[i], "E ");
 
-        if(length <= 0)
+        if(index.IsScanned())
         {
-          fclose(inputFile);
-          ++i;
-          continue;
+          cout << "** Indexed " << index.GetEntries() << " events" << endl;
         }
+
+        indexedEvents = index.GetEntries();
+        if(indexedEvents > skipEvents) indexedEvents = skipEvents;
+
+        fseeko(inputFile, index.GetOffset(indexedEvents), SEEK_SET);
       }
 
       reader->SetInputFile(inputFile);
@@ -174,7 +205,7 @@ int main(int argc, char *argv[])
       ExRootProgressBar progressBar(length);
 
       // Loop over all objects
-      eventCounter = 0;
+      eventCounter = indexedEvents;
       treeWriter->Clear();
       modularDelphes->Clear();
       reader->Clear();
@@ -206,14 +237,22 @@ int main(int argc, char *argv[])
 
           readStopWatch.Start();
         }
-        progressBar.Update(ftello(inputFile), eventCounter);
+        progressBar.Update(inputStream->GetPosition(), eventCounter);
+      }
+
+      reader->StopReadAhead();
+
+      if(ferror(inputFile))
+      {
+        message << "can't read " << (i == argc ? "standard input" : argv[i]);
+        throw runtime_error(message.str());
       }
 
-      fseek(inputFile, 0L, SEEK_END);
-      progressBar.Update(ftello(inputFile), eventCounter, kTRUE);
+      progressBar.Update(length, eventCounter, kTRUE);
       progressBar.Finish();
 
-      if(inputFile != stdin) fclose(inputFile);
+      delete inputStream;
+      inputStream = 0;
 
       ++i;
     } while(i < argc);
@@ -34,6 +34,7 @@
 
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesInputStream.h"
 #include "classes/DelphesLHEFReader.h"
 #include "modules/Delphes.h"
 
@@ -58,6 +59,7 @@ int main(int argc, char *argv[])
 {
   char appName[] = "DelphesLHEF";
   stringstream message;
+  DelphesInputStream *inputStream = 0;
   FILE *inputFile = 0;
   TFile *outputFile = 0;
   TStopwatch readStopWatch, procStopWatch;
@@ -68,7 +70,7 @@ int main(int argc, char *argv[])
   DelphesFactory *factory = 0;
   TObjArray *stableParticleOutputArray = 0, *allParticleOutputArray = 0, *partonOutputArray = 0;
   DelphesLHEFReader *reader = 0;
-  Int_t i, maxEvents, skipEvents;
+  Int_t i, maxEvents, skipEvents, readAheadEvents;
   Long64_t length, eventCounter;
 
   if(argc < 3)
@@ -101,16 +103,19 @@ int main(int argc, char *argv[])
       throw runtime_error(message.str());
     }
 
+    confReader = new ExRootConfReader;
+    confReader->ReadFile(argv[1]);
+
     treeWriter = new ExRootTreeWriter(outputFile, "Delphes");
+    // the layout applies to all branches, including the ones created here
+    treeWriter->SetFlatLayout(confReader->GetBool("::FlatLayout", false));
 
     branchEvent = treeWriter->NewBranch("Event", LHEFEvent::Class());
     branchWeight = treeWriter->NewBranch("Weight", LHEFWeight::Class());
 
-    confReader = new ExRootConfReader;
-    confReader->ReadFile(argv[1]);
-
     maxEvents = confReader->GetInt("::MaxEvents", 0);
     skipEvents = confReader->GetInt("::SkipEvents", 0);
+    readAheadEvents = confReader->GetInt("::ReadAheadEvents", 0);
 
     if(maxEvents < 0)
     {
@@ -122,6 +127,11 @@ int main(int argc, char *argv[])
       throw runtime_error("SkipEvents must be zero or positive");
     }
 
+    if(readAheadEvents < 0)
+    {
+      throw runtime_error("ReadAheadEvents must be zero or positive");
+    }
+
     modularDelphes = new Delphes("Delphes");
     modularDelphes->SetConfReader(confReader);
     modularDelphes->SetTreeWriter(treeWriter);
@@ -132,6 +142,7 @@ int main(int argc, char *argv[])
     partonOutputArray = modularDelphes->ExportArray("partons");
 
     reader = new DelphesLHEFReader;
+    reader->SetReadAhead(readAheadEvents);
 
     modularDelphes->InitTask();
 
@@ -143,32 +154,30 @@ int main(int argc, char *argv[])
       if(i == argc || strncmp(argv[i], "-", 2) == 0)
       {
         cout << "** Reading standard input" << endl;
-        inputFile = stdin;
-        length = -1;
+        inputStream = new DelphesInputStream(0);
       }
       else
       {
         cout << "** Reading " << argv[i] << endl;
-        inputFile = fopen(argv[i], "r");
+        inputStream = new DelphesInputStream(argv[i]);
 
-        if(inputFile == NULL)
+        if(inputStream->GetSize() <= 0)
         {
-          message << "can't open " << argv[i];
-          throw runtime_error(message.str());
-        }
-
-        fseek(inputFile, 0L, SEEK_END);
-        length = ftello(inputFile);
-        fseek(inputFile, 0L, SEEK_SET);
-
-        if(length <= 0)
-        {
-          fclose(inputFile);
+          delete inputStream;
+          inputStream = 0;
           ++i;
           continue;
         }
       }
 
+      if(inputStream->GetCompression() != DelphesInputStream::kNone)
+      {
+        cout << "** Decompressing " << inputStream->GetCompressionName() << " input" << endl;
+      }
+
+      inputFile = inputStream->GetFile();
+      length = inputStream->GetSize();
+
       reader->SetInputFile(inputFile);
 
       ExRootProgressBar progressBar(length);
@@ -207,14 +216,22 @@ int main(int argc, char *argv[])
 
           readStopWatch.Start();
         }
-        progressBar.Update(ftello(inputFile), eventCounter);
+        progressBar.Update(inputStream->GetPosition(), eventCounter);
+      }
+
+      reader->StopReadAhead();
+
+      if(ferror(inputFile))
+      {
+        message << "can't read " << (i == argc ? "standard input" : argv[i]);
+        throw runtime_error(message.str());
       }
 
-      fseek(inputFile, 0L, SEEK_END);
-      progressBar.Update(ftello(inputFile), eventCounter, kTRUE);
+      progressBar.Update(length, eventCounter, kTRUE);
       progressBar.Finish();
 
-      if(inputFile != stdin) fclose(inputFile);
+      delete inputStream;
+      inputStream = 0;
 
       ++i;
     } while(i < argc);
@@ -69,7 +69,6 @@ int main(int argc, char *argv[])
 {
   char appName[] = "DelphesROOT";
   stringstream message;
-  TFile *inputFile = 0;
   TFile *outputFile = 0;
   TStopwatch eventStopWatch;
   ExRootTreeWriter *treeWriter = 0;
@@ -85,8 +84,11 @@ int main(int argc, char *argv[])
   const Double_t c_light = 2.99792458E8;
 
   TObjArray *allParticleOutputArray = 0, *stableParticleOutputArray = 0, *partonOutputArray = 0;
+  TChain *chain = 0;
+  ExRootTreeReader *treeReader = 0;
+  TClonesArray *branchParticle = 0, *branchHepMCEvent = 0;
   Int_t i;
-  Long64_t eventCounter, numberOfEvents;
+  Long64_t entry, eventCounter, numberOfEvents;
 
   if(argc < 4)
   {
@@ -117,18 +119,20 @@ int main(int argc, char *argv[])
       throw runtime_error(message.str());
     }
 
+    confReader = new ExRootConfReader;
+    confReader->ReadFile(argv[1]);
+
     treeWriter = new ExRootTreeWriter(outputFile, "Delphes");
+    // the layout applies to all branches, including the ones created here
+    treeWriter->SetFlatLayout(confReader->GetBool("::FlatLayout", false));
 
     branchEvent = treeWriter->NewBranch("Event", HepMCEvent::Class());
 
-    confReader = new ExRootConfReader;
-    confReader->ReadFile(argv[1]);
-
     modularDelphes = new Delphes("Delphes");
     modularDelphes->SetConfReader(confReader);
     modularDelphes->SetTreeWriter(treeWriter);
 
-    TChain *chain = new TChain("Delphes");
+    chain = new TChain("Delphes");
 
     factory = modularDelphes->GetFactory();
     allParticleOutputArray = modularDelphes->ExportArray("allParticles");
@@ -137,117 +141,112 @@ int main(int argc, char *argv[])
 
     modularDelphes->InitTask();
 
-    for(i = 3; i < argc && !interrupted; ++i)
+    for(i = 3; i < argc; ++i)
     {
       cout << "** Reading " << argv[i] << endl;
 
-      chain->Add(argv[i]);
-      ExRootTreeReader *treeReader = new ExRootTreeReader(chain);
-
-      inputFile = TFile::Open(argv[i]);
-
-      if(inputFile == NULL)
+      // nentries = 0 opens the file now to check it
+      if(chain->Add(argv[i], 0) == 0)
       {
         message << "can't open " << argv[i] << endl;
         throw runtime_error(message.str());
       }
+    }
 
-      numberOfEvents = treeReader->GetEntries();
-      TClonesArray *branchParticle = treeReader->UseBranch("Particle");
-      TClonesArray *branchHepMCEvent = treeReader->UseBranch("Event");
+    // one reader for all input files, its tree cache is kept across files
+    treeReader = new ExRootTreeReader(chain);
+    treeReader->SetAsyncPrefetching(confReader->GetBool("::AsyncPrefetching", false));
 
-      if(numberOfEvents <= 0) continue;
+    branchParticle = treeReader->UseBranch("Particle");
+    branchHepMCEvent = treeReader->UseBranch("Event");
 
-      // ExRootProgressBar progressBar(numberOfEvents - 1);
-      ExRootProgressBar progressBar(-1);
+    numberOfEvents = treeReader->GetEntries();
 
-      // Loop over all objects
-      eventCounter = 0;
-      modularDelphes->Clear();
-      treeWriter->Clear();
-      for(Int_t entry = 0; entry < numberOfEvents && !interrupted; ++entry)
-      {
+    ExRootProgressBar progressBar(numberOfEvents);
 
-        treeReader->ReadEntry(entry);
+    // Loop over all objects
+    eventCounter = 0;
+    modularDelphes->Clear();
+    treeWriter->Clear();
+    for(entry = 0; entry < numberOfEvents && !interrupted; ++entry)
+    {
+      if(!treeReader->ReadEntry(entry)) break;
 
-        // -- TBC need also to include event weights --
+      // -- TBC need also to include event weights --
 
-        eve = (HepMCEvent *)branchHepMCEvent->At(0);
-        element = static_cast<HepMCEvent *>(branchEvent->NewEntry());
+      eve = (HepMCEvent *)branchHepMCEvent->At(0);
+      element = static_cast<HepMCEvent *>(branchEvent->NewEntry());
 
-        element->Number = eventCounter;
+      element->Number = eventCounter;
 
-        element->ProcessID = eve->ProcessID;
-        element->MPI = eve->MPI;
-        element->Weight = eve->Weight;
-        element->Scale = eve->Scale;
-        element->AlphaQED = eve->AlphaQED;
-        element->AlphaQCD = eve->AlphaQCD;
+      element->ProcessID = eve->ProcessID;
+      element->MPI = eve->MPI;
+      element->Weight = eve->Weight;
+      element->Scale = eve->Scale;
+      element->AlphaQED = eve->AlphaQED;
+      element->AlphaQCD = eve->AlphaQCD;
 
-        element->ID1 = eve->ID1;
-        element->ID2 = eve->ID2;
-        element->X1 = eve->X1;
-        element->X2 = eve->X2;
-        element->ScalePDF = eve->ScalePDF;
-        element->PDF1 = eve->PDF1;
-        element->PDF2 = eve->PDF2;
+      element->ID1 = eve->ID1;
+      element->ID2 = eve->ID2;
+      element->X1 = eve->X1;
+      element->X2 = eve->X2;
+      element->ScalePDF = eve->ScalePDF;
+      element->PDF1 = eve->PDF1;
+      element->PDF2 = eve->PDF2;
 
-        element->ReadTime = eve->ReadTime;
-        element->ProcTime = eve->ProcTime;
+      element->ReadTime = eve->ReadTime;
+      element->ProcTime = eve->ProcTime;
 
-        for(Int_t j = 0; j < branchParticle->GetEntriesFast(); j++)
-        {
+      for(Int_t j = 0; j < branchParticle->GetEntriesFast(); j++)
+      {
 
-          gen = (GenParticle *)branchParticle->At(j);
-          candidate = factory->NewCandidate();
+        gen = (GenParticle *)branchParticle->At(j);
+        candidate = factory->NewCandidate();
 
-          candidate->Momentum = gen->P4();
-          candidate->Position.SetXYZT(gen->X, gen->Y, gen->Z, gen->T * 1.0E3 * c_light);
+        candidate->Momentum = gen->P4();
+        candidate->Position.SetXYZT(gen->X, gen->Y, gen->Z, gen->T * 1.0E3 * c_light);
 
-          candidate->PID = gen->PID;
-          candidate->Status = gen->Status;
+        candidate->PID = gen->PID;
+        candidate->Status = gen->Status;
 
-          candidate->M1 = gen->M1;
-          candidate->M2 = gen->M2;
+        candidate->M1 = gen->M1;
+        candidate->M2 = gen->M2;
 
-          candidate->D1 = gen->D1;
-          candidate->D2 = gen->D2;
+        candidate->D1 = gen->D1;
+        candidate->D2 = gen->D2;
 
-          candidate->Charge = gen->Charge;
-          candidate->Mass = gen->Mass;
+        candidate->Charge = gen->Charge;
+        candidate->Mass = gen->Mass;
 
-          allParticleOutputArray->Add(candidate);
+        allParticleOutputArray->Add(candidate);
 
-          pdgCode = TMath::Abs(gen->PID);
+        pdgCode = TMath::Abs(gen->PID);
 
-          if(gen->Status == 1)
-          {
-            stableParticleOutputArray->Add(candidate);
-          }
-          else if(pdgCode <= 5 || pdgCode == 21 || pdgCode == 15)
-          {
-            partonOutputArray->Add(candidate);
-          }
+        if(gen->Status == 1)
+        {
+          stableParticleOutputArray->Add(candidate);
         }
+        else if(pdgCode <= 5 || pdgCode == 21 || pdgCode == 15)
+        {
+          partonOutputArray->Add(candidate);
+        }
+      }
 
-        modularDelphes->ProcessTask();
-
-        treeWriter->Fill();
+      modularDelphes->ProcessTask();
 
-        modularDelphes->Clear();
-        treeWriter->Clear();
+      treeWriter->Fill();
 
-        progressBar.Update(eventCounter, eventCounter);
-        ++eventCounter;
-      }
+      modularDelphes->Clear();
+      treeWriter->Clear();
 
-      progressBar.Update(eventCounter, eventCounter, kTRUE);
-      progressBar.Finish();
+      ++eventCounter;
+      progressBar.Update(eventCounter, eventCounter);
+    }
 
-      inputFile->Close();
+    progressBar.Update(eventCounter, eventCounter, kTRUE);
+    progressBar.Finish();
 
-      delete treeReader;
-    }
+    delete treeReader;
 
     modularDelphes->FinishTask();
     treeWriter->Write();
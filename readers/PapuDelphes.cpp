@@ -13,13 +13,16 @@
 
 #include "TFile.h"
 #include "TTree.h"
-#include "TLeaf.h"
 #include "TLorentzVector.h"
+#include "TMath.h"
+#include "TVector2.h"
 
 #include "ExRootAnalysis/ExRootProgressBar.h"
 #include "ExRootAnalysis/ExRootTreeBranch.h"
 #include "ExRootAnalysis/ExRootTreeWriter.h"
 
+#include "classes/DelphesPapuReader.h"
+
 #include "fastjet/ClusterSequence.hh"
 #include "fastjet/ClusterSequenceArea.hh"
 #include "fastjet/JetDefinition.hh"
@@ -49,18 +52,29 @@ using namespace fastjet::contrib;
 
 //---------------------------------------------------------------------------
 
-
-struct PFCand
+// fill the jet kinematics with the soft drop mass if the jet matches the
+// reference direction, only the matched jet is groomed
+bool 
+match_and_groom(vector<PseudoJet> &jets, double minpt, double refeta, double refphi, 
+                SoftDrop &softDrop, float &pt, float &eta, float &phi, float &m)
 {
-  float pt = 0;
-  float eta = 0;
-  float phi = 0;
-  float e = 0;
-  float puppi = 1;
-  float hardfrac = 1;  
-};
-
-
+  for (auto& jet : jets) {
+    if (jet.perp() < minpt)
+      break;
+
+    double deta = jet.eta() - refeta;
+    double dphi = TVector2::Phi_mpi_pi(jet.phi_std() - refphi);
+    if (deta*deta + dphi*dphi < 0.8*0.8){
+      PseudoJet sdJet = softDrop(jet);
+      pt = jet.perp();
+      eta = jet.eta();
+      phi = jet.phi_std();
+      m = sdJet.m();
+      return true;
+    }
+  }
+  return false;
+}
 
 //---------------------------------------------------------------------------
 
@@ -69,14 +83,28 @@ int main(int argc, char *argv[])
 
   srand(time(NULL));
 
-  if(argc < 3) {
+  if(argc < 3 || argc > 4) {
     cout << " Usage: " << "PapuDelphes" << " input_file"
-         << " output_file" << endl;
+         << " output_file" << " [strategy]" << endl;
     cout << " input_file - input file in ROOT format," << endl;
-    cout << " output_file - output file in ROOT format" << endl;
+    cout << " output_file - output file in ROOT format," << endl;
+    cout << " strategy - FastJet clustering strategy: Best (default), N2Tiled, N2Plain or NlnN" << endl;
     return 1;
   }
 
+  fastjet::Strategy strategy = fastjet::Best;
+  if (argc > 3) {
+    string name = argv[3];
+    if (name == "Best") strategy = fastjet::Best;
+    else if (name == "N2Tiled") strategy = fastjet::N2Tiled;
+    else if (name == "N2Plain") strategy = fastjet::N2Plain;
+    else if (name == "NlnN") strategy = fastjet::NlnN;
+    else {
+      cerr << "** ERROR: unknown clustering strategy '" << name << "'" << endl;
+      return 1;
+    }
+  }
+
   // figure out how to read the file here 
   //
 
@@ -86,33 +114,30 @@ int main(int argc, char *argv[])
   auto* fout = TFile::Open(argv[2], "RECREATE");
   auto* tout = new TTree("events", "events");
 
-  unsigned int nevt = itree->GetEntries();
-  TBranch* partbranch = (TBranch*)itree->GetBranch("Particle");
-  TBranch* pfbranch = (TBranch*)itree->GetBranch("ParticleFlowCandidate");
-  TBranch* genjetbranch = (TBranch*)itree->GetBranch("GenJet");
+  DelphesPapuReader reader(itree, DelphesPapuReader::kParticles | DelphesPapuReader::kGenJets | DelphesPapuReader::kHiggs);
+
+  unsigned int nevt = reader.GetEntries();
   std::cout << "NEVT: " << nevt << std::endl;
-  vector<PFCand> input_particles;
+  PapuEvent event;
 
   float genjetpt=-99., genjeteta=-99., genjetphi=-99., genjetm=-99.;
   float puppijetpt=-99., puppijeteta=-99., puppijetphi=-99., puppijetm=-99.;
   float truthjetpt=-99., truthjeteta=-99., truthjetphi=-99., truthjetm=-99.;
   
-  TBranch* b_genjetpt = tout->Branch("genjetpt",&genjetpt, "genjetpt/F");
-  TBranch* b_genjeteta = tout->Branch("genjeteta",&genjeteta, "genjeteta/F");
-  TBranch* b_genjetphi = tout->Branch("genjetphi",&genjetphi, "genjetphi/F");
-  TBranch* b_genjetm = tout->Branch("genjetm",&genjetm, "genjetm/F");
-  TBranch* b_puppijetpt = tout->Branch("puppijetpt",&puppijetpt, "puppijetpt/F");
-  TBranch* b_puppijeteta = tout->Branch("puppijeteta",&puppijeteta, "puppijeteta/F");
-  TBranch* b_puppijetphi = tout->Branch("puppijetphi",&puppijetphi, "puppijetphi/F");
-  TBranch* b_puppijetm = tout->Branch("puppijetm",&puppijetm, "puppijetm/F");
-  TBranch* b_truthjetpt = tout->Branch("truthjetpt",&truthjetpt, "truthjetpt/F");
-  TBranch* b_truthjeteta = tout->Branch("truthjeteta",&truthjeteta, "truthjeteta/F");
-  TBranch* b_truthjetphi = tout->Branch("truthjetphi",&truthjetphi, "truthjetphi/F");
-  TBranch* b_truthjetm = tout->Branch("truthjetm",&truthjetm, "truthjetm/F");
+  tout->Branch("genjetpt",&genjetpt, "genjetpt/F");
+  tout->Branch("genjeteta",&genjeteta, "genjeteta/F");
+  tout->Branch("genjetphi",&genjetphi, "genjetphi/F");
+  tout->Branch("genjetm",&genjetm, "genjetm/F");
+  tout->Branch("puppijetpt",&puppijetpt, "puppijetpt/F");
+  tout->Branch("puppijeteta",&puppijeteta, "puppijeteta/F");
+  tout->Branch("puppijetphi",&puppijetphi, "puppijetphi/F");
+  tout->Branch("puppijetm",&puppijetm, "puppijetm/F");
+  tout->Branch("truthjetpt",&truthjetpt, "truthjetpt/F");
+  tout->Branch("truthjeteta",&truthjeteta, "truthjeteta/F");
+  tout->Branch("truthjetphi",&truthjetphi, "truthjetphi/F");
+  tout->Branch("truthjetm",&truthjetm, "truthjetm/F");
 
   ExRootProgressBar progressBar(nevt);
-  
-  auto comp_p4 = [](auto &a, auto &b) { return a.pt > b.pt; };
 
   //int activeAreaRepeats = 1;
   //double ghostArea = 0.01;
@@ -120,7 +145,7 @@ int main(int argc, char *argv[])
 
   //fastjet::GhostedAreaSpec *activeArea = new fastjet::GhostedAreaSpec(ghostEtaMax,activeAreaRepeats,ghostArea);
   //fastjet::AreaDefinition *areaDef = new fastjet::AreaDefinition(fastjet::active_area_explicit_ghosts,*activeArea);
-  fastjet::JetDefinition *jetDef = new fastjet::JetDefinition(fastjet::antikt_algorithm,0.8);
+  fastjet::JetDefinition *jetDef = new fastjet::JetDefinition(fastjet::antikt_algorithm,0.8,fastjet::E_scheme,strategy);
 
   double radius = 0.8;
   double sdZcut = 0.1;
@@ -128,30 +153,20 @@ int main(int argc, char *argv[])
   
   fastjet::contrib::SoftDrop softDrop = fastjet::contrib::SoftDrop(sdBeta,sdZcut,radius);
 
+  vector<fastjet::PseudoJet> finalStates_puppi;
+  vector<fastjet::PseudoJet> finalStates_truth;
+
   for (unsigned int k=0; k<nevt; k++){
-    itree->GetEntry(k);
+    reader.ReadEntry(k, event);
     //if (k>100)
     //break;
 
     //if (k%100==0)
     //std::cout << k << " / " << nevt << std::endl;
 
-    TLorentzVector higgs;
-    higgs.SetPtEtaPhiE(0.,0.,0.,0.);
-    unsigned int nparts = partbranch->GetEntries();
-    nparts = itree->GetLeaf("Particle_size")->GetValue(0);
-    for (unsigned int j=0; j<nparts; j++){
-      if (itree->GetLeaf("Particle.PID")->GetValue(j)==25){
-	higgs.SetPtEtaPhiE(itree->GetLeaf("Particle.PT")->GetValue(j),itree->GetLeaf("Particle.Eta")->GetValue(j),itree->GetLeaf("Particle.Phi")->GetValue(j),itree->GetLeaf("Particle.E")->GetValue(j));
-	break;
-      }
-    }
-    
-    unsigned int ngenjets = genjetbranch->GetEntries();
-    ngenjets = itree->GetLeaf("GenJet_size")->GetValue(0);
-    for (unsigned int j=0; j<ngenjets; j++){
-      TLorentzVector tmpjet;
-      tmpjet.SetPtEtaPhiM(itree->GetLeaf("GenJet.PT")->GetValue(j),itree->GetLeaf("GenJet.Eta")->GetValue(j),itree->GetLeaf("GenJet.Phi")->GetValue(j),itree->GetLeaf("GenJet.Mass")->GetValue(j));
+    TLorentzVector &higgs = event.higgs;
+
+    for (auto &tmpjet : event.genJets){
       if (tmpjet.DeltaR(higgs)<0.8){
 	genjetpt = tmpjet.Pt();
 	genjeteta = tmpjet.Eta();
@@ -161,82 +176,31 @@ int main(int argc, char *argv[])
       }
     }
 
-    input_particles.clear();
-    unsigned int npfs = pfbranch->GetEntries();
-    npfs = itree->GetLeaf("ParticleFlowCandidate_size")->GetValue(0);
-
-    for (unsigned int j=0; j<npfs; j++){
-      PFCand tmppf;
-      tmppf.pt = itree->GetLeaf("ParticleFlowCandidate.PT")->GetValue(j);
-      tmppf.eta = itree->GetLeaf("ParticleFlowCandidate.Eta")->GetValue(j);
-      tmppf.phi = itree->GetLeaf("ParticleFlowCandidate.Phi")->GetValue(j);
-      tmppf.e = itree->GetLeaf("ParticleFlowCandidate.E")->GetValue(j);
-      tmppf.puppi = itree->GetLeaf("ParticleFlowCandidate.PuppiW")->GetValue(j);
-      tmppf.hardfrac = itree->GetLeaf("ParticleFlowCandidate.hardfrac")->GetValue(j);
-      input_particles.push_back(tmppf);
-    }
-
-    // sorting input particles by pT
-    sort(input_particles.begin(), input_particles.end(), comp_p4);
-
-    vector<fastjet::PseudoJet> finalStates_puppi;
-    vector<fastjet::PseudoJet> finalStates_truth;
-    vector<fastjet::PseudoJet> finalStates_pf;
-    for(auto &p : input_particles){
-      TLorentzVector tmp;
-      tmp.SetPtEtaPhiE(p.pt,p.eta,p.phi,p.e);
-      finalStates_pf.emplace_back(tmp.Px(), tmp.Py(), tmp.Pz(), tmp.E());
-      if (p.puppi>0.)
-	finalStates_puppi.emplace_back(p.puppi*tmp.Px(), p.puppi*tmp.Py(), p.puppi*tmp.Pz(), p.puppi*tmp.E());
-      if (p.hardfrac>0.)
-	finalStates_truth.emplace_back(p.hardfrac*tmp.Px(), p.hardfrac*tmp.Py(), p.hardfrac*tmp.Pz(), p.hardfrac*tmp.E());
-    }
-
-    fastjet::ClusterSequence seq_puppi(sorted_by_pt(finalStates_puppi), *jetDef);
-    fastjet::ClusterSequence seq_truth(sorted_by_pt(finalStates_truth), *jetDef);
-    //fastjet::ClusterSequence seq_pf(sorted_by_pt(finalStates_pf), *jetDef);
-
-    vector<fastjet::PseudoJet> allJets_puppi(sorted_by_pt(seq_puppi.inclusive_jets(400.)));
-    vector<fastjet::PseudoJet> allJets_truth(sorted_by_pt(seq_truth.inclusive_jets(400.)));
-    //vector<fastjet::PseudoJet> allJets_pf(sorted_by_pt(seq_pf.inclusive_jets(400.)));
-
-    //for (auto& pfJet : allJets_pf) {
-    //if (pfJet.m()<0 && pfJet.perp() > 400.)
-    //	std::cout << "WTF: " << pfJet.m() << std::endl;
-    //}
-
-    for (auto& puppiJet : allJets_puppi) {
-      if (puppiJet.perp() < 400.)
-	break;
-
-      fastjet::PseudoJet sdJet = (softDrop)(puppiJet);
-
-      TLorentzVector tmp;
-      tmp.SetPtEtaPhiM(puppiJet.perp(),puppiJet.eta(),puppiJet.phi(),sdJet.m());
-      if (tmp.DeltaR(higgs)<0.8){
-	puppijetpt = tmp.Pt();
-	puppijeteta = tmp.Eta();
-	puppijetphi = tmp.Phi();
-	puppijetm = tmp.M();
-	break;
+    // without a Higgs boson there is nothing to match
+    if (higgs.Pt()>0.){
+      // PseudoJets are built directly from (pt, eta, phi, e),
+      // the clustering does not need sorted inputs
+      finalStates_puppi.clear();
+      finalStates_truth.clear();
+      for(auto &p : event.particles){
+	double px = p.pt*TMath::Cos(p.phi);
+	double py = p.pt*TMath::Sin(p.phi);
+	double pz = p.pt*TMath::SinH(p.eta);
+	if (p.puppi>0.)
+	  finalStates_puppi.emplace_back(p.puppi*px, p.puppi*py, p.puppi*pz, p.puppi*p.e);
+	if (p.hardfrac>0.)
+	  finalStates_truth.emplace_back(p.hardfrac*px, p.hardfrac*py, p.hardfrac*pz, p.hardfrac*p.e);
       }
-    }
 
-    for (auto& truthJet : allJets_truth) {
-      if (truthJet.perp() < 400.)
-	break;
+      fastjet::ClusterSequence seq_puppi(finalStates_puppi, *jetDef);
+      fastjet::ClusterSequence seq_truth(finalStates_truth, *jetDef);
 
-      fastjet::PseudoJet sdJet = (softDrop)(truthJet);
+      vector<fastjet::PseudoJet> allJets_puppi(sorted_by_pt(seq_puppi.inclusive_jets(400.)));
+      vector<fastjet::PseudoJet> allJets_truth(sorted_by_pt(seq_truth.inclusive_jets(400.)));
 
-      TLorentzVector tmp;
-      tmp.SetPtEtaPhiM(truthJet.perp(),truthJet.eta(),truthJet.phi(),sdJet.m());
-      if (tmp.DeltaR(higgs)<0.8){
-	truthjetpt = tmp.Pt();
-	truthjeteta = tmp.Eta();
-	truthjetphi = tmp.Phi();
-	truthjetm = tmp.M();
-	break;
-      }
+      // match the jets to the Higgs boson before grooming
+      match_and_groom(allJets_puppi, 400., higgs.Eta(), higgs.Phi(), softDrop, puppijetpt, puppijeteta, puppijetphi, puppijetm);
+      match_and_groom(allJets_truth, 400., higgs.Eta(), higgs.Phi(), softDrop, truthjetpt, truthjeteta, truthjetphi, truthjetm);
     }
 
     tout->Fill();
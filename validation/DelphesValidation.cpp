@@ -17,6 +17,7 @@
  */
 
 #include <iostream>
+#include <map>
 #include <typeinfo>
 #include <utility>
 #include <vector>
@@ -42,6 +43,7 @@
 #include "TStyle.h"
 
 #include "classes/DelphesClasses.h"
+#include "classes/DelphesColumnReader.h"
 
 #include "ExRootAnalysis/ExRootResult.h"
 #include "ExRootAnalysis/ExRootTreeBranch.h"
@@ -770,141 +772,178 @@ TH1D *GetTauEffEta(TClonesArray *branchReco, TClonesArray *branchParticle, TStri
   return histRecoEta;
 }
 
+// gen-level quantities and reco/gen ratios of the reconstructed objects matched to a particle
+struct resolMatches
+{
+  std::vector<Float_t> genPT;
+  std::vector<Float_t> genE;
+  std::vector<Float_t> genEta;
+  std::vector<Double_t> ptRatio;
+  std::vector<Double_t> eRatio;
+};
+
+// field holding the transverse momentum used by P4() of the reconstructed objects
 template <typename T>
-void GetPtres(std::vector<resolPlot> *histos, TClonesArray *branchReco, TClonesArray *branchParticle, int pdgID, Double_t etaMin, Double_t etaMax, ExRootTreeReader *treeReader)
+const char *GetPTField()
 {
-  Long64_t allEntries = treeReader->GetEntries();
+  return "PT";
+}
 
-  cout << "** Computing pt resolution of " << branchReco->GetName() << " induced by " << branchParticle->GetName() << " with PID " << pdgID << endl;
+template <>
+const char *GetPTField<Tower>()
+{
+  return "ET";
+}
 
-  GenParticle *particle;
-  T *recoObj;
+template <typename T>
+resolMatches *GetResolMatches(TClonesArray *branchReco, TClonesArray *branchParticle, int pdgID, ExRootTreeReader *treeReader)
+{
+  static std::map<TString, resolMatches> cache;
 
-  TLorentzVector recoMomentum, genMomentum, bestGenMomentum;
+  const char *recoName = branchReco->GetName();
+  const char *particleName = branchParticle->GetName();
 
-  Float_t deltaR;
-  Float_t pt, eta;
-  Long64_t entry;
+  TString key = TString::Format("%p %s %s %d", static_cast<void *>(treeReader), recoName, particleName, pdgID);
 
-  Int_t i, j, bin;
+  std::map<TString, resolMatches>::iterator itCache = cache.find(key);
+  if(itCache != cache.end()) return &itCache->second;
 
-  // Loop over all events
-  for(entry = 0; entry < allEntries; ++entry)
-  {
-    // Load selected branches with data from specified event
-    treeReader->ReadEntry(entry);
+  resolMatches *matches = &cache[key];
 
-    // Loop over all reconstructed jets in event
-    for(i = 0; i < branchReco->GetEntriesFast(); ++i)
-    {
-      recoObj = (T *)branchReco->At(i);
-      recoMomentum = recoObj->P4();
+  cout << "** Matching " << recoName << " to " << particleName << " with PID " << pdgID << endl;
 
-      deltaR = 999;
+  // read the columns through a separate chain so that the branches of treeReader stay untouched
+  TChain chain("Delphes");
+  chain.Add(static_cast<TChain *>(treeReader->GetTree()));
 
-      // Loop over all hard partons in event
-      for(j = 0; j < branchParticle->GetEntriesFast(); ++j)
-      {
-        particle = (GenParticle *)branchParticle->At(j);
-        if(particle->PID == pdgID && particle->Status == 1)
-        {
-          genMomentum = particle->P4();
+  DelphesColumnReader columns(&chain);
 
-          // this is simply to avoid warnings from initial state particle
-          // having infite rapidity ...
-          if(genMomentum.Px() == 0 && genMomentum.Py() == 0) continue;
+  columns.AddColumn(recoName, GetPTField<T>());
+  columns.AddColumn(recoName, "Eta");
+  columns.AddColumn(recoName, "Phi");
 
-          // take the closest parton candidate
-          if(genMomentum.DeltaR(recoMomentum) < deltaR)
-          {
-            deltaR = genMomentum.DeltaR(recoMomentum);
-            bestGenMomentum = genMomentum;
-          }
-        }
-      }
+  columns.AddColumn(particleName, "PID");
+  columns.AddColumn(particleName, "Status");
+  columns.AddColumn(particleName, "Px");
+  columns.AddColumn(particleName, "Py");
+  columns.AddColumn(particleName, "Pz");
+  columns.AddColumn(particleName, "E");
 
-      if(deltaR < 0.3)
+  const std::vector<Long64_t> &recoOffsets = columns.GetOffsets(recoName);
+  const std::vector<Double_t> &recoPT = columns.GetColumn(recoName, GetPTField<T>());
+  const std::vector<Double_t> &recoEta = columns.GetColumn(recoName, "Eta");
+  const std::vector<Double_t> &recoPhi = columns.GetColumn(recoName, "Phi");
+
+  const std::vector<Long64_t> &particleOffsets = columns.GetOffsets(particleName);
+  const std::vector<Long64_t> &particlePID = columns.GetIntegerColumn(particleName, "PID");
+  const std::vector<Long64_t> &particleStatus = columns.GetIntegerColumn(particleName, "Status");
+  const std::vector<Double_t> &particlePx = columns.GetColumn(particleName, "Px");
+  const std::vector<Double_t> &particlePy = columns.GetColumn(particleName, "Py");
+  const std::vector<Double_t> &particlePz = columns.GetColumn(particleName, "Pz");
+  const std::vector<Double_t> &particleE = columns.GetColumn(particleName, "E");
+
+  TLorentzVector recoMomentum, genMomentum, bestGenMomentum;
+
+  Float_t deltaR;
+  Long64_t first, entry, entries, i, j;
+
+  for(first = 0; (entries = columns.ReadEntries(first, 10000)) > 0; first += entries)
+  {
+    for(entry = 0; entry < entries; ++entry)
+    {
+      // Loop over all reconstructed objects in event
+      for(i = recoOffsets[entry]; i < recoOffsets[entry + 1]; ++i)
       {
-        pt = bestGenMomentum.Pt();
-        eta = TMath::Abs(bestGenMomentum.Eta());
+        recoMomentum.SetPtEtaPhiM(recoPT[i], recoEta[i], recoPhi[i], 0.0);
 
-        for(bin = 0; bin < Nbins; bin++)
+        deltaR = 999;
+
+        // Loop over all hard partons in event
+        for(j = particleOffsets[entry]; j < particleOffsets[entry + 1]; ++j)
         {
-          if(pt > histos->at(bin).ptmin && pt < histos->at(bin).ptmax && eta > etaMin && eta < etaMax)
+          if(particlePID[j] == pdgID && particleStatus[j] == 1)
           {
-            histos->at(bin).resolHist->Fill(recoMomentum.Pt() / bestGenMomentum.Pt());
+            // this is simply to avoid warnings from initial state particle
+            // having infite rapidity ...
+            if(particlePx[j] == 0 && particlePy[j] == 0) continue;
+
+            genMomentum.SetPxPyPzE(particlePx[j], particlePy[j], particlePz[j], particleE[j]);
+
+            // take the closest parton candidate
+            if(genMomentum.DeltaR(recoMomentum) < deltaR)
+            {
+              deltaR = genMomentum.DeltaR(recoMomentum);
+              bestGenMomentum = genMomentum;
+            }
           }
         }
+
+        if(deltaR < 0.3)
+        {
+          matches->genPT.push_back(bestGenMomentum.Pt());
+          matches->genE.push_back(bestGenMomentum.E());
+          matches->genEta.push_back(bestGenMomentum.Eta());
+          matches->ptRatio.push_back(recoMomentum.Pt() / bestGenMomentum.Pt());
+          matches->eRatio.push_back(recoMomentum.E() / bestGenMomentum.E());
+        }
       }
     }
   }
+
+  return matches;
 }
 
 template <typename T>
-void GetEres(std::vector<resolPlot> *histos, TClonesArray *branchReco, TClonesArray *branchParticle, int pdgID, Double_t etaMin, Double_t etaMax, ExRootTreeReader *treeReader)
+void GetPtres(std::vector<resolPlot> *histos, TClonesArray *branchReco, TClonesArray *branchParticle, int pdgID, Double_t etaMin, Double_t etaMax, ExRootTreeReader *treeReader)
 {
-  Long64_t allEntries = treeReader->GetEntries();
-
-  cout << "** Computing e resolution of " << branchReco->GetName() << " induced by " << branchParticle->GetName() << " with PID " << pdgID << endl;
-
-  GenParticle *particle;
-  T *recoObj;
+  resolMatches *matches = GetResolMatches<T>(branchReco, branchParticle, pdgID, treeReader);
 
-  TLorentzVector recoMomentum, genMomentum, bestGenMomentum;
+  cout << "** Computing pt resolution of " << branchReco->GetName() << " induced by " << branchParticle->GetName() << " with PID " << pdgID << endl;
 
-  Float_t deltaR;
-  Float_t e, eta;
-  Long64_t entry;
+  Float_t pt, eta;
+  size_t i;
 
-  Int_t i, j, bin;
+  Int_t bin;
 
-  // Loop over all events
-  for(entry = 0; entry < allEntries; ++entry)
+  // Loop over all matched objects
+  for(i = 0; i < matches->genPT.size(); ++i)
   {
-    // Load selected branches with data from specified event
-    treeReader->ReadEntry(entry);
+    pt = matches->genPT[i];
+    eta = TMath::Abs(matches->genEta[i]);
 
-    // Loop over all reconstructed jets in event
-    for(i = 0; i < branchReco->GetEntriesFast(); ++i)
+    for(bin = 0; bin < Nbins; bin++)
     {
-      recoObj = (T *)branchReco->At(i);
-      recoMomentum = recoObj->P4();
+      if(pt > histos->at(bin).ptmin && pt < histos->at(bin).ptmax && eta > etaMin && eta < etaMax)
+      {
+        histos->at(bin).resolHist->Fill(matches->ptRatio[i]);
+      }
+    }
+  }
+}
 
-      deltaR = 999;
+template <typename T>
+void GetEres(std::vector<resolPlot> *histos, TClonesArray *branchReco, TClonesArray *branchParticle, int pdgID, Double_t etaMin, Double_t etaMax, ExRootTreeReader *treeReader)
+{
+  resolMatches *matches = GetResolMatches<T>(branchReco, branchParticle, pdgID, treeReader);
 
-      // Loop over all hard partons in event
-      for(j = 0; j < branchParticle->GetEntriesFast(); ++j)
-      {
-        particle = (GenParticle *)branchParticle->At(j);
-        if(particle->PID == pdgID && particle->Status == 1)
-        {
-          genMomentum = particle->P4();
+  cout << "** Computing e resolution of " << branchReco->GetName() << " induced by " << branchParticle->GetName() << " with PID " << pdgID << endl;
 
-          // this is simply to avoid warnings from initial state particle
-          // having infite rapidity ...
-          if(genMomentum.Px() == 0 && genMomentum.Py() == 0) continue;
+  Float_t e, eta;
+  size_t i;
 
-          // take the closest parton candidate
-          if(genMomentum.DeltaR(recoMomentum) < deltaR)
-          {
-            deltaR = genMomentum.DeltaR(recoMomentum);
-            bestGenMomentum = genMomentum;
-          }
-        }
-      }
+  Int_t bin;
 
-      if(deltaR < 0.3)
-      {
-        e = bestGenMomentum.E();
-        eta = TMath::Abs(bestGenMomentum.Eta());
+  // Loop over all matched objects
+  for(i = 0; i < matches->genE.size(); ++i)
+  {
+    e = matches->genE[i];
+    eta = TMath::Abs(matches->genEta[i]);
 
-        for(bin = 0; bin < Nbins; bin++)
-        {
-          if(e > histos->at(bin).ptmin && e < histos->at(bin).ptmax && eta > etaMin && eta < etaMax)
-          {
-            histos->at(bin).resolHist->Fill(recoMomentum.E() / bestGenMomentum.E());
-          }
-        }
+    for(bin = 0; bin < Nbins; bin++)
+    {
+      if(e > histos->at(bin).ptmin && e < histos->at(bin).ptmax && eta > etaMin && eta < etaMax)
+      {
+        histos->at(bin).resolHist->Fill(matches->eRatio[i]);
       }
     }
   }
@@ -913,68 +952,26 @@ void GetEres(std::vector<resolPlot> *histos, TClonesArray *branchReco, TClonesAr
 template <typename T>
 void GetPtresVsEta(std::vector<resolPlot> *histos, TClonesArray *branchReco, TClonesArray *branchParticle, int pdgID, Double_t ptMin, Double_t ptMax, ExRootTreeReader *treeReader)
 {
-  Long64_t allEntries = treeReader->GetEntries();
+  resolMatches *matches = GetResolMatches<T>(branchReco, branchParticle, pdgID, treeReader);
 
   cout << "** Computing pt resolution of " << branchReco->GetName() << " induced by " << branchParticle->GetName() << " with PID " << pdgID << endl;
 
-  GenParticle *particle;
-  T *recoObj;
-
-  TLorentzVector recoMomentum, genMomentum, bestGenMomentum;
-
-  Float_t deltaR;
   Float_t pt, eta;
-  Long64_t entry;
+  size_t i;
 
-  Int_t i, j, bin;
+  Int_t bin;
 
-  // Loop over all events
-  for(entry = 0; entry < allEntries; ++entry)
+  // Loop over all matched objects
+  for(i = 0; i < matches->genPT.size(); ++i)
   {
-    // Load selected branches with data from specified event
-    treeReader->ReadEntry(entry);
+    pt = matches->genPT[i];
+    eta = matches->genEta[i];
 
-    // Loop over all reconstructed jets in event
-    for(i = 0; i < branchReco->GetEntriesFast(); ++i)
+    for(bin = 0; bin < Nbins; bin++)
     {
-      recoObj = (T *)branchReco->At(i);
-      recoMomentum = recoObj->P4();
-
-      deltaR = 999;
-
-      // Loop over all hard partons in event
-      for(j = 0; j < branchParticle->GetEntriesFast(); ++j)
-      {
-        particle = (GenParticle *)branchParticle->At(j);
-        if(particle->PID == pdgID && particle->Status == 1)
-        {
-          genMomentum = particle->P4();
-
-          // this is simply to avoid warnings from initial state particle
-          // having infite rapidity ...
-          if(genMomentum.Px() == 0 && genMomentum.Py() == 0) continue;
-
-          // take the closest parton candidate
-          if(genMomentum.DeltaR(recoMomentum) < deltaR)
-          {
-            deltaR = genMomentum.DeltaR(recoMomentum);
-            bestGenMomentum = genMomentum;
-          }
-        }
-      }
-
-      if(deltaR < 0.3)
+      if(eta > histos->at(bin).etamin && eta < histos->at(bin).etamax && pt > ptMin && pt < ptMax)
       {
-        pt = bestGenMomentum.Pt();
-        eta = bestGenMomentum.Eta();
-
-        for(bin = 0; bin < Nbins; bin++)
-        {
-          if(eta > histos->at(bin).etamin && eta < histos->at(bin).etamax && pt > ptMin && pt < ptMax)
-          {
-            histos->at(bin).resolHist->Fill(recoMomentum.Pt() / bestGenMomentum.Pt());
-          }
-        }
+        histos->at(bin).resolHist->Fill(matches->ptRatio[i]);
       }
     }
   }
@@ -983,68 +980,26 @@ void GetPtresVsEta(std::vector<resolPlot> *histos, TClonesArray *branchReco, TCl
 template <typename T>
 void GetEresVsEta(std::vector<resolPlot> *histos, TClonesArray *branchReco, TClonesArray *branchParticle, int pdgID, Double_t eMin, Double_t eMax, ExRootTreeReader *treeReader)
 {
-  Long64_t allEntries = treeReader->GetEntries();
+  resolMatches *matches = GetResolMatches<T>(branchReco, branchParticle, pdgID, treeReader);
 
   cout << "** Computing E resolution of " << branchReco->GetName() << " induced by " << branchParticle->GetName() << " with PID " << pdgID << endl;
 
-  GenParticle *particle;
-  T *recoObj;
-
-  TLorentzVector recoMomentum, genMomentum, bestGenMomentum;
-
-  Float_t deltaR;
   Float_t e, eta;
-  Long64_t entry;
+  size_t i;
 
-  Int_t i, j, bin;
+  Int_t bin;
 
-  // Loop over all events
-  for(entry = 0; entry < allEntries; ++entry)
+  // Loop over all matched objects
+  for(i = 0; i < matches->genE.size(); ++i)
   {
-    // Load selected branches with data from specified event
-    treeReader->ReadEntry(entry);
+    e = matches->genE[i];
+    eta = matches->genEta[i];
 
-    // Loop over all reconstructed jets in event
-    for(i = 0; i < branchReco->GetEntriesFast(); ++i)
+    for(bin = 0; bin < Nbins; bin++)
     {
-      recoObj = (T *)branchReco->At(i);
-      recoMomentum = recoObj->P4();
-
-      deltaR = 999;
-
-      // Loop over all hard partons in event
-      for(j = 0; j < branchParticle->GetEntriesFast(); ++j)
-      {
-        particle = (GenParticle *)branchParticle->At(j);
-        if(particle->PID == pdgID && particle->Status == 1)
-        {
-          genMomentum = particle->P4();
-
-          // this is simply to avoid warnings from initial state particle
-          // having infite rapidity ...
-          if(genMomentum.Px() == 0 && genMomentum.Py() == 0) continue;
-
-          // take the closest parton candidate
-          if(genMomentum.DeltaR(recoMomentum) < deltaR)
-          {
-            deltaR = genMomentum.DeltaR(recoMomentum);
-            bestGenMomentum = genMomentum;
-          }
-        }
-      }
-
-      if(deltaR < 0.3)
+      if(eta > histos->at(bin).etamin && eta < histos->at(bin).etamax && e > eMin && e < eMax)
       {
-        e = bestGenMomentum.E();
-        eta = bestGenMomentum.Eta();
-
-        for(bin = 0; bin < Nbins; bin++)
-        {
-          if(eta > histos->at(bin).etamin && eta < histos->at(bin).etamax && e > eMin && e < eMax)
-          {
-            histos->at(bin).resolHist->Fill(recoMomentum.E() / bestGenMomentum.E());
-          }
-        }
+        histos->at(bin).resolHist->Fill(matches->eRatio[i]);
       }
     }
   }